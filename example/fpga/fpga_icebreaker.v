@@ -10,6 +10,9 @@
 module fpga_icebreaker #(
 	parameter        DPIDR              = 32'hdeadbeef,
 	parameter        TARGETID           = 32'hbaadf00d,
+	// Register slices on the DP's AP interface, for higher SWCLK Fmax:
+	parameter        REGISTER_AP_REQ    = 0,
+	parameter        REGISTER_AP_RESP   = 0,
 
 	parameter [10:0] IDR_DESIGNER       = 11'h7ff,
 	parameter [3:0]  IDR_REVISION       = 4'h0,
@@ -70,8 +73,10 @@ wire        ap_rdy;
 wire        ap_err;
 
 opendap_sw_dp #(
-	.DPIDR    (DPIDR),
-	.TARGETID (TARGETID)
+	.DPIDR            (DPIDR),
+	.TARGETID         (TARGETID),
+	.REGISTER_AP_REQ  (REGISTER_AP_REQ),
+	.REGISTER_AP_RESP (REGISTER_AP_RESP)
 ) dp (
 	.swclk        (swclk),
 	.rst_n        (rst_n_por),
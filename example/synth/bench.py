@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+
+# Synthesise and place each OpenDAP module on its own, for a list of
+# parameter combinations, and record LUT/FF counts and achieved Fmax per
+# clock domain. Uses yosys and nextpnr-ice40 targeting the iCEBreaker's
+# UP5K, so the numbers are comparable with the example FPGA build.
+#
+# Resource counts come from synthesising the module by itself. Fmax comes
+# from placing the module inside a small harness, which feeds every input
+# from a shift register and registers every output, so that the module's
+# own paths are timed flop-to-flop without needing a pin for every port.
+#
+# Usage (after sourcing ../../sourceme):
+#
+#   ./bench.py                         # all configs, write bench_results.tsv
+#   ./bench.py -k sw_dp                # only configs whose name contains sw_dp
+#   ./bench.py --compare old.tsv       # also print deltas against old results
+#
+# Results are tab-separated, one row per (config, clock). The git revision
+# is recorded on every row, so results from different revisions can be
+# concatenated and compared.
+
+import argparse
+import concurrent.futures
+import json
+import os
+import re
+import subprocess
+import sys
+
+HDL = os.environ.get("HDL", os.path.join(os.path.dirname(os.path.abspath(__file__)), "../../hdl"))
+
+# ----------------------------------------------------------------------------
+# Configurations
+
+# Each module has a file list, a list of clocks, and a rule for which clock
+# each data port belongs to (first matching prefix, else the first clock).
+# Inputs named rst_n* are driven directly from a pin.
+
+MODULES = {
+	"opendap_sw_dp": {
+		"dotf":   "opendap_sw_dp.f",
+		"clocks": ["swclk"],
+		"domain": {},
+	},
+	"opendap_sw_dp_sysclk": {
+		"dotf":   "opendap_sw_dp_sysclk.f",
+		"clocks": ["clk"],
+		# swclk is just another (asynchronous) input here.
+		"domain": {},
+	},
+	"opendap_mem_ap_apb": {
+		"dotf":   "opendap_mem_ap_apb.f",
+		"clocks": ["swclk", "clk_dst"],
+		"domain": {"dst_": "clk_dst"},
+	},
+	"opendap_apb_async_bridge": {
+		"dotf":   "opendap_mem_ap_apb.f",
+		"clocks": ["clk_src", "clk_dst"],
+		"domain": {"src_": "clk_src", "dst_": "clk_dst"},
+	},
+	"opendap_ap_mux": {
+		"dotf":   "opendap_ap_mux.f",
+		"clocks": ["swclk"],
+		"domain": {},
+	},
+	"opendap_trace_ap": {
+		"dotf":   "opendap_trace_ap.f",
+		"clocks": ["swclk", "clk_trace"],
+		"domain": {"trace_": "clk_trace"},
+	},
+	"opendap_mailbox_ap": {
+		"dotf":   "opendap_mailbox_ap.f",
+		"clocks": ["swclk", "clk_tgt"],
+		"domain": {"tgt_": "clk_tgt"},
+	},
+	"opendap_reg_window_ap": {
+		"dotf":   "opendap_reg_window_ap.f",
+		"clocks": ["swclk", "clk_dst"],
+		"domain": {"dst_": "clk_dst"},
+	},
+	"opendap_rom_table": {
+		"dotf":   "opendap_rom_table.f",
+		"clocks": ["clk"],
+		"domain": {},
+	},
+}
+
+def config(name, module, params={}, tie={}):
+	return {"name": name, "module": module, "params": params, "tie": tie}
+
+CONFIGS = [
+	config("sw_dp_mindp",              "opendap_sw_dp", {"MINDP": 1}),
+	config("sw_dp_full",               "opendap_sw_dp", {"MINDP": 0}),
+	config("sw_dp_mindp_regreq",       "opendap_sw_dp", {"MINDP": 1, "REGISTER_AP_REQ": 1}),
+	config("sw_dp_mindp_regresp",      "opendap_sw_dp", {"MINDP": 1, "REGISTER_AP_RESP": 1}),
+	config("sw_dp_mindp_regboth",      "opendap_sw_dp", {"MINDP": 1, "REGISTER_AP_REQ": 1, "REGISTER_AP_RESP": 1}),
+	config("sw_dp_full_regboth",       "opendap_sw_dp", {"MINDP": 0, "REGISTER_AP_REQ": 1, "REGISTER_AP_RESP": 1}),
+
+	config("sw_dp_sysclk_sync2",       "opendap_sw_dp_sysclk", {"N_SYNC_STAGES": 2}),
+	config("sw_dp_sysclk_sync3",       "opendap_sw_dp_sysclk", {"N_SYNC_STAGES": 3}),
+	config("sw_dp_sysclk_full",        "opendap_sw_dp_sysclk", {"MINDP": 0}),
+
+	config("mem_ap_tarinc10",          "opendap_mem_ap_apb", {"TAR_INCREMENT_BITS": 10}),
+	config("mem_ap_tarinc12",          "opendap_mem_ap_apb", {"TAR_INCREMENT_BITS": 12}),
+	config("mem_ap_tarinc32",          "opendap_mem_ap_apb", {"TAR_INCREMENT_BITS": 32}),
+	config("mem_ap_sync3",             "opendap_mem_ap_apb", {"N_SYNC_STAGES": 3}),
+	config("mem_ap_sync0",             "opendap_mem_ap_apb", {"N_SYNC_STAGES": 0}, tie={"clk_dst": "swclk"}),
+	config("mem_ap_timeout256",        "opendap_mem_ap_apb", {"DST_TIMEOUT_CYCLES": 256}),
+	config("mem_ap_engine",            "opendap_mem_ap_apb", {"MEM_ENGINE": 1}),
+	config("mem_ap_stride",            "opendap_mem_ap_apb", {"TAR_STRIDE": 1}),
+	config("mem_ap_stride_2d",         "opendap_mem_ap_apb", {"TAR_STRIDE": 1, "TAR_2D": 1}),
+	config("mem_ap_atomic",            "opendap_mem_ap_apb", {"ATOMIC_ALIASES": 1}),
+
+	config("bridge_sync2",             "opendap_apb_async_bridge", {"W_ADDR": 32, "N_SYNC_STAGES": 2}),
+	config("bridge_sync3",             "opendap_apb_async_bridge", {"W_ADDR": 32, "N_SYNC_STAGES": 3}),
+	config("bridge_sync0",             "opendap_apb_async_bridge", {"W_ADDR": 32, "N_SYNC_STAGES": 0}, tie={"clk_dst": "clk_src"}),
+	config("bridge_timeout256",        "opendap_apb_async_bridge", {"W_ADDR": 32, "DST_TIMEOUT_CYCLES": 256}),
+	config("bridge_rmw",               "opendap_apb_async_bridge", {"W_ADDR": 32, "RMW": 1}),
+
+	config("ap_mux_2",                 "opendap_ap_mux", {"N_APS": 2}),
+	config("ap_mux_8",                 "opendap_ap_mux", {"N_APS": 8}),
+	config("ap_mux_8_regboth",         "opendap_ap_mux", {"N_APS": 8, "REGISTER_REQ": 1, "REGISTER_RESP": 1}),
+
+	config("trace_ap_512",             "opendap_trace_ap", {"LOG2_DEPTH": 9}),
+	config("trace_ap_2k",              "opendap_trace_ap", {"LOG2_DEPTH": 11}),
+	config("trace_ap_512_sync0",       "opendap_trace_ap", {"LOG2_DEPTH": 9, "N_SYNC_STAGES": 0}, tie={"clk_trace": "swclk"}),
+
+	config("mailbox_ap_8_32",          "opendap_mailbox_ap", {"LOG2_H2T_DEPTH": 3, "LOG2_T2H_DEPTH": 5}),
+	config("mailbox_ap_8_32_sync0",    "opendap_mailbox_ap", {"LOG2_H2T_DEPTH": 3, "LOG2_T2H_DEPTH": 5, "N_SYNC_STAGES": 0}, tie={"clk_tgt": "swclk"}),
+
+	config("reg_window_ap",            "opendap_reg_window_ap"),
+	config("reg_window_ap_sync0",      "opendap_reg_window_ap", {"N_SYNC_STAGES": 0}, tie={"clk_dst": "swclk"}),
+
+	config("rom_table_4",              "opendap_rom_table", {"N_COMPONENTS": 4}),
+	config("rom_table_64",             "opendap_rom_table", {"N_COMPONENTS": 64}),
+]
+
+DEVICE = "up5k"
+PACKAGE = "sg48"
+# Placement target. Set high so nextpnr works hard on every design; the
+# achieved Fmax is what we record.
+TARGET_FREQ_MHZ = 100
+
+# ----------------------------------------------------------------------------
+# Flow
+
+def run(cmd, cwd, log):
+	with open(os.path.join(cwd, log), "w") as f:
+		subprocess.run(cmd, cwd=cwd, stdout=f, stderr=subprocess.STDOUT, check=True)
+
+def listfiles(dotf):
+	out = subprocess.run(["listfiles", os.path.join(HDL, dotf)], check=True,
+		stdout=subprocess.PIPE, universal_newlines=True).stdout
+	return out.split()
+
+def chparam_cmd(module, params):
+	if not params:
+		return ""
+	return "chparam " + " ".join(f"-set {k} {v}" for k, v in params.items()) + f" {module}; "
+
+def get_ports(cfg, workdir, srcs):
+	jfile = "ports.json"
+	run(["yosys", "-p",
+		f"read_verilog -I {HDL} {' '.join(srcs)}; " +
+		chparam_cmd(cfg["module"], cfg["params"]) +
+		f"hierarchy -top {cfg['module']}; proc; write_json {jfile}"
+	], workdir, "ports.log")
+	with open(os.path.join(workdir, jfile)) as f:
+		ports = json.load(f)["modules"][cfg["module"]]["ports"]
+	return [(name, p["direction"], len(p["bits"])) for name, p in ports.items()]
+
+def port_clock(mod, cfg, name):
+	for prefix, clk in mod["domain"].items():
+		if name.startswith(prefix):
+			return cfg["tie"].get(clk, clk)
+	return cfg["tie"].get(mod["clocks"][0], mod["clocks"][0])
+
+def write_harness(cfg, ports, path):
+	mod = MODULES[cfg["module"]]
+	clocks = [c for c in mod["clocks"] if c not in cfg["tie"]]
+	ins = {c: [] for c in clocks}
+	outs = {c: [] for c in clocks}
+	conns = []
+	for name, direction, width in ports:
+		if name in mod["clocks"]:
+			conns.append((name, cfg["tie"].get(name, name)))
+		elif direction == "input" and name.startswith("rst_n"):
+			conns.append((name, "rst_n"))
+		elif direction == "input":
+			ins[port_clock(mod, cfg, name)].append((name, width))
+			conns.append((name, f"in_{name}"))
+		else:
+			outs[port_clock(mod, cfg, name)].append((name, width))
+			conns.append((name, f"out_{name}"))
+
+	v = []
+	v.append("module bench_harness (")
+	v.append("\tinput wire rst_n,")
+	for c in clocks:
+		v.append(f"\tinput wire {c},")
+		v.append(f"\tinput wire din_{c},")
+		v.append(f"\toutput reg dout_{c},")
+	v[-1] = v[-1].rstrip(",")
+	v.append(");")
+	for c in clocks:
+		n_in = sum(w for _, w in ins[c])
+		n_out = sum(w for _, w in outs[c])
+		if n_in:
+			v.append(f"reg [{n_in - 1}:0] in_sreg_{c};")
+			v.append(f"always @ (posedge {c}) in_sreg_{c} <= {{in_sreg_{c}, din_{c}}};")
+			lsb = 0
+			for name, w in ins[c]:
+				v.append(f"wire [{w - 1}:0] in_{name} = in_sreg_{c}[{lsb + w - 1}:{lsb}];")
+				lsb += w
+		for name, w in outs[c]:
+			v.append(f"wire [{w - 1}:0] out_{name};")
+		if n_out:
+			v.append(f"reg [{n_out - 1}:0] out_reg_{c};")
+			v.append(f"always @ (posedge {c}) out_reg_{c} <= {{{', '.join('out_' + n for n, _ in outs[c])}}};")
+			v.append(f"always @ (posedge {c}) dout_{c} <= ^out_reg_{c};")
+		else:
+			v.append(f"always @ (posedge {c}) dout_{c} <= 1'b0;")
+	v.append(f"{cfg['module']} dut (")
+	v.append(",\n".join(f"\t.{p} ({s})" for p, s in conns))
+	v.append(");")
+	v.append("endmodule")
+	with open(path, "w") as f:
+		f.write("\n".join(v) + "\n")
+
+def parse_stat(logfile):
+	# Take the last stat block in the log, which is the one after synthesis.
+	cells = {}
+	with open(logfile) as f:
+		for line in f:
+			if "Number of cells:" in line:
+				cells = {}
+			m = re.match(r"\s+(SB_\w+)\s+(\d+)\s*$", line)
+			if m:
+				cells[m.group(1)] = int(m.group(2))
+	return {
+		"luts":   cells.get("SB_LUT4", 0),
+		"ffs":    sum(n for c, n in cells.items() if c.startswith("SB_DFF")),
+		"carrys": cells.get("SB_CARRY", 0),
+		"brams":  cells.get("SB_RAM40_4K", 0),
+	}
+
+def bench_one(cfg, builddir):
+	workdir = os.path.join(builddir, cfg["name"])
+	os.makedirs(workdir, exist_ok=True)
+	mod = MODULES[cfg["module"]]
+	srcs = [os.path.abspath(s) for s in listfiles(mod["dotf"])]
+	read = f"read_verilog -I {HDL} {' '.join(srcs)}; " + chparam_cmd(cfg["module"], cfg["params"])
+
+	# Resources: module by itself
+	run(["yosys", "-p", read + f"synth_ice40 -top {cfg['module']}; stat"], workdir, "synth_module.log")
+	res = parse_stat(os.path.join(workdir, "synth_module.log"))
+
+	# Fmax: module inside harness
+	ports = get_ports(cfg, workdir, srcs)
+	write_harness(cfg, ports, os.path.join(workdir, "bench_harness.v"))
+	run(["yosys", "-p", read + "read_verilog bench_harness.v; synth_ice40 -top bench_harness -json harness.json"],
+		workdir, "synth_harness.log")
+	run(["nextpnr-ice40", f"--{DEVICE}", "--package", PACKAGE, "--json", "harness.json",
+		"--pcf-allow-unconstrained", "--freq", str(TARGET_FREQ_MHZ), "--timing-allow-fail",
+		"--report", "report.json"], workdir, "pnr.log")
+	with open(os.path.join(workdir, "report.json")) as f:
+		fmax = json.load(f).get("fmax", {})
+
+	rows = []
+	for clk in [c for c in mod["clocks"] if c not in cfg["tie"]]:
+		# nextpnr names clock nets after the promoted global buffer, e.g.
+		# "swclk$SB_IO_IN_$glb_clk", so match on the port name prefix.
+		achieved = [v["achieved"] for k, v in fmax.items() if k == clk or k.startswith(clk + "$")]
+		rows.append(dict(res, clock=clk, fmax=achieved[0] if achieved else float("nan")))
+	return rows
+
+def git_rev():
+	try:
+		return subprocess.run(["git", "describe", "--always", "--dirty"], check=True,
+			stdout=subprocess.PIPE, universal_newlines=True).stdout.strip()
+	except (OSError, subprocess.CalledProcessError):
+		return "unknown"
+
+COLUMNS = ["rev", "config", "module", "params", "clock", "fmax_mhz", "luts", "ffs", "carrys", "brams"]
+
+def read_results(path):
+	with open(path) as f:
+		lines = [l.rstrip("\n").split("\t") for l in f if l.strip()]
+	hdr = lines[0]
+	return {(r[hdr.index("config")], r[hdr.index("clock")]): dict(zip(hdr, r)) for r in lines[1:]}
+
+def main():
+	parser = argparse.ArgumentParser(description="Per-module Fmax and resource benchmark")
+	parser.add_argument("-k", "--filter", default="", help="only run configs whose name contains this")
+	parser.add_argument("-o", "--out", default="bench_results.tsv", help="results file")
+	parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="parallel jobs")
+	parser.add_argument("--builddir", default="bench_build")
+	parser.add_argument("--compare", help="previous results file to compare against")
+	args = parser.parse_args()
+
+	configs = [c for c in CONFIGS if args.filter in c["name"]]
+	rev = git_rev()
+	results = {}
+	with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+		futures = {pool.submit(bench_one, c, args.builddir): c for c in configs}
+		for fut in concurrent.futures.as_completed(futures):
+			c = futures[fut]
+			try:
+				results[c["name"]] = fut.result()
+				print(f"Done: {c['name']}")
+			except subprocess.CalledProcessError as e:
+				print(f"FAILED: {c['name']} (see {os.path.join(args.builddir, c['name'])}): {e}", file=sys.stderr)
+
+	with open(args.out, "w") as f:
+		f.write("\t".join(COLUMNS) + "\n")
+		for c in configs:
+			for r in results.get(c["name"], []):
+				params = ",".join(f"{k}={v}" for k, v in c["params"].items()) or "-"
+				f.write("\t".join(str(x) for x in [
+					rev, c["name"], c["module"], params, r["clock"], f"{r['fmax']:.2f}",
+					r["luts"], r["ffs"], r["carrys"], r["brams"]
+				]) + "\n")
+
+	old = read_results(args.compare) if args.compare else {}
+	print(f"{'config':<28}{'clock':<10}{'Fmax MHz':>10}{'LUTs':>8}{'FFs':>8}")
+	for c in configs:
+		for r in results.get(c["name"], []):
+			line = f"{c['name']:<28}{r['clock']:<10}{r['fmax']:>10.2f}{r['luts']:>8}{r['ffs']:>8}"
+			prev = old.get((c["name"], r["clock"]))
+			if prev:
+				line += "   (was {:.2f} MHz, {} LUTs, {} FFs)".format(
+					float(prev["fmax_mhz"]), prev["luts"], prev["ffs"])
+			print(line)
+
+	return 0 if len(results) == len(configs) else 1
+
+if __name__ == "__main__":
+	sys.exit(main())
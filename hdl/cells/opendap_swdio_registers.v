@@ -10,6 +10,10 @@
 // specific to your FPGA/process, or replace it with passthrough wires so
 // that you can instantiate a registered IO cell at a higher hierarchy
 // level.
+//
+// clk_en is tied high when the DP is clocked directly by SWCLK, so a plain
+// IO register is fine there. The oversampled DP uses it to update the
+// registers once per SWCLK rising edge.
 
 `ifndef OPENDAP_REG_KEEP_ATTRIBUTE
 `define OPENDAP_REG_KEEP_ATTRIBUTE (* keep = 1'b1 *)
@@ -19,6 +23,7 @@
 
 module opendap_swdio_flops (
 	input  wire clk,
+	input  wire clk_en,
 	input  wire rst_n,
 
 	// DP-facing signals
@@ -41,7 +46,7 @@ always @ (posedge clk or negedge rst_n) begin
 		swdi_reg <= 1'b0;
 		swdo_reg <= 1'b0;
 		swdo_en_reg <= 1'b0;
-	end else begin
+	end else if (clk_en) begin
 		swdi_reg <= pad_swdi;
 		swdo_reg <= dp_swdo_next;
 		swdo_en_reg <= dp_swdo_en_next;
@@ -0,0 +1 @@
+file opendap_ap_mux.v
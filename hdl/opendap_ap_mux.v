@@ -0,0 +1,191 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// Connect one DP to multiple APs. Decodes APSEL to route accesses to AP
+// ports 0 through N_APS - 1, and muxes the responses back. Accesses to any
+// other APSEL are RAZ/WI, which is how the host finds the end of the AP list
+// (IDR reads as zero).
+//
+// Both sides of this module follow the AP interface described in
+// opendap_sw_dp_core.v. Optional register slices can be added on the request
+// and/or response paths, at a cost of one cycle of AP latency each.
+
+`default_nettype none
+
+module opendap_ap_mux #(
+	parameter N_APS         = 2,
+	// Register wen/ren/addr/wdata on their way to the APs:
+	parameter REGISTER_REQ  = 0,
+	// Register rdata/rdy/err on their way back to the DP:
+	parameter REGISTER_RESP = 0
+) (
+	input  wire                swclk,
+	input  wire                rst_n,
+
+	// From DP
+	input  wire [7:0]          dpacc_sel,
+	input  wire [5:0]          dpacc_addr,
+	input  wire [31:0]         dpacc_wdata,
+	input  wire                dpacc_wen,
+	input  wire                dpacc_ren,
+	input  wire                dpacc_abort,
+	output wire [31:0]         dpacc_rdata,
+	output wire                dpacc_rdy,
+	output wire                dpacc_err,
+
+	// To APs. addr, wdata and abort are common to all APs.
+	output wire [5:0]          ap_addr,
+	output wire [31:0]         ap_wdata,
+	output wire [N_APS-1:0]    ap_wen,
+	output wire [N_APS-1:0]    ap_ren,
+	output wire                ap_abort,
+	input  wire [N_APS*32-1:0] ap_rdata,
+	input  wire [N_APS-1:0]    ap_rdy,
+	input  wire [N_APS-1:0]    ap_err
+);
+
+// ----------------------------------------------------------------------------
+// Request path
+
+wire [N_APS-1:0] sel_onehot;
+
+genvar g;
+generate
+for (g = 0; g < N_APS; g = g + 1) begin: sel_decode
+	assign sel_onehot[g] = dpacc_sel == g;
+end
+endgenerate
+
+// DAPABORT is never registered: the DP requires rdy to go high on the cycle
+// after abort, and it is harmless to broadcast it to every AP.
+assign ap_abort = dpacc_abort;
+
+// High when a request is sitting in the request slice, and has not yet
+// reached its AP. The AP's own rdy doesn't reflect the request yet, so we
+// must hold rdy low on its behalf.
+wire req_in_slice;
+
+generate
+if (REGISTER_REQ) begin: req_slice
+
+	reg [5:0]       addr_r;
+	reg [31:0]      wdata_r;
+	reg [N_APS-1:0] wen_r;
+	reg [N_APS-1:0] ren_r;
+
+	always @ (posedge swclk or negedge rst_n) begin
+		if (!rst_n) begin
+			addr_r <= 6'h0;
+			wdata_r <= 32'h0;
+			wen_r <= {N_APS{1'b0}};
+			ren_r <= {N_APS{1'b0}};
+		end else begin
+			wen_r <= sel_onehot & {N_APS{dpacc_wen}};
+			ren_r <= sel_onehot & {N_APS{dpacc_ren}};
+			if (dpacc_wen || dpacc_ren) begin
+				addr_r <= dpacc_addr;
+				wdata_r <= dpacc_wdata;
+			end
+		end
+	end
+
+	assign ap_addr = addr_r;
+	assign ap_wdata = wdata_r;
+	assign ap_wen = wen_r;
+	assign ap_ren = ren_r;
+	assign req_in_slice = |{wen_r, ren_r};
+
+end else begin: no_req_slice
+
+	assign ap_addr = dpacc_addr;
+	assign ap_wdata = dpacc_wdata;
+	assign ap_wen = sel_onehot & {N_APS{dpacc_wen}};
+	assign ap_ren = sel_onehot & {N_APS{dpacc_ren}};
+	assign req_in_slice = 1'b0;
+
+end
+endgenerate
+
+// ----------------------------------------------------------------------------
+// Response path
+
+// Responses come from whichever AP was most recently accessed. The DP
+// interface only requires rdata to be held until the next wen/ren, so there
+// is no need to distinguish reads from writes here. No bits set means the
+// last access was to a nonexistent AP.
+
+reg [N_APS-1:0] acc_onehot;
+
+always @ (posedge swclk or negedge rst_n) begin
+	if (!rst_n) begin
+		acc_onehot <= {N_APS{1'b0}};
+	end else if (dpacc_wen || dpacc_ren) begin
+		acc_onehot <= sel_onehot;
+	end
+end
+
+reg [31:0] rdata_muxed;
+reg        rdy_muxed;
+reg        err_muxed;
+
+integer i;
+always @ (*) begin
+	rdata_muxed = 32'h0;
+	rdy_muxed = !req_in_slice;
+	err_muxed = 1'b0;
+	for (i = 0; i < N_APS; i = i + 1) begin
+		rdata_muxed = rdata_muxed | (ap_rdata[i * 32 +: 32] & {32{acc_onehot[i]}});
+		rdy_muxed = rdy_muxed && (ap_rdy[i] || !acc_onehot[i]);
+		err_muxed = err_muxed || (ap_err[i] && acc_onehot[i]);
+	end
+end
+
+generate
+if (REGISTER_RESP) begin: resp_slice
+
+	reg [31:0] rdata_r;
+	reg        rdy_r;
+	reg        err_r;
+
+	always @ (posedge swclk or negedge rst_n) begin
+		if (!rst_n) begin
+			rdata_r <= 32'h0;
+			rdy_r <= 1'b1;
+			err_r <= 1'b0;
+		end else begin
+			rdata_r <= rdata_muxed;
+			if (dpacc_abort) begin
+				rdy_r <= 1'b1;
+				err_r <= 1'b0;
+			end else if (dpacc_wen || dpacc_ren) begin
+				// The AP can't have seen this access yet, so we must drop rdy
+				// on the next cycle ourselves.
+				rdy_r <= 1'b0;
+				err_r <= 1'b0;
+			end else begin
+				rdy_r <= rdy_muxed;
+				err_r <= err_muxed && rdy_muxed;
+			end
+		end
+	end
+
+	assign dpacc_rdata = rdata_r;
+	assign dpacc_rdy = rdy_r;
+	assign dpacc_err = err_r;
+
+end else begin: no_resp_slice
+
+	assign dpacc_rdata = rdata_muxed;
+	assign dpacc_rdy = rdy_muxed;
+	assign dpacc_err = err_muxed;
+
+end
+endgenerate
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
@@ -18,7 +18,21 @@
 module opendap_apb_async_bridge #(
 	parameter W_ADDR = 8,
 	parameter W_DATA = 32,
-	parameter N_SYNC_STAGES = 2
+	// Set to 0 if clk_src and clk_dst are the same clock. The handshake still
+	// runs, but without synchronisers, which saves 2 * N_SYNC_STAGES cycles of
+	// latency per transfer.
+	parameter N_SYNC_STAGES = 2,
+	// If nonzero, a dst transfer which spends this many cycles in its access
+	// phase without pready is terminated with an error. Note this violates
+	// APB (psel is removed before pready) so is a last resort for slaves
+	// which may never respond. src_abort terminates a transfer the same way,
+	// whatever this is set to.
+	parameter DST_TIMEOUT_CYCLES = 0,
+	// If nonzero, measure the length of each dst transfer in clk_dst cycles,
+	// and return it to src alongside the transfer's response.
+	parameter MEASURE_XFER_CYCLES = 0,
+	// If nonzero, support read-modify-write transfers (src_rmw_op).
+	parameter RMW = 0
 ) (
 	// Resets assumed to be synchronised externally
 	input wire               clk_src,
@@ -37,6 +51,28 @@ module opendap_apb_async_bridge #(
 	output wire              src_pready,
 	output wire              src_pslverr,
 
+	// Read-modify-write, sampled alongside paddr and only valid for writes.
+	// 0 is a plain write. Otherwise dst reads the word at paddr, then writes
+	// back the old value with pwdata set (1), cleared (2) or toggled (3).
+	// Both transfers happen within the one src transfer, so nothing can get
+	// in between them on the src side. A read error skips the write.
+	input  wire [1:0]        src_rmw_op,
+
+	// Abandon the current src transfer: pready goes high on the next cycle.
+	// The downstream transfer is allowed to drain out in the background, and
+	// src_busy stays high until it has done so. If the dst slave is still
+	// stalling the access phase once the abort has crossed into clk_dst, the
+	// transfer is terminated there as for DST_TIMEOUT_CYCLES, so a slave
+	// which never responds can't hold src_busy high forever.
+	input  wire              src_abort,
+	output wire              src_busy,
+
+	// Pulses for one clk_src cycle when a transfer completes (not including
+	// aborted transfers), along with the number of clk_dst cycles it spent
+	// on the dst bus (setup phase plus access phase). Saturates at all-ones.
+	output wire              src_xfer_done,
+	output wire [15:0]       src_xfer_cycles,
+
 	// APB port to Debug Module
 	output wire              dst_psel,
 	output wire              dst_penable,
@@ -81,40 +117,63 @@ wire                                                       src_ack;
 `OPENDAP_REG_KEEP_ATTRIBUTE reg [W_ADDR + W_DATA + 1 -1:0] src_paddr_pwdata_pwrite; // launch
 `OPENDAP_REG_KEEP_ATTRIBUTE reg [W_ADDR + W_DATA + 1 -1:0] dst_paddr_pwdata_pwrite; // capture
 
+`OPENDAP_REG_KEEP_ATTRIBUTE reg [1:0]                      src_rmw_op_r;            // launch
+`OPENDAP_REG_KEEP_ATTRIBUTE reg [1:0]                      dst_rmw_op_r;            // capture
+
 `OPENDAP_REG_KEEP_ATTRIBUTE reg [W_DATA + 1 -1:0]          dst_prdata_pslverr;      // launch
 `OPENDAP_REG_KEEP_ATTRIBUTE reg [W_DATA + 1 -1:0]          src_prdata_pslverr;      // capture
 
-opendap_sync_1bit #(
-	.N_STAGES (N_SYNC_STAGES)
-) sync_req (
-	.clk   (clk_dst),
-	.rst_n (rst_n_dst),
-	.i     (src_req),
-	.o     (dst_req)
-);
+generate
+if (N_SYNC_STAGES == 0) begin: no_sync
 
-opendap_sync_1bit #(
-	.N_STAGES (N_SYNC_STAGES)
-) sync_ack (
-	.clk   (clk_src),
-	.rst_n (rst_n_src),
-	.i     (dst_ack),
-	.o     (src_ack)
-);
+	assign dst_req = src_req;
+	assign src_ack = dst_ack;
+
+end else begin: sync
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_req (
+		.clk   (clk_dst),
+		.rst_n (rst_n_dst),
+		.i     (src_req),
+		.o     (dst_req)
+	);
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_ack (
+		.clk   (clk_src),
+		.rst_n (rst_n_src),
+		.i     (dst_ack),
+		.o     (src_ack)
+	);
+
+end
+endgenerate
 
 // ----------------------------------------------------------------------------
 // src state machine
 
 reg src_waiting_for_downstream;
 reg src_pready_r;
+`OPENDAP_REG_KEEP_ATTRIBUTE reg src_aborted;
 
 always @ (posedge clk_src or negedge rst_n_src) begin
 	if (!rst_n_src) begin
 		src_req <= 1'b0;
 		src_waiting_for_downstream <= 1'b0;
+		src_aborted <= 1'b0;
 		src_prdata_pslverr <= {W_DATA + 1{1'b0}};
 		src_pready_r <= 1'b1;
 	end else if (src_waiting_for_downstream) begin
+		if (src_abort) begin
+			// Release the upstream bus now, but keep running the handshake
+			// until the downstream transfer completes. Dropping req early
+			// would let a new transfer overtake the old one in dst.
+			src_pready_r <= 1'b1;
+			src_aborted <= 1'b1;
+		end
 		if (src_req && src_ack) begin
 			// Request was acknowledged, so deassert.
 			src_req <= 1'b0;
@@ -122,9 +181,18 @@ always @ (posedge clk_src or negedge rst_n_src) begin
 			// Downstream transfer has finished, data is valid.
 			src_pready_r <= 1'b1;
 			src_waiting_for_downstream <= 1'b0;
+			src_aborted <= 1'b0;
 			// Note this assignment is cross-domain (but data has been stable
-			// for duration of ack synchronisation delay):
-			src_prdata_pslverr <= dst_prdata_pslverr;
+			// for duration of ack synchronisation delay). The response to an
+			// aborted transfer is discarded.
+			if (!(src_aborted || src_abort))
+				src_prdata_pslverr <= dst_prdata_pslverr;
+		end
+		if (src_aborted && src_psel) begin
+			// New transfer whilst still draining an aborted one: we can't
+			// launch it safely, and the old transfer may never finish, so
+			// fail it immediately rather than stalling.
+			src_prdata_pslverr <= {{W_DATA{1'b0}}, 1'b1};
 		end
 	end else begin
 		// paddr, pwdata and pwrite are all valid during the setup phase, and
@@ -140,19 +208,43 @@ end
 
 // Bus request launch register is not resettable
 always @ (posedge clk_src) begin
-	if (src_psel && !src_waiting_for_downstream)
+	if (src_psel && !src_waiting_for_downstream) begin
 		src_paddr_pwdata_pwrite <= {src_paddr, src_pwdata, src_pwrite};
+		src_rmw_op_r <= RMW && src_pwrite ? src_rmw_op : 2'h0;
+	end
 end
 
+// Same condition as the src_prdata_pslverr capture above
+wire src_xfer_finish = src_waiting_for_downstream && !(src_req || src_ack) &&
+	!(src_aborted || src_abort);
+
 assign {src_prdata, src_pslverr} = src_prdata_pslverr;
 assign src_pready = src_pready_r;
+assign src_busy = src_waiting_for_downstream;
 
 // ----------------------------------------------------------------------------
 // dst state machine
 
 wire dst_bus_finish = dst_penable && dst_pready;
+wire dst_timeout;
+wire dst_abort;
+// Either ends a stalled access phase early, with an error
+wire dst_bus_kill = dst_timeout || dst_abort;
 reg dst_psel_r;
 reg dst_penable_r;
+// In the read half of a read-modify-write
+reg dst_rmw_read;
+
+wire [W_DATA-1:0] dst_rmw_wdata = dst_paddr_pwdata_pwrite[W_DATA:1];
+reg  [W_DATA-1:0] dst_rmw_result;
+
+always @ (*) begin
+	case (dst_rmw_op_r)
+	2'h1:    dst_rmw_result = dst_prdata | dst_rmw_wdata;
+	2'h2:    dst_rmw_result = dst_prdata & ~dst_rmw_wdata;
+	default: dst_rmw_result = dst_prdata ^ dst_rmw_wdata;
+	endcase
+end
 
 always @ (posedge clk_dst or negedge rst_n_dst) begin
 	if (!rst_n_dst) begin
@@ -168,16 +260,26 @@ always @ (posedge clk_dst or negedge rst_n_dst) begin
 	if (!rst_n_dst) begin
 		dst_psel_r <= 1'b0;
 		dst_penable_r <= 1'b0;
+		dst_rmw_read <= 1'b0;
 	end else if (dst_req && !dst_ack) begin
 		dst_psel_r <= 1'b1;
-		// Note this assignment is cross-domain. The src register has been
-		// stable for the duration of the req sync delay.
+		// Note these assignments are cross-domain. The src registers have
+		// been stable for the duration of the req sync delay.
 		dst_paddr_pwdata_pwrite <= src_paddr_pwdata_pwrite;
+		dst_rmw_op_r <= src_rmw_op_r;
+		dst_rmw_read <= |src_rmw_op_r;
 	end else if (dst_psel_r && !dst_penable_r) begin
 		dst_penable_r <= 1'b1;
-	end else if (dst_bus_finish) begin
+	end else if (dst_bus_finish && dst_rmw_read && !dst_pslverr) begin
+		// Read half done: go straight to the setup phase of the write half,
+		// with the modified data.
+		dst_penable_r <= 1'b0;
+		dst_rmw_read <= 1'b0;
+		dst_paddr_pwdata_pwrite[W_DATA:1] <= dst_rmw_result;
+	end else if (dst_bus_finish || dst_bus_kill) begin
 		dst_psel_r <= 1'b0;
 		dst_penable_r <= 1'b0;
+		dst_rmw_read <= 1'b0;
 	end
 end
 
@@ -185,11 +287,122 @@ end
 always @ (posedge clk_dst) begin
 	if (dst_bus_finish)
 		dst_prdata_pslverr <= {dst_prdata, dst_pslverr};
+	else if (dst_bus_kill)
+		dst_prdata_pslverr <= {{W_DATA{1'b0}}, 1'b1};
+end
+
+// Optional access phase watchdog
+
+localparam W_TIMEOUT_CTR = DST_TIMEOUT_CYCLES > 1 ? $clog2(DST_TIMEOUT_CYCLES) : 1;
+
+generate
+if (DST_TIMEOUT_CYCLES == 0) begin: no_timeout
+
+	assign dst_timeout = 1'b0;
+
+end else begin: has_timeout
+
+	reg [W_TIMEOUT_CTR-1:0] dst_timeout_ctr;
+
+	always @ (posedge clk_dst or negedge rst_n_dst) begin
+		if (!rst_n_dst) begin
+			dst_timeout_ctr <= {W_TIMEOUT_CTR{1'b0}};
+		end else if (!dst_penable_r) begin
+			dst_timeout_ctr <= DST_TIMEOUT_CYCLES - 1;
+		end else begin
+			dst_timeout_ctr <= dst_timeout_ctr - |dst_timeout_ctr;
+		end
+	end
+
+	assign dst_timeout = dst_penable_r && !dst_pready && ~|dst_timeout_ctr;
+
+end
+endgenerate
+
+// Abort. src_aborted is high from the abort until src sees the handshake
+// finish, and is synchronised into dst like req. It terminates only an
+// access phase, so can't hit the next transfer: src_aborted falls at least a
+// cycle before src can raise req again, and dst only reaches the access
+// phase two cycles after it sees req.
+
+wire dst_src_aborted;
+
+generate
+if (N_SYNC_STAGES == 0) begin: no_sync_abort
+
+	assign dst_src_aborted = src_aborted;
+
+end else begin: sync_abort
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_abort (
+		.clk   (clk_dst),
+		.rst_n (rst_n_dst),
+		.i     (src_aborted),
+		.o     (dst_src_aborted)
+	);
+
+end
+endgenerate
+
+assign dst_abort = dst_penable_r && !dst_pready && dst_src_aborted;
+
+// Optional transfer length measurement. The count travels back to src the
+// same way as the read data: a non-resettable launch register in dst, which
+// is stable by the time src captures it.
+
+generate
+if (MEASURE_XFER_CYCLES == 0) begin: no_measure
+
+	assign src_xfer_done = 1'b0;
+	assign src_xfer_cycles = 16'h0;
+
+end else begin: measure
+
+	reg [15:0]                             dst_xfer_ctr;
+	`OPENDAP_REG_KEEP_ATTRIBUTE reg [15:0] dst_xfer_cycles; // launch
+	`OPENDAP_REG_KEEP_ATTRIBUTE reg [15:0] src_xfer_cycles_r; // capture
+	reg                                    src_xfer_done_r;
+
+	always @ (posedge clk_dst or negedge rst_n_dst) begin
+		if (!rst_n_dst) begin
+			dst_xfer_ctr <= 16'h0;
+		end else if (dst_req && !dst_ack) begin
+			dst_xfer_ctr <= 16'h1;
+		end else if (dst_psel_r) begin
+			dst_xfer_ctr <= dst_xfer_ctr + {15'h0, ~&dst_xfer_ctr};
+		end
+	end
+
+	always @ (posedge clk_dst) begin
+		if (dst_bus_finish || dst_bus_kill)
+			dst_xfer_cycles <= dst_xfer_ctr;
+	end
+
+	always @ (posedge clk_src or negedge rst_n_src) begin
+		if (!rst_n_src) begin
+			src_xfer_done_r <= 1'b0;
+			src_xfer_cycles_r <= 16'h0;
+		end else begin
+			src_xfer_done_r <= src_xfer_finish;
+			if (src_xfer_finish) begin
+				// Cross-domain, same as src_prdata_pslverr.
+				src_xfer_cycles_r <= dst_xfer_cycles;
+			end
+		end
+	end
+
+	assign src_xfer_done = src_xfer_done_r;
+	assign src_xfer_cycles = src_xfer_cycles_r;
+
 end
+endgenerate
 
 assign dst_psel = dst_psel_r;
 assign dst_penable = dst_penable_r;
-assign {dst_paddr, dst_pwdata, dst_pwrite} = dst_paddr_pwdata_pwrite;
+assign {dst_paddr, dst_pwdata} = dst_paddr_pwdata_pwrite[W_ADDR + W_DATA:1];
+assign dst_pwrite = dst_paddr_pwdata_pwrite[0] && !dst_rmw_read;
 
 endmodule
 
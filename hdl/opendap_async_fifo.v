@@ -0,0 +1,158 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// Asynchronous FIFO with Gray-coded pointers. Read data is first-word
+// fall-through: rdata is valid whenever rempty is low, and rpop consumes it.
+// The storage is read asynchronously, so this suits small FIFOs in LUT RAM or
+// flops rather than block RAM.
+//
+// Each side also sees a fill level. The write side's level may overestimate
+// (it sees reads late) and the read side's level may underestimate (it sees
+// writes late), so both are safe for flow control.
+//
+// wrst_n and rrst_n must be asserted together, e.g. one reset asserted
+// asynchronously and released synchronously in each domain. Resetting only
+// one side leaves the other with a stale pointer.
+//
+// Note this module depends on the opendap_sync_1bit module (a flop-chain
+// synchroniser) which should be reimplemented for your FPGA/process.
+
+`default_nettype none
+
+module opendap_async_fifo #(
+	parameter W_DATA        = 32,
+	parameter LOG2_DEPTH    = 3, // Should be >= 1
+	// Set to 0 if wclk and rclk are the same clock.
+	parameter N_SYNC_STAGES = 2
+) (
+	input  wire                wclk,
+	input  wire                wrst_n,
+	input  wire [W_DATA-1:0]   wdata,
+	input  wire                wpush,
+	output wire                wfull,
+	output wire [LOG2_DEPTH:0] wlevel,
+
+	input  wire                rclk,
+	input  wire                rrst_n,
+	output wire [W_DATA-1:0]   rdata,
+	input  wire                rpop,
+	output wire                rempty,
+	output wire [LOG2_DEPTH:0] rlevel
+);
+
+localparam DEPTH = 1 << LOG2_DEPTH;
+localparam W_PTR = LOG2_DEPTH + 1;
+
+function [W_PTR-1:0] bin2gray;
+	input [W_PTR-1:0] bin;
+begin
+	bin2gray = bin ^ (bin >> 1);
+end
+endfunction
+
+function [W_PTR-1:0] gray2bin;
+	input [W_PTR-1:0] gray;
+	integer i;
+begin
+	gray2bin[W_PTR-1] = gray[W_PTR-1];
+	for (i = W_PTR - 2; i >= 0; i = i - 1)
+		gray2bin[i] = gray2bin[i + 1] ^ gray[i];
+end
+endfunction
+
+reg [W_DATA-1:0] mem [0:DEPTH-1];
+
+// ----------------------------------------------------------------------------
+// Write side
+
+reg  [W_PTR-1:0] wptr_bin;
+reg  [W_PTR-1:0] wptr_gray;
+wire [W_PTR-1:0] rptr_gray_wclk;
+
+assign wlevel = wptr_bin - gray2bin(rptr_gray_wclk);
+// Level can't exceed DEPTH, so the MSB is only set when full.
+assign wfull = wlevel[LOG2_DEPTH];
+
+wire [W_PTR-1:0] wptr_bin_nxt = wptr_bin + 1'b1;
+
+always @ (posedge wclk or negedge wrst_n) begin
+	if (!wrst_n) begin
+		wptr_bin <= {W_PTR{1'b0}};
+		wptr_gray <= {W_PTR{1'b0}};
+	end else if (wpush && !wfull) begin
+		wptr_bin <= wptr_bin_nxt;
+		wptr_gray <= bin2gray(wptr_bin_nxt);
+	end
+end
+
+always @ (posedge wclk) begin
+	if (wpush && !wfull)
+		mem[wptr_bin[LOG2_DEPTH-1:0]] <= wdata;
+end
+
+// ----------------------------------------------------------------------------
+// Read side
+
+reg  [W_PTR-1:0] rptr_bin;
+reg  [W_PTR-1:0] rptr_gray;
+wire [W_PTR-1:0] wptr_gray_rclk;
+
+assign rlevel = gray2bin(wptr_gray_rclk) - rptr_bin;
+assign rempty = ~|rlevel;
+assign rdata = mem[rptr_bin[LOG2_DEPTH-1:0]];
+
+wire [W_PTR-1:0] rptr_bin_nxt = rptr_bin + 1'b1;
+
+always @ (posedge rclk or negedge rrst_n) begin
+	if (!rrst_n) begin
+		rptr_bin <= {W_PTR{1'b0}};
+		rptr_gray <= {W_PTR{1'b0}};
+	end else if (rpop && !rempty) begin
+		rptr_bin <= rptr_bin_nxt;
+		rptr_gray <= bin2gray(rptr_bin_nxt);
+	end
+end
+
+// ----------------------------------------------------------------------------
+// Pointer synchronisers
+
+generate
+if (N_SYNC_STAGES == 0) begin: no_sync
+
+	assign rptr_gray_wclk = rptr_gray;
+	assign wptr_gray_rclk = wptr_gray;
+
+end else begin: sync
+
+	// Gray code: only one bit changes at a time, so bitwise sync is safe.
+	genvar g;
+	for (g = 0; g < W_PTR; g = g + 1) begin: sync_bit
+		opendap_sync_1bit #(
+			.N_STAGES (N_SYNC_STAGES)
+		) sync_rptr (
+			.clk   (wclk),
+			.rst_n (wrst_n),
+			.i     (rptr_gray[g]),
+			.o     (rptr_gray_wclk[g])
+		);
+
+		opendap_sync_1bit #(
+			.N_STAGES (N_SYNC_STAGES)
+		) sync_wptr (
+			.clk   (rclk),
+			.rst_n (rrst_n),
+			.i     (wptr_gray[g]),
+			.o     (wptr_gray_rclk[g])
+		);
+	end
+
+end
+endgenerate
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
@@ -0,0 +1,3 @@
+file opendap_mailbox_ap.v
+file opendap_async_fifo.v
+file cells/opendap_sync_1bit.v
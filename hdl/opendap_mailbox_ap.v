@@ -0,0 +1,288 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// Mailbox AP. A pair of FIFOs for streaming data between the debug host and
+// the target, e.g. for semihosting or logging, without the address traffic
+// and index polling of a shared-memory buffer accessed through a Mem-AP.
+//
+// The host pushes and pops through a single DATA register, so a stream is
+// just a block of back-to-back AP writes or (pipelined) AP reads. A write to
+// a full host->target FIFO, or a read from an empty target->host FIFO, holds
+// the access until space or data becomes available, so the host gets WAIT
+// responses as flow control rather than silently losing data. A host which
+// would rather not see WAIT can check LEVEL first. DAPABORT cancels a held
+// access, without pushing or popping anything.
+//
+// The target side is a pair of valid/ready streams in the clk_tgt domain,
+// plus interrupts for "host->target FIFO is not empty" and "target->host
+// FIFO is empty".
+//
+// Either reset (rst_n_por or rst_n_tgt) empties both FIFOs, on both sides.
+// Any data in them, or being pushed at the time, is lost.
+//
+// Registers:
+//
+// - 0x00 STATUS (RO)
+//   - [0] H2T_FULL
+//   - [1] H2T_EMPTY
+//   - [2] T2H_FULL
+//   - [3] T2H_EMPTY
+// - 0x04 LEVEL (RO)
+//   - [15:0]  Number of words in host->target FIFO
+//   - [31:16] Number of words in target->host FIFO
+// - 0x08 DEPTH (RO)
+//   - [15:0]  host->target FIFO depth
+//   - [31:16] target->host FIFO depth
+// - 0x0c DATA: write to push host->target, read to pop target->host
+// - 0xfc IDR
+
+`default_nettype none
+
+module opendap_mailbox_ap #(
+	// Bring your own JEP106 code
+	parameter [10:0] IDR_DESIGNER   = 11'h7ff,
+	parameter [3:0]  IDR_REVISION   = 4'h0,
+
+	// FIFO depths are 2 ** LOG2_*_DEPTH words. Max depth is 32768.
+	parameter        LOG2_H2T_DEPTH = 3,
+	parameter        LOG2_T2H_DEPTH = 5,
+
+	// Synchroniser depth for the FIFO pointers. Set to 0 when clk_tgt is the
+	// same clock as swclk.
+	parameter        N_SYNC_STAGES  = 2
+) (
+	input  wire        swclk,
+	input  wire        rst_n_por,
+
+	input  wire        clk_tgt,
+	input  wire        rst_n_tgt,
+
+	// DP-AP bus
+	input  wire [5:0]  dpacc_addr,
+	input  wire [31:0] dpacc_wdata,
+
+	input  wire        dpacc_wen,
+	input  wire        dpacc_ren,
+	input  wire        dpacc_abort,
+
+	output reg  [31:0] dpacc_rdata,
+	output wire        dpacc_rdy,
+	output wire        dpacc_err,
+
+	// Target side, clk_tgt domain
+	output wire [31:0] tgt_h2t_data,
+	output wire        tgt_h2t_valid,
+	input  wire        tgt_h2t_ready,
+
+	input  wire [31:0] tgt_t2h_data,
+	input  wire        tgt_t2h_valid,
+	output wire        tgt_t2h_ready,
+
+	output wire        tgt_irq_h2t_nonempty,
+	output wire        tgt_irq_t2h_empty
+);
+
+localparam H2T_DEPTH = 1 << LOG2_H2T_DEPTH;
+localparam T2H_DEPTH = 1 << LOG2_T2H_DEPTH;
+
+localparam REG_STATUS = 6'h00;
+localparam REG_LEVEL  = 6'h01;
+localparam REG_DEPTH  = 6'h02;
+localparam REG_DATA   = 6'h03;
+localparam REG_IDR    = 6'h3f;
+
+// ----------------------------------------------------------------------------
+// FIFOs
+
+// Both sides of each FIFO must be reset together: if only one side's pointer
+// were reset, the other side would see a stale pointer, and its level would
+// be garbage (e.g. spurious data, or a FIFO which is full forever). So the
+// FIFOs are reset by either reset, asserted asynchronously and released
+// synchronously in each domain.
+
+wire rst_n_fifo = rst_n_por && rst_n_tgt;
+wire rst_n_fifo_swclk;
+wire rst_n_fifo_tgt;
+
+generate
+if (N_SYNC_STAGES == 0) begin: no_sync_rst
+
+	assign rst_n_fifo_swclk = rst_n_fifo;
+	assign rst_n_fifo_tgt = rst_n_fifo;
+
+end else begin: sync_rst
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_rst_swclk (
+		.clk   (swclk),
+		.rst_n (rst_n_fifo),
+		.i     (1'b1),
+		.o     (rst_n_fifo_swclk)
+	);
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_rst_tgt (
+		.clk   (clk_tgt),
+		.rst_n (rst_n_fifo),
+		.i     (1'b1),
+		.o     (rst_n_fifo_tgt)
+	);
+
+end
+endgenerate
+
+wire                    h2t_push;
+wire                    h2t_full;
+wire [LOG2_H2T_DEPTH:0] h2t_level;
+wire                    h2t_empty_tgt;
+
+reg  [31:0]             wr_data;
+
+opendap_async_fifo #(
+	.W_DATA        (32),
+	.LOG2_DEPTH    (LOG2_H2T_DEPTH),
+	.N_SYNC_STAGES (N_SYNC_STAGES)
+) h2t_fifo (
+	.wclk   (swclk),
+	.wrst_n (rst_n_fifo_swclk),
+	.wdata  (wr_data),
+	.wpush  (h2t_push),
+	.wfull  (h2t_full),
+	.wlevel (h2t_level),
+
+	.rclk   (clk_tgt),
+	.rrst_n (rst_n_fifo_tgt),
+	.rdata  (tgt_h2t_data),
+	.rpop   (tgt_h2t_ready),
+	.rempty (h2t_empty_tgt),
+	.rlevel (/* unused */)
+);
+
+assign tgt_h2t_valid = !h2t_empty_tgt;
+
+wire                    t2h_pop;
+wire                    t2h_empty;
+wire [LOG2_T2H_DEPTH:0] t2h_level;
+wire [31:0]             t2h_rdata;
+wire                    t2h_full_tgt;
+wire [LOG2_T2H_DEPTH:0] t2h_level_tgt;
+
+opendap_async_fifo #(
+	.W_DATA        (32),
+	.LOG2_DEPTH    (LOG2_T2H_DEPTH),
+	.N_SYNC_STAGES (N_SYNC_STAGES)
+) t2h_fifo (
+	.wclk   (clk_tgt),
+	.wrst_n (rst_n_fifo_tgt),
+	.wdata  (tgt_t2h_data),
+	.wpush  (tgt_t2h_valid),
+	.wfull  (t2h_full_tgt),
+	.wlevel (t2h_level_tgt),
+
+	.rclk   (swclk),
+	.rrst_n (rst_n_fifo_swclk),
+	.rdata  (t2h_rdata),
+	.rpop   (t2h_pop),
+	.rempty (t2h_empty),
+	.rlevel (t2h_level)
+);
+
+assign tgt_t2h_ready = !t2h_full_tgt;
+
+assign tgt_irq_h2t_nonempty = !h2t_empty_tgt;
+assign tgt_irq_t2h_empty = ~|t2h_level_tgt;
+
+// ----------------------------------------------------------------------------
+// Register interface (swclk domain)
+
+// A DATA access is always held for at least one cycle, and completes once
+// the FIFO has space/data. The DP won't issue another access until we are
+// ready, so the held data register doubles as the FIFO write data.
+
+reg        wr_pending;
+reg        rd_pending;
+reg [31:0] rd_data;
+
+assign h2t_push = wr_pending && !h2t_full && !dpacc_abort;
+assign t2h_pop = rd_pending && !t2h_empty && !dpacc_abort;
+
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		wr_pending <= 1'b0;
+		wr_data <= 32'h0;
+		rd_pending <= 1'b0;
+		rd_data <= 32'h0;
+	end else if (dpacc_abort) begin
+		wr_pending <= 1'b0;
+		rd_pending <= 1'b0;
+	end else begin
+		if (dpacc_wen && dpacc_addr == REG_DATA) begin
+			wr_pending <= 1'b1;
+			wr_data <= dpacc_wdata;
+		end else if (h2t_push) begin
+			wr_pending <= 1'b0;
+		end
+		if (dpacc_ren && dpacc_addr == REG_DATA) begin
+			rd_pending <= 1'b1;
+		end else if (t2h_pop) begin
+			rd_pending <= 1'b0;
+			rd_data <= t2h_rdata;
+		end
+	end
+end
+
+assign dpacc_rdy = !(wr_pending || rd_pending);
+assign dpacc_err = 1'b0;
+
+reg [5:0] dpacc_addr_prev;
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		dpacc_addr_prev <= 6'h0;
+	end else if (dpacc_ren) begin
+		dpacc_addr_prev <= dpacc_addr;
+	end
+end
+
+always @ (*) begin
+	case (dpacc_addr_prev)
+
+	REG_STATUS: dpacc_rdata = {
+		28'h0,
+		t2h_empty,
+		t2h_level[LOG2_T2H_DEPTH],
+		~|h2t_level,
+		h2t_full
+	};
+
+	REG_LEVEL:  dpacc_rdata = {
+		{15 - LOG2_T2H_DEPTH{1'b0}}, t2h_level,
+		{15 - LOG2_H2T_DEPTH{1'b0}}, h2t_level
+	};
+
+	REG_DEPTH:  dpacc_rdata = {T2H_DEPTH[15:0], H2T_DEPTH[15:0]};
+
+	REG_DATA:   dpacc_rdata = rd_data;
+
+	REG_IDR:    dpacc_rdata = {
+		IDR_REVISION,
+		IDR_DESIGNER,
+		4'h0,           // CLASS   = no defined class
+		5'h0,           // RES0
+		4'h0,           // VARIANT = 0
+		4'h2            // TYPE    = 2
+	};
+
+	default:    dpacc_rdata = 32'h0;
+
+	endcase
+end
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
@@ -1,4 +1,5 @@
 file opendap_mem_ap_apb.v
 file opendap_apb_async_bridge.v
+file opendap_mem_ap_engine.v
 
 file cells/opendap_sync_1bit.v
@@ -15,9 +15,41 @@ module opendap_mem_ap_apb #(
 	// Base of debug registers or ROM table
 	parameter [31:0] BASE               = 32'h0000_0000,
 
-	// Minimum of 10 (A[9:0]). 12 is common, for 4kB pages.
+	// Minimum of 10 (A[9:0]). 12 is common, for 4kB pages. Ignored if
+	// TAR_STRIDE is set.
 	parameter        TAR_INCREMENT_BITS = 12,
 
+	// Implementation-defined TAR auto-increment stride, at 0xc4, and if
+	// TAR_2D is also set, row length and row stride for 2-D auto-increment,
+	// at 0xc8 and 0xcc. See "TAR stride" below.
+	parameter        TAR_STRIDE         = 0,
+	parameter        TAR_2D             = 0,
+
+	// Implementation-defined atomic set/clear/toggle aliases of the word at
+	// TAR, at 0x40 through 0x48. See "Atomic aliases" below.
+	parameter        ATOMIC_ALIASES     = 0,
+
+	// If nonzero, downstream transfers which stall for this many clk_dst
+	// cycles are terminated with an error. This bounds the time the DP can
+	// spend returning WAIT for a slave which never raises pready. Without
+	// it, the host can still recover with DAPABORT, which terminates a
+	// stalled transfer the same way (see the async bridge).
+	parameter        DST_TIMEOUT_CYCLES = 0,
+
+	// Synchroniser depth for the swclk -> clk_dst crossing. Set to 0 when
+	// clk_dst is the same clock as swclk, e.g. when the DP is an
+	// opendap_sw_dp_sysclk running from the system clock.
+	parameter        N_SYNC_STAGES      = 2,
+
+	// Implementation-defined performance counters for downstream transfers,
+	// at 0xd0 through 0xd8. See "Performance counters" below.
+	parameter        PERF_COUNTERS      = 0,
+
+	// Implementation-defined memory engine (CRC32/fill/compare over a range
+	// of memory, or polling one location, in the clk_dst domain), at 0xc0
+	// and 0xe0 through 0xec. See "Memory engine" below.
+	parameter        MEM_ENGINE         = 0,
+
 	parameter        W_ADDR             = 32, // do not modify
 	parameter        W_DATA             = 32  // do not modify
 ) (
@@ -47,7 +79,13 @@ module opendap_mem_ap_apb #(
 	output wire [W_DATA-1:0] dst_pwdata,
 	input  wire [W_DATA-1:0] dst_prdata,
 	input  wire              dst_pready,
-	input  wire              dst_pslverr
+	input  wire              dst_pslverr,
+
+	// High when the memory engine's last operation was a poll, which has
+	// now finished (matched or timed out). swclk domain. Can be used to
+	// drive the DP's EVENTSTAT input, so the host can wait on the condition
+	// without any AP traffic.
+	output wire              eng_poll_done
 );
 
 // ----------------------------------------------------------------------------
@@ -63,13 +101,28 @@ localparam REG_BD0  = 6'h04;
 localparam REG_BD1  = 6'h05;
 localparam REG_BD2  = 6'h06;
 localparam REG_BD3  = 6'h07;
+localparam REG_DSET = 6'h10;
+localparam REG_DCLR = 6'h11;
+localparam REG_DXOR = 6'h12;
+localparam REG_PERF_XFER_COUNT  = 6'h34;
+localparam REG_PERF_XFER_CYCLES = 6'h35;
+localparam REG_PERF_XFER_MAX    = 6'h36;
+localparam REG_ENG_MASK         = 6'h30;
+localparam REG_TAR_STRIDE       = 6'h31;
+localparam REG_TAR_ROW_LEN      = 6'h32;
+localparam REG_TAR_ROW_STRIDE   = 6'h33;
+localparam REG_ENG_CTRL         = 6'h38;
+localparam REG_ENG_LEN          = 6'h39;
+localparam REG_ENG_PATTERN      = 6'h3a;
+localparam REG_ENG_RESULT       = 6'h3b;
 localparam REG_CFG  = 6'h3d;
 localparam REG_BASE = 6'h3e;
 localparam REG_IDR  = 6'h3f;
 
 
-reg csw_tr_in_prog; // FIXME drive this
-reg csw_addr_inc;
+wire csw_tr_in_prog;
+reg  csw_addr_inc;
+wire eng_busy;
 
 always @ (posedge swclk or negedge rst_n_por) begin
 	if (!rst_n_por) begin
@@ -81,13 +134,32 @@ end
 
 reg  [31:0]       tar;
 
+// Note only DRW memory accesses increment, not BDx. Accesses rejected due to
+// the memory engine being busy, or the bridge still draining an aborted
+// transfer, do not increment either.
+wire bridge_busy;
+wire tar_inc = (dpacc_wen || dpacc_ren) && csw_addr_inc && dpacc_addr == REG_DRW && !eng_busy &&
+	!bridge_busy;
+// The memory engine reads TAR from clk_dst, so TAR is frozen whilst it runs.
+wire tar_wen = dpacc_wen && dpacc_addr == REG_TAR && !eng_busy;
+
+reg  [31:0]       tar_stride;
+reg  [15:0]       tar_row_len;
+reg  [31:0]       tar_row_stride;
+reg  [31:0]       tar_row_base;
+reg  [15:0]       tar_row_count;
+
+wire              tar_row_end = TAR_2D && |tar_row_len && tar_row_count == tar_row_len - 1'b1;
+wire [31:0]       tar_next_row = tar_row_base + tar_row_stride;
+
 always @ (posedge swclk or negedge rst_n_por) begin
 	if (!rst_n_por) begin
 		tar <= {W_ADDR{1'b0}};
-	end else if (dpacc_wen && dpacc_addr == REG_TAR) begin
+	end else if (tar_wen) begin
 		tar <= {dpacc_wdata[W_ADDR-1:2], 2'b00};
-	end else if ((dpacc_wen || dpacc_ren) && csw_addr_inc && dpacc_addr == REG_DRW) begin
-		// Note only DRW memory accesses increment, not BDx.
+	end else if (tar_inc && TAR_STRIDE) begin
+		tar <= tar_row_end ? tar_next_row : tar + tar_stride;
+	end else if (tar_inc) begin
 		tar <= {
 			tar[W_ADDR-1:TAR_INCREMENT_BITS],
 			tar[TAR_INCREMENT_BITS-1:2] + 1'b1, // self-determined size due to concat
@@ -109,6 +181,20 @@ end
 
 wire [W_DATA-1:0] bridge_prdata;
 
+reg  [31:0]       perf_xfer_count;
+reg  [31:0]       perf_xfer_cycles;
+reg  [15:0]       perf_xfer_max;
+
+reg  [1:0]        eng_op;
+reg  [31:0]       eng_len;
+reg  [31:0]       eng_pattern;
+reg  [31:0]       eng_mask;
+reg               eng_started;
+wire              eng_err;
+wire              eng_mismatch;
+wire              eng_timeout;
+wire [31:0]       eng_result;
+
 always @ (*) begin
 	case (dpacc_addr_prev)
 
@@ -139,6 +225,39 @@ always @ (*) begin
 
 	REG_BD3: dpacc_rdata = bridge_prdata;
 
+	REG_PERF_XFER_COUNT:  dpacc_rdata = perf_xfer_count;
+
+	REG_PERF_XFER_CYCLES: dpacc_rdata = perf_xfer_cycles;
+
+	REG_PERF_XFER_MAX:    dpacc_rdata = {16'h0, perf_xfer_max};
+
+	REG_ENG_CTRL: dpacc_rdata = {
+		19'h0,          // RES0
+		eng_timeout,
+		eng_mismatch,
+		eng_err,
+		eng_started && !eng_busy,
+		eng_busy,
+		3'h0,           // RES0
+		1'b0,           // START is write-only
+		2'h0,           // RES0
+		eng_op
+	};
+
+	REG_ENG_LEN:     dpacc_rdata = eng_len;
+
+	REG_ENG_PATTERN: dpacc_rdata = eng_pattern;
+
+	REG_ENG_RESULT:  dpacc_rdata = eng_result;
+
+	REG_ENG_MASK:    dpacc_rdata = eng_mask;
+
+	REG_TAR_STRIDE:     dpacc_rdata = tar_stride;
+
+	REG_TAR_ROW_LEN:    dpacc_rdata = {16'h0, tar_row_len};
+
+	REG_TAR_ROW_STRIDE: dpacc_rdata = tar_row_stride;
+
 	REG_CFG: dpacc_rdata = {
 		29'h0,          // RES0
 		1'b0,           // LD=0, no large data
@@ -162,6 +281,61 @@ always @ (*) begin
 	endcase
 end
 
+// ----------------------------------------------------------------------------
+// TAR stride (not present unless TAR_STRIDE)
+
+// With CSW.AddrInc set, each DRW access adds STRIDE to TAR, rather than 4.
+// The addition carries through the whole of TAR (TAR_INCREMENT_BITS does not
+// apply), so a strided walk can cross pages, and a negative stride walks
+// downwards. With the reset value of 4, DRW behaves as a normal Mem-AP.
+//
+// With TAR_2D, nonzero ROW_LEN also splits the walk into rows: after ROW_LEN
+// DRW accesses, TAR goes to the start of the current row plus ROW_STRIDE,
+// rather than adding STRIDE. A TAR write marks the start of the first row.
+// For example, an 8-word column of a framebuffer with a 1 kB pitch is STRIDE
+// = 1024, ROW_LEN = 0, and an 8 x 4-word block is STRIDE = 4, ROW_LEN = 4,
+// ROW_STRIDE = 1024. Either way, the host writes TAR once and then streams
+// DRW accesses back-to-back.
+//
+// - 0xc4 STRIDE: signed byte increment, word-aligned, reset to 4
+// - 0xc8 ROW_LEN: [15:0] words per row, 0 for no rows
+// - 0xcc ROW_STRIDE: signed byte offset from the start of one row to the
+//        start of the next, word-aligned
+//
+// Program these before writing TAR. Memory engine ranges are contiguous
+// whatever the stride.
+
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		tar_stride <= TAR_STRIDE ? 32'h4 : 32'h0;
+		tar_row_len <= 16'h0;
+		tar_row_stride <= 32'h0;
+		tar_row_base <= 32'h0;
+		tar_row_count <= 16'h0;
+	end else if (TAR_STRIDE) begin
+		if (dpacc_wen && dpacc_addr == REG_TAR_STRIDE) begin
+			tar_stride <= {dpacc_wdata[31:2], 2'b00};
+		end
+		if (TAR_2D) begin
+			if (dpacc_wen && dpacc_addr == REG_TAR_ROW_LEN) begin
+				tar_row_len <= dpacc_wdata[15:0];
+			end
+			if (dpacc_wen && dpacc_addr == REG_TAR_ROW_STRIDE) begin
+				tar_row_stride <= {dpacc_wdata[31:2], 2'b00};
+			end
+			if (tar_wen) begin
+				tar_row_base <= {dpacc_wdata[31:2], 2'b00};
+				tar_row_count <= 16'h0;
+			end else if (tar_inc && tar_row_end) begin
+				tar_row_base <= tar_next_row;
+				tar_row_count <= 16'h0;
+			end else if (tar_inc) begin
+				tar_row_count <= tar_row_count + 1'b1;
+			end
+		end
+	end
+end
+
 // ----------------------------------------------------------------------------
 // Non-optional async bridge
 // (clock crossing and downstream protocol handling)
@@ -175,13 +349,25 @@ wire              bridge_penable = 1'b0;
 wire              bridge_pwrite  = dpacc_wen;
 wire [W_ADDR-1:0] bridge_paddr;
 wire [W_DATA-1:0] bridge_pwdata  = dpacc_wdata;
+wire [1:0]        bridge_rmw_op;
 wire              bridge_pready;
 wire              bridge_pslverr;
+wire              bridge_xfer_done;
+wire [15:0]       bridge_xfer_cycles;
+
+wire              bridge_dst_psel;
+wire              bridge_dst_penable;
+wire              bridge_dst_pwrite;
+wire [W_ADDR-1:0] bridge_dst_paddr;
+wire [W_DATA-1:0] bridge_dst_pwdata;
 
 opendap_apb_async_bridge #(
-	.W_ADDR        (W_ADDR),
-	.W_DATA        (W_DATA),
-	.N_SYNC_STAGES (2)
+	.W_ADDR              (W_ADDR),
+	.W_DATA              (W_DATA),
+	.N_SYNC_STAGES       (N_SYNC_STAGES),
+	.DST_TIMEOUT_CYCLES  (DST_TIMEOUT_CYCLES),
+	.MEASURE_XFER_CYCLES (PERF_COUNTERS),
+	.RMW                 (ATOMIC_ALIASES)
 ) async_bridge (
 	.clk_src     (swclk),
 	.rst_n_src   (rst_n_por),
@@ -197,12 +383,19 @@ opendap_apb_async_bridge #(
 	.src_prdata  (bridge_prdata),
 	.src_pready  (bridge_pready),
 	.src_pslverr (bridge_pslverr),
+	.src_rmw_op  (bridge_rmw_op),
+
+	.src_abort   (dpacc_abort),
+	.src_busy    (bridge_busy),
+
+	.src_xfer_done   (bridge_xfer_done),
+	.src_xfer_cycles (bridge_xfer_cycles),
 
-	.dst_psel    (dst_psel),
-	.dst_penable (dst_penable),
-	.dst_pwrite  (dst_pwrite),
-	.dst_paddr   (dst_paddr),
-	.dst_pwdata  (dst_pwdata),
+	.dst_psel    (bridge_dst_psel),
+	.dst_penable (bridge_dst_penable),
+	.dst_pwrite  (bridge_dst_pwrite),
+	.dst_paddr   (bridge_dst_paddr),
+	.dst_pwdata  (bridge_dst_pwdata),
 	.dst_prdata  (dst_prdata),
 	.dst_pready  (dst_pready),
 	.dst_pslverr (dst_pslverr)
@@ -210,17 +403,29 @@ opendap_apb_async_bridge #(
 
 // Send bus transfers to bridge
 
+// Atomic aliases are write-only, and reads of them are RES0. See below.
+wire dpacc_is_alias = ATOMIC_ALIASES && dpacc_wen &&
+	(dpacc_addr == REG_DSET || dpacc_addr == REG_DCLR || dpacc_addr == REG_DXOR);
+
 assign bridge_paddr = {
 	tar[W_ADDR-1:4],
-	dpacc_addr == REG_DRW ? tar[3:2] : dpacc_addr[1:0],
+	dpacc_addr == REG_DRW || dpacc_is_alias ? tar[3:2] : dpacc_addr[1:0],
 	2'b00
 };
 
-wire dpacc_is_mem = dpacc_addr == REG_DRW || (dpacc_addr & 6'h3c) == REG_BD0;
-assign bridge_psel = (dpacc_wen || dpacc_ren) && dpacc_is_mem;
+assign bridge_rmw_op = dpacc_is_alias ? dpacc_addr[1:0] + 2'h1 : 2'h0;
+
+wire dpacc_is_mem = dpacc_addr == REG_DRW || (dpacc_addr & 6'h3c) == REG_BD0 || dpacc_is_alias;
+assign bridge_psel = (dpacc_wen || dpacc_ren) && dpacc_is_mem && !eng_busy;
 
-// TODO abort
+// On DAPABORT the bridge releases pready on the next cycle, and carries on
+// draining the aborted transfer in the background. If the slave is still
+// stalling, the bridge terminates the transfer once the abort reaches
+// clk_dst, so this takes a few cycles of each clock at most. TrInProg shows
+// the host whether that transfer is still outstanding. Any new memory access
+// before then fails with an error, and doesn't increment TAR.
 assign dpacc_rdy = bridge_pready;
+assign csw_tr_in_prog = bridge_busy;
 
 reg error_vld;
 
@@ -228,12 +433,213 @@ always @ (posedge swclk or negedge rst_n_por) begin
 	if (!rst_n_por) begin
 		error_vld <= 1'b0;
 	end else begin
-		error_vld <= bridge_psel || !bridge_pready;
+		error_vld <= (bridge_psel || !bridge_pready) && !dpacc_abort;
 	end
 end
 
+// The memory engine and the bridge take turns on the downstream bus: memory
+// accesses whilst the engine is busy, and engine starts whilst the engine or
+// bridge is busy, fail with an error and have no other effect.
+wire eng_start = dpacc_wen && dpacc_addr == REG_ENG_CTRL && dpacc_wdata[4];
+reg  eng_reject;
+
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		eng_reject <= 1'b0;
+	end else begin
+		eng_reject <= !dpacc_abort && (
+			((dpacc_wen || dpacc_ren) && dpacc_is_mem && eng_busy) ||
+			(eng_start && (eng_busy || bridge_busy) && MEM_ENGINE)
+		);
+	end
+end
+
+assign dpacc_err = (bridge_pslverr && error_vld) || eng_reject;
+
+// ----------------------------------------------------------------------------
+// Atomic aliases (not present unless ATOMIC_ALIASES)
+
+// A write to one of these changes bits in the word at TAR, without the host
+// reading it first. The bridge does the read-modify-write on the downstream
+// bus as one transfer from the DP's point of view, so it costs one SWD write,
+// and there's no window between the read and the write for the host to lose
+// a race with the target. (Target bus masters can still get in between the
+// two downstream transfers: this is atomic with respect to the debugger, not
+// the system.)
+//
+// - 0x40 DSET: word at TAR |= wdata
+// - 0x44 DCLR: word at TAR &= ~wdata
+// - 0x48 DXOR: word at TAR ^= wdata
+//
+// TAR does not auto-increment. A downstream error on either the read or the
+// write sets STICKYERR as for DRW, and an error on the read skips the write.
+
+// ----------------------------------------------------------------------------
+// Performance counters (not present unless PERF_COUNTERS)
+
+// The bridge measures each downstream transfer in clk_dst cycles, and hands
+// the count back with the transfer's response, so everything here is in the
+// swclk domain:
+//
+// - 0xd0: Number of completed transfers (not including aborted transfers)
+// - 0xd4: Total clk_dst cycles spent in those transfers
+// - 0xd8: Longest single transfer, in clk_dst cycles (high water mark)
+//
+// All saturate at all-ones. Writing any value to any of them clears all
+// three.
+
+wire [31:0] perf_xfer_cycles_sum = perf_xfer_cycles + {16'h0, bridge_xfer_cycles};
 
-assign dpacc_err = bridge_pslverr && error_vld;
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		perf_xfer_count <= 32'h0;
+		perf_xfer_cycles <= 32'h0;
+		perf_xfer_max <= 16'h0;
+	end else if (PERF_COUNTERS) begin
+		if (dpacc_wen && (dpacc_addr == REG_PERF_XFER_COUNT ||
+			dpacc_addr == REG_PERF_XFER_CYCLES || dpacc_addr == REG_PERF_XFER_MAX)) begin
+			perf_xfer_count <= 32'h0;
+			perf_xfer_cycles <= 32'h0;
+			perf_xfer_max <= 16'h0;
+		end else if (bridge_xfer_done) begin
+			perf_xfer_count <= perf_xfer_count + {31'h0, ~&perf_xfer_count};
+			perf_xfer_cycles <= perf_xfer_cycles_sum < perf_xfer_cycles ?
+				32'hffff_ffff : perf_xfer_cycles_sum;
+			if (bridge_xfer_cycles > perf_xfer_max)
+				perf_xfer_max <= bridge_xfer_cycles;
+		end
+	end
+end
+
+// ----------------------------------------------------------------------------
+// Memory engine (not present unless MEM_ENGINE)
+
+// Runs a whole-range operation on the downstream bus without any further
+// SWD traffic. The range starts at TAR, and is ENG_LEN bytes long (rounded
+// down to whole words).
+//
+// The poll operation instead reads the word at TAR back-to-back until
+// (data & ENG_MASK) == (ENG_PATTERN & ENG_MASK), or until ENG_LEN clk_dst
+// cycles have passed (ENG_LEN = 0 polls forever). This replaces a host loop
+// of SWD reads, e.g. waiting for a halt bit or a flash busy flag, and
+// notices the condition at clk_dst rate. eng_poll_done goes high when the
+// poll finishes.
+//
+// - 0xc0 ENG_MASK: poll mask, reset to all-ones
+// - 0xe0 ENG_CTRL
+//   - [1:0] OP: 0 = CRC32 (as zlib crc32()), 1 = fill with ENG_PATTERN,
+//               2 = compare against ENG_PATTERN, 3 = poll
+//   - [4]   START (WO): write 1 to start OP
+//   - [8]   BUSY (RO)
+//   - [9]   DONE (RO): an operation has completed since reset
+//   - [10]  ERR (RO): bus error or timeout, or stopped by DAPABORT
+//   - [11]  MISMATCH (RO): compare found a word which differs
+//   - [12]  TIMEOUT (RO): poll gave up without a match
+// - 0xe4 ENG_LEN: length in bytes, or poll timeout in clk_dst cycles
+// - 0xe8 ENG_PATTERN: fill/compare pattern, or poll expected value
+// - 0xec ENG_RESULT (RO): CRC for a successful CRC32, last value read for
+//        a poll, else the address at which the operation stopped (TAR +
+//        ENG_LEN on success)
+//
+// Writes to TAR, ENG_CTRL, ENG_LEN, ENG_PATTERN and ENG_MASK are ignored
+// whilst BUSY. DAPABORT stops a busy engine at the next word boundary.
+
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		eng_op <= 2'h0;
+		eng_len <= 32'h0;
+		eng_pattern <= 32'h0;
+		eng_mask <= 32'hffff_ffff;
+		eng_started <= 1'b0;
+	end else if (MEM_ENGINE && !eng_busy) begin
+		if (dpacc_wen && dpacc_addr == REG_ENG_CTRL) begin
+			eng_op <= dpacc_wdata[1:0];
+		end
+		if (dpacc_wen && dpacc_addr == REG_ENG_LEN) begin
+			eng_len <= dpacc_wdata;
+		end
+		if (dpacc_wen && dpacc_addr == REG_ENG_PATTERN) begin
+			eng_pattern <= dpacc_wdata;
+		end
+		if (dpacc_wen && dpacc_addr == REG_ENG_MASK) begin
+			eng_mask <= dpacc_wdata;
+		end
+		if (eng_start && !bridge_busy) begin
+			eng_started <= 1'b1;
+		end
+	end
+end
+
+generate
+if (MEM_ENGINE) begin: engine
+
+	wire              eng_dst_psel;
+	wire              eng_dst_penable;
+	wire              eng_dst_pwrite;
+	wire [W_ADDR-1:0] eng_dst_paddr;
+	wire [W_DATA-1:0] eng_dst_pwdata;
+
+	opendap_mem_ap_engine #(
+		.W_ADDR             (W_ADDR),
+		.N_SYNC_STAGES      (N_SYNC_STAGES),
+		.DST_TIMEOUT_CYCLES (DST_TIMEOUT_CYCLES)
+	) engine (
+		.clk_src       (swclk),
+		.rst_n_src     (rst_n_por),
+
+		.clk_dst       (clk_dst),
+		.rst_n_dst     (rst_n_dst),
+
+		.src_start     (eng_start && !bridge_busy && !dpacc_abort),
+		.src_stop      (dpacc_abort),
+		.src_op        (eng_op),
+		.src_addr      (tar),
+		.src_len       (eng_len),
+		.src_pattern   (eng_pattern),
+		.src_mask      (eng_mask),
+
+		.src_busy      (eng_busy),
+		.src_err       (eng_err),
+		.src_mismatch  (eng_mismatch),
+		.src_timeout   (eng_timeout),
+		.src_result    (eng_result),
+		.src_poll_done (eng_poll_done),
+
+		.dst_psel      (eng_dst_psel),
+		.dst_penable   (eng_dst_penable),
+		.dst_pwrite    (eng_dst_pwrite),
+		.dst_paddr     (eng_dst_paddr),
+		.dst_pwdata    (eng_dst_pwdata),
+		.dst_prdata    (dst_prdata),
+		.dst_pready    (dst_pready),
+		.dst_pslverr   (dst_pslverr)
+	);
+
+	// The bridge's dst port is idle whenever the engine is active, and vice
+	// versa, so there is no arbitration here, just a mux.
+	assign dst_psel    = bridge_dst_psel || eng_dst_psel;
+	assign dst_penable = eng_dst_psel ? eng_dst_penable : bridge_dst_penable;
+	assign dst_pwrite  = eng_dst_psel ? eng_dst_pwrite  : bridge_dst_pwrite;
+	assign dst_paddr   = eng_dst_psel ? eng_dst_paddr   : bridge_dst_paddr;
+	assign dst_pwdata  = eng_dst_psel ? eng_dst_pwdata  : bridge_dst_pwdata;
+
+end else begin: no_engine
+
+	assign eng_busy      = 1'b0;
+	assign eng_err       = 1'b0;
+	assign eng_mismatch  = 1'b0;
+	assign eng_timeout   = 1'b0;
+	assign eng_result    = 32'h0;
+	assign eng_poll_done = 1'b0;
+
+	assign dst_psel    = bridge_dst_psel;
+	assign dst_penable = bridge_dst_penable;
+	assign dst_pwrite  = bridge_dst_pwrite;
+	assign dst_paddr   = bridge_dst_paddr;
+	assign dst_pwdata  = bridge_dst_pwdata;
+
+end
+endgenerate
 
 endmodule
 
@@ -0,0 +1,295 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// Memory engine for the Mem-AP. Runs a whole-range operation on the
+// downstream APB bus, in the clk_dst domain, so that the host doesn't have to
+// move every word over SWD:
+//
+// - OP_CRC32:   compute the CRC32 of the range (as zlib crc32(), with bytes
+//               in little-endian order within each word)
+// - OP_FILL:    write the pattern to every word in the range
+// - OP_COMPARE: read every word in the range, stopping at the first which
+//               differs from the pattern
+// - OP_POLL:    read the word at src_addr repeatedly, at clk_dst rate, until
+//               (data & mask) == (pattern & mask), or src_len clk_dst cycles
+//               have passed (0 means wait forever)
+//
+// For all other operations, the range is src_len / 4 32-bit words starting
+// at src_addr. src_op, src_addr, src_len, src_pattern and src_mask are
+// passed to clk_dst quasi-statically, so must be held stable whilst src_busy
+// is high.
+//
+// Start and completion are passed across with a req/ack toggle handshake.
+// Results are valid in the src domain whenever src_busy is low:
+//
+// - src_err:      a transfer returned an error (or timed out), or the
+//                 operation was stopped early with src_stop
+// - src_mismatch: OP_COMPARE found a mismatching word
+// - src_timeout:  OP_POLL gave up without a match
+// - src_result:   the CRC, for a successful OP_CRC32, the last value read,
+//                 for OP_POLL, else the address at which the operation
+//                 stopped (one past the end on success)
+// - src_poll_done: the last operation was an OP_POLL (so either matched or
+//                  timed out), e.g. to drive the DP's EVENTSTAT
+
+`default_nettype none
+
+module opendap_mem_ap_engine #(
+	parameter W_ADDR             = 32,
+	// Set to 0 if clk_src and clk_dst are the same clock.
+	parameter N_SYNC_STAGES      = 2,
+	// If nonzero, a transfer which spends this many cycles in its access
+	// phase without pready is terminated, and the operation stops with an
+	// error. See opendap_apb_async_bridge.
+	parameter DST_TIMEOUT_CYCLES = 0
+) (
+	input  wire              clk_src,
+	input  wire              rst_n_src,
+
+	input  wire              clk_dst,
+	input  wire              rst_n_dst,
+
+	// Control and status, clk_src domain
+	input  wire              src_start,
+	input  wire              src_stop,
+	input  wire [1:0]        src_op,
+	input  wire [W_ADDR-1:0] src_addr,
+	input  wire [31:0]       src_len,
+	input  wire [31:0]       src_pattern,
+	input  wire [31:0]       src_mask,
+
+	output wire              src_busy,
+	output reg               src_err,
+	output reg               src_mismatch,
+	output reg               src_timeout,
+	output reg  [31:0]       src_result,
+	output reg               src_poll_done,
+
+	// APB master, clk_dst domain. Idle whenever src_busy is low.
+	output wire              dst_psel,
+	output wire              dst_penable,
+	output wire              dst_pwrite,
+	output wire [W_ADDR-1:0] dst_paddr,
+	output wire [31:0]       dst_pwdata,
+	input  wire [31:0]       dst_prdata,
+	input  wire              dst_pready,
+	input  wire              dst_pslverr
+);
+
+localparam OP_CRC32   = 2'd0;
+localparam OP_FILL    = 2'd1;
+localparam OP_COMPARE = 2'd2;
+localparam OP_POLL    = 2'd3;
+
+// Reflected CRC32 (polynomial 0x04c11db7), 32 data bits at once.
+function [31:0] crc32_word;
+	input [31:0] crc;
+	input [31:0] data;
+	integer i;
+begin
+	crc32_word = crc ^ data;
+	for (i = 0; i < 32; i = i + 1)
+		crc32_word = (crc32_word >> 1) ^ (32'hedb88320 & {32{crc32_word[0]}});
+end
+endfunction
+
+// ----------------------------------------------------------------------------
+// Handshake
+
+reg  src_req;
+wire src_ack_sync;
+reg  src_ack;
+reg  src_stop_req;
+
+always @ (posedge clk_src or negedge rst_n_src) begin
+	if (!rst_n_src) begin
+		src_req <= 1'b0;
+		src_stop_req <= 1'b0;
+	end else if (src_start && !src_busy) begin
+		src_req <= !src_req;
+		src_stop_req <= 1'b0;
+	end else if (src_stop && src_busy) begin
+		src_stop_req <= 1'b1;
+	end
+end
+
+// src_ack follows the synchronised ack one cycle later, at the same time as
+// the results are captured, so busy never falls before the results are in.
+assign src_busy = src_req != src_ack;
+
+reg  dst_ack;
+wire dst_req_sync;
+wire dst_stop_sync;
+
+generate
+if (N_SYNC_STAGES == 0) begin: no_sync
+
+	assign dst_req_sync = src_req;
+	assign dst_stop_sync = src_stop_req;
+	assign src_ack_sync = dst_ack;
+
+end else begin: sync
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_req (
+		.clk   (clk_dst),
+		.rst_n (rst_n_dst),
+		.i     (src_req),
+		.o     (dst_req_sync)
+	);
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_stop (
+		.clk   (clk_dst),
+		.rst_n (rst_n_dst),
+		.i     (src_stop_req),
+		.o     (dst_stop_sync)
+	);
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_ack (
+		.clk   (clk_src),
+		.rst_n (rst_n_src),
+		.i     (dst_ack),
+		.o     (src_ack_sync)
+	);
+
+end
+endgenerate
+
+// ----------------------------------------------------------------------------
+// Engine (clk_dst domain)
+
+localparam W_STATE      = 2;
+localparam S_IDLE       = 2'd0;
+localparam S_SETUP      = 2'd1;
+localparam S_ACCESS     = 2'd2;
+localparam S_DONE       = 2'd3;
+
+localparam W_TIMEOUT_CTR = DST_TIMEOUT_CYCLES > 1 ? $clog2(DST_TIMEOUT_CYCLES) : 1;
+
+reg [W_STATE-1:0]       state;
+reg [W_ADDR-1:0]        addr;
+reg [31:0]              remaining;   // Words, or cycles for OP_POLL
+reg [31:0]              acc;         // CRC, or last value for OP_POLL
+reg                     dst_err;
+reg                     dst_mismatch;
+reg                     dst_timeout;
+reg [W_TIMEOUT_CTR-1:0] timeout_ctr;
+
+wire timed_out = DST_TIMEOUT_CYCLES != 0 && ~|timeout_ctr;
+
+wire op_poll = src_op == OP_POLL;
+wire poll_timed_out = op_poll && |src_len && ~|remaining;
+wire poll_match = (dst_prdata & src_mask) == (src_pattern & src_mask);
+
+always @ (posedge clk_dst or negedge rst_n_dst) begin
+	if (!rst_n_dst) begin
+		state <= S_IDLE;
+		addr <= {W_ADDR{1'b0}};
+		remaining <= 32'h0;
+		acc <= 32'h0;
+		dst_err <= 1'b0;
+		dst_mismatch <= 1'b0;
+		dst_timeout <= 1'b0;
+		dst_ack <= 1'b0;
+		timeout_ctr <= {W_TIMEOUT_CTR{1'b0}};
+	end else case (state)
+	S_IDLE: if (dst_req_sync != dst_ack) begin
+		// Cross-domain: these have been stable for the req sync delay.
+		addr <= {src_addr[W_ADDR-1:2], 2'b00};
+		remaining <= op_poll ? src_len : {2'b00, src_len[31:2]};
+		acc <= 32'hffff_ffff;
+		dst_err <= 1'b0;
+		dst_mismatch <= 1'b0;
+		dst_timeout <= 1'b0;
+		state <= ~|src_len[31:2] && !op_poll ? S_DONE : S_SETUP;
+	end
+	S_SETUP: begin
+		timeout_ctr <= DST_TIMEOUT_CYCLES - 1;
+		if (op_poll)
+			remaining <= remaining - |remaining;
+		if (dst_stop_sync) begin
+			dst_err <= 1'b1;
+			state <= S_DONE;
+		end else if (poll_timed_out) begin
+			dst_timeout <= 1'b1;
+			state <= S_DONE;
+		end else begin
+			state <= S_ACCESS;
+		end
+	end
+	S_ACCESS: begin
+		timeout_ctr <= timeout_ctr - |timeout_ctr;
+		if (op_poll)
+			remaining <= remaining - |remaining;
+		if (timed_out && !dst_pready) begin
+			dst_err <= 1'b1;
+			state <= S_DONE;
+		end else if (dst_pready) begin
+			if (dst_pslverr) begin
+				dst_err <= 1'b1;
+				state <= S_DONE;
+			end else if (op_poll) begin
+				// Timeout is checked on the way back through S_SETUP.
+				acc <= dst_prdata;
+				state <= poll_match ? S_DONE : S_SETUP;
+			end else if (src_op == OP_COMPARE && dst_prdata != src_pattern) begin
+				dst_mismatch <= 1'b1;
+				state <= S_DONE;
+			end else begin
+				acc <= crc32_word(acc, dst_prdata);
+				addr <= addr + 3'h4;
+				remaining <= remaining - 1'b1;
+				state <= remaining == 32'h1 ? S_DONE : S_SETUP;
+			end
+		end
+	end
+	S_DONE: begin
+		dst_ack <= dst_req_sync;
+		state <= S_IDLE;
+	end
+	endcase
+end
+
+assign dst_psel = state == S_SETUP || state == S_ACCESS;
+assign dst_penable = state == S_ACCESS;
+assign dst_pwrite = src_op == OP_FILL;
+assign dst_paddr = addr;
+assign dst_pwdata = src_pattern;
+
+// Results are stable from before the ack is toggled until the next start, so
+// they can be passed back quasi-statically. Register them on the src side so
+// that the Mem-AP read mux doesn't look directly into clk_dst.
+
+always @ (posedge clk_src or negedge rst_n_src) begin
+	if (!rst_n_src) begin
+		src_ack <= 1'b0;
+		src_err <= 1'b0;
+		src_mismatch <= 1'b0;
+		src_timeout <= 1'b0;
+		src_result <= 32'h0;
+		src_poll_done <= 1'b0;
+	end else if (src_start && !src_busy) begin
+		src_poll_done <= 1'b0;
+	end else if (src_ack != src_ack_sync) begin
+		src_ack <= src_ack_sync;
+		src_err <= dst_err;
+		src_mismatch <= dst_mismatch;
+		src_timeout <= dst_timeout;
+		src_poll_done <= op_poll;
+		src_result <= op_poll                        ? acc  :
+		              src_op == OP_CRC32 && !dst_err ? ~acc : addr;
+	end
+end
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
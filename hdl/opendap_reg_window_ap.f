@@ -0,0 +1,3 @@
+file opendap_reg_window_ap.v
+file opendap_apb_async_bridge.v
+file cells/opendap_sync_1bit.v
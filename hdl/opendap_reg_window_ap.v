@@ -0,0 +1,205 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// Register window AP. Maps most of the AP's own register space directly onto
+// a 256-byte window of the downstream APB bus, at a base address programmed
+// by the host. Registers scattered around a block of debug or peripheral
+// registers (e.g. a RISC-V Debug Module) then cost one SWD transfer each,
+// plus a SELECT write when moving between banks, rather than a TAR write and
+// a BDx access.
+//
+// Registers:
+//
+// - 0x00 through 0xec: window. An access at AP address A goes to downstream
+//   address WINDOW + A.
+// - 0xf0 WINDOW: base of the window, 256-byte aligned. Only bits set in
+//   WINDOW_MASK are writable, the rest read as WINDOW_RESET.
+// - 0xf4 STATUS (RO)
+//   - [0] TRINPROG: a downstream transfer is still in progress (e.g.
+//         draining after DAPABORT). New window accesses fail until it
+//         completes.
+// - 0xf8 RES0
+// - 0xfc IDR
+//
+// The last 16 bytes of the window (WINDOW + 0xf0 through WINDOW + 0xfc) are
+// not accessible; place the window so that they are not needed.
+
+`default_nettype none
+
+module opendap_reg_window_ap #(
+	// Bring your own JEP106 code
+	parameter [10:0] IDR_DESIGNER       = 11'h7ff,
+	parameter [3:0]  IDR_REVISION       = 4'h0,
+
+	// Reset value of WINDOW, and which of its bits the host can change.
+	// Clearing high-order bits of the mask confines the window to part of
+	// the address space, e.g. just the debug registers.
+	parameter [31:0] WINDOW_RESET       = 32'h0000_0000,
+	parameter [31:0] WINDOW_MASK        = 32'hffff_ff00,
+
+	// See opendap_mem_ap_apb.
+	parameter        DST_TIMEOUT_CYCLES = 0,
+	parameter        N_SYNC_STAGES      = 2,
+
+	parameter        W_ADDR             = 32, // do not modify
+	parameter        W_DATA             = 32  // do not modify
+) (
+	input  wire              swclk,
+	input  wire              rst_n_por,
+
+	input  wire              clk_dst,
+	input  wire              rst_n_dst,
+
+	// DP-AP bus
+	input  wire [5:0]        dpacc_addr,
+	input  wire [W_DATA-1:0] dpacc_wdata,
+
+	input  wire              dpacc_wen,
+	input  wire              dpacc_ren,
+	input  wire              dpacc_abort,
+
+	output reg  [W_DATA-1:0] dpacc_rdata,
+	output wire              dpacc_rdy,
+	output wire              dpacc_err,
+
+	// Downstream bus
+	output wire              dst_psel,
+	output wire              dst_penable,
+	output wire              dst_pwrite,
+	output wire [W_ADDR-1:0] dst_paddr,
+	output wire [W_DATA-1:0] dst_pwdata,
+	input  wire [W_DATA-1:0] dst_prdata,
+	input  wire              dst_pready,
+	input  wire              dst_pslverr
+);
+
+// ----------------------------------------------------------------------------
+// AP logic
+
+localparam REG_WINDOW = 6'h3c;
+localparam REG_STATUS = 6'h3d;
+localparam REG_IDR    = 6'h3f;
+
+localparam [31:0] WINDOW_MASK_ALIGNED = WINDOW_MASK & 32'hffff_ff00;
+
+reg [31:0] window;
+
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		window <= WINDOW_RESET & 32'hffff_ff00;
+	end else if (dpacc_wen && dpacc_addr == REG_WINDOW) begin
+		window <= (dpacc_wdata & WINDOW_MASK_ALIGNED) | (window & ~WINDOW_MASK_ALIGNED);
+	end
+end
+
+reg [5:0] dpacc_addr_prev;
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		dpacc_addr_prev <= 6'h0;
+	end else if (dpacc_ren) begin
+		dpacc_addr_prev <= dpacc_addr;
+	end
+end
+
+// Register file read mux
+
+wire [W_DATA-1:0] bridge_prdata;
+wire              bridge_busy;
+
+always @ (*) begin
+	case (dpacc_addr_prev)
+
+	REG_WINDOW: dpacc_rdata = window;
+
+	REG_STATUS: dpacc_rdata = {31'h0, bridge_busy};
+
+	REG_IDR: dpacc_rdata = {
+		IDR_REVISION,
+		IDR_DESIGNER,
+		4'h0,           // CLASS   = no defined class
+		5'h0,           // RES0
+		4'h0,           // VARIANT = 0
+		4'h3            // TYPE    = 3
+	};
+
+	default: dpacc_rdata = (dpacc_addr_prev & 6'h3c) == 6'h3c ? 32'h0 : bridge_prdata;
+
+	endcase
+end
+
+// ----------------------------------------------------------------------------
+// Async bridge
+
+wire              bridge_psel;
+wire              bridge_penable = 1'b0;
+
+wire              bridge_pwrite  = dpacc_wen;
+wire [W_ADDR-1:0] bridge_paddr   = {window[W_ADDR-1:8], dpacc_addr, 2'b00};
+wire [W_DATA-1:0] bridge_pwdata  = dpacc_wdata;
+wire              bridge_pready;
+wire              bridge_pslverr;
+
+opendap_apb_async_bridge #(
+	.W_ADDR              (W_ADDR),
+	.W_DATA              (W_DATA),
+	.N_SYNC_STAGES       (N_SYNC_STAGES),
+	.DST_TIMEOUT_CYCLES  (DST_TIMEOUT_CYCLES)
+) async_bridge (
+	.clk_src     (swclk),
+	.rst_n_src   (rst_n_por),
+
+	.clk_dst     (clk_dst),
+	.rst_n_dst   (rst_n_dst),
+
+	.src_psel    (bridge_psel),
+	.src_penable (bridge_penable),
+	.src_pwrite  (bridge_pwrite),
+	.src_paddr   (bridge_paddr),
+	.src_pwdata  (bridge_pwdata),
+	.src_prdata  (bridge_prdata),
+	.src_pready  (bridge_pready),
+	.src_pslverr (bridge_pslverr),
+	.src_rmw_op  (2'h0),
+
+	.src_abort   (dpacc_abort),
+	.src_busy    (bridge_busy),
+
+	.src_xfer_done   (/* unused */),
+	.src_xfer_cycles (/* unused */),
+
+	.dst_psel    (dst_psel),
+	.dst_penable (dst_penable),
+	.dst_pwrite  (dst_pwrite),
+	.dst_paddr   (dst_paddr),
+	.dst_pwdata  (dst_pwdata),
+	.dst_prdata  (dst_prdata),
+	.dst_pready  (dst_pready),
+	.dst_pslverr (dst_pslverr)
+);
+
+// Everything below bank 0xf is the window.
+wire dpacc_is_window = (dpacc_addr & 6'h3c) != 6'h3c;
+assign bridge_psel = (dpacc_wen || dpacc_ren) && dpacc_is_window;
+
+// Same abort and error handling as the Mem-AP: see opendap_mem_ap_apb.
+assign dpacc_rdy = bridge_pready;
+
+reg error_vld;
+
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		error_vld <= 1'b0;
+	end else begin
+		error_vld <= (bridge_psel || !bridge_pready) && !dpacc_abort;
+	end
+end
+
+assign dpacc_err = bridge_pslverr && error_vld;
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
@@ -0,0 +1 @@
+file opendap_rom_table.v
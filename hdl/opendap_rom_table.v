@@ -0,0 +1,122 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// CoreSight Class 0x1 ROM table, as an APB slave. Point a Mem-AP's BASE
+// register at it so that a debugger can find the components behind that
+// Mem-AP without any prior knowledge of the system.
+//
+// The table is generated from a list of absolute component base addresses,
+// which are converted to the signed offsets that the ROM table format
+// requires. Components can be marked as not present, e.g. when a
+// configuration option removes them, without renumbering the rest of the
+// list. A component can itself be another ROM table.
+//
+// Registers (4 kB, read-only, writes are ignored):
+//
+// - 0x000 + 4 * n: entry n, for n < N_COMPONENTS
+//   - [31:12] signed offset from ROM_BASE to component n
+//   - [1]     format: 1 (32-bit)
+//   - [0]     entry present
+// - 0x000 + 4 * N_COMPONENTS: zero, which terminates the table
+// - 0xfcc MEMTYPE: [0] SYSMEM, system memory is also present on this bus
+// - 0xfd0 PIDR4: 4 kB, JEP106 continuation code
+// - 0xfe0 through 0xfec PIDR0-3: part number, JEP106 identity, revision
+// - 0xff0 through 0xffc CIDR0-3: preamble, class 0x1
+//
+// All other addresses read as zero.
+
+`default_nettype none
+
+module opendap_rom_table #(
+	// Address of this table, 4 kB aligned.
+	parameter [31:0]                 ROM_BASE     = 32'h0000_0000,
+	// Between 1 and 960 components. Entry 0 is the least-significant word of
+	// COMPONENTS, and bit 0 of PRESENT.
+	parameter                        N_COMPONENTS = 1,
+	parameter [32*N_COMPONENTS-1:0]  COMPONENTS   = {N_COMPONENTS{32'h0000_0000}},
+	parameter [N_COMPONENTS-1:0]     PRESENT      = {N_COMPONENTS{1'b1}},
+	parameter                        SYSMEM       = 0,
+
+	// Bring your own JEP106 code
+	parameter [10:0]                 DESIGNER     = 11'h7ff,
+	parameter [11:0]                 PART_NUMBER  = 12'h000,
+	parameter [3:0]                  REVISION     = 4'h0,
+
+	parameter                        W_ADDR       = 12, // do not modify
+	parameter                        W_DATA       = 32  // do not modify
+) (
+	input  wire              clk,
+	input  wire              rst_n,
+
+	input  wire              psel,
+	input  wire              penable,
+	input  wire              pwrite,
+	input  wire [W_ADDR-1:0] paddr,
+	input  wire [W_DATA-1:0] pwdata,
+	output reg  [W_DATA-1:0] prdata,
+	output wire              pready,
+	output wire              pslverr
+);
+
+localparam [9:0] WORD_MEMTYPE = 10'h3f3;
+localparam [9:0] WORD_PIDR4   = 10'h3f4;
+localparam [9:0] WORD_PIDR0   = 10'h3f8;
+localparam [9:0] WORD_PIDR1   = 10'h3f9;
+localparam [9:0] WORD_PIDR2   = 10'h3fa;
+localparam [9:0] WORD_PIDR3   = 10'h3fb;
+localparam [9:0] WORD_CIDR0   = 10'h3fc;
+localparam [9:0] WORD_CIDR1   = 10'h3fd;
+localparam [9:0] WORD_CIDR2   = 10'h3fe;
+localparam [9:0] WORD_CIDR3   = 10'h3ff;
+
+wire [9:0] word = paddr[11:2];
+
+// The offsets are constant, so this all reduces to a lookup table.
+reg [31:0] entry;
+integer i;
+always @ (*) begin
+	entry = 32'h0;
+	for (i = 0; i < N_COMPONENTS; i = i + 1) begin
+		if (word == i) begin
+			entry = {COMPONENTS[32 * i +: 32] - ROM_BASE} & 32'hffff_f000;
+			entry[1:0] = {1'b1, PRESENT[i]};
+		end
+	end
+end
+
+reg [31:0] rdata_next;
+always @ (*) begin
+	case (word)
+	WORD_MEMTYPE: rdata_next = {31'h0, SYSMEM != 0};
+	WORD_PIDR4:   rdata_next = {28'h0, DESIGNER[10:7]};
+	WORD_PIDR0:   rdata_next = {24'h0, PART_NUMBER[7:0]};
+	WORD_PIDR1:   rdata_next = {24'h0, DESIGNER[3:0], PART_NUMBER[11:8]};
+	WORD_PIDR2:   rdata_next = {24'h0, REVISION, 1'b1, DESIGNER[6:4]};
+	WORD_PIDR3:   rdata_next = 32'h0;
+	WORD_CIDR0:   rdata_next = 32'h0d;
+	WORD_CIDR1:   rdata_next = 32'h10;
+	WORD_CIDR2:   rdata_next = 32'h05;
+	WORD_CIDR3:   rdata_next = 32'hb1;
+	default:      rdata_next = entry;
+	endcase
+end
+
+// Register during the setup phase so the lookup is off the pready path.
+always @ (posedge clk or negedge rst_n) begin
+	if (!rst_n) begin
+		prdata <= {W_DATA{1'b0}};
+	end else if (psel && !penable && !pwrite) begin
+		prdata <= rdata_next;
+	end
+end
+
+assign pready = 1'b1;
+assign pslverr = 1'b0;
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
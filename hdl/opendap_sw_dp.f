@@ -1,4 +1,5 @@
 file opendap_sw_dp.v
+file opendap_sw_dp_core.v
 file opendap_sw_dp_serial_comms.v
 file opendap_swd_dormant_monitor.v
 file cells/opendap_swdio_registers.v
@@ -0,0 +1,637 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// SW-DP implementation. Supports DPv2, SWD version 2.
+//
+// This is the clock-agnostic core of the DP: all state advances only on
+// cycles where clk_en is high. You probably want to instantiate one of the
+// wrappers instead:
+//
+// - opendap_sw_dp: clocked directly by SWCLK (clk_en tied high)
+// - opendap_sw_dp_sysclk: clocked by a system clock, oversampling SWCLK
+//
+// Note the AP interface below is clocked by clk, and is not qualified by
+// clk_en: AP responses may arrive on any clk cycle.
+
+`default_nettype none
+
+ module opendap_sw_dp_core #(
+	// DPIDR[16] (MIN) is ignored, and reads back as the MINDP parameter
+	// below. (Also I don't have a JEP106 ID for the DPIDR -- you'll have to
+	// bring your own)
+	parameter DPIDR            = 32'hdeadbeef,
+	parameter TARGETID         = 32'hbaadf00d,
+	// MINDP=1: minimal DP, TRNCNT/MASKLANE/TRNMODE/STICKYCMP are RAZ/WI.
+	// MINDP=0: full DPv2, with the transaction counter and pushed
+	// compare/verify operations.
+	parameter MINDP            = 1,
+	// Register the AP interface outputs (wen/ren/sel/addr/wdata). Breaks the
+	// path from the serial unit's shift registers to the AP.
+	parameter REGISTER_AP_REQ  = 0,
+	// Register the AP interface inputs (rdata/rdy/err). Breaks the path from
+	// AP rdy through the WAIT/OK decision into the serial unit.
+	//
+	// Each slice adds one cycle of latency to every AP access. The DP
+	// returns WAIT for that extra time, so the protocol seen by the host is
+	// unchanged, but the host may need more idle cycles to avoid WAITs.
+	parameter REGISTER_AP_RESP = 0,
+	// Implementation-defined performance counters, readable at address 0x4
+	// with DPBANKSEL = 0x8 through 0xd. See "Performance counters" below.
+	parameter PERF_COUNTERS    = 0
+) (
+	input  wire        clk,
+	input  wire        clk_en,
+	input  wire        rst_n,
+
+	input  wire        swdi,
+	output wire        swdo,
+	output wire        swdo_en,
+
+	output wire        cdbgpwrupreq,
+	input  wire        cdbgpwrupack,
+	output wire        csyspwrupreq,
+	input  wire        csyspwrupack,
+	output wire        cdbgrstreq,
+	input  wire        cdbgrstack,
+
+	input  wire [3:0]  instid,
+	input  wire        eventstat,
+
+	// AP Interface:
+	// - sel, addr and wdata are valid only on the cycle where wen/ren is asserted.
+	// - AP may then take rdy low for arbitrarily many cycles.
+	// - rdata must be valid from the first cycle rdy goes high after a ren,
+	//   until the next time ren/wen is asserted.
+	// - err may go high only on the first cycle rdy is high after a ren/wen.
+	// - when abort is asserted, rdy must go high on the next cycle.
+	output wire [7:0]  ap_sel,
+	output wire [5:0]  ap_addr,
+	output wire [31:0] ap_wdata,
+
+	output wire        ap_wen,
+	output wire        ap_ren,
+	output wire        ap_abort,
+
+	input  wire [31:0] ap_rdata,
+	input  wire        ap_rdy,
+	input  wire        ap_err
+);
+
+wire [1:0]  hostacc_addr;
+wire        hostacc_r_nw;
+wire        hostacc_ap_ndp;
+wire [31:0] hostacc_wdata;
+wire        hostacc_en_raw;
+reg  [31:0] hostacc_rdata;
+wire        hostacc_fault;
+wire        hostacc_wait;
+
+// The serial unit's strobes are valid for the whole of a clk_en period.
+// Qualify them with clk_en to get single-cycle pulses for the register file
+// and the AP interface.
+wire        hostacc_en    = hostacc_en_raw && clk_en;
+
+// AP interface as seen by the DP logic, before the optional register slices
+// at the bottom of this file. Same rules as the AP interface ports.
+wire [7:0]  core_ap_sel;
+wire [5:0]  core_ap_addr;
+wire [31:0] core_ap_wdata;
+wire        core_ap_wen;
+wire        core_ap_ren;
+wire [31:0] core_ap_rdata;
+wire        core_ap_rdy;
+wire        core_ap_err;
+
+wire        hostacc_write = hostacc_en && !hostacc_fault && !hostacc_r_nw;
+wire        hostacc_read  = hostacc_en && !hostacc_fault &&  hostacc_r_nw;
+
+wire        set_wdataerr_raw;
+wire        set_stickyorun_raw;
+wire        clear_readok_raw; // driven by serial unit
+wire        set_wdataerr = set_wdataerr_raw && clk_en;
+wire        set_stickyorun = set_stickyorun_raw && clk_en;
+wire        set_stickyerr = core_ap_rdy && core_ap_err;
+wire        set_stickycmp;
+wire        set_readok = hostacc_read && (hostacc_ap_ndp || hostacc_addr == 2'b11);
+wire        clear_readok = clear_readok_raw && clk_en;
+
+wire        stat_ack_ok_raw;
+wire        stat_ack_wait_raw;
+wire        stat_ack_fault_raw;
+wire        stat_protocol_err_raw;
+
+// ----------------------------------------------------------------------------
+// DP register file
+
+localparam [31:0] DPIDR_MIN = 32'h00010000;
+localparam [31:0] DPIDR_VAL = (DPIDR & ~DPIDR_MIN) | (MINDP ? DPIDR_MIN : 32'h0);
+
+reg [7:0] select_apsel;
+reg [3:0] select_apbanksel;
+reg [3:0] select_dpbanksel;
+
+always @ (posedge clk or negedge rst_n) begin
+	if (!rst_n) begin
+		select_apsel <= 8'h0;
+		select_apbanksel <= 4'h0;
+		select_dpbanksel <= 4'h0;
+	end else if (hostacc_write && !hostacc_ap_ndp && hostacc_addr == 2'b10) begin
+		select_apsel <= hostacc_wdata[31:24];
+		select_apbanksel <= hostacc_wdata[7:4];
+		select_dpbanksel <= hostacc_wdata[3:0];
+	end
+end
+
+reg ctrl_stat_csyspwrupreq;
+reg ctrl_stat_cdbgpwrupreq;
+reg ctrl_stat_cdbgrstreq;
+reg ctrl_stat_orundetect;
+reg ctrl_stat_readok;
+reg ctrl_stat_stickyerr;
+reg ctrl_stat_stickyorun;
+reg ctrl_stat_wdataerr;
+reg ctrl_stat_stickycmp;
+reg [1:0]  ctrl_stat_trnmode;
+reg [3:0]  ctrl_stat_masklane;
+reg [11:0] ctrl_stat_trncnt;
+
+localparam TRNMODE_NORMAL         = 2'b00;
+localparam TRNMODE_PUSHED_VERIFY  = 2'b01;
+localparam TRNMODE_PUSHED_COMPARE = 2'b10;
+
+wire trn_repeat; // An AP access is being reissued due to nonzero TRNCNT
+
+assign csyspwrupreq = ctrl_stat_csyspwrupreq;
+assign cdbgpwrupreq = ctrl_stat_cdbgpwrupreq;
+assign cdbgrstreq   = ctrl_stat_cdbgrstreq;
+
+always @ (posedge clk or negedge rst_n) begin
+	if (!rst_n) begin
+		ctrl_stat_cdbgpwrupreq <= 1'b0;
+		ctrl_stat_csyspwrupreq <= 1'b0;
+		ctrl_stat_orundetect <= 1'b0;
+		ctrl_stat_readok <= 1'b0;
+		ctrl_stat_stickyerr <= 1'b0;
+		ctrl_stat_stickyorun <= 1'b0;
+		ctrl_stat_wdataerr <= 1'b0;
+		ctrl_stat_stickycmp <= 1'b0;
+		ctrl_stat_trnmode <= TRNMODE_NORMAL;
+		ctrl_stat_masklane <= 4'h0;
+		ctrl_stat_trncnt <= 12'h000;
+	end else begin
+		if (hostacc_write && !hostacc_ap_ndp && hostacc_addr == 2'b00) begin
+			// ABORT write
+			ctrl_stat_stickyorun <= ctrl_stat_stickyorun && !hostacc_wdata[4];
+			ctrl_stat_wdataerr <= ctrl_stat_wdataerr && !hostacc_wdata[3];
+			ctrl_stat_stickyerr <= ctrl_stat_stickyerr && !hostacc_wdata[2];
+			ctrl_stat_stickycmp <= ctrl_stat_stickycmp && !hostacc_wdata[1];
+			// TRNCNT is UNKNOWN after DAPABORT. Zero it so the abandoned
+			// sequence is not resumed.
+			if (hostacc_wdata[0])
+				ctrl_stat_trncnt <= 12'h000;
+		end
+		if (hostacc_write && !hostacc_ap_ndp && hostacc_addr == 2'b01 && select_dpbanksel == 4'h0) begin
+			// CTRL/STAT write
+			ctrl_stat_csyspwrupreq <= hostacc_wdata[30];
+			ctrl_stat_cdbgpwrupreq <= hostacc_wdata[28];
+			ctrl_stat_cdbgrstreq   <= hostacc_wdata[26];
+			// If MINDP, implement TRNCNT/MASKLANE/TRNMODE as RAZ/WI. TRNMODE=3
+			// is reserved, and we treat it as normal mode.
+			if (!MINDP) begin
+				ctrl_stat_trncnt <= hostacc_wdata[23:12];
+				ctrl_stat_masklane <= hostacc_wdata[11:8];
+				ctrl_stat_trnmode <= &hostacc_wdata[3:2] ? TRNMODE_NORMAL : hostacc_wdata[3:2];
+			end
+			ctrl_stat_orundetect <= hostacc_wdata[0];
+			// B1.2 says STICKYORUN becomes UNKNOWN if ORUNDETECT is cleared when
+			// STICKYORUN is left set. However it seems polite to just clear it.
+			ctrl_stat_stickyorun <= ctrl_stat_stickyorun && hostacc_wdata[0];
+		end
+		if (set_wdataerr)
+			ctrl_stat_wdataerr <= 1'b1;
+		if (set_stickyorun)
+			ctrl_stat_stickyorun <= 1'b1;
+		if (set_stickyerr)
+			ctrl_stat_stickyerr <= 1'b1;
+		if (set_stickycmp)
+			ctrl_stat_stickycmp <= 1'b1;
+		if (trn_repeat)
+			ctrl_stat_trncnt <= ctrl_stat_trncnt - 12'h001;
+		ctrl_stat_readok <= (ctrl_stat_readok || set_readok) && !clear_readok;
+	end
+end
+
+// Performance counters, declared here for the read mux. See below.
+reg [31:0] perf_ack_ok;
+reg [31:0] perf_ack_wait;
+reg [31:0] perf_ack_fault;
+reg [31:0] perf_protocol_err;
+reg [31:0] perf_ap_reads;
+reg [31:0] perf_ap_writes;
+
+always @ (*) begin
+	if (hostacc_ap_ndp) begin
+		hostacc_rdata = core_ap_rdata;
+	end else casez ({hostacc_addr, select_dpbanksel})
+		6'h0z: hostacc_rdata = DPIDR_VAL;
+
+		6'h10: hostacc_rdata = {
+			csyspwrupack,
+			ctrl_stat_csyspwrupreq,
+			cdbgpwrupack,
+			ctrl_stat_cdbgpwrupreq,
+			cdbgrstack,
+			ctrl_stat_cdbgrstreq,
+			2'b00,                            // RES0
+			ctrl_stat_trncnt,
+			ctrl_stat_masklane,
+			ctrl_stat_wdataerr,
+			ctrl_stat_readok,
+			ctrl_stat_stickyerr,
+			ctrl_stat_stickycmp,
+			ctrl_stat_trnmode,
+			ctrl_stat_stickyorun,
+			ctrl_stat_orundetect
+		};
+
+		6'h11: hostacc_rdata = 32'h0000_0040; // DLCR
+
+		6'h12: hostacc_rdata = TARGETID;
+
+		6'h13: hostacc_rdata = {              // DLPIDR
+			instid, // TINSTANCE
+			24'h0,  // RES0
+			4'h1    // PROTVSN
+		};
+
+		6'h14: hostacc_rdata = {              // EVENTSTAT
+			31'h0,  // RES0
+			eventstat
+		};
+
+		6'h18: hostacc_rdata = perf_ack_ok;
+		6'h19: hostacc_rdata = perf_ack_wait;
+		6'h1a: hostacc_rdata = perf_ack_fault;
+		6'h1b: hostacc_rdata = perf_protocol_err;
+		6'h1c: hostacc_rdata = perf_ap_reads;
+		6'h1d: hostacc_rdata = perf_ap_writes;
+
+		6'h1z: hostacc_rdata = 32'h0000_0000; // RES0
+
+		6'h2z: hostacc_rdata = 32'h0000_0000; // RESEND is handled inside the serial comms.
+
+		6'h3z: hostacc_rdata = core_ap_rdata; // RDBUFF
+	endcase
+end
+
+reg resend_possible;
+
+always @ (posedge clk or negedge rst_n) begin
+	if (!rst_n) begin
+		resend_possible <= 1'b0;
+	end else if (hostacc_en) begin
+		// B2.2.8 says RESEND returns specifically the last AP read or RDBUFF
+		// read, not just the last read in general.
+		//
+		// Since we are just recirculating the shift register, we need to fail
+		// a RESEND if any *other* type of read takes place since the last
+		// AP/RDBUFF read, as well as if any write takes place. Otherwise we
+		// would give the wrong data!
+		//
+		// (RESEND is the only other exception -- we can repeatedly send the
+		// same data as many times as the host likes.)
+		resend_possible <= hostacc_read && (
+			hostacc_ap_ndp ||        // AP read
+			hostacc_addr == 2'b11 || // RDBUFF
+			hostacc_addr == 2'b10    // RESEND
+		);
+	end
+end
+
+wire hostacc_protocol_err =
+	(hostacc_write && !hostacc_ap_ndp && {hostacc_addr, select_dpbanksel} == 6'h11 && // Bad TURNROUND
+		hostacc_wdata[9:8] != 2'b00) ||
+	(hostacc_read  && !hostacc_ap_ndp &&  hostacc_addr                    == 2'b10 && // Bad RESEND
+		!resend_possible);
+
+// ----------------------------------------------------------------------------
+// Serial comms unit
+
+// See B4.2.3, B4.2.4 for this list (same list of exceptions for both WAIT and
+// FAULT). See also B4.2.8 for a summary of all target responses.
+
+// Bit of a hole in the spec here as you may need to write SELECT to select
+// CTRL/STAT in the first place, so if DPBANKSEL is currently nonzero, it's
+// impossible to read CTRL/STAT and determine which flag is causing your
+// FAULT. Fairly minor issue as the nonzero DPBANKSEL registers are much less
+// used than CTRL/STAT.
+
+wire access_always_ok = !hostacc_ap_ndp && (
+	 hostacc_r_nw && hostacc_addr == 2'b00 ||                          // DPIDR read
+	!hostacc_r_nw && hostacc_addr == 2'b00 ||                          // ABORT write
+	 hostacc_r_nw && hostacc_addr == 2'b01 && select_dpbanksel == 4'h0 // C/S   read
+);
+
+// Most accesses when a sticky flag is set cause a FAULT response. Same is
+// true for WAIT responses when an AP transfer is in flight. The exception is
+// those accesses which are necessary for diagnosing and clearing the fault
+// condition.
+
+wire any_sticky_errors = ctrl_stat_stickyorun || ctrl_stat_stickyerr || ctrl_stat_wdataerr ||
+	ctrl_stat_stickycmp;
+
+// We are decoding this straight out of the serial comms' shift register, so
+// must be combinatorial, and not a function of hostacc_en.
+
+assign hostacc_fault = any_sticky_errors && !access_always_ok;
+
+// The AP also counts as busy whilst a TRNCNT sequence is still running, even
+// on cycles where rdy is high between two of its transactions.
+
+wire ap_busy;
+
+assign hostacc_wait = ap_busy && !access_always_ok;
+
+opendap_sw_dp_serial_comms serial_comms (
+	.clk                 (clk),
+	.clk_en              (clk_en),
+	.rst_n               (rst_n),
+
+	.swdi                (swdi),
+	.swdo                (swdo),
+	.swdo_en             (swdo_en),
+
+	.bus_addr            (hostacc_addr),
+	.bus_r_nw            (hostacc_r_nw),
+	.bus_ap_ndp          (hostacc_ap_ndp),
+	.bus_wdata           (hostacc_wdata),
+	.bus_rdata           (hostacc_rdata),
+	.bus_en              (hostacc_en_raw),
+
+	.targetsel_expected  ({instid, TARGETID[27:0]}),
+	.dp_set_wdataerr     (set_wdataerr_raw),
+	.dp_set_stickyorun   (set_stickyorun_raw),
+	.dp_clear_readok     (clear_readok_raw),
+	.dp_orundetect       (ctrl_stat_orundetect),
+	.dp_acc_fault        (hostacc_fault),
+	.dp_acc_protocol_err (hostacc_protocol_err),
+	.dp_acc_wait         (hostacc_wait),
+
+	.stat_ack_ok         (stat_ack_ok_raw),
+	.stat_ack_wait       (stat_ack_wait_raw),
+	.stat_ack_fault      (stat_ack_fault_raw),
+	.stat_protocol_err   (stat_protocol_err_raw)
+);
+
+// ----------------------------------------------------------------------------
+// Performance counters (not present unless PERF_COUNTERS)
+
+// Read-only at address 0x4, DPBANKSEL = 0x8 to 0xd:
+//
+// - 0x8: OK responses
+// - 0x9: WAIT responses
+// - 0xa: FAULT responses
+// - 0xb: Protocol errors: bad header, bad write data parity, or an access
+//        which causes lockout (e.g. bad RESEND). Note the line reset
+//        sequence looks like a bad header if the line was active, so every
+//        line reset from the active state counts once.
+// - 0xc: AP reads issued (including pushed operations and TRNCNT repeats)
+// - 0xd: AP writes issued (including TRNCNT repeats)
+//
+// The counters saturate at all-ones. Writing any value to address 0x4 with
+// DPBANKSEL[3] set clears all of them.
+
+wire perf_clear = hostacc_write && !hostacc_ap_ndp && hostacc_addr == 2'b01 &&
+	select_dpbanksel[3];
+
+always @ (posedge clk or negedge rst_n) begin
+	if (!rst_n) begin
+		perf_ack_ok <= 32'h0;
+		perf_ack_wait <= 32'h0;
+		perf_ack_fault <= 32'h0;
+		perf_protocol_err <= 32'h0;
+		perf_ap_reads <= 32'h0;
+		perf_ap_writes <= 32'h0;
+	end else if (PERF_COUNTERS) begin
+		if (perf_clear) begin
+			perf_ack_ok <= 32'h0;
+			perf_ack_wait <= 32'h0;
+			perf_ack_fault <= 32'h0;
+			perf_protocol_err <= 32'h0;
+			perf_ap_reads <= 32'h0;
+			perf_ap_writes <= 32'h0;
+		end else begin
+			if (stat_ack_ok_raw && clk_en)
+				perf_ack_ok <= perf_ack_ok + {31'h0, ~&perf_ack_ok};
+			if (stat_ack_wait_raw && clk_en)
+				perf_ack_wait <= perf_ack_wait + {31'h0, ~&perf_ack_wait};
+			if (stat_ack_fault_raw && clk_en)
+				perf_ack_fault <= perf_ack_fault + {31'h0, ~&perf_ack_fault};
+			if (stat_protocol_err_raw && clk_en)
+				perf_protocol_err <= perf_protocol_err + {31'h0, ~&perf_protocol_err};
+			if (core_ap_ren)
+				perf_ap_reads <= perf_ap_reads + {31'h0, ~&perf_ap_reads};
+			if (core_ap_wen)
+				perf_ap_writes <= perf_ap_writes + {31'h0, ~&perf_ap_writes};
+		end
+	end
+end
+
+// ----------------------------------------------------------------------------
+// Pushed operations and transaction counter (not present if MINDP)
+
+// Pushed verify/compare: an AP write is converted into an AP read. When the
+// read completes, the read data is compared against the write data, under
+// MASKLANE. STICKYCMP is set on a mismatch (verify) or match (compare).
+//
+// Transaction counter: when an AP access completes with TRNCNT nonzero,
+// TRNCNT is decremented and the same access is reissued to the AP, so
+// TRNCNT=n gives a total of n + 1 transactions. The sequence stops early if
+// the access errors or sets STICKYCMP, so e.g. a pushed compare with a large
+// TRNCNT will poll an address until it holds the expected value, and a
+// pushed verify with TAR auto-increment checks a whole block for one SWD
+// write. The host sees WAIT until the sequence finishes.
+
+reg        ap_acc_in_flight;
+reg        ap_acc_pushed;
+reg        ap_acc_compare;
+reg        ap_acc_r_nw;
+reg [1:0]  ap_acc_addr;
+reg [31:0] ap_acc_wdata;
+
+wire hostacc_pushed = !MINDP && hostacc_ap_ndp && !hostacc_r_nw && (
+	ctrl_stat_trnmode == TRNMODE_PUSHED_VERIFY ||
+	ctrl_stat_trnmode == TRNMODE_PUSHED_COMPARE
+);
+
+wire ap_acc_done = !MINDP && ap_acc_in_flight && core_ap_rdy;
+
+wire [31:0] pushed_mask = {
+	{8{ctrl_stat_masklane[3]}},
+	{8{ctrl_stat_masklane[2]}},
+	{8{ctrl_stat_masklane[1]}},
+	{8{ctrl_stat_masklane[0]}}
+};
+
+wire pushed_match = ~|((core_ap_rdata ^ ap_acc_wdata) & pushed_mask);
+
+assign set_stickycmp = ap_acc_done && ap_acc_pushed && !core_ap_err &&
+	pushed_match == ap_acc_compare;
+
+assign trn_repeat = ap_acc_done && |ctrl_stat_trncnt && !core_ap_err && !set_stickycmp &&
+	!any_sticky_errors && !ap_abort;
+
+assign ap_busy = !core_ap_rdy || (!MINDP && ap_acc_in_flight && |ctrl_stat_trncnt);
+
+always @ (posedge clk or negedge rst_n) begin
+	if (!rst_n) begin
+		ap_acc_in_flight <= 1'b0;
+		ap_acc_pushed <= 1'b0;
+		ap_acc_compare <= 1'b0;
+		ap_acc_r_nw <= 1'b0;
+		ap_acc_addr <= 2'b00;
+		ap_acc_wdata <= 32'h0;
+	end else if (!MINDP) begin
+		if (ap_abort) begin
+			ap_acc_in_flight <= 1'b0;
+		end else if (core_ap_wen || core_ap_ren) begin
+			ap_acc_in_flight <= 1'b1;
+		end else if (core_ap_rdy) begin
+			ap_acc_in_flight <= 1'b0;
+		end
+		// Remember the host's access so that it can be repeated.
+		if (hostacc_en && hostacc_ap_ndp && !hostacc_fault) begin
+			ap_acc_pushed <= hostacc_pushed;
+			ap_acc_compare <= ctrl_stat_trnmode == TRNMODE_PUSHED_COMPARE;
+			ap_acc_r_nw <= hostacc_r_nw || hostacc_pushed;
+			ap_acc_addr <= hostacc_addr;
+			ap_acc_wdata <= hostacc_wdata;
+		end
+	end
+end
+
+// ----------------------------------------------------------------------------
+// AP signalling
+
+// Note there is no conflict between trn_repeat and host accesses, as the
+// host gets a WAIT response for AP accesses until TRNCNT reaches zero.
+
+assign core_ap_wen = hostacc_write && hostacc_ap_ndp && !hostacc_pushed ||
+	trn_repeat && !ap_acc_r_nw;
+assign core_ap_ren = hostacc_read && hostacc_ap_ndp || hostacc_write && hostacc_pushed ||
+	trn_repeat && ap_acc_r_nw;
+assign core_ap_sel = select_apsel;
+assign core_ap_addr = {select_apbanksel, trn_repeat ? ap_acc_addr : hostacc_addr};
+assign core_ap_wdata = trn_repeat ? ap_acc_wdata : hostacc_wdata;
+// DAPABORT is lsb of the ABORT register. When we assert this flag, rdy must
+// be asserted high on the next cycle. It is never registered, for this
+// reason. (There is no conflict with a request sitting in the request slice,
+// as ABORT is a DP write, which can't be issued within a cycle of an AP
+// access.)
+assign ap_abort = hostacc_write && !hostacc_ap_ndp && hostacc_addr == 2'b00 && hostacc_wdata[0];
+
+// ----------------------------------------------------------------------------
+// AP interface register slices
+
+// High when a request is sitting in the request slice, and has not yet
+// reached the AP. The AP's own rdy doesn't reflect the request yet, so we
+// must hold rdy low on its behalf.
+wire ap_req_in_slice;
+
+generate
+if (REGISTER_AP_REQ) begin: ap_req_slice
+
+	reg [7:0]  ap_sel_r;
+	reg [5:0]  ap_addr_r;
+	reg [31:0] ap_wdata_r;
+	reg        ap_wen_r;
+	reg        ap_ren_r;
+
+	always @ (posedge clk or negedge rst_n) begin
+		if (!rst_n) begin
+			ap_sel_r <= 8'h0;
+			ap_addr_r <= 6'h0;
+			ap_wdata_r <= 32'h0;
+			ap_wen_r <= 1'b0;
+			ap_ren_r <= 1'b0;
+		end else begin
+			ap_wen_r <= core_ap_wen;
+			ap_ren_r <= core_ap_ren;
+			if (core_ap_wen || core_ap_ren) begin
+				ap_sel_r <= core_ap_sel;
+				ap_addr_r <= core_ap_addr;
+				ap_wdata_r <= core_ap_wdata;
+			end
+		end
+	end
+
+	assign ap_sel = ap_sel_r;
+	assign ap_addr = ap_addr_r;
+	assign ap_wdata = ap_wdata_r;
+	assign ap_wen = ap_wen_r;
+	assign ap_ren = ap_ren_r;
+	assign ap_req_in_slice = ap_wen_r || ap_ren_r;
+
+end else begin: no_ap_req_slice
+
+	assign ap_sel = core_ap_sel;
+	assign ap_addr = core_ap_addr;
+	assign ap_wdata = core_ap_wdata;
+	assign ap_wen = core_ap_wen;
+	assign ap_ren = core_ap_ren;
+	assign ap_req_in_slice = 1'b0;
+
+end
+endgenerate
+
+wire ap_rdy_qualified = ap_rdy && !ap_req_in_slice;
+
+generate
+if (REGISTER_AP_RESP) begin: ap_resp_slice
+
+	reg [31:0] ap_rdata_r;
+	reg        ap_rdy_r;
+	reg        ap_err_r;
+
+	always @ (posedge clk or negedge rst_n) begin
+		if (!rst_n) begin
+			ap_rdata_r <= 32'h0;
+			ap_rdy_r <= 1'b1;
+			ap_err_r <= 1'b0;
+		end else begin
+			ap_rdata_r <= ap_rdata;
+			if (ap_abort) begin
+				ap_rdy_r <= 1'b1;
+				ap_err_r <= 1'b0;
+			end else if (core_ap_wen || core_ap_ren) begin
+				// The AP can't have seen this access yet, so we must drop rdy
+				// on the next cycle ourselves.
+				ap_rdy_r <= 1'b0;
+				ap_err_r <= 1'b0;
+			end else begin
+				ap_rdy_r <= ap_rdy_qualified;
+				ap_err_r <= ap_err && ap_rdy_qualified;
+			end
+		end
+	end
+
+	assign core_ap_rdata = ap_rdata_r;
+	assign core_ap_rdy = ap_rdy_r;
+	assign core_ap_err = ap_err_r;
+
+end else begin: no_ap_resp_slice
+
+	assign core_ap_rdata = ap_rdata;
+	assign core_ap_rdy = ap_rdy_qualified;
+	assign core_ap_err = ap_err && !ap_req_in_slice;
+
+end
+endgenerate
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
@@ -6,16 +6,20 @@
 // Serialise and deserialise data. Track link state, detect parity or serial
 // protocol errors, provide OK/WAIT/FAULT responses. Perform parallel
 // accesses on the core DP logic, which may be forwarded on to the AP.
+//
+// All state advances only when clk_en is high (once per SWCLK rising edge).
+// Outputs to the DP are valid for the entire clk_en period.
 
 `default_nettype none
 
  module opendap_sw_dp_serial_comms (
-	input  wire        swclk,
+	input  wire        clk,
+	input  wire        clk_en,
 	input  wire        rst_n,
 
 	input  wire        swdi,
-	output reg         swdo,
-	output reg         swdo_en,
+	output wire        swdo,
+	output wire        swdo_en,
 
 	output wire [1:0]  bus_addr,
 	output wire        bus_r_nw,
@@ -32,7 +36,13 @@
 	input  wire        dp_orundetect,
 	input  wire        dp_acc_fault,
 	input  wire        dp_acc_protocol_err,
-	input  wire        dp_acc_wait
+	input  wire        dp_acc_wait,
+
+	// Event strobes for performance counters, valid with bus_en timing:
+	output reg         stat_ack_ok,
+	output reg         stat_ack_wait,
+	output reg         stat_ack_fault,
+	output reg         stat_protocol_err
 );
 
 // ----------------------------------------------------------------------------
@@ -47,7 +57,8 @@ reg  swdo_nxt;
 reg  swdo_en_nxt;
 
 opendap_swdio_flops io_flops (
-	.clk             (swclk),
+	.clk             (clk),
+	.clk_en          (clk_en),
 	.rst_n           (rst_n),
 
 	.dp_swdo_next    (swdo_nxt),
@@ -70,7 +81,8 @@ wire enter_dormant;
 wire line_reset;
 
 opendap_swd_dormant_monitor dormant_monitor (
-	.swclk         (swclk),
+	.clk           (clk),
+	.clk_en        (clk_en),
 	.rst_n         (rst_n),
 
 	.swdi_reg      (swdi_reg),
@@ -143,6 +155,11 @@ always @ (*) begin
 	dp_set_stickyorun = 1'b0;
 	dp_clear_readok = 1'b0;
 
+	stat_ack_ok = 1'b0;
+	stat_ack_wait = 1'b0;
+	stat_ack_fault = 1'b0;
+	stat_protocol_err = 1'b0;
+
 	swdo_nxt = 1'b0;
 	swdo_en_nxt = 1'b0;
 
@@ -169,6 +186,7 @@ always @ (*) begin
 			if (!header_ok) begin
 				link_state_nxt = LINK_LOCKEDOUT;
 				dp_set_stickyorun = dp_orundetect;
+				stat_protocol_err = 1'b1;
 			end else if (header_is_targetsel_write) begin
 				if (link_state == LINK_RESET) begin
 					// Do not drive swdo_en -- TARGETSEL is supposed to be unacknowledged.
@@ -194,18 +212,22 @@ always @ (*) begin
 					phase_nxt = PHASE_ACK_FAULT;
 					dp_set_stickyorun = dp_orundetect;
 					dp_clear_readok = header_modifies_readok;
+					stat_ack_fault = 1'b1;
 				end else if (dp_acc_wait) begin
 					phase_nxt = PHASE_ACK_WAIT;
 					dp_set_stickyorun = dp_orundetect;
 					dp_clear_readok = header_modifies_readok;
+					stat_ack_wait = 1'b1;
 				end else begin
 					bus_en = header_r_nw;
 					if (dp_acc_protocol_err) begin
 						link_state_nxt = LINK_LOCKEDOUT;
 						swdo_en_nxt = 1'b0;
+						stat_protocol_err = 1'b1;
 					end else begin
 						phase_nxt = PHASE_ACK_OK;
 						swdo_nxt = 1'b1;
+						stat_ack_ok = 1'b1;
 					end
 				end
 			end
@@ -296,10 +318,12 @@ always @ (*) begin
 				phase_nxt = PHASE_IDLE;
 				if (swdi_reg != data_parity) begin
 					dp_set_wdataerr = 1'b1;
+					stat_protocol_err = 1'b1;
 				end else begin
 					bus_en = 1'b1;
 					if (dp_acc_protocol_err) begin
 						link_state_nxt = LINK_LOCKEDOUT;
+						stat_protocol_err = 1'b1;
 					end
 				end
 			end else begin
@@ -349,29 +373,25 @@ always @ (*) begin
 
 end
 
-always @ (posedge swclk or negedge rst_n) begin
+always @ (posedge clk or negedge rst_n) begin
 	if (!rst_n) begin
 		link_state  <= LINK_DORMANT;
 		phase       <= PHASE_IDLE;
 		bit_ctr     <= 6'h0;
 		data_parity <= 1'b0;
-		swdo        <= 1'b0;
-		swdo_en     <= 1'b0;
-	end else begin
+	end else if (clk_en) begin
 		link_state  <= link_state_nxt;
 		phase       <= phase_nxt;
 		bit_ctr     <= bit_ctr_nxt;
 		data_parity <= data_parity_nxt;
-		swdo        <= swdo_nxt;
-		swdo_en     <= swdo_en_nxt;
 	end
 end
 
-always @ (posedge swclk or negedge rst_n) begin
+always @ (posedge clk or negedge rst_n) begin
 	if (!rst_n) begin
 		data_sreg <= 32'h0;
 		header_sreg <= 6'h0;
-	end else begin
+	end else if (clk_en) begin
 		// On reads we recirculate the data so that we can RESEND it.
 		if (data_sreg_en)
 			data_sreg <= {header_r_nw ? data_sreg[0] : swdi_reg, data_sreg[31:1]};
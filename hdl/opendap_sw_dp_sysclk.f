@@ -0,0 +1,6 @@
+file opendap_sw_dp_sysclk.v
+file opendap_sw_dp_core.v
+file opendap_sw_dp_serial_comms.v
+file opendap_swd_dormant_monitor.v
+file cells/opendap_swdio_registers.v
+file cells/opendap_sync_1bit.v
@@ -0,0 +1,160 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// SW-DP clocked by a free-running system clock, which oversamples SWCLK.
+//
+// SWCLK and SWDI are passed through identical synchronisers, and the DP
+// advances by one SWD bit on each rising edge of the synchronised SWCLK. The
+// AP interface is then in the clk domain, so an AP on the same clock can
+// skip the clock crossing altogether (e.g. opendap_mem_ap_apb with
+// N_SYNC_STAGES = 0). This removes the SWCLK-domain synchroniser delay from
+// every AP access, so the host can get away with fewer idle cycles before
+// it stops seeing WAITs -- and the AP logic no longer needs SWCLK to be
+// running to make progress.
+//
+// Limits on SWCLK frequency, in clk periods (tclk). Let N = N_SYNC_STAGES:
+//
+// - Both the high and low phases of SWCLK must last at least 2 * tclk, so
+//   that every edge is seen and SWDI is sampled clear of its transitions
+//   (the host launches SWDI on the falling edge).
+//
+// - SWDO changes up to (N + 2) * tclk after the SWCLK rising edge, plus pad
+//   delays. Allowing one tclk for those, a host which samples on the next
+//   rising edge needs a SWCLK period of more than (N + 3) * tclk, and a host
+//   which samples on the falling edge needs a half period of more than
+//   (N + 3) * tclk.
+//
+// So for the default N = 2, clk must run at least 10x faster than SWCLK to
+// support all hosts, or 5x for hosts which sample on the rising edge.
+//
+// rst_n must be synchronised to clk externally.
+
+`default_nettype none
+
+ module opendap_sw_dp_sysclk #(
+	parameter DPIDR            = 32'hdeadbeef,
+	parameter TARGETID         = 32'hbaadf00d,
+	parameter MINDP            = 1,
+	parameter REGISTER_AP_REQ  = 0,
+	parameter REGISTER_AP_RESP = 0,
+	parameter PERF_COUNTERS    = 0,
+	parameter N_SYNC_STAGES    = 2
+) (
+	input  wire        clk,
+	input  wire        rst_n,
+
+	// Raw pad signals, asynchronous to clk
+	input  wire        swclk,
+	input  wire        swdi,
+	output wire        swdo,
+	output wire        swdo_en,
+
+	output wire        cdbgpwrupreq,
+	input  wire        cdbgpwrupack,
+	output wire        csyspwrupreq,
+	input  wire        csyspwrupack,
+	output wire        cdbgrstreq,
+	input  wire        cdbgrstack,
+
+	input  wire [3:0]  instid,
+	input  wire        eventstat,
+
+	// AP Interface, clocked by clk (see opendap_sw_dp_core for the rules)
+	output wire [7:0]  ap_sel,
+	output wire [5:0]  ap_addr,
+	output wire [31:0] ap_wdata,
+
+	output wire        ap_wen,
+	output wire        ap_ren,
+	output wire        ap_abort,
+
+	input  wire [31:0] ap_rdata,
+	input  wire        ap_rdy,
+	input  wire        ap_err
+);
+
+// ----------------------------------------------------------------------------
+// SWCLK edge detection
+
+wire swclk_sync;
+wire swdi_sync;
+
+opendap_sync_1bit #(
+	.N_STAGES (N_SYNC_STAGES)
+) sync_swclk (
+	.clk   (clk),
+	.rst_n (rst_n),
+	.i     (swclk),
+	.o     (swclk_sync)
+);
+
+// Same depth as SWCLK, so SWDI is sampled at the same point relative to the
+// SWCLK edge as it would be by a flop clocked directly by SWCLK.
+opendap_sync_1bit #(
+	.N_STAGES (N_SYNC_STAGES)
+) sync_swdi (
+	.clk   (clk),
+	.rst_n (rst_n),
+	.i     (swdi),
+	.o     (swdi_sync)
+);
+
+reg swclk_sync_prev;
+
+always @ (posedge clk or negedge rst_n) begin
+	if (!rst_n) begin
+		swclk_sync_prev <= 1'b0;
+	end else begin
+		swclk_sync_prev <= swclk_sync;
+	end
+end
+
+wire swclk_rise = swclk_sync && !swclk_sync_prev;
+
+// ----------------------------------------------------------------------------
+// DP core
+
+opendap_sw_dp_core #(
+	.DPIDR            (DPIDR),
+	.TARGETID         (TARGETID),
+	.MINDP            (MINDP),
+	.REGISTER_AP_REQ  (REGISTER_AP_REQ),
+	.REGISTER_AP_RESP (REGISTER_AP_RESP),
+	.PERF_COUNTERS    (PERF_COUNTERS)
+) core (
+	.clk          (clk),
+	.clk_en       (swclk_rise),
+	.rst_n        (rst_n),
+
+	.swdi         (swdi_sync),
+	.swdo         (swdo),
+	.swdo_en      (swdo_en),
+
+	.cdbgpwrupreq (cdbgpwrupreq),
+	.cdbgpwrupack (cdbgpwrupack),
+	.csyspwrupreq (csyspwrupreq),
+	.csyspwrupack (csyspwrupack),
+	.cdbgrstreq   (cdbgrstreq),
+	.cdbgrstack   (cdbgrstack),
+
+	.instid       (instid),
+	.eventstat    (eventstat),
+
+	.ap_sel       (ap_sel),
+	.ap_addr      (ap_addr),
+	.ap_wdata     (ap_wdata),
+	.ap_wen       (ap_wen),
+	.ap_ren       (ap_ren),
+	.ap_abort     (ap_abort),
+	.ap_rdata     (ap_rdata),
+	.ap_rdy       (ap_rdy),
+	.ap_err       (ap_err)
+);
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
@@ -5,11 +5,14 @@
 
 // Watch for switches between the Dormant and SWD link states.
 // Ref: IHI0031F, "B5.3 Dormant Operation"
+//
+// State advances only when clk_en is high (once per SWCLK rising edge).
 
 `default_nettype none
 
 module opendap_swd_dormant_monitor (
-	input  wire swclk,
+	input  wire clk,
+	input  wire clk_en,
 	input  wire rst_n,
 
 	input  wire swdi_reg,
@@ -31,13 +34,15 @@ localparam [6:0]  LFSR_TAPS  = 7'b1001011;
 reg  [6:0] lfsr;
 reg        lfsr_resync;
 
-always @ (posedge swclk or negedge rst_n) begin
+always @ (posedge clk or negedge rst_n) begin
 	if (!rst_n) begin
 		lfsr <= LFSR_INIT;
-	end else if (lfsr_resync) begin
-		lfsr <= LFSR_INIT;
-	end else begin
-		lfsr <= {^(lfsr & LFSR_TAPS), lfsr[6:1]};
+	end else if (clk_en) begin
+		if (lfsr_resync) begin
+			lfsr <= LFSR_INIT;
+		end else begin
+			lfsr <= {^(lfsr & LFSR_TAPS), lfsr[6:1]};
+		end
 	end
 end
 
@@ -147,12 +152,12 @@ always @ (*) begin
 	endcase
 end
 
-always @ (posedge swclk or negedge rst_n) begin
+always @ (posedge clk or negedge rst_n) begin
 	if (!rst_n) begin
 		state <= S_D2S_START_BIT;
 		bit_ctr <= 7'd0;
 		rst_ctr <= 6'd0;
-	end else begin
+	end else if (clk_en) begin
 		state <= state_nxt;
 		bit_ctr <= bit_ctr_nxt;
 		rst_ctr <= rst_ctr_nxt;
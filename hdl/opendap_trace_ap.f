@@ -0,0 +1,2 @@
+file opendap_trace_ap.v
+file cells/opendap_sync_1bit.v
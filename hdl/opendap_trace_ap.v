@@ -0,0 +1,288 @@
+// ----------------------------------------------------------------------------
+// Part of the OpenDAP project. Original author: Luke Wren
+// SPDX-License-Identifier CC0-1.0
+// ----------------------------------------------------------------------------
+
+// Trace capture AP. Captures a stream of 32-bit words from the system into a
+// circular buffer in on-chip RAM, without involving the system bus. The
+// buffer is read back through an auto-incrementing data register, so a whole
+// capture comes out with one pipelined block of AP reads.
+//
+// The capture logic runs in the trace clock domain. Control registers are
+// passed across quasi-statically: CTRL.MODE, CTRL.TRIGEN and TRIGCNT must
+// only be changed whilst CTRL.ENABLE is clear, and are sampled when capture
+// is armed. Likewise STATUS.WRAPPED, STATUS.TRIGGERED and WRPTR are only
+// valid when STATUS.RUNNING is clear.
+//
+// Registers:
+//
+// - 0x00 CTRL
+//   - [0]   ENABLE: 0->1 clears the buffer state and starts capture.
+//                   1->0 stops capture.
+//   - [1]   MODE:   0: wrap, overwriting the oldest data. 1: stop when full.
+//   - [2]   TRIGEN: Stop TRIGCNT words after the trigger input is asserted.
+// - 0x04 STATUS (RO)
+//   - [0]   RUNNING: capture is in progress.
+//   - [1]   WRAPPED: the write pointer has wrapped (buffer is full).
+//   - [2]   TRIGGERED: trigger input was seen whilst running with TRIGEN.
+// - 0x08 WRPTR (RO): index of the next word to be written.
+// - 0x0c RDATA (RO): returns the word at RDPTR, and increments RDPTR.
+// - 0x10 RDPTR: index of the next word RDATA will return.
+// - 0x14 TRIGCNT: number of words to capture after the trigger, including
+//        a word captured in the same cycle as the trigger. 0 means stop
+//        immediately.
+// - 0x18 DEPTH (RO): buffer size in words.
+// - 0xfc IDR
+//
+// After capture stops, the oldest word is at WRPTR if WRAPPED, else at 0.
+
+`default_nettype none
+
+module opendap_trace_ap #(
+	// Bring your own JEP106 code
+	parameter [10:0] IDR_DESIGNER  = 11'h7ff,
+	parameter [3:0]  IDR_REVISION  = 4'h0,
+
+	// Buffer depth is 2 ** LOG2_DEPTH words.
+	parameter        LOG2_DEPTH    = 9,
+
+	// Synchroniser depth for the swclk <-> clk_trace crossing. Set to 0 when
+	// clk_trace is the same clock as swclk.
+	parameter        N_SYNC_STAGES = 2
+) (
+	input  wire        swclk,
+	input  wire        rst_n_por,
+
+	input  wire        clk_trace,
+	input  wire        rst_n_trace,
+
+	// DP-AP bus
+	input  wire [5:0]  dpacc_addr,
+	input  wire [31:0] dpacc_wdata,
+
+	input  wire        dpacc_wen,
+	input  wire        dpacc_ren,
+	input  wire        dpacc_abort,
+
+	output reg  [31:0] dpacc_rdata,
+	output wire        dpacc_rdy,
+	output wire        dpacc_err,
+
+	// Trace input, clk_trace domain
+	input  wire        trace_valid,
+	input  wire [31:0] trace_data,
+	input  wire        trace_trigger
+);
+
+localparam DEPTH = 1 << LOG2_DEPTH;
+
+// ----------------------------------------------------------------------------
+// Register interface (swclk domain)
+
+localparam REG_CTRL    = 6'h00;
+localparam REG_STATUS  = 6'h01;
+localparam REG_WRPTR   = 6'h02;
+localparam REG_RDATA   = 6'h03;
+localparam REG_RDPTR   = 6'h04;
+localparam REG_TRIGCNT = 6'h05;
+localparam REG_DEPTH   = 6'h06;
+localparam REG_IDR     = 6'h3f;
+
+reg                  ctrl_enable;
+reg                  ctrl_mode_stop;
+reg                  ctrl_trigen;
+reg [LOG2_DEPTH:0]   trigcnt;
+reg [LOG2_DEPTH-1:0] rdptr;
+
+wire rdata_read = dpacc_ren && dpacc_addr == REG_RDATA;
+
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		ctrl_enable <= 1'b0;
+		ctrl_mode_stop <= 1'b0;
+		ctrl_trigen <= 1'b0;
+		trigcnt <= {LOG2_DEPTH + 1{1'b0}};
+		rdptr <= {LOG2_DEPTH{1'b0}};
+	end else begin
+		if (dpacc_wen && dpacc_addr == REG_CTRL) begin
+			ctrl_enable <= dpacc_wdata[0];
+			ctrl_mode_stop <= dpacc_wdata[1];
+			ctrl_trigen <= dpacc_wdata[2];
+		end
+		if (dpacc_wen && dpacc_addr == REG_TRIGCNT) begin
+			// Saturate rather than truncate, so huge counts mean "forever".
+			trigcnt <= |dpacc_wdata[31:LOG2_DEPTH + 1] ? {LOG2_DEPTH + 1{1'b1}} :
+				dpacc_wdata[LOG2_DEPTH:0];
+		end
+		if (dpacc_wen && dpacc_addr == REG_RDPTR) begin
+			rdptr <= dpacc_wdata[LOG2_DEPTH-1:0];
+		end else if (rdata_read) begin
+			rdptr <= rdptr + 1'b1;
+		end
+	end
+end
+
+// Trace-domain status, read quasi-statically (see above)
+wire                  trace_running;
+wire                  running_sync;
+reg  [LOG2_DEPTH-1:0] wrptr;
+reg                   wrapped;
+reg                   triggered;
+
+// Buffer read port. Only clocked on RDATA reads, so that the data stays valid
+// until the next AP access, as the DP requires.
+reg [31:0] mem [0:DEPTH-1];
+reg [31:0] mem_rdata;
+
+always @ (posedge swclk) begin
+	if (rdata_read)
+		mem_rdata <= mem[rdptr];
+end
+
+reg [5:0] dpacc_addr_prev;
+always @ (posedge swclk or negedge rst_n_por) begin
+	if (!rst_n_por) begin
+		dpacc_addr_prev <= 6'h0;
+	end else if (dpacc_ren) begin
+		dpacc_addr_prev <= dpacc_addr;
+	end
+end
+
+always @ (*) begin
+	case (dpacc_addr_prev)
+
+	REG_CTRL:    dpacc_rdata = {29'h0, ctrl_trigen, ctrl_mode_stop, ctrl_enable};
+
+	REG_STATUS:  dpacc_rdata = {29'h0, triggered, wrapped, running_sync};
+
+	REG_WRPTR:   dpacc_rdata = {{32 - LOG2_DEPTH{1'b0}}, wrptr};
+
+	REG_RDATA:   dpacc_rdata = mem_rdata;
+
+	REG_RDPTR:   dpacc_rdata = {{32 - LOG2_DEPTH{1'b0}}, rdptr};
+
+	REG_TRIGCNT: dpacc_rdata = {{31 - LOG2_DEPTH{1'b0}}, trigcnt};
+
+	REG_DEPTH:   dpacc_rdata = DEPTH;
+
+	REG_IDR:     dpacc_rdata = {
+		IDR_REVISION,
+		IDR_DESIGNER,
+		4'h0,           // CLASS   = no defined class
+		5'h0,           // RES0
+		4'h0,           // VARIANT = 0
+		4'h1            // TYPE    = 1 (0 would look like a JTAG-AP)
+	};
+
+	default:     dpacc_rdata = 32'h0;
+
+	endcase
+end
+
+// All registers respond immediately, and never error. (RDATA takes one cycle
+// to come out of the RAM, but the DP doesn't look at rdata until at least
+// the next cycle.)
+assign dpacc_rdy = 1'b1;
+assign dpacc_err = 1'b0;
+
+// ----------------------------------------------------------------------------
+// Clock crossing
+
+wire enable_sync;
+
+generate
+if (N_SYNC_STAGES == 0) begin: no_sync
+
+	assign enable_sync = ctrl_enable;
+	assign running_sync = trace_running;
+
+end else begin: sync
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_enable (
+		.clk   (clk_trace),
+		.rst_n (rst_n_trace),
+		.i     (ctrl_enable),
+		.o     (enable_sync)
+	);
+
+	opendap_sync_1bit #(
+		.N_STAGES (N_SYNC_STAGES)
+	) sync_running (
+		.clk   (swclk),
+		.rst_n (rst_n_por),
+		.i     (trace_running),
+		.o     (running_sync)
+	);
+
+end
+endgenerate
+
+// ----------------------------------------------------------------------------
+// Capture logic (clk_trace domain)
+
+reg                running;
+reg                enable_prev;
+reg [LOG2_DEPTH:0] post_ctr;
+
+wire arm = enable_sync && !enable_prev;
+
+// Trigger handling: once triggered, count down post_ctr on each captured
+// word, and stop when it reaches zero.
+wire trig_now    = running && ctrl_trigen && trace_trigger && !triggered;
+wire post_active = triggered || trig_now;
+wire trig_done   = post_active && ~|post_ctr;
+
+wire do_write    = running && enable_sync && trace_valid && !trig_done;
+wire stop_full   = do_write && ctrl_mode_stop && &wrptr;
+wire stop_trig   = trig_done || (do_write && post_active && post_ctr == 1);
+
+always @ (posedge clk_trace or negedge rst_n_trace) begin
+	if (!rst_n_trace) begin
+		running <= 1'b0;
+		enable_prev <= 1'b0;
+		post_ctr <= {LOG2_DEPTH + 1{1'b0}};
+		wrptr <= {LOG2_DEPTH{1'b0}};
+		wrapped <= 1'b0;
+		triggered <= 1'b0;
+	end else begin
+		enable_prev <= enable_sync;
+		if (arm) begin
+			// Cross-domain: trigcnt has been stable for the enable sync delay.
+			running <= 1'b1;
+			post_ctr <= trigcnt;
+			wrptr <= {LOG2_DEPTH{1'b0}};
+			wrapped <= 1'b0;
+			triggered <= 1'b0;
+		end else if (!enable_sync) begin
+			running <= 1'b0;
+		end else begin
+			if (trig_now)
+				triggered <= 1'b1;
+			if (do_write) begin
+				wrptr <= wrptr + 1'b1;
+				if (&wrptr)
+					wrapped <= 1'b1;
+				if (post_active)
+					post_ctr <= post_ctr - 1'b1;
+			end
+			if (stop_full || stop_trig)
+				running <= 1'b0;
+		end
+	end
+end
+
+assign trace_running = running;
+
+// Buffer write port
+always @ (posedge clk_trace) begin
+	if (do_write)
+		mem[wrptr] <= trace_data;
+end
+
+endmodule
+
+`ifndef YOSYS
+`default_nettype wire
+`endif
@@ -0,0 +1,60 @@
+#pragma once
+
+// Simulator backend for the AP mux testbench. tb.cpp drives the DUT only
+// through these pin-level structs, so the same testbench and testcases run
+// on any simulator. Exactly one backend is linked, chosen by SIM in the
+// Makefiles:
+//
+// - cxxrtl: dut_cxxrtl.cpp, using the Yosys CXXRTL model (default)
+// - verilator: dut_verilator.cpp, using a Verilator model
+//
+// Wave times are in us, one per step.
+
+#include <string>
+#include <cstdint>
+
+// Must match N_APS in ap_mux_integration.v
+static const int N_APS = 8;
+
+// The ports the testbench drives. The AP bus ports have one bit (or one
+// ap_rdata word) per AP.
+struct dut_inputs {
+	bool     swclk;
+	bool     rst_n;
+	bool     swdi;
+	uint8_t  instid;
+	bool     eventstat;
+	uint32_t ap_rdata[N_APS];
+	uint8_t  ap_rdy;
+	uint8_t  ap_err;
+};
+
+// The ports the testbench observes
+struct dut_outputs {
+	bool     swdo;
+	bool     swdo_en;
+	uint8_t  ap_addr;
+	uint32_t ap_wdata;
+	uint8_t  ap_wen;
+	uint8_t  ap_ren;
+	bool     ap_abort;
+};
+
+class dut_sim {
+public:
+	dut_sim();
+	~dut_sim();
+	// Apply inputs, settle, and read back outputs
+	void eval(const dut_inputs &in, dut_outputs &out);
+	// Waves are off until a file is opened
+	bool open_waves(const std::string &path);
+	void sample_waves(uint64_t time);
+	static const char *backend();
+
+private:
+	dut_sim(const dut_sim&) = delete;
+	dut_sim &operator=(const dut_sim&) = delete;
+
+	struct impl;
+	impl *p;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "dut_sim.h"
+#include "swd_util.h"
+
+struct ap_read_response {
+	uint32_t rdata;
+	int delay_cycles;
+	bool err;
+};
+
+struct ap_write_response {
+	int delay_cycles;
+	bool err;
+};
+
+// addr is {apsel, ap_addr}, same as the DP tb. apsel is the index of the AP
+// port which received the access.
+typedef ap_read_response (*ap_read_callback)(uint16_t addr);
+
+typedef ap_write_response (*ap_write_callback)(uint16_t addr, uint32_t data);
+
+class tb {
+public:
+	tb(std::string vcdfile);
+	void set_ap_read_callback(ap_read_callback cb);
+	void set_ap_write_callback(ap_write_callback cb);
+
+	void set_swclk(bool swclk);
+	void set_swdi(bool swdi);
+	bool get_swdo();
+	void set_instid(uint8_t instid);
+	void step();
+	// Simulator this testbench was built with
+	const char *backend() {return dut_sim::backend();}
+private:
+	int vcd_sample;
+	bool swclk_prev;
+	ap_read_callback read_callback;
+	ap_write_callback write_callback;
+	// Per-AP response state
+	int delay_cycles[N_APS];
+	uint32_t pending_rdata[N_APS];
+	bool pending_err[N_APS];
+	bool pending_is_read[N_APS];
+	dut_sim sim;
+	dut_inputs in;
+	dut_outputs out;
+};
+
+#define tb_assert(cond, ...) if (!(cond)) {printf(__VA_ARGS__); exit(-1);}
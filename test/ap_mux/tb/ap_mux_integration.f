@@ -0,0 +1,3 @@
+file ap_mux_integration.v
+list $HDL/opendap_sw_dp.f
+list $HDL/opendap_ap_mux.f
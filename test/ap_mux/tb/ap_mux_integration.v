@@ -0,0 +1,109 @@
+// Integrate SW-DP and AP mux for testing. The APs themselves are modelled in
+// C++ -- all testbench logic is C++.
+
+module ap_mux_integration #(
+	parameter DPIDR         = 32'hdeadbeef,
+	parameter TARGETID      = 32'hbaadf00d,
+
+	parameter N_APS         = 8,
+	parameter REGISTER_REQ  = 1,
+	parameter REGISTER_RESP = 1
+) (
+	input  wire                swclk,
+	input  wire                rst_n,
+
+	input  wire                swdi,
+	output reg                 swdo,
+	output reg                 swdo_en,
+
+	input  wire [3:0]          instid,
+	input  wire                eventstat,
+
+	output wire [5:0]          ap_addr,
+	output wire [31:0]         ap_wdata,
+	output wire [N_APS-1:0]    ap_wen,
+	output wire [N_APS-1:0]    ap_ren,
+	output wire                ap_abort,
+	input  wire [N_APS*32-1:0] ap_rdata,
+	input  wire [N_APS-1:0]    ap_rdy,
+	input  wire [N_APS-1:0]    ap_err
+);
+
+wire cdbgpwrupreq;
+wire cdbgpwrupack = cdbgpwrupreq;
+wire csyspwrupreq;
+wire csyspwrupack = csyspwrupreq;
+wire cdbgrstreq;
+wire cdbgrstack = cdbgrstreq;
+
+wire [7:0]  dp_ap_sel;
+wire [5:0]  dp_ap_addr;
+wire [31:0] dp_ap_wdata;
+wire        dp_ap_wen;
+wire        dp_ap_ren;
+wire        dp_ap_abort;
+wire [31:0] dp_ap_rdata;
+wire        dp_ap_rdy;
+wire        dp_ap_err;
+
+opendap_sw_dp #(
+	.DPIDR    (DPIDR),
+	.TARGETID (TARGETID)
+) dp (
+	.swclk        (swclk),
+	.rst_n        (rst_n),
+
+	.swdi         (swdi),
+	.swdo         (swdo),
+	.swdo_en      (swdo_en),
+
+	.cdbgpwrupreq (cdbgpwrupreq),
+	.cdbgpwrupack (cdbgpwrupack),
+	.csyspwrupreq (csyspwrupreq),
+	.csyspwrupack (csyspwrupack),
+	.cdbgrstreq   (cdbgrstreq),
+	.cdbgrstack   (cdbgrstack),
+
+	.instid       (instid),
+	.eventstat    (eventstat),
+
+	.ap_sel       (dp_ap_sel),
+	.ap_addr      (dp_ap_addr),
+	.ap_wdata     (dp_ap_wdata),
+	.ap_wen       (dp_ap_wen),
+	.ap_ren       (dp_ap_ren),
+	.ap_abort     (dp_ap_abort),
+	.ap_rdata     (dp_ap_rdata),
+	.ap_rdy       (dp_ap_rdy),
+	.ap_err       (dp_ap_err)
+);
+
+opendap_ap_mux #(
+	.N_APS         (N_APS),
+	.REGISTER_REQ  (REGISTER_REQ),
+	.REGISTER_RESP (REGISTER_RESP)
+) ap_mux (
+	.swclk       (swclk),
+	.rst_n       (rst_n),
+
+	.dpacc_sel   (dp_ap_sel),
+	.dpacc_addr  (dp_ap_addr),
+	.dpacc_wdata (dp_ap_wdata),
+	.dpacc_wen   (dp_ap_wen),
+	.dpacc_ren   (dp_ap_ren),
+	.dpacc_abort (dp_ap_abort),
+	.dpacc_rdata (dp_ap_rdata),
+	.dpacc_rdy   (dp_ap_rdy),
+	.dpacc_err   (dp_ap_err),
+
+	.ap_addr     (ap_addr),
+	.ap_wdata    (ap_wdata),
+	.ap_wen      (ap_wen),
+	.ap_ren      (ap_ren),
+	.ap_abort    (ap_abort),
+	.ap_rdata    (ap_rdata),
+	.ap_rdy      (ap_rdy),
+	.ap_err      (ap_err)
+);
+
+endmodule
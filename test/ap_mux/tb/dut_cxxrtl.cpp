@@ -0,0 +1,64 @@
+#include "dut_sim.h"
+
+#include <fstream>
+
+#include "dut.cpp"
+#include <backends/cxxrtl/cxxrtl_vcd.h>
+
+struct dut_sim::impl {
+	cxxrtl_design::p_ap__mux__integration top;
+	cxxrtl::vcd_writer vcd;
+	std::ofstream waves_fd;
+};
+
+dut_sim::dut_sim() : p(new impl) {
+	cxxrtl::debug_items all_debug_items;
+	p->top.debug_info(all_debug_items);
+	p->vcd.timescale(1, "us");
+	p->vcd.add(all_debug_items);
+}
+
+dut_sim::~dut_sim() {
+	delete p;
+}
+
+const char *dut_sim::backend() {
+	return "cxxrtl";
+}
+
+void dut_sim::eval(const dut_inputs &in, dut_outputs &out) {
+	cxxrtl_design::p_ap__mux__integration &top = p->top;
+	top.p_swclk.set<bool>(in.swclk);
+	top.p_rst__n.set<bool>(in.rst_n);
+	top.p_swdi.set<bool>(in.swdi);
+	top.p_instid.set<uint8_t>(in.instid);
+	top.p_eventstat.set<bool>(in.eventstat);
+	for (int i = 0; i < N_APS; ++i)
+		top.p_ap__rdata.data[i] = in.ap_rdata[i];
+	top.p_ap__rdy.set<uint8_t>(in.ap_rdy);
+	top.p_ap__err.set<uint8_t>(in.ap_err);
+
+	top.step();
+
+	out.swdo = top.p_swdo.get<bool>();
+	out.swdo_en = top.p_swdo__en.get<bool>();
+	out.ap_addr = top.p_ap__addr.get<uint8_t>();
+	out.ap_wdata = top.p_ap__wdata.get<uint32_t>();
+	out.ap_wen = top.p_ap__wen.get<uint8_t>();
+	out.ap_ren = top.p_ap__ren.get<uint8_t>();
+	out.ap_abort = top.p_ap__abort.get<bool>();
+}
+
+bool dut_sim::open_waves(const std::string &path) {
+	p->waves_fd.open(path);
+	return p->waves_fd.is_open();
+}
+
+void dut_sim::sample_waves(uint64_t time) {
+	if (!p->waves_fd.is_open())
+		return;
+	p->vcd.sample(time);
+	p->waves_fd << p->vcd.buffer;
+	p->waves_fd.flush();
+	p->vcd.buffer.clear();
+}
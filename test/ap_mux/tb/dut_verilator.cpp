@@ -0,0 +1,74 @@
+#include "dut_sim.h"
+
+#include "Vap_mux_integration.h"
+#include "verilated.h"
+#include "verilated_vcd_c.h"
+
+struct dut_sim::impl {
+	Vap_mux_integration *top;
+	VerilatedVcdC *vcd;
+};
+
+dut_sim::dut_sim() : p(new impl) {
+	// Must be set before the model is built, or trace() does nothing
+	Verilated::traceEverOn(true);
+	p->top = new Vap_mux_integration;
+	p->vcd = nullptr;
+	// Verilator models the asynchronous resets as edge-triggered, so start
+	// with rst_n high: the testbench's first eval then makes a falling edge.
+	p->top->rst_n = 1;
+	p->top->eval();
+}
+
+dut_sim::~dut_sim() {
+	p->top->final();
+	if (p->vcd) {
+		p->vcd->close();
+		delete p->vcd;
+	}
+	delete p->top;
+	delete p;
+}
+
+const char *dut_sim::backend() {
+	return "verilator";
+}
+
+void dut_sim::eval(const dut_inputs &in, dut_outputs &out) {
+	Vap_mux_integration *top = p->top;
+	top->swclk = in.swclk;
+	top->rst_n = in.rst_n;
+	top->swdi = in.swdi;
+	top->instid = in.instid;
+	top->eventstat = in.eventstat;
+	for (int i = 0; i < N_APS; ++i)
+		top->ap_rdata[i] = in.ap_rdata[i];
+	top->ap_rdy = in.ap_rdy;
+	top->ap_err = in.ap_err;
+
+	top->eval();
+
+	out.swdo = top->swdo;
+	out.swdo_en = top->swdo_en;
+	out.ap_addr = top->ap_addr;
+	out.ap_wdata = top->ap_wdata;
+	out.ap_wen = top->ap_wen;
+	out.ap_ren = top->ap_ren;
+	out.ap_abort = top->ap_abort;
+}
+
+bool dut_sim::open_waves(const std::string &path) {
+	if (p->vcd)
+		return false;
+	p->vcd = new VerilatedVcdC;
+	p->top->trace(p->vcd, 99);
+	p->vcd->open(path.c_str());
+	return p->vcd->isOpen();
+}
+
+void dut_sim::sample_waves(uint64_t time) {
+	if (!p->vcd)
+		return;
+	p->vcd->dump(time);
+	p->vcd->flush();
+}
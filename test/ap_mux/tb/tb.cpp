@@ -0,0 +1,117 @@
+#include "tb.h"
+
+#include <cstdint>
+
+tb::tb(std::string vcdfile) {
+	in = dut_inputs();
+	out = dut_outputs();
+	sim.open_waves(vcdfile);
+	vcd_sample = 0;
+
+	in.rst_n = false;
+	sim.eval(in, out);
+	in.rst_n = true;
+	in.ap_rdy = 0xffu;
+	sim.eval(in, out);
+
+	swclk_prev = false;
+	read_callback = NULL;
+	write_callback = NULL;
+	for (int i = 0; i < N_APS; ++i) {
+		delay_cycles[i] = 0;
+		pending_rdata[i] = 0;
+		pending_err[i] = false;
+		pending_is_read[i] = false;
+	}
+
+	sim.sample_waves(vcd_sample++);
+}
+
+void tb::set_ap_read_callback(ap_read_callback cb) {
+	read_callback = cb;
+}
+
+void tb::set_ap_write_callback(ap_write_callback cb) {
+	write_callback = cb;
+}
+
+void tb::set_swclk(bool swclk) {
+	in.swclk = swclk;
+}
+
+void tb::set_swdi(bool swdi) {
+	in.swdi = swdi;
+}
+
+bool tb::get_swdo() {
+	// Pullup on bus, so return 1 if pin tristated.
+	return out.swdo_en ? out.swdo : true;
+}
+
+void tb::set_instid(uint8_t instid) {
+	in.instid = instid;
+}
+
+void tb::step() {
+	uint8_t ap_wen = out.ap_wen;
+	uint8_t ap_ren = out.ap_ren;
+	bool ap_abort = out.ap_abort;
+	uint8_t ap_addr = out.ap_addr;
+	uint32_t ap_wdata = out.ap_wdata;
+
+	sim.eval(in, out);
+	sim.eval(in, out);
+	sim.sample_waves(vcd_sample++);
+
+	// Each AP port is an independent responder, with the same timing rules
+	// as the AP model in the DP tb. On DAPABORT, all APs drop their pending
+	// responses and go ready on the next cycle.
+	if (!swclk_prev && in.swclk) {
+		uint8_t rdy = in.ap_rdy;
+		uint8_t err = 0;
+		for (int i = 0; i < N_APS; ++i) {
+			if (ap_abort) {
+				delay_cycles[i] = 0;
+				rdy |= 1u << i;
+				continue;
+			}
+			if (delay_cycles[i] > 0 && --delay_cycles[i] == 0) {
+				if (pending_is_read[i])
+					in.ap_rdata[i] = pending_rdata[i];
+				err |= (uint8_t)pending_err[i] << i;
+				rdy |= 1u << i;
+			}
+			uint16_t addr = i << 6 | ap_addr;
+			bool start = false;
+			if ((ap_ren & (1u << i)) && read_callback) {
+				ap_read_response resp = read_callback(addr);
+				pending_is_read[i] = true;
+				pending_rdata[i] = resp.rdata;
+				pending_err[i] = resp.err;
+				delay_cycles[i] = resp.delay_cycles;
+				start = true;
+			}
+			else if ((ap_wen & (1u << i)) && write_callback) {
+				ap_write_response resp = write_callback(addr, ap_wdata);
+				pending_is_read[i] = false;
+				pending_err[i] = resp.err;
+				delay_cycles[i] = resp.delay_cycles;
+				start = true;
+			}
+			if (start) {
+				if (delay_cycles[i] == 0) {
+					if (pending_is_read[i])
+						in.ap_rdata[i] = pending_rdata[i];
+					err |= (uint8_t)pending_err[i] << i;
+					rdy |= 1u << i;
+				}
+				else {
+					rdy &= ~(1u << i);
+				}
+			}
+		}
+		in.ap_rdy = rdy;
+		in.ap_err = err;
+	}
+	swclk_prev = in.swclk;
+}
@@ -0,0 +1,39 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check that DAPABORT reaches the APs and releases a DP which
+// is stalled on a stuck AP, even with the mux register slices in the path.
+
+ap_read_response read_callback(uint16_t addr) {
+	return {
+		.rdata = addr,
+		.delay_cycles = addr >> 6 == 6 ? 100000 : 0,
+		.err = false
+	};
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_ap_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	uint32_t data;
+	(void)swd_write(t, DP, DP_REG_SELECT, 6 << 24);
+	status = swd_read(t, AP, 0, data);
+	tb_assert(status == OK, "Priming read should give OK\n");
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == WAIT, "Read from stuck AP should WAIT\n");
+
+	status = swd_write(t, DP, DP_REG_ABORT, DP_ABORT_DAPABORT);
+	tb_assert(status == OK, "ABORT should always give OK\n");
+	status = swd_write(t, DP, DP_REG_SELECT, 2 << 24);
+	tb_assert(status == OK, "DP should be released after DAPABORT\n");
+
+	(void)swd_read(t, AP, 0, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == 2u << 6, "Bad read from APSEL 2 after abort\n");
+
+	return 0;
+}
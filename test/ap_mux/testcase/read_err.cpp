@@ -0,0 +1,49 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check that an error from one AP port sets STICKYERR, and that
+// errors are not reported for accesses to other APs.
+
+ap_read_response read_callback(uint16_t addr) {
+	return {
+		.rdata = addr,
+		.delay_cycles = 2,
+		.err = addr >> 6 == 5
+	};
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_ap_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	uint32_t data;
+	for (int apsel = 0; apsel < N_APS; ++apsel) {
+		if (apsel == 5)
+			continue;
+		(void)swd_write(t, DP, DP_REG_SELECT, apsel << 24);
+		(void)swd_read(t, AP, 0, data);
+		idle_clocks(t, 10);
+		status = swd_read(t, DP, DP_REG_RDBUF, data);
+		tb_assert(status == OK && data == (uint32_t)apsel << 6, "Bad read from APSEL %d\n", apsel);
+	}
+
+	(void)swd_write(t, DP, DP_REG_SELECT, 5 << 24);
+	(void)swd_read(t, AP, 0, data);
+	idle_clocks(t, 10);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == FAULT, "Read error on APSEL 5 should FAULT\n");
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK && (data & DP_CTRL_STAT_STICKYERR), "STICKYERR should be set\n");
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_STKERRCLR);
+
+	(void)swd_write(t, DP, DP_REG_SELECT, 4 << 24);
+	(void)swd_read(t, AP, 0, data);
+	idle_clocks(t, 10);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == 4u << 6, "Bad read from APSEL 4 after error\n");
+
+	return 0;
+}
@@ -0,0 +1,63 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: perform pipelined reads that hop between APs with different
+// response delays, and check each read returns data from the correct AP.
+// Nonexistent APs must read as zero, so that the host can find the end of
+// the AP list by reading IDR.
+
+static uint32_t count = 0;
+
+ap_read_response read_callback(uint16_t addr) {
+	return {
+		.rdata = (uint32_t)addr << 16 | count++,
+		.delay_cycles = (int)(addr >> 6) * 3,
+		.err = false
+	};
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_ap_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	uint32_t data;
+	for (int apsel = 0; apsel < N_APS; ++apsel) {
+		(void)swd_write(t, DP, DP_REG_SELECT, apsel << 24 | 0xf << 4);
+		status = swd_read(t, AP, 3, data);
+		tb_assert(status == OK, "AP read failed on APSEL %d\n", apsel);
+		// Wait on stall, then read result
+		do {
+			status = swd_read(t, DP, DP_REG_RDBUF, data);
+		} while (status == WAIT);
+		uint16_t addr_expected = apsel << 6 | 0xf << 2 | 3;
+		tb_assert(status == OK && data >> 16 == addr_expected, "Bad data %08x for APSEL %d\n", data, apsel);
+	}
+
+	// Pipelined reads across APs: each read returns the previous one's data.
+	uint16_t prev_addr = 0;
+	for (int apsel = 0; apsel < N_APS; ++apsel) {
+		// SELECT gets WAIT too, if the previous AP read is still in flight.
+		do {
+			status = swd_write(t, DP, DP_REG_SELECT, apsel << 24);
+		} while (status == WAIT);
+		do {
+			status = swd_read(t, AP, 1, data);
+		} while (status == WAIT);
+		tb_assert(status == OK, "AP read failed on APSEL %d\n", apsel);
+		if (apsel > 0)
+			tb_assert(data >> 16 == prev_addr, "Bad pipelined data %08x at APSEL %d\n", data, apsel);
+		prev_addr = apsel << 6 | 1;
+	}
+
+	for (unsigned apsel = N_APS; apsel < 256; apsel += 37) {
+		(void)swd_write(t, DP, DP_REG_SELECT, apsel << 24 | 0xf << 4);
+		(void)swd_read(t, AP, 3, data);
+		status = swd_read(t, DP, DP_REG_RDBUF, data);
+		tb_assert(status == OK && data == 0, "Nonexistent APSEL %u should read as 0, got %08x\n", apsel, data);
+	}
+
+	return 0;
+}
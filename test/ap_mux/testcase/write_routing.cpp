@@ -0,0 +1,56 @@
+#include "tb.h"
+#include <cstdio>
+#include <vector>
+
+// Test intent: check that AP writes are routed to the correct AP port, with
+// correct address and data, and that writes to nonexistent APs go nowhere.
+
+std::vector<uint64_t> write_history;
+
+ap_write_response write_callback(uint16_t addr, uint32_t data) {
+	write_history.push_back((uint64_t)addr << 32 | data);
+	return {
+		.delay_cycles = (int)(addr >> 6),
+		.err = false
+	};
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_ap_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	const uint32_t magic = 0xabcd1234;
+	const unsigned apsels[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0x80, 0xff};
+	std::vector<uint64_t> expected_write_seq;
+	for (unsigned apsel : apsels) {
+		for (unsigned bank = 0; bank < 16; bank += 5) {
+			status = swd_write(t, DP, DP_REG_SELECT, apsel << 24 | bank << 4);
+			tb_assert(status == OK, "SELECT failed\n");
+			for (unsigned reg = 0; reg < 4; ++reg) {
+				uint16_t addr_expected = apsel << 6 | bank << 2 | reg;
+				status = swd_write(t, AP, reg, magic - addr_expected);
+				tb_assert(status == OK, "write failed, APSEL=%u, APBANKSEL=%u, A[3:2]=%u\n", apsel, bank, reg);
+				if (apsel < (unsigned)N_APS)
+					expected_write_seq.push_back(magic - addr_expected | (uint64_t)addr_expected << 32);
+			}
+		}
+	}
+	idle_clocks(t, 20);
+	tb_assert(
+		write_history.size() == expected_write_seq.size(),
+		"Wrong amount of write data, expected %lu, got %lu\n",
+		expected_write_seq.size(), write_history.size()
+	);
+	for (size_t i = 0; i < expected_write_seq.size(); ++i){
+		tb_assert(
+			write_history[i] == expected_write_seq[i],
+			"Bad data item %lu, expected %012lx, got %012lx\n",
+			i, expected_write_seq[i], write_history[i]
+		);
+	}
+
+	return 0;
+}
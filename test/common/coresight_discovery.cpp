@@ -0,0 +1,306 @@
+// CoreSight topology discovery, see coresight_discovery.h
+
+#include <cstdio>
+#include <algorithm>
+
+#include "tb.h"
+#include "coresight_discovery.h"
+
+static const uint32_t CS_CSW_SIZE_32_INC_SINGLE = 0x12u;
+static const uint32_t CS_ROM_MAX_ENTRIES = 960;
+// Entries are speculatively read this many at a time, until a zero entry.
+static const int CS_ROM_ENTRY_CHUNK = 16;
+// PIDR4 through CIDR3
+static const uint32_t CS_ID_BLOCK_OFFSET = 0xfd0u;
+static const int CS_ID_BLOCK_WORDS = 12;
+
+struct cs_walker {
+	tb &t;
+	const cs_walk_options &opt;
+	cs_walk_stats &stats;
+	bool tar_valid;
+	uint32_t tar;
+	std::vector<uint32_t> visited;
+};
+
+// ----------------------------------------------------------------------------
+// SWD access with WAIT retry and statistics
+
+static swd_status_t cs_swd_read(cs_walker &w, ap_dp_t ap_ndp, uint8_t addr, uint32_t &data) {
+	swd_retry_stats s = {0, 0};
+	swd_status_t status = swd_read_retry(w.t, ap_ndp, addr, data, &s);
+	w.stats.swd_reads += s.packets;
+	w.stats.swd_waits += s.waits;
+	return status;
+}
+
+static swd_status_t cs_swd_write(cs_walker &w, ap_dp_t ap_ndp, uint8_t addr, uint32_t data) {
+	swd_retry_stats s = {0, 0};
+	swd_status_t status = swd_write_retry(w.t, ap_ndp, addr, data, &s);
+	w.stats.swd_writes += s.packets;
+	w.stats.swd_waits += s.waits;
+	return status;
+}
+
+// A FAULT leaves STICKYERR set, which blocks all further AP accesses.
+static void cs_clear_fault(cs_walker &w) {
+	(void)cs_swd_write(w, DP, DP_REG_ABORT, DP_ABORT_STKERRCLR);
+	w.tar_valid = false;
+}
+
+// ----------------------------------------------------------------------------
+// Memory access
+
+static swd_status_t cs_set_tar(cs_walker &w, uint32_t addr) {
+	if (w.tar_valid && w.tar == addr)
+		return OK;
+	swd_status_t status = cs_swd_write(w, AP, AP_REG_TAR, addr);
+	w.tar_valid = status == OK;
+	w.tar = addr;
+	return status;
+}
+
+// Pipelined DRW reads. Each run stops at a 1 kB boundary, beyond which the
+// Mem-AP need not increment TAR.
+static swd_status_t cs_read_block(cs_walker &w, uint32_t addr, uint32_t *data, int n) {
+	while (n > 0) {
+		int run = std::min(n, (int)((0x400u - (addr & 0x3ffu)) / 4));
+		if (!w.opt.block_reads)
+			run = 1;
+		swd_status_t status = cs_set_tar(w, addr);
+		if (status != OK)
+			return status;
+		uint32_t discard;
+		status = cs_swd_read(w, AP, AP_REG_DRW, discard);
+		for (int i = 1; i < run && status == OK; ++i)
+			status = cs_swd_read(w, AP, AP_REG_DRW, data[i - 1]);
+		if (status == OK)
+			status = cs_swd_read(w, DP, DP_REG_RDBUF, data[run - 1]);
+		if (status != OK) {
+			cs_clear_fault(w);
+			return status;
+		}
+		w.stats.mem_words += run;
+		addr += 4 * run;
+		data += run;
+		n -= run;
+		// Where TAR goes after crossing the boundary is IMPLEMENTATION DEFINED
+		w.tar = addr;
+		w.tar_valid = w.opt.block_reads && (addr & 0x3ffu) != 0;
+	}
+	return OK;
+}
+
+// ----------------------------------------------------------------------------
+// Table walk
+
+static bool cs_valid_cidr(uint32_t cidr) {
+	return (cidr & 0xffff0fffu) == 0xb105000du;
+}
+
+static swd_status_t cs_read_component(cs_walker &w, uint32_t base, cs_component &c) {
+	uint32_t id[CS_ID_BLOCK_WORDS];
+	c.base = base;
+	c.cidr = 0;
+	c.pidr = 0;
+	swd_status_t status = cs_read_block(w, base + CS_ID_BLOCK_OFFSET, id, CS_ID_BLOCK_WORDS);
+	c.error = status != OK;
+	if (c.error)
+		return status;
+	for (int i = 0; i < 4; ++i) {
+		c.pidr |= (uint64_t)(id[i] & 0xffu) << (32 + 8 * i);
+		c.pidr |= (uint64_t)(id[4 + i] & 0xffu) << (8 * i);
+		c.cidr |= (id[8 + i] & 0xffu) << (8 * i);
+	}
+	if (!cs_valid_cidr(c.cidr))
+		c.error = true;
+	return OK;
+}
+
+// Entries up to and including the terminating zero, if there is one.
+static swd_status_t cs_read_entries(cs_walker &w, uint32_t base, std::vector<uint32_t> &entries) {
+	entries.clear();
+	while (entries.size() < CS_ROM_MAX_ENTRIES) {
+		int n = std::min<int>(CS_ROM_ENTRY_CHUNK, CS_ROM_MAX_ENTRIES - entries.size());
+		uint32_t chunk[CS_ROM_ENTRY_CHUNK];
+		swd_status_t status = cs_read_block(w, base + 4 * entries.size(), chunk, n);
+		if (status != OK)
+			return status;
+		for (int i = 0; i < n; ++i) {
+			entries.push_back(chunk[i]);
+			if (chunk[i] == 0)
+				return OK;
+		}
+	}
+	return OK;
+}
+
+static void cs_walk_table(cs_walker &w, cs_topology &topo, int table_index, const std::vector<uint32_t> &entries) {
+	const uint32_t table_base = topo.components[table_index].base;
+	const int depth = topo.components[table_index].depth + 1;
+	for (uint32_t entry : entries) {
+		// Stop at the terminator, or at a legacy 8-bit format entry
+		if (entry == 0 || !(entry & 0x2u))
+			break;
+		if (!(entry & 0x1u))
+			continue;
+		uint32_t base = table_base + (entry & 0xfffff000u);
+		if (std::find(w.visited.begin(), w.visited.end(), base) != w.visited.end())
+			continue;
+		w.visited.push_back(base);
+
+		cs_component c;
+		(void)cs_read_component(w, base, c);
+		c.depth = depth;
+		c.parent = table_index;
+		topo.components.push_back(c);
+		if (c.is_rom_table() && depth < w.opt.max_depth) {
+			std::vector<uint32_t> child_entries;
+			if (cs_read_entries(w, base, child_entries) == OK)
+				cs_walk_table(w, topo, topo.components.size() - 1, child_entries);
+		}
+	}
+}
+
+uint32_t cs_crc32(uint32_t crc, const uint32_t *words, int n) {
+	crc = ~crc;
+	for (int i = 0; i < n; ++i) {
+		for (int b = 0; b < 32; b += 8) {
+			crc ^= (words[i] >> b) & 0xffu;
+			for (int k = 0; k < 8; ++k)
+				crc = crc & 1u ? (crc >> 1) ^ 0xedb88320u : crc >> 1;
+		}
+	}
+	return ~crc;
+}
+
+swd_status_t cs_discover(tb &t, const cs_walk_options &opt, cs_topology_cache *cache,
+		cs_topology &topo, cs_walk_stats &stats) {
+	stats = cs_walk_stats();
+	cs_walker w = {t, opt, stats, false, 0, {}};
+	topo = cs_topology();
+
+	swd_status_t status = cs_swd_read(w, DP, DP_REG_DPIDR, topo.dpidr);
+	if (status == OK)
+		status = cs_swd_write(w, DP, DP_REG_SELECT, DP_BANK_TARGETID);
+	if (status == OK)
+		status = cs_swd_read(w, DP, DP_REG_TARGETID, topo.targetid);
+
+	uint32_t base = 0;
+	const uint32_t apsel = (uint32_t)opt.apsel << 24;
+	if (status == OK)
+		status = cs_swd_write(w, DP, DP_REG_SELECT, apsel | AP_BANK_BASE);
+	if (status == OK)
+		status = cs_swd_read(w, AP, AP_REG_BASE, base);
+	if (status == OK)
+		status = cs_swd_read(w, DP, DP_REG_RDBUF, base);
+	if (status == OK)
+		status = cs_swd_write(w, DP, DP_REG_SELECT, apsel | AP_BANK_CSW);
+	if (status == OK)
+		status = cs_swd_write(w, AP, AP_REG_CSW, CS_CSW_SIZE_32_INC_SINGLE);
+	if (status != OK) {
+		if (status == FAULT)
+			cs_clear_fault(w);
+		return status;
+	}
+
+	// Legacy "no debug entries" value, or format 1 with the present bit clear
+	topo.rom_checksum = cs_crc32(0, &base, 1);
+	if (base == 0xffffffffu || (base & 0x3u) != 0x3u)
+		return OK;
+
+	// The top-level table is read on every connection, to form the key.
+	cs_component root;
+	std::vector<uint32_t> entries;
+	status = cs_read_component(w, base & 0xfffff000u, root);
+	if (status == OK)
+		status = cs_read_entries(w, root.base, entries);
+	if (status != OK)
+		return status;
+	root.depth = 0;
+	root.parent = -1;
+	uint32_t id_words[3] = {root.cidr, (uint32_t)(root.pidr >> 32), (uint32_t)root.pidr};
+	topo.rom_checksum = cs_crc32(topo.rom_checksum, id_words, 3);
+	topo.rom_checksum = cs_crc32(topo.rom_checksum, entries.data(), entries.size());
+
+	if (cache) {
+		const cs_topology *hit = cache->find(topo.dpidr, topo.targetid, topo.rom_checksum);
+		if (hit) {
+			topo = *hit;
+			stats.cache_hit = true;
+			return OK;
+		}
+	}
+
+	topo.components.push_back(root);
+	w.visited.push_back(root.base);
+	if (root.is_rom_table())
+		cs_walk_table(w, topo, 0, entries);
+
+	if (cache)
+		cache->insert(topo);
+	return OK;
+}
+
+// ----------------------------------------------------------------------------
+// Cache
+
+const cs_topology *cs_topology_cache::find(uint32_t dpidr, uint32_t targetid, uint32_t rom_checksum) const {
+	for (const cs_topology &e : entries) {
+		if (e.dpidr == dpidr && e.targetid == targetid && e.rom_checksum == rom_checksum)
+			return &e;
+	}
+	return nullptr;
+}
+
+void cs_topology_cache::insert(const cs_topology &topo) {
+	for (cs_topology &e : entries) {
+		if (e.dpidr == topo.dpidr && e.targetid == topo.targetid && e.rom_checksum == topo.rom_checksum) {
+			e = topo;
+			return;
+		}
+	}
+	entries.push_back(topo);
+}
+
+bool cs_topology_cache::save(const char *path) const {
+	FILE *f = fopen(path, "w");
+	if (!f)
+		return false;
+	for (const cs_topology &e : entries) {
+		fprintf(f, "topology %08x %08x %08x %d\n", e.dpidr, e.targetid, e.rom_checksum, (int)e.components.size());
+		for (const cs_component &c : e.components) {
+			fprintf(f, "%08x %08x %08x%08x %d %d %d\n", c.base, c.cidr,
+				(uint32_t)(c.pidr >> 32), (uint32_t)c.pidr, c.depth, c.parent, (int)c.error);
+		}
+	}
+	return fclose(f) == 0;
+}
+
+bool cs_topology_cache::load(const char *path) {
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return false;
+	bool ok = true;
+	cs_topology e;
+	int n;
+	while (ok && fscanf(f, " topology %x %x %x %d", &e.dpidr, &e.targetid, &e.rom_checksum, &n) == 4) {
+		e.components.resize(n);
+		for (cs_component &c : e.components) {
+			uint32_t pidr_hi, pidr_lo;
+			int error;
+			if (fscanf(f, " %x %x %8x%8x %d %d %d", &c.base, &c.cidr, &pidr_hi, &pidr_lo,
+					&c.depth, &c.parent, &error) != 7) {
+				ok = false;
+				break;
+			}
+			c.pidr = (uint64_t)pidr_hi << 32 | pidr_lo;
+			c.error = error != 0;
+		}
+		if (ok)
+			insert(e);
+	}
+	ok = ok && feof(f);
+	fclose(f);
+	return ok;
+}
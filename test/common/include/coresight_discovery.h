@@ -0,0 +1,96 @@
+#pragma once
+
+// Host-side CoreSight topology discovery through a Mem-AP, built on the SWD
+// functions in swd_util.h.
+//
+// Starting from the Mem-AP's BASE register, walk Class 0x1 ROM tables
+// (32-bit format) depth-first, reading the ID registers of every present
+// component and the entries of every nested table. Memory is read with
+// auto-incrementing DRW block reads, rewriting TAR only at 1 kB boundaries,
+// which is the smallest auto-increment range ADIv5 allows.
+//
+// Discovered topologies can be kept in a cache keyed by DPIDR, TARGETID and
+// a CRC32 of the top-level ROM table (BASE, its entries and its ID
+// registers). On reconnect, only the top-level table is read; if the key
+// matches, the rest of the walk is skipped. A change below the top level
+// which leaves DPIDR, TARGETID and the top-level table untouched is not
+// detected, so TARGETID.TREVISION should be bumped when nested tables change.
+//
+// Not supported: Class 0x9 ROM tables (treated as ordinary components), the
+// legacy 8-bit entry format, and power domain control.
+
+#include <cstdint>
+#include <vector>
+
+#include "swd_util.h"
+
+struct cs_component {
+	uint32_t base;
+	uint32_t cidr;  // CIDR0-3, one byte each
+	uint64_t pidr;  // PIDR0-7, one byte each
+	int depth;      // 0 for the top-level ROM table
+	int parent;     // Index of the table this was found in, -1 for the top
+	bool error;     // Bus error reading the ID registers
+
+	uint32_t component_class() const {return (cidr >> 12) & 0xfu;}
+	bool is_rom_table() const {return !error && component_class() == 1;}
+	uint32_t part_number() const {return pidr & 0xfffu;}
+	uint32_t designer() const {return (uint32_t)((pidr >> 32) & 0xfu) << 7 | ((uint32_t)(pidr >> 12) & 0x7fu);}
+	uint32_t revision() const {return (pidr >> 20) & 0xfu;}
+};
+
+struct cs_topology {
+	uint32_t dpidr;
+	uint32_t targetid;
+	uint32_t rom_checksum;
+	// Depth-first order. Empty if BASE indicates no debug entries.
+	std::vector<cs_component> components;
+};
+
+struct cs_walk_options {
+	uint8_t apsel;
+	// false: write TAR before every word, for comparison
+	bool block_reads;
+	int max_depth;
+};
+
+static const cs_walk_options CS_WALK_DEFAULT_OPTIONS = {
+	.apsel = 0,
+	.block_reads = true,
+	.max_depth = 16
+};
+
+struct cs_walk_stats {
+	int swd_reads;
+	int swd_writes;
+	int swd_waits;
+	int mem_words;  // Words read through the Mem-AP
+	bool cache_hit;
+};
+
+class cs_topology_cache {
+public:
+	const cs_topology *find(uint32_t dpidr, uint32_t targetid, uint32_t rom_checksum) const;
+	// Replaces any entry with the same key
+	void insert(const cs_topology &topo);
+	int size() const {return (int)entries.size();}
+
+	// Plain text, one topology per block. load() appends to the cache, and
+	// returns false if the file is missing or malformed.
+	bool save(const char *path) const;
+	bool load(const char *path);
+
+private:
+	std::vector<cs_topology> entries;
+};
+
+// Assumes the DP has been prepared for AP access, and that apsel is a Mem-AP
+// with 32-bit accesses. Leaves SELECT pointing at bank 0 of that AP. Returns
+// FAULT, after clearing STICKYERR, only if BASE or the top-level table can't
+// be read; errors further down are recorded against the component. cache may
+// be null.
+swd_status_t cs_discover(tb &t, const cs_walk_options &opt, cs_topology_cache *cache,
+	cs_topology &topo, cs_walk_stats &stats);
+
+// CRC-32 (IEEE 802.3, reflected, as used by zlib)
+uint32_t cs_crc32(uint32_t crc, const uint32_t *words, int n);
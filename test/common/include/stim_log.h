@@ -0,0 +1,111 @@
+#pragma once
+
+// Record and replay of the pin-level stimulus a testbench applies to its
+// dut_sim. The testbench only talks to the DUT through dut_inputs, which
+// already hold the results of the APB, trace and mailbox responders, so
+// replaying the recorded inputs through a fresh model reproduces the run
+// exactly, without the testcase or its callbacks.
+//
+// The log is a stream of LEB128 varints, each tagged in its two LSBs:
+//
+// - EVAL:   bitmask of the 32-bit words of dut_inputs which changed since
+//           the previous eval, followed by the new value of each
+// - REPEAT: this many more evals with unchanged inputs
+// - SAMPLE: waves sampled, at this time after the previous sample
+// - STEP:   end of one tb::step()
+//
+// Every checkpoint_steps steps, the recorder also appends a checkpoint to
+// a second file (log path plus ".ckpt"): the step count, the log offset,
+// the current inputs and a snapshot of the model's state, if the backend
+// supports it (see dut_sim::save_state). The player restores the latest
+// checkpoint at or before the step it is asked to seek to, and replays
+// the log from there. Without checkpoints it replays from the start.
+//
+// Testbenches record when TB_RECORD is set to a log path in the
+// environment. TB_RECORD_CHECKPOINT sets the checkpoint interval in SWCLK
+// cycles.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "dut_sim.h"
+
+static const uint64_t STIM_DEFAULT_CHECKPOINT_STEPS = 1ull << 21;
+
+class stim_recorder {
+public:
+	stim_recorder();
+	~stim_recorder();
+
+	// Call before the first eval. Returns false if either file can't be
+	// created, and records nothing.
+	bool open(const std::string &path, uint64_t checkpoint_steps = STIM_DEFAULT_CHECKPOINT_STEPS);
+	bool is_open() const {return log != nullptr;}
+	void close();
+
+	void eval(const dut_inputs &in);
+	void sample(uint64_t time);
+	// At the end of every tb::step(), with the model as it is then
+	void end_step(dut_sim &sim);
+
+private:
+	void put(uint64_t v);
+	void flush_repeats();
+
+	FILE *log;
+	FILE *ckpt;
+	uint64_t checkpoint_steps;
+	uint64_t steps;
+	uint64_t offset;
+	uint64_t repeats;
+	uint64_t last_time;
+	dut_inputs prev;
+	std::vector<uint8_t> state;
+};
+
+struct stim_checkpoint {
+	uint64_t steps;
+	uint64_t log_offset;
+	uint64_t last_time;
+	dut_inputs in;
+	long state_pos;     // Offset of the state in the checkpoint file
+	uint64_t state_size;
+};
+
+class stim_player {
+public:
+	stim_player();
+	~stim_player();
+
+	// Reads the log header and the checkpoint index
+	bool open(const std::string &path);
+	const std::vector<stim_checkpoint> &checkpoints() const {return index;}
+
+	// Bring sim to the end of step n, which must not be behind steps_done().
+	// If use_checkpoints, first restore the latest checkpoint at or before n,
+	// if that's ahead of where we are. Returns false if the log ends first.
+	bool seek(dut_sim &sim, uint64_t n, bool use_checkpoints = true);
+	// Replay one more step. Returns false at the end of the log.
+	bool run_step(dut_sim &sim);
+	uint64_t steps_done() const {return steps;}
+	// Checkpoint restored by the last seek, or -1
+	int restored() const {return last_restored;}
+	// Compare the model's state with a checkpoint's. Meaningful once
+	// steps_done() has reached the checkpoint's step count.
+	bool matches(dut_sim &sim, const stim_checkpoint &c);
+
+private:
+	bool get(uint64_t &v);
+	bool load_state(const stim_checkpoint &c, std::vector<uint8_t> &state);
+
+	FILE *log;
+	FILE *ckpt;
+	std::vector<stim_checkpoint> index;
+	uint64_t steps;
+	uint64_t last_time;
+	int last_restored;
+	dut_inputs in;
+	dut_outputs out;
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+// Passive SWD protocol monitor. Fed with the state of SWDIO on every SWCLK
+// rising edge, it decodes the bit stream the same way the target does, and
+// logs one record per transaction or link event:
+//
+// - Packets: header, ACK, data and data parity, with DP register names and
+//   AP addresses resolved from the SELECT and CTRL/STAT writes it has seen
+// - TARGETSEL (no ACK)
+// - Line resets
+// - Dormant-to-SWD (selection alert plus activation code) and SWD-to-Dormant
+// - Protocol errors: a malformed header, after which the target ignores the
+//   line until the next line reset
+//
+// The log is either JSON lines (one object per line), or packed binary
+// records (swd_monitor_record, in host byte order), or nothing. It also
+// keeps histograms of:
+//
+// - AP access latency: SWCLK cycles from the OK ACK of an AP access to the
+//   next ACK other than WAIT, i.e. until the DP can accept or return
+//   something else. Includes any idle cycles the host inserts.
+// - WAIT retries per transfer: WAIT ACKs seen before each other ACK
+// - Idle cycles between the end of one packet and the start of the next
+//
+// The monitor starts in the Dormant state, like the DP, unless start_active()
+// is called before the first clock.
+//
+// Timestamps in the JSON log are SWCLK cycles, plus a "time" field if a time
+// source is given. Line resets are stamped at the start of their run of
+// ones, but timed at the edge which ends it, so that a time source only has
+// to cover recent cycles.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+class swd_histogram {
+public:
+	swd_histogram();
+	void add(uint64_t value);
+	uint64_t count() const {return n;}
+	uint64_t min() const {return n ? lo : 0;}
+	uint64_t max() const {return hi;}
+	double mean() const {return n ? (double)sum / n : 0.0;}
+	// Bucket 0 holds 0, bucket k holds 2^(k-1) through 2^k - 1
+	uint64_t bucket(int k) const {return k < (int)buckets.size() ? buckets[k] : 0;}
+	void print(FILE *f, const char *title) const;
+
+private:
+	std::vector<uint64_t> buckets;
+	uint64_t n, sum, lo, hi;
+};
+
+enum swd_monitor_event {
+	SWD_EVENT_PACKET         = 0,
+	SWD_EVENT_TARGETSEL      = 1,
+	SWD_EVENT_LINE_RESET     = 2,
+	SWD_EVENT_DORMANT_TO_SWD = 3,
+	SWD_EVENT_SWD_TO_DORMANT = 4,
+	SWD_EVENT_ACTIVATION     = 5, // Activation code other than SWD: data holds the code
+	SWD_EVENT_PROTOCOL_ERROR = 6
+};
+
+static const uint8_t SWD_RECORD_DATA_PHASE   = 1u << 0;
+static const uint8_t SWD_RECORD_PARITY_ERROR = 1u << 1;
+
+struct swd_monitor_record {
+	uint64_t cycle;   // SWCLK cycle of the first bit
+	uint32_t data;    // Packet/TARGETSEL data, line reset length, activation code
+	uint8_t event;    // swd_monitor_event
+	uint8_t header;   // Packets, TARGETSEL and protocol errors
+	uint8_t ack;      // Packets, as on the wire (1 OK, 2 WAIT, 4 FAULT)
+	uint8_t flags;    // SWD_RECORD_x
+};
+
+enum swd_log_format {
+	SWD_LOG_NONE,
+	SWD_LOG_JSONL,
+	SWD_LOG_BINARY
+};
+
+typedef uint64_t (*swd_time_source)(void *ctx, uint64_t cycle);
+
+class swd_monitor {
+public:
+	// A log_path of "-" is stdout.
+	swd_monitor(const char *log_path = nullptr, swd_log_format fmt = SWD_LOG_NONE);
+	~swd_monitor();
+
+	// Once per SWCLK rising edge, with the value on the wire.
+	void clock(bool swdio);
+
+	// For captures which start part way through a session: assume the link
+	// is already in SWD mode, and start decoding at the first line reset.
+	void start_active();
+
+	void set_time_source(swd_time_source fn, void *ctx) {time_fn = fn; time_ctx = ctx;}
+	// Log only FAULTs, missing ACKs, parity errors and protocol errors.
+	// Statistics still cover everything.
+	bool log_errors_only;
+
+	void print_summary(FILE *f) const;
+
+	// Totals
+	uint64_t cycles;
+	uint64_t packets;
+	uint64_t acks_ok;
+	uint64_t acks_wait;
+	uint64_t acks_fault;
+	uint64_t acks_none;
+	uint64_t parity_errors;
+	uint64_t protocol_errors;
+	uint64_t line_resets;
+	uint64_t targetsels;
+	uint64_t dormant_exits;
+	uint64_t dormant_entries;
+
+	swd_histogram ap_latency;
+	swd_histogram wait_retries;
+	swd_histogram idle_cycles;
+
+	// Most recent record, for testcases
+	swd_monitor_record last;
+
+private:
+	enum state_t {
+		S_DORMANT,
+		S_ACTIVATION,  // Four low cycles, then the activation code
+		S_IDLE,
+		S_HEADER,
+		S_TRN_ACK,     // Turnaround before ACK
+		S_ACK,
+		S_TRN_WDATA,   // Turnaround before write data
+		S_DATA,
+		S_TRN_END,     // Turnaround after read data, WAIT or FAULT
+		S_TARGETSEL_TRN,
+		S_LOCKOUT      // Protocol error: nothing decoded until line reset
+	};
+
+	void emit(const swd_monitor_record &r, uint32_t idle);
+	void end_packet();
+	void check_pending_error(bool discard);
+	void line_reset_seen(uint64_t ones);
+
+	FILE *log;
+	swd_log_format format;
+	swd_time_source time_fn;
+	void *time_ctx;
+
+	state_t state;
+	int bit_count;
+	uint32_t shift;
+	bool parity;
+	swd_monitor_record cur;
+
+	// Line reset and sequence detection on the raw bit stream
+	uint64_t ones_run;
+	uint64_t history[2];
+	uint32_t bits_since_reset;
+
+	// Tracked DP state
+	uint32_t select;
+	bool orundetect;
+
+	// Statistics state
+	uint64_t packet_end_cycle;
+	bool have_packet_end;
+	uint64_t idle_before;
+	uint32_t waits_this_transfer;
+	bool ap_latency_pending;
+	uint64_t ap_ok_cycle;
+
+	// A malformed header just after a line reset may be the start of
+	// SWD-to-Dormant, so is only reported once that is ruled out.
+	bool error_pending;
+	swd_monitor_record pending_error;
+};
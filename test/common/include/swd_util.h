@@ -4,7 +4,10 @@ class tb;
 
 // Constants
 
+// DPIDR[16] (MIN) follows the DP's MINDP parameter, so check DPIDR reads
+// with swd_dpidr_ok() where the DP may be built either way.
 static const uint32_t DPIDR_EXPECTED = 0xdeadbeefu;
+static const uint32_t DPIDR_MIN = 1u << 16;
 static const uint32_t TARGETID_EXPECTED = 0xbaadf00du; 
 // REVISION = 0, DESIGNER = 7ff, CLASS = Mem-AP, TYPE = APB2/APB3
 static const uint32_t APIDR_EXPECTED = 0x0fff0002u;
@@ -38,6 +41,13 @@ static const int DP_BANK_DLCR      = 1;
 static const int DP_BANK_TARGETID  = 2;
 static const int DP_BANK_DLPIDR    = 3;
 static const int DP_BANK_EVENTSTAT = 4;
+// Implementation-defined performance counters, if present
+static const int DP_BANK_PERF_ACK_OK       = 0x8;
+static const int DP_BANK_PERF_ACK_WAIT     = 0x9;
+static const int DP_BANK_PERF_ACK_FAULT    = 0xa;
+static const int DP_BANK_PERF_PROTOCOL_ERR = 0xb;
+static const int DP_BANK_PERF_AP_READS     = 0xc;
+static const int DP_BANK_PERF_AP_WRITES    = 0xd;
 
 static const uint32_t DP_CTRL_STAT_CSYSPWRUPACK = 1u << 31;
 static const uint32_t DP_CTRL_STAT_CSYSPWRUPREQ = 1u << 30;
@@ -45,19 +55,50 @@ static const uint32_t DP_CTRL_STAT_CDBGPWRUPACK = 1u << 29;
 static const uint32_t DP_CTRL_STAT_CDBGPWRUPREQ = 1u << 28;
 static const uint32_t DP_CTRL_STAT_CDBGRSTACK   = 1u << 27;
 static const uint32_t DP_CTRL_STAT_CDBGRSTREQ   = 1u << 26;
+static const int      DP_CTRL_STAT_TRNCNT_LSB   = 12;
+static const uint32_t DP_CTRL_STAT_TRNCNT       = 0xfffu << 12;
+static const int      DP_CTRL_STAT_MASKLANE_LSB = 8;
+static const uint32_t DP_CTRL_STAT_MASKLANE     = 0xfu << 8;
 static const uint32_t DP_CTRL_STAT_WDATAERR     = 1u << 7;
 static const uint32_t DP_CTRL_STAT_READOK       = 1u << 6;
 static const uint32_t DP_CTRL_STAT_STICKYERR    = 1u << 5;
 static const uint32_t DP_CTRL_STAT_STICKYCMP    = 1u << 4;
+static const uint32_t DP_CTRL_STAT_TRNMODE      = 3u << 2;
+static const uint32_t DP_CTRL_STAT_TRNMODE_PUSHED_VERIFY  = 1u << 2;
+static const uint32_t DP_CTRL_STAT_TRNMODE_PUSHED_COMPARE = 2u << 2;
 static const uint32_t DP_CTRL_STAT_STICKYORUN   = 1u << 1;
 static const uint32_t DP_CTRL_STAT_ORUNDETECT   = 1u << 0;
 
+static const uint32_t DP_ABORT_ORUNERRCLR       = 1u << 4;
+static const uint32_t DP_ABORT_WDERRCLR         = 1u << 3;
+static const uint32_t DP_ABORT_STKERRCLR        = 1u << 2;
+static const uint32_t DP_ABORT_STKCMPCLR        = 1u << 1;
+static const uint32_t DP_ABORT_DAPABORT         = 1u << 0;
+
 static const int AP_REG_CSW   = 0;
 static const int AP_REG_TAR   = 1;
 static const int AP_REG_DRW   = 3;
 static const int AP_REG_CFG   = 0;
 static const int AP_REG_BASE  = 2;
 static const int AP_REG_IDR   = 3;
+// Implementation-defined Mem-AP performance counters, if present
+static const int AP_REG_PERF_XFER_COUNT  = 0;
+static const int AP_REG_PERF_XFER_CYCLES = 1;
+static const int AP_REG_PERF_XFER_MAX    = 2;
+// Implementation-defined Mem-AP memory engine, if present
+static const int AP_REG_ENG_CTRL         = 0;
+static const int AP_REG_ENG_LEN          = 1;
+static const int AP_REG_ENG_PATTERN      = 2;
+static const int AP_REG_ENG_RESULT       = 3;
+static const int AP_REG_ENG_MASK         = 0;
+// Implementation-defined Mem-AP TAR stride, if present
+static const int AP_REG_TAR_STRIDE       = 1;
+static const int AP_REG_TAR_ROW_LEN      = 2;
+static const int AP_REG_TAR_ROW_STRIDE   = 3;
+// Implementation-defined Mem-AP atomic aliases, if present
+static const int AP_REG_DSET             = 0;
+static const int AP_REG_DCLR             = 1;
+static const int AP_REG_DXOR             = 2;
 
 static const int AP_BANK_CSW  = 0 << 4;
 static const int AP_BANK_TAR  = 0 << 4;
@@ -66,6 +107,64 @@ static const int AP_BANK_BDx  = 1 << 4;
 static const int AP_BANK_CFG  = 0xf << 4;
 static const int AP_BANK_BASE = 0xf << 4;
 static const int AP_BANK_IDR  = 0xf << 4;
+static const int AP_BANK_PERF = 0xd << 4;
+static const int AP_BANK_ENG  = 0xe << 4;
+static const int AP_BANK_ENG_MASK = 0xc << 4;
+static const int AP_BANK_TAR_STRIDE = 0xc << 4;
+static const int AP_BANK_ATOMIC = 4 << 4;
+
+static const uint32_t AP_ENG_OP_CRC32      = 0;
+static const uint32_t AP_ENG_OP_FILL       = 1;
+static const uint32_t AP_ENG_OP_COMPARE    = 2;
+static const uint32_t AP_ENG_OP_POLL       = 3;
+static const uint32_t AP_ENG_CTRL_START    = 1u << 4;
+static const uint32_t AP_ENG_CTRL_BUSY     = 1u << 8;
+static const uint32_t AP_ENG_CTRL_DONE     = 1u << 9;
+static const uint32_t AP_ENG_CTRL_ERR      = 1u << 10;
+static const uint32_t AP_ENG_CTRL_MISMATCH = 1u << 11;
+static const uint32_t AP_ENG_CTRL_TIMEOUT  = 1u << 12;
+
+static const uint32_t DP_EVENTSTAT_EA = 1u << 0;
+
+// Trace capture AP, opendap_trace_ap.v (APSEL 1 in the DAP testbench)
+static const uint32_t TRACE_APIDR_EXPECTED = 0x0ffe0001u;
+static const int TRACE_AP_APSEL       = 1;
+static const int TRACE_AP_REG_CTRL    = 0;
+static const int TRACE_AP_REG_STATUS  = 1;
+static const int TRACE_AP_REG_WRPTR   = 2;
+static const int TRACE_AP_REG_RDATA   = 3;
+static const int TRACE_AP_REG_RDPTR   = 0;
+static const int TRACE_AP_REG_TRIGCNT = 1;
+static const int TRACE_AP_REG_DEPTH   = 2;
+static const int TRACE_AP_BANK_CTRL   = 0 << 4;
+static const int TRACE_AP_BANK_RDPTR  = 1 << 4;
+
+static const uint32_t TRACE_AP_CTRL_ENABLE    = 1u << 0;
+static const uint32_t TRACE_AP_CTRL_MODE_STOP = 1u << 1;
+static const uint32_t TRACE_AP_CTRL_TRIGEN    = 1u << 2;
+static const uint32_t TRACE_AP_STATUS_RUNNING   = 1u << 0;
+static const uint32_t TRACE_AP_STATUS_WRAPPED   = 1u << 1;
+static const uint32_t TRACE_AP_STATUS_TRIGGERED = 1u << 2;
+
+// Mailbox AP, opendap_mailbox_ap.v (APSEL 2 in the DAP testbench)
+static const uint32_t MBOX_APIDR_EXPECTED = 0x0ffe0002u;
+static const int MBOX_AP_APSEL      = 2;
+static const int MBOX_AP_REG_STATUS = 0;
+static const int MBOX_AP_REG_LEVEL  = 1;
+static const int MBOX_AP_REG_DEPTH  = 2;
+static const int MBOX_AP_REG_DATA   = 3;
+
+static const uint32_t MBOX_AP_STATUS_H2T_FULL  = 1u << 0;
+static const uint32_t MBOX_AP_STATUS_H2T_EMPTY = 1u << 1;
+static const uint32_t MBOX_AP_STATUS_T2H_FULL  = 1u << 2;
+static const uint32_t MBOX_AP_STATUS_T2H_EMPTY = 1u << 3;
+
+// Register window AP, opendap_reg_window_ap.v (APSEL 3 in the DAP testbench)
+static const uint32_t WINDOW_APIDR_EXPECTED = 0x0ffe0003u;
+static const int WINDOW_AP_APSEL      = 3;
+static const int WINDOW_AP_REG_WINDOW = 0;
+static const int WINDOW_AP_REG_STATUS = 1;
+static const int WINDOW_AP_BANK_CTRL  = 0xf << 4;
 
 // Convenience functions
 
@@ -85,4 +184,19 @@ swd_status_t swd_write(tb &t, ap_dp_t ap_dp, uint8_t addr, uint32_t data);
 swd_status_t swd_read_orun(tb &t, ap_dp_t ap_dp, uint8_t addr, uint32_t &data);
 swd_status_t swd_write_orun(tb &t, ap_dp_t ap_dp, uint8_t addr, uint32_t data);
 
+// Packets sent (WAITs included) and WAITs received by the retrying accesses
+struct swd_retry_stats {
+	int packets;
+	int waits;
+};
+
+// Repeat an access while it gets WAIT, and return the first other response.
+// Counts into stats, if not null. Fails the test after SWD_MAX_WAIT_RETRIES
+// WAITs in a row, rather than hanging on a target which never responds.
+static const int SWD_MAX_WAIT_RETRIES = 1024;
+swd_status_t swd_read_retry(tb &t, ap_dp_t ap_dp, uint8_t addr, uint32_t &data, swd_retry_stats *stats = nullptr);
+swd_status_t swd_write_retry(tb &t, ap_dp_t ap_dp, uint8_t addr, uint32_t data, swd_retry_stats *stats = nullptr);
+
 swd_status_t swd_prepare_dp_for_ap_access(tb &t);
+bool swd_dpidr_ok(uint32_t dpidr);
+bool swd_dp_has_pushed_ops(tb &t);
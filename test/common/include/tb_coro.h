@@ -0,0 +1,360 @@
+#pragma once
+
+// Cooperative scheduler for testbench agents written as C++20 coroutines.
+// Host drivers, APB responders, clock generators and monitors each become an
+// independent tb_task<void> which waits on the simulation with:
+//
+//   co_await s.clock_edge();       // one tb::step(), i.e. half a SWCLK period
+//   co_await s.clock_edge(n);      // n steps
+//   co_await s.until(cond);        // until cond() is true after some step
+//   co_await some_task(...);       // run another tb_task as a subroutine
+//
+// and the scheduler resumes each one from a single simulation loop, in the
+// order they were spawned, after every step. Agents drive inputs after a step
+// for the next one, like the blocking helpers in swd_util.h.
+//
+// The scheduler hooks tb::step(), so agents also advance when plain code
+// steps the testbench: a testcase can keep using swd_read() and friends on
+// the host side whilst agents model the target. Agents themselves must only
+// co_await, never step the testbench.
+//
+// Needs -std=c++20. Testcases named coro_*.cpp are built with it.
+
+#if __cplusplus < 202002L
+#error "tb_coro.h needs C++20"
+#endif
+
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tb.h"
+
+template <typename T = void>
+class tb_task;
+
+namespace tb_coro_detail {
+
+struct promise_base {
+	// Coroutine which co_awaited this one, resumed when this one returns
+	std::coroutine_handle<> continuation;
+
+	std::suspend_always initial_suspend() noexcept {return {};}
+
+	struct final_awaiter {
+		bool await_ready() noexcept {return false;}
+		template <typename P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+			std::coroutine_handle<> c = h.promise().continuation;
+			return c ? c : std::noop_coroutine();
+		}
+		void await_resume() noexcept {}
+	};
+	final_awaiter final_suspend() noexcept {return {};}
+
+	void unhandled_exception() {std::terminate();}
+};
+
+template <typename T>
+struct promise : promise_base {
+	T value{};
+	tb_task<T> get_return_object();
+	void return_value(T v) {value = std::move(v);}
+};
+
+template <>
+struct promise<void> : promise_base {
+	tb_task<void> get_return_object();
+	void return_void() {}
+};
+
+}
+
+// Lazily started: nothing runs until the task is spawned or co_awaited.
+template <typename T>
+class tb_task {
+public:
+	using promise_type = tb_coro_detail::promise<T>;
+	using handle = std::coroutine_handle<promise_type>;
+
+	explicit tb_task(handle h) : h(h) {}
+	tb_task(tb_task &&other) noexcept : h(std::exchange(other.h, {})) {}
+	tb_task(const tb_task &) = delete;
+	tb_task &operator=(const tb_task &) = delete;
+	~tb_task() {if (h) h.destroy();}
+
+	bool await_ready() const noexcept {return false;}
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+		h.promise().continuation = caller;
+		return h;
+	}
+	T await_resume() {
+		if constexpr (!std::is_void_v<T>)
+			return std::move(h.promise().value);
+	}
+
+private:
+	friend class tb_sched;
+	handle h;
+};
+
+template <typename T>
+tb_task<T> tb_coro_detail::promise<T>::get_return_object() {
+	return tb_task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline tb_task<void> tb_coro_detail::promise<void>::get_return_object() {
+	return tb_task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+class tb_sched {
+public:
+	explicit tb_sched(tb &t) : t(t) {
+		t.set_step_hook(step_hook, this);
+	}
+	~tb_sched() {
+		t.set_step_hook(NULL, NULL);
+		for (auto &a : agents)
+			a->root.destroy();
+		for (auto &a : spawned)
+			a->root.destroy();
+	}
+	tb_sched(const tb_sched &) = delete;
+	tb_sched &operator=(const tb_sched &) = delete;
+
+	tb &target() {return t;}
+	// Steps since the scheduler was created
+	uint64_t steps() const {return step_count;}
+
+	// The agent starts at the next run() or step, and runs until it first
+	// suspends. Daemons (responders, monitors, clock generators) usually run
+	// forever, and don't keep run() going.
+	void spawn(tb_task<void> task, bool daemon = false) {
+		std::unique_ptr<agent> a(new agent());
+		a->root = std::exchange(task.h, {});
+		a->daemon = daemon;
+		spawned.push_back(std::move(a));
+	}
+
+	// Step the testbench until every agent other than the daemons has
+	// returned. Returns false if that takes more than max_steps.
+	bool run(uint64_t max_steps = UINT64_MAX) {
+		start_spawned();
+		for (uint64_t i = 0; running > 0; ++i) {
+			if (i >= max_steps)
+				return false;
+			t.step();
+		}
+		return true;
+	}
+
+	struct edge_awaiter {
+		tb_sched &s;
+		uint64_t n;
+		bool await_ready() const noexcept {return n == 0;}
+		void await_suspend(std::coroutine_handle<> h) {s.wait(h, s.step_count + n, NULL, NULL);}
+		void await_resume() const noexcept {}
+	};
+
+	template <typename F>
+	struct until_awaiter {
+		tb_sched &s;
+		F cond;
+		bool await_ready() {return cond();}
+		void await_suspend(std::coroutine_handle<> h) {s.wait(h, 0, check, this);}
+		void await_resume() const noexcept {}
+		static bool check(void *ctx) {return static_cast<until_awaiter *>(ctx)->cond();}
+	};
+
+	edge_awaiter clock_edge(uint64_t n = 1) {return {*this, n};}
+	// Returns at once if cond() is already true
+	template <typename F>
+	until_awaiter<F> until(F cond) {return {*this, std::move(cond)};}
+
+private:
+	struct agent {
+		std::coroutine_handle<> root;
+		// Innermost coroutine of the agent, suspended in one of our awaiters
+		std::coroutine_handle<> resume_at;
+		uint64_t wake_step;
+		bool (*cond)(void *ctx);
+		void *cond_ctx;
+		bool daemon;
+	};
+
+	static void step_hook(void *ctx) {
+		static_cast<tb_sched *>(ctx)->after_step();
+	}
+
+	void wait(std::coroutine_handle<> h, uint64_t wake_step, bool (*cond)(void *), void *cond_ctx) {
+		tb_assert(current, "co_await on the scheduler from outside an agent\n");
+		current->resume_at = h;
+		current->wake_step = wake_step;
+		current->cond = cond;
+		current->cond_ctx = cond_ctx;
+	}
+
+	// Returns true if the agent has returned
+	bool resume(agent &a, std::coroutine_handle<> h) {
+		current = &a;
+		a.resume_at = {};
+		h.resume();
+		current = NULL;
+		if (a.root.done())
+			return true;
+		tb_assert(a.resume_at, "Agent suspended on something other than the scheduler\n");
+		return false;
+	}
+
+	void start_spawned() {
+		// Agents may spawn more agents
+		while (!spawned.empty()) {
+			std::unique_ptr<agent> a = std::move(spawned.front());
+			spawned.erase(spawned.begin());
+			if (resume(*a, a->root)) {
+				a->root.destroy();
+			} else {
+				if (!a->daemon)
+					++running;
+				agents.push_back(std::move(a));
+			}
+		}
+	}
+
+	void after_step() {
+		tb_assert(!in_hook, "Agents must co_await, not step the testbench\n");
+		in_hook = true;
+		++step_count;
+		bool any_done = false;
+		for (auto &a : agents) {
+			if (a->root.done() || step_count < a->wake_step)
+				continue;
+			if (a->cond && !a->cond(a->cond_ctx))
+				continue;
+			if (resume(*a, a->resume_at)) {
+				any_done = true;
+				if (!a->daemon)
+					--running;
+			}
+		}
+		if (any_done) {
+			for (size_t i = 0; i < agents.size();) {
+				if (agents[i]->root.done()) {
+					agents[i]->root.destroy();
+					agents.erase(agents.begin() + i);
+				} else {
+					++i;
+				}
+			}
+		}
+		start_spawned();
+		in_hook = false;
+	}
+
+	tb &t;
+	std::vector<std::unique_ptr<agent>> agents;
+	std::vector<std::unique_ptr<agent>> spawned;
+	agent *current = NULL;
+	uint64_t step_count = 0;
+	int running = 0;
+	bool in_hook = false;
+};
+
+// Host-side SWD for agents, bit for bit the same as put_bits(), get_bits(),
+// swd_read() etc. in swd_util.cpp, but suspending instead of stepping.
+
+inline tb_task<> co_put_bits(tb_sched &s, const uint8_t *tx, int n_bits) {
+	tb &t = s.target();
+	uint8_t shifter = 0;
+	for (int i = 0; i < n_bits; ++i) {
+		if (i % 8 == 0)
+			shifter = tx[i / 8];
+		else
+			shifter >>= 1;
+		t.set_swdi(shifter & 1u);
+		co_await s.clock_edge();
+		t.set_swclk(1);
+		co_await s.clock_edge();
+		t.set_swclk(0);
+	}
+}
+
+inline tb_task<> co_get_bits(tb_sched &s, uint8_t *rx, int n_bits) {
+	tb &t = s.target();
+	uint8_t shifter = 0;
+	for (int i = 0; i < n_bits; ++i) {
+		co_await s.clock_edge();
+		bool sample = t.get_swdo();
+		t.set_swdi(sample);
+		t.set_swclk(1);
+		co_await s.clock_edge();
+		t.set_swclk(0);
+
+		shifter = (shifter >> 1) | (sample << 7);
+		if (i % 8 == 7)
+			rx[i / 8] = shifter;
+	}
+	if (n_bits % 8 != 0) {
+		rx[n_bits / 8] = shifter >> (8 - n_bits % 8);
+	}
+}
+
+inline tb_task<> co_hiz_clocks(tb_sched &s, int n_bits) {
+	tb &t = s.target();
+	for (int i = 0; i < n_bits; ++i) {
+		t.set_swdi(t.get_swdo());
+		co_await s.clock_edge();
+		t.set_swclk(1);
+		co_await s.clock_edge();
+		t.set_swclk(0);
+	}
+}
+
+inline tb_task<swd_status_t> co_swd_read(tb_sched &s, ap_dp_t ap_ndp, uint8_t addr, uint32_t &data) {
+	uint8_t header = swd_header(ap_ndp, 1, addr);
+	co_await co_put_bits(s, &header, 8);
+	co_await co_hiz_clocks(s, 1);
+	uint8_t status;
+	co_await co_get_bits(s, &status, 3);
+	if (status != OK) {
+		co_await co_hiz_clocks(s, 1);
+		data = 0;
+		co_return (swd_status_t)status;
+	}
+	uint8_t rxbuf[4];
+	co_await co_get_bits(s, rxbuf, 32);
+	data = 0;
+	for (int i = 0; i < 4; ++i)
+		data = (data >> 8) | ((uint32_t)rxbuf[i] << 24);
+	co_await co_get_bits(s, rxbuf, 1);
+	co_await co_hiz_clocks(s, 1);
+	co_return (swd_status_t)status;
+}
+
+inline tb_task<swd_status_t> co_swd_write(tb_sched &s, ap_dp_t ap_ndp, uint8_t addr, uint32_t data) {
+	uint8_t header = swd_header(ap_ndp, 0, addr);
+	co_await co_put_bits(s, &header, 8);
+	co_await co_hiz_clocks(s, 1);
+	uint8_t status;
+	co_await co_get_bits(s, &status, 3);
+	if (status != OK) {
+		co_await co_hiz_clocks(s, 1);
+		co_return (swd_status_t)status;
+	}
+	co_await co_hiz_clocks(s, 1);
+	uint8_t txbuf[4];
+	for (int i = 0; i < 4; ++i)
+		txbuf[i] = (data >> i * 8) & 0xff;
+	co_await co_put_bits(s, txbuf, 32);
+	txbuf[0] = 0;
+	for (int i = 0; i < 32; ++i)
+		txbuf[0] ^= (data >> i) & 0x1;
+	co_await co_put_bits(s, txbuf, 1);
+	co_return (swd_status_t)status;
+}
@@ -0,0 +1,312 @@
+// Stimulus record and replay, see stim_log.h
+
+#include "stim_log.h"
+
+#include <cstring>
+
+enum {
+	TAG_EVAL   = 0,
+	TAG_REPEAT = 1,
+	TAG_SAMPLE = 2,
+	TAG_STEP   = 3
+};
+
+static const char log_magic[8] = {'O', 'D', 'S', 'T', 'I', 'M', '1', '\n'};
+static const char ckpt_magic[8] = {'O', 'D', 'C', 'K', 'P', 'T', '1', '\n'};
+static const char entry_magic[4] = {'C', 'K', 'P', 'T'};
+static const int backend_name_len = 16;
+
+static const int n_words = sizeof(dut_inputs) / 4;
+static_assert(sizeof(dut_inputs) % 4 == 0, "dut_inputs must be a whole number of words");
+static_assert(sizeof(dut_inputs) / 4 <= 60, "dut_inputs too big for the change mask");
+
+// Checkpoints are only usable by the backend that wrote them, and the log
+// only by a testbench with the same inputs.
+static void write_header(FILE *f, const char *magic, bool with_backend) {
+	fwrite(magic, 1, 8, f);
+	uint32_t size = sizeof(dut_inputs);
+	fwrite(&size, sizeof(size), 1, f);
+	if (with_backend) {
+		char name[backend_name_len] = {0};
+		strncpy(name, dut_sim::backend(), backend_name_len - 1);
+		fwrite(name, 1, backend_name_len, f);
+	}
+}
+
+static bool check_header(FILE *f, const char *magic, bool with_backend) {
+	char m[8];
+	uint32_t size;
+	if (fread(m, 1, 8, f) != 8 || memcmp(m, magic, 8) || fread(&size, sizeof(size), 1, f) != 1)
+		return false;
+	if (size != sizeof(dut_inputs))
+		return false;
+	if (with_backend) {
+		char name[backend_name_len];
+		if (fread(name, 1, backend_name_len, f) != (size_t)backend_name_len)
+			return false;
+		name[backend_name_len - 1] = '\0';
+		if (strcmp(name, dut_sim::backend()))
+			return false;
+	}
+	return true;
+}
+
+static uint64_t zigzag(int64_t v) {
+	return (uint64_t)v << 1 ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1u);
+}
+
+// ----------------------------------------------------------------------------
+// Recorder
+
+stim_recorder::stim_recorder() {
+	log = nullptr;
+	ckpt = nullptr;
+	checkpoint_steps = 0;
+	steps = 0;
+	offset = 0;
+	repeats = 0;
+	last_time = 0;
+	prev = dut_inputs();
+}
+
+stim_recorder::~stim_recorder() {
+	close();
+}
+
+bool stim_recorder::open(const std::string &path, uint64_t checkpoint_steps_) {
+	close();
+	log = fopen(path.c_str(), "wb");
+	if (!log)
+		return false;
+	ckpt = fopen((path + ".ckpt").c_str(), "wb");
+	if (!ckpt) {
+		fclose(log);
+		log = nullptr;
+		return false;
+	}
+	write_header(log, log_magic, false);
+	write_header(ckpt, ckpt_magic, true);
+	offset = ftell(log);
+	checkpoint_steps = checkpoint_steps_ ? checkpoint_steps_ : STIM_DEFAULT_CHECKPOINT_STEPS;
+	steps = 0;
+	repeats = 0;
+	last_time = 0;
+	prev = dut_inputs();
+	return true;
+}
+
+void stim_recorder::close() {
+	if (!log)
+		return;
+	flush_repeats();
+	fclose(log);
+	log = nullptr;
+	if (ckpt)
+		fclose(ckpt);
+	ckpt = nullptr;
+}
+
+void stim_recorder::put(uint64_t v) {
+	do {
+		uint8_t b = v & 0x7fu;
+		v >>= 7;
+		putc(v ? b | 0x80u : b, log);
+		++offset;
+	} while (v);
+}
+
+void stim_recorder::flush_repeats() {
+	if (repeats) {
+		put(repeats << 2 | TAG_REPEAT);
+		repeats = 0;
+	}
+}
+
+void stim_recorder::eval(const dut_inputs &in) {
+	uint32_t w[n_words], p[n_words];
+	memcpy(w, &in, sizeof(w));
+	memcpy(p, &prev, sizeof(p));
+	uint64_t mask = 0;
+	for (int i = 0; i < n_words; ++i)
+		mask |= (uint64_t)(w[i] != p[i]) << i;
+	if (!mask) {
+		++repeats;
+		return;
+	}
+	flush_repeats();
+	put(mask << 2 | TAG_EVAL);
+	for (int i = 0; i < n_words; ++i) {
+		if (mask >> i & 1u)
+			put(w[i]);
+	}
+	prev = in;
+}
+
+void stim_recorder::sample(uint64_t time) {
+	flush_repeats();
+	put(zigzag((int64_t)(time - last_time)) << 2 | TAG_SAMPLE);
+	last_time = time;
+}
+
+void stim_recorder::end_step(dut_sim &sim) {
+	flush_repeats();
+	put(TAG_STEP);
+	++steps;
+	if (!ckpt || steps % checkpoint_steps)
+		return;
+	if (!sim.save_state(state)) {
+		// Backend can't snapshot: the log still replays from the start
+		fclose(ckpt);
+		ckpt = nullptr;
+		return;
+	}
+	uint64_t size = state.size();
+	fwrite(entry_magic, 1, 4, ckpt);
+	fwrite(&steps, sizeof(steps), 1, ckpt);
+	fwrite(&offset, sizeof(offset), 1, ckpt);
+	fwrite(&last_time, sizeof(last_time), 1, ckpt);
+	fwrite(&prev, sizeof(prev), 1, ckpt);
+	fwrite(&size, sizeof(size), 1, ckpt);
+	fwrite(state.data(), 1, size, ckpt);
+	// A checkpoint is only any use if the log up to it is on disk too
+	fflush(log);
+	fflush(ckpt);
+}
+
+// ----------------------------------------------------------------------------
+// Player
+
+stim_player::stim_player() {
+	log = nullptr;
+	ckpt = nullptr;
+	steps = 0;
+	last_time = 0;
+	last_restored = -1;
+	in = dut_inputs();
+	out = dut_outputs();
+}
+
+stim_player::~stim_player() {
+	if (log)
+		fclose(log);
+	if (ckpt)
+		fclose(ckpt);
+}
+
+bool stim_player::open(const std::string &path) {
+	log = fopen(path.c_str(), "rb");
+	if (!log || !check_header(log, log_magic, false))
+		return false;
+
+	// Checkpoints are optional: a missing, truncated or foreign file just
+	// means replaying from further back.
+	ckpt = fopen((path + ".ckpt").c_str(), "rb");
+	if (ckpt && !check_header(ckpt, ckpt_magic, true)) {
+		fclose(ckpt);
+		ckpt = nullptr;
+	}
+	while (ckpt) {
+		stim_checkpoint c;
+		char m[4];
+		bool ok = fread(m, 1, 4, ckpt) == 4 && !memcmp(m, entry_magic, 4) &&
+			fread(&c.steps, sizeof(c.steps), 1, ckpt) == 1 &&
+			fread(&c.log_offset, sizeof(c.log_offset), 1, ckpt) == 1 &&
+			fread(&c.last_time, sizeof(c.last_time), 1, ckpt) == 1 &&
+			fread(&c.in, sizeof(c.in), 1, ckpt) == 1 &&
+			fread(&c.state_size, sizeof(c.state_size), 1, ckpt) == 1;
+		if (!ok)
+			break;
+		c.state_pos = ftell(ckpt);
+		if (fseek(ckpt, c.state_size, SEEK_CUR))
+			break;
+		index.push_back(c);
+	}
+	return true;
+}
+
+bool stim_player::get(uint64_t &v) {
+	v = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = getc(log);
+		if (c == EOF)
+			return false;
+		v |= (uint64_t)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+bool stim_player::run_step(dut_sim &sim) {
+	uint64_t v;
+	while (get(v)) {
+		switch (v & 3u) {
+		case TAG_EVAL: {
+			uint32_t w[n_words];
+			memcpy(w, &in, sizeof(w));
+			for (int i = 0; i < n_words; ++i) {
+				uint64_t word;
+				if (v >> (i + 2) & 1u) {
+					if (!get(word))
+						return false;
+					w[i] = (uint32_t)word;
+				}
+			}
+			memcpy(&in, w, sizeof(w));
+			sim.eval(in, out);
+			break;
+		}
+		case TAG_REPEAT:
+			for (uint64_t i = 0; i < v >> 2; ++i)
+				sim.eval(in, out);
+			break;
+		case TAG_SAMPLE:
+			last_time += unzigzag(v >> 2);
+			sim.sample_waves(last_time);
+			break;
+		default:
+			++steps;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool stim_player::load_state(const stim_checkpoint &c, std::vector<uint8_t> &state) {
+	state.resize(c.state_size);
+	return !fseek(ckpt, c.state_pos, SEEK_SET) && fread(state.data(), 1, c.state_size, ckpt) == c.state_size;
+}
+
+bool stim_player::seek(dut_sim &sim, uint64_t n, bool use_checkpoints) {
+	last_restored = -1;
+	if (n < steps)
+		return false;
+	int best = -1;
+	for (int i = 0; use_checkpoints && i < (int)index.size(); ++i) {
+		if (index[i].steps <= n && index[i].steps > steps)
+			best = i;
+	}
+	std::vector<uint8_t> state;
+	if (best >= 0 && load_state(index[best], state) && sim.restore_state(state) &&
+			!fseek(log, index[best].log_offset, SEEK_SET)) {
+		const stim_checkpoint &c = index[best];
+		steps = c.steps;
+		last_time = c.last_time;
+		in = c.in;
+		last_restored = best;
+	}
+	while (steps < n) {
+		if (!run_step(sim))
+			return false;
+	}
+	return true;
+}
+
+bool stim_player::matches(dut_sim &sim, const stim_checkpoint &c) {
+	std::vector<uint8_t> saved, now;
+	return load_state(c, saved) && sim.save_state(now) && saved == now;
+}
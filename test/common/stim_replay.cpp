@@ -0,0 +1,104 @@
+// Replay a stimulus log recorded with TB_RECORD (see stim_log.h) through a
+// fresh model of the same bench, built with the same parameters. Seeks to a
+// SWCLK cycle through the nearest checkpoint, then optionally dumps waves
+// from there, so a failure deep into a long run can be looked at without
+// rerunning the testcase or dumping waves for all of it.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "dut_sim.h"
+#include "stim_log.h"
+
+static void usage(const char *argv0) {
+	fprintf(stderr,
+		"Usage: %s [options] <log>\n"
+		"  --cycle N    Seek to SWCLK cycle N (default 0)\n"
+		"  --cycles M   Then replay M more cycles (default: to the end of the log)\n"
+		"  --vcd path   Dump waves of the cycles replayed after the seek\n"
+		"  --verify     Replay from the start, checking the model state against\n"
+		"               each checkpoint on the way\n",
+		argv0
+	);
+	exit(-1);
+}
+
+int main(int argc, char **argv) {
+	uint64_t cycle = 0;
+	uint64_t cycles = ~0ull;
+	std::string vcd_path;
+	bool verify = false;
+	const char *log_path = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--cycle") && i + 1 < argc) {
+			cycle = strtoull(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--cycles") && i + 1 < argc) {
+			cycles = strtoull(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--vcd") && i + 1 < argc) {
+			vcd_path = argv[++i];
+		} else if (!strcmp(argv[i], "--verify")) {
+			verify = true;
+		} else if (argv[i][0] == '-' || log_path) {
+			usage(argv[0]);
+		} else {
+			log_path = argv[i];
+		}
+	}
+	if (!log_path)
+		usage(argv[0]);
+
+	stim_player player;
+	if (!player.open(log_path)) {
+		fprintf(stderr, "Can't read stimulus log %s\n", log_path);
+		return -1;
+	}
+	const std::vector<stim_checkpoint> &ckpts = player.checkpoints();
+	printf("%s: backend %s, %zu checkpoints\n", log_path, dut_sim::backend(), ckpts.size());
+
+	dut_sim sim;
+
+	if (verify) {
+		for (const stim_checkpoint &c : ckpts) {
+			if (!player.seek(sim, c.steps, false)) {
+				fprintf(stderr, "Log ends before checkpoint at cycle %llu\n",
+					(unsigned long long)(c.steps / 2));
+				return -1;
+			}
+			if (!player.matches(sim, c)) {
+				fprintf(stderr, "State differs from checkpoint at cycle %llu\n",
+					(unsigned long long)(c.steps / 2));
+				return -1;
+			}
+		}
+		printf("%zu checkpoints match\n", ckpts.size());
+		return 0;
+	}
+
+	auto start_time = std::chrono::steady_clock::now();
+	if (!player.seek(sim, 2 * cycle)) {
+		fprintf(stderr, "Log ends before cycle %llu\n", (unsigned long long)cycle);
+		return -1;
+	}
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	if (player.restored() >= 0) {
+		printf("Seek to cycle %llu took %.3f s, from checkpoint at cycle %llu\n",
+			(unsigned long long)cycle, secs,
+			(unsigned long long)(ckpts[player.restored()].steps / 2));
+	} else {
+		printf("Seek to cycle %llu took %.3f s, from the start\n", (unsigned long long)cycle, secs);
+	}
+
+	if (!vcd_path.empty())
+		sim.open_waves(vcd_path);
+	uint64_t steps = 0;
+	while (steps / 2 < cycles && player.run_step(sim))
+		++steps;
+	printf("Replayed %llu cycles, to cycle %llu\n", (unsigned long long)(steps / 2),
+		(unsigned long long)(player.steps_done() / 2));
+
+	return 0;
+}
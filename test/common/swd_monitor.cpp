@@ -0,0 +1,461 @@
+// Passive SWD protocol monitor, see swd_monitor.h
+
+#include "swd_monitor.h"
+
+// Selection alert, 128 bits, first bit in the LSB of byte 0
+static const uint8_t seq_alert[16] = {
+	0x92, 0xf3, 0x09, 0x62,
+	0x95, 0x2d, 0x85, 0x86,
+	0xe9, 0xaf, 0xdd, 0xe3,
+	0xa2, 0x0e, 0xbc, 0x19
+};
+static const uint32_t activation_code_swd = 0x1a;
+static const uint32_t seq_swd_to_dormant = 0xe3bc;
+static const uint8_t header_targetsel = 0x99;
+
+static const uint64_t line_reset_min_ones = 50;
+
+// ----------------------------------------------------------------------------
+// Histogram
+
+swd_histogram::swd_histogram() : n(0), sum(0), lo(0), hi(0) {}
+
+void swd_histogram::add(uint64_t value) {
+	int k = 0;
+	while (k < 64 && (value >> k) != 0)
+		++k;
+	if ((int)buckets.size() <= k)
+		buckets.resize(k + 1, 0);
+	++buckets[k];
+	lo = n == 0 || value < lo ? value : lo;
+	hi = value > hi ? value : hi;
+	sum += value;
+	++n;
+}
+
+void swd_histogram::print(FILE *f, const char *title) const {
+	fprintf(f, "%s: n=%llu min=%llu mean=%.1f max=%llu\n", title,
+		(unsigned long long)n, (unsigned long long)min(), mean(), (unsigned long long)hi);
+	uint64_t peak = 0;
+	for (uint64_t b : buckets)
+		peak = b > peak ? b : peak;
+	for (int k = 0; k < (int)buckets.size(); ++k) {
+		if (!buckets[k])
+			continue;
+		uint64_t b_lo = k == 0 ? 0 : 1ull << (k - 1);
+		uint64_t b_hi = k == 0 ? 0 : (1ull << k) - 1;
+		int bar = (int)(40 * buckets[k] / peak);
+		fprintf(f, "  %6llu - %-6llu %8llu ", (unsigned long long)b_lo, (unsigned long long)b_hi,
+			(unsigned long long)buckets[k]);
+		for (int i = 0; i < bar; ++i)
+			fputc('#', f);
+		fputc('\n', f);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Monitor
+
+swd_monitor::swd_monitor(const char *log_path, swd_log_format fmt) {
+	log = nullptr;
+	format = SWD_LOG_NONE;
+	if (log_path && fmt != SWD_LOG_NONE) {
+		if (log_path[0] == '-' && log_path[1] == '\0')
+			log = stdout;
+		else
+			log = fopen(log_path, fmt == SWD_LOG_BINARY ? "wb" : "w");
+		if (log)
+			format = fmt;
+	}
+	time_fn = nullptr;
+	time_ctx = nullptr;
+	log_errors_only = false;
+	cycles = 0;
+	packets = 0;
+	acks_ok = 0;
+	acks_wait = 0;
+	acks_fault = 0;
+	acks_none = 0;
+	parity_errors = 0;
+	protocol_errors = 0;
+	line_resets = 0;
+	targetsels = 0;
+	dormant_exits = 0;
+	dormant_entries = 0;
+	last = swd_monitor_record();
+
+	state = S_DORMANT;
+	bit_count = 0;
+	shift = 0;
+	parity = false;
+	cur = swd_monitor_record();
+	ones_run = 0;
+	history[0] = history[1] = 0;
+	bits_since_reset = UINT32_MAX;
+	select = 0;
+	orundetect = false;
+	packet_end_cycle = 0;
+	have_packet_end = false;
+	idle_before = 0;
+	waits_this_transfer = 0;
+	ap_latency_pending = false;
+	ap_ok_cycle = 0;
+	error_pending = false;
+	pending_error = swd_monitor_record();
+}
+
+swd_monitor::~swd_monitor() {
+	check_pending_error(false);
+	if (log == stdout)
+		fflush(log);
+	else if (log)
+		fclose(log);
+}
+
+static const char *dp_reg_name(uint32_t a, bool rnw, uint32_t dpbanksel) {
+	static const char *bank1_names[] = {"CTRL/STAT", "DLCR", "TARGETID", "DLPIDR", "EVENTSTAT"};
+	switch (a) {
+	case 0:  return rnw ? "DPIDR" : "ABORT";
+	case 1:  return dpbanksel < 5 ? bank1_names[dpbanksel] : "DP bank";
+	case 2:  return rnw ? "RESEND" : "SELECT";
+	default: return rnw ? "RDBUFF" : "TARGETSEL";
+	}
+}
+
+static const char *ack_name(uint8_t ack) {
+	switch (ack) {
+	case 1:  return "OK";
+	case 2:  return "WAIT";
+	case 4:  return "FAULT";
+	case 7:  return "none";
+	default: return "invalid";
+	}
+}
+
+static bool is_error(const swd_monitor_record &r) {
+	if (r.event == SWD_EVENT_PROTOCOL_ERROR || (r.flags & SWD_RECORD_PARITY_ERROR))
+		return true;
+	return r.event == SWD_EVENT_PACKET && r.ack != 1 && r.ack != 2;
+}
+
+void swd_monitor::emit(const swd_monitor_record &r, uint32_t idle) {
+	last = r;
+	if (log_errors_only && !is_error(r))
+		return;
+	if (format == SWD_LOG_BINARY) {
+		fwrite(&r, sizeof(r), 1, log);
+		return;
+	}
+	if (format != SWD_LOG_JSONL)
+		return;
+
+	fprintf(log, "{\"cycle\":%llu,", (unsigned long long)r.cycle);
+	if (time_fn) {
+		uint64_t c = r.event == SWD_EVENT_LINE_RESET ? r.cycle + r.data : r.cycle;
+		fprintf(log, "\"time\":%llu,", (unsigned long long)time_fn(time_ctx, c));
+	}
+	switch (r.event) {
+	case SWD_EVENT_PACKET: {
+		bool apndp = r.header & 0x2u;
+		bool rnw = r.header & 0x4u;
+		uint32_t a = (r.header >> 3) & 0x3u;
+		fprintf(log, "\"event\":\"packet\",\"port\":\"%s\",\"rnw\":%d,", apndp ? "AP" : "DP", (int)rnw);
+		if (apndp) {
+			fprintf(log, "\"apsel\":%u,\"addr\":\"0x%02x\",", select >> 24, (select & 0xf0u) | a << 2);
+		} else {
+			fprintf(log, "\"reg\":\"%s\",", dp_reg_name(a, rnw, select & 0xfu));
+		}
+		fprintf(log, "\"ack\":\"%s\"", ack_name(r.ack));
+		if (r.flags & SWD_RECORD_DATA_PHASE) {
+			fprintf(log, ",\"data\":\"0x%08x\",\"parity\":\"%s\"", r.data,
+				r.flags & SWD_RECORD_PARITY_ERROR ? "bad" : "ok");
+		}
+		fprintf(log, ",\"idle\":%u}\n", idle);
+		break;
+	}
+	case SWD_EVENT_TARGETSEL:
+		fprintf(log, "\"event\":\"targetsel\",\"data\":\"0x%08x\",\"parity\":\"%s\"}\n", r.data,
+			r.flags & SWD_RECORD_PARITY_ERROR ? "bad" : "ok");
+		break;
+	case SWD_EVENT_LINE_RESET:
+		fprintf(log, "\"event\":\"line_reset\",\"ones\":%u}\n", r.data);
+		break;
+	case SWD_EVENT_DORMANT_TO_SWD:
+		fprintf(log, "\"event\":\"dormant_to_swd\"}\n");
+		break;
+	case SWD_EVENT_SWD_TO_DORMANT:
+		fprintf(log, "\"event\":\"swd_to_dormant\"}\n");
+		break;
+	case SWD_EVENT_ACTIVATION:
+		fprintf(log, "\"event\":\"activation\",\"code\":\"0x%02x\"}\n", r.data);
+		break;
+	default:
+		fprintf(log, "\"event\":\"protocol_error\",\"header\":\"0x%02x\"}\n", r.header);
+		break;
+	}
+}
+
+void swd_monitor::check_pending_error(bool discard) {
+	if (!error_pending)
+		return;
+	error_pending = false;
+	if (!discard) {
+		++protocol_errors;
+		emit(pending_error, 0);
+	}
+}
+
+void swd_monitor::start_active() {
+	// Nothing can be decoded until a line reset puts the link in a known state
+	if (state == S_DORMANT)
+		state = S_LOCKOUT;
+}
+
+void swd_monitor::line_reset_seen(uint64_t ones) {
+	swd_monitor_record r = swd_monitor_record();
+	// The zero which ended the reset is the current bit
+	r.cycle = cycles - 1 - ones;
+	r.event = SWD_EVENT_LINE_RESET;
+	r.data = ones > UINT32_MAX ? UINT32_MAX : (uint32_t)ones;
+	check_pending_error(false);
+	++line_resets;
+	emit(r, 0);
+	state = S_IDLE;
+	bits_since_reset = 1;
+	have_packet_end = false;
+	waits_this_transfer = 0;
+	ap_latency_pending = false;
+}
+
+void swd_monitor::end_packet() {
+	if (cur.event == SWD_EVENT_TARGETSEL)
+		++targetsels;
+	emit(cur, (uint32_t)idle_before);
+	// Track the DP state which changes how later packets decode
+	bool write_ok = cur.event == SWD_EVENT_PACKET && !(cur.header & 0x4u) && cur.ack == 1;
+	bool dp = !(cur.header & 0x2u);
+	uint32_t a = (cur.header >> 3) & 0x3u;
+	if (write_ok && dp && a == 2)
+		select = cur.data;
+	else if (write_ok && dp && a == 1 && (select & 0xfu) == 0)
+		orundetect = cur.data & 0x1u;
+	packet_end_cycle = cycles;
+	have_packet_end = true;
+	state = S_IDLE;
+}
+
+void swd_monitor::clock(bool swdio) {
+	const uint64_t now = cycles++;
+
+	// Raw bit stream: sequences and line resets, which override whatever the
+	// packet decoder is doing.
+	history[0] = history[0] >> 1 | (history[1] & 1u) << 63;
+	history[1] = history[1] >> 1 | (uint64_t)swdio << 63;
+	if (bits_since_reset < UINT32_MAX)
+		++bits_since_reset;
+
+	bool link_active = state != S_DORMANT && state != S_ACTIVATION;
+	if (swdio) {
+		++ones_run;
+		// No valid packet contains this many ones, so drop whatever was in
+		// progress; the reset is logged when the line goes low again.
+		if (ones_run == line_reset_min_ones && link_active && state != S_LOCKOUT)
+			state = S_LOCKOUT;
+	} else {
+		if (ones_run >= line_reset_min_ones && link_active)
+			line_reset_seen(ones_run);
+		ones_run = 0;
+	}
+
+	if (state == S_DORMANT) {
+		uint64_t alert[2] = {0, 0};
+		for (int i = 0; i < 16; ++i)
+			alert[i / 8] |= (uint64_t)seq_alert[i] << (8 * (i % 8));
+		if (history[0] == alert[0] && history[1] == alert[1]) {
+			state = S_ACTIVATION;
+			bit_count = 0;
+			shift = 0;
+			cur = swd_monitor_record();
+			cur.cycle = now - 127;
+		}
+		return;
+	}
+
+	if (state == S_ACTIVATION) {
+		// Four low cycles, then an 8-bit activation code
+		if (bit_count >= 4)
+			shift |= (uint32_t)swdio << (bit_count - 4);
+		if (++bit_count == 12) {
+			cur.data = shift;
+			if (shift == activation_code_swd) {
+				cur.event = SWD_EVENT_DORMANT_TO_SWD;
+				++dormant_exits;
+				// A line reset is needed before the first packet
+				state = S_LOCKOUT;
+			} else {
+				cur.event = SWD_EVENT_ACTIVATION;
+				state = S_DORMANT;
+			}
+			emit(cur, 0);
+		}
+		return;
+	}
+
+	if (bits_since_reset == 16 && (history[1] >> 48) == seq_swd_to_dormant) {
+		check_pending_error(true);
+		swd_monitor_record r = swd_monitor_record();
+		r.cycle = now - 15;
+		r.event = SWD_EVENT_SWD_TO_DORMANT;
+		++dormant_entries;
+		emit(r, 0);
+		state = S_DORMANT;
+		have_packet_end = false;
+		return;
+	}
+	if (bits_since_reset >= 16)
+		check_pending_error(false);
+
+	switch (state) {
+	case S_IDLE:
+		if (swdio) {
+			cur = swd_monitor_record();
+			cur.cycle = now;
+			cur.event = SWD_EVENT_PACKET;
+			idle_before = have_packet_end ? now - packet_end_cycle : 0;
+			if (have_packet_end)
+				idle_cycles.add(idle_before);
+			shift = 1;
+			bit_count = 1;
+			state = S_HEADER;
+		}
+		break;
+
+	case S_HEADER: {
+		shift |= (uint32_t)swdio << bit_count;
+		if (++bit_count < 8)
+			break;
+		uint8_t h = shift;
+		cur.header = h;
+		bool hparity = ((h >> 1) ^ (h >> 2) ^ (h >> 3) ^ (h >> 4)) & 1u;
+		bool valid = (h & 0x1u) && !(h & 0x40u) && (h & 0x80u) && hparity == ((h >> 5) & 1u);
+		if (!valid) {
+			state = S_LOCKOUT;
+			// All ones is the line being held high, e.g. the start of a line
+			// reset, rather than a malformed packet.
+			if (h != 0xffu) {
+				cur.event = SWD_EVENT_PROTOCOL_ERROR;
+				pending_error = cur;
+				error_pending = true;
+				if (bits_since_reset >= 16)
+					check_pending_error(false);
+			}
+		} else if (h == header_targetsel) {
+			cur.event = SWD_EVENT_TARGETSEL;
+			bit_count = 0;
+			state = S_TARGETSEL_TRN;
+		} else {
+			state = S_TRN_ACK;
+		}
+		break;
+	}
+
+	case S_TRN_ACK:
+		bit_count = 0;
+		shift = 0;
+		state = S_ACK;
+		break;
+
+	case S_ACK: {
+		shift |= (uint32_t)swdio << bit_count;
+		if (++bit_count < 3)
+			break;
+		cur.ack = shift;
+		++packets;
+		acks_ok += cur.ack == 1;
+		acks_wait += cur.ack == 2;
+		acks_fault += cur.ack == 4;
+		acks_none += cur.ack != 1 && cur.ack != 2 && cur.ack != 4;
+
+		if (cur.ack == 2) {
+			++waits_this_transfer;
+		} else {
+			wait_retries.add(waits_this_transfer);
+			waits_this_transfer = 0;
+			if (ap_latency_pending)
+				ap_latency.add(now - ap_ok_cycle);
+			ap_latency_pending = false;
+		}
+		if (cur.ack == 1 && (cur.header & 0x2u)) {
+			ap_latency_pending = true;
+			ap_ok_cycle = now;
+		}
+
+		bool data_phase = cur.ack == 1 || (orundetect && (cur.ack == 2 || cur.ack == 4));
+		bool rnw = cur.header & 0x4u;
+		bit_count = 0;
+		shift = 0;
+		parity = false;
+		if (!data_phase)
+			state = S_TRN_END;
+		else if (rnw)
+			state = S_DATA;
+		else
+			state = S_TRN_WDATA;
+		break;
+	}
+
+	case S_TARGETSEL_TRN:
+		// Turnaround, three undriven ACK cycles, turnaround
+		if (++bit_count == 5) {
+			bit_count = 0;
+			shift = 0;
+			parity = false;
+			state = S_DATA;
+		}
+		break;
+
+	case S_TRN_WDATA:
+		state = S_DATA;
+		break;
+
+	case S_DATA:
+		if (bit_count < 32) {
+			shift |= (uint32_t)swdio << bit_count;
+			parity ^= swdio;
+			++bit_count;
+			break;
+		}
+		cur.data = shift;
+		cur.flags |= SWD_RECORD_DATA_PHASE;
+		if (parity != swdio) {
+			cur.flags |= SWD_RECORD_PARITY_ERROR;
+			++parity_errors;
+		}
+		if (cur.header & 0x4u)
+			state = S_TRN_END;
+		else
+			end_packet();
+		break;
+
+	case S_TRN_END:
+		end_packet();
+		break;
+
+	default:
+		break;
+	}
+}
+
+void swd_monitor::print_summary(FILE *f) const {
+	fprintf(f, "SWCLK cycles: %llu, packets: %llu (OK %llu, WAIT %llu, FAULT %llu, no ACK %llu)\n",
+		(unsigned long long)cycles, (unsigned long long)packets, (unsigned long long)acks_ok,
+		(unsigned long long)acks_wait, (unsigned long long)acks_fault, (unsigned long long)acks_none);
+	fprintf(f, "Line resets: %llu, TARGETSEL: %llu, dormant exits/entries: %llu/%llu\n",
+		(unsigned long long)line_resets, (unsigned long long)targetsels,
+		(unsigned long long)dormant_exits, (unsigned long long)dormant_entries);
+	fprintf(f, "Parity errors: %llu, protocol errors: %llu\n",
+		(unsigned long long)parity_errors, (unsigned long long)protocol_errors);
+	ap_latency.print(f, "AP access latency (SWCLK cycles)");
+	wait_retries.print(f, "WAIT retries per transfer");
+	idle_cycles.print(f, "Idle cycles between packets");
+}
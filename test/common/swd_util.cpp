@@ -177,6 +177,36 @@ swd_status_t swd_write_orun(tb &t, ap_dp_t ap_ndp, uint8_t addr, uint32_t data)
 	return swd_write_impl(t, ap_ndp, addr, data, true);
 }
 
+swd_status_t swd_read_retry(tb &t, ap_dp_t ap_ndp, uint8_t addr, uint32_t &data, swd_retry_stats *stats) {
+	swd_status_t status;
+	int retries = 0;
+	do {
+		status = swd_read(t, ap_ndp, addr, data);
+		if (stats) {
+			++stats->packets;
+			stats->waits += status == WAIT;
+		}
+		tb_assert(status != WAIT || ++retries < SWD_MAX_WAIT_RETRIES,
+			"%s read %d still WAIT after %d retries\n", ap_ndp == AP ? "AP" : "DP", addr, retries);
+	} while (status == WAIT);
+	return status;
+}
+
+swd_status_t swd_write_retry(tb &t, ap_dp_t ap_ndp, uint8_t addr, uint32_t data, swd_retry_stats *stats) {
+	swd_status_t status;
+	int retries = 0;
+	do {
+		status = swd_write(t, ap_ndp, addr, data);
+		if (stats) {
+			++stats->packets;
+			stats->waits += status == WAIT;
+		}
+		tb_assert(status != WAIT || ++retries < SWD_MAX_WAIT_RETRIES,
+			"%s write %d still WAIT after %d retries\n", ap_ndp == AP ? "AP" : "DP", addr, retries);
+	} while (status == WAIT);
+	return status;
+}
+
 swd_status_t swd_prepare_dp_for_ap_access(tb &t) {
 	send_dormant_to_swd(t);
 	swd_line_reset(t);
@@ -215,3 +245,15 @@ swd_status_t swd_prepare_dp_for_ap_access(tb &t) {
 	return OK;
 }
 
+
+bool swd_dpidr_ok(uint32_t dpidr) {
+	return (dpidr & ~DPIDR_MIN) == (DPIDR_EXPECTED & ~DPIDR_MIN);
+}
+
+// A full (non-MINDP) DP reports DPIDR.MIN clear.
+bool swd_dp_has_pushed_ops(tb &t) {
+	uint32_t dpidr;
+	swd_status_t status = swd_read(t, DP, DP_REG_DPIDR, dpidr);
+	tb_assert(status == OK, "DPIDR read failed\n");
+	return !(dpidr & DPIDR_MIN);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+// APB responder driven by a captured bus trace, for attaching to the DAP
+// testbench's downstream APB port through the APB callbacks. Replays the
+// downstream latency (and error) pattern of real hardware, so throughput
+// regressions can be checked against it repeatably.
+//
+// The trace is a flat binary file, in host byte order, which is mapped
+// rather than read, so captures can be larger than memory:
+//
+//   apb_trace_header, then n_beats x apb_trace_beat
+//
+// one beat per APB transfer, in the order they happened. Two replay modes:
+//
+// - APB_TRACE_EXACT: the Nth transfer gets the Nth beat's wait states and
+//   PSLVERR, plus its data if it is a read. The host is expected to repeat
+//   the captured access sequence: transfers whose address or direction
+//   differ from the beat are counted as mismatches, but still get the
+//   beat's timing. At the end of the trace it starts again from the first
+//   beat if loop is set, else responds with zero wait states and an error.
+// - APB_TRACE_STATISTICAL: wait states and PSLVERR are drawn at random (from
+//   a fixed seed) from the capture's distributions, separately for reads and
+//   writes. Data comes from a memory model, which starts with the last data
+//   the capture saw at each address (read or written), and stores writes.
+//
+// Wait states count clk_dst cycles, like apb_read_response::delay_cycles.
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tb.h"
+
+static const char APB_TRACE_MAGIC[8] = {'O', 'D', 'A', 'P', 'B', 'T', 'R', '1'};
+
+static const uint8_t APB_TRACE_WRITE  = 1u << 0;
+static const uint8_t APB_TRACE_SLVERR = 1u << 1;
+
+struct apb_trace_header {
+	char magic[8];        // APB_TRACE_MAGIC
+	uint32_t beat_size;   // sizeof(apb_trace_beat)
+	uint32_t reserved;
+	uint64_t n_beats;
+};
+
+struct apb_trace_beat {
+	uint32_t addr;
+	uint32_t data;        // Write data, or read data returned
+	uint16_t wait_states; // Cycles with PREADY low in the access phase
+	uint8_t flags;        // APB_TRACE_x
+	uint8_t reserved;
+};
+
+enum apb_trace_mode {
+	APB_TRACE_EXACT,
+	APB_TRACE_STATISTICAL
+};
+
+// Returns false if the file can't be written.
+bool apb_trace_write(const std::string &path, const std::vector<apb_trace_beat> &beats);
+
+class apb_trace_responder {
+public:
+	apb_trace_responder();
+	~apb_trace_responder();
+
+	// Returns false if the file can't be mapped, or is not a trace.
+	bool open(const std::string &path, apb_trace_mode mode, bool loop = false, uint32_t seed = 1);
+	void close();
+	// Back to the first beat, and the same random sequence. The memory
+	// model keeps its contents.
+	void rewind();
+
+	apb_read_response apb_read(uint32_t addr);
+	apb_write_response apb_write(uint32_t addr, uint32_t data);
+
+	uint64_t n_beats() const {return n;}
+	// Mean wait states in the capture, per read and per write
+	double capture_mean_read_wait() const;
+	double capture_mean_write_wait() const;
+
+	// Statistics since open() or rewind()
+	uint64_t transfers;
+	uint64_t wait_states;
+	uint64_t errors;
+	uint64_t mismatches;      // Exact mode only
+	uint64_t first_mismatch;  // Transfer index, valid if mismatches > 0
+
+private:
+	struct latency_dist {
+		// Cumulative count of transfers with each number of wait states
+		std::vector<uint64_t> cumulative;
+		uint64_t errors = 0;
+		uint64_t total() const {return cumulative.empty() ? 0 : cumulative.back();}
+	};
+
+	const apb_trace_beat *next_beat(bool write, uint32_t addr);
+	int draw(const latency_dist &d, bool &err);
+	uint32_t rand_next();
+
+	const apb_trace_header *hdr;
+	const apb_trace_beat *beats;
+	size_t map_size;
+	uint64_t n;
+	apb_trace_mode mode;
+	bool loop;
+	uint64_t pos;
+	uint32_t seed;
+	uint64_t rand_state;
+
+	latency_dist read_dist;
+	latency_dist write_dist;
+	std::unordered_map<uint32_t, uint32_t> mem;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+// Simulator backend for the DAP testbench. tb.cpp drives the DUT only
+// through these pin-level structs, so the same testbench and testcases run
+// on any simulator. Exactly one backend is linked, chosen by SIM in the
+// Makefiles:
+//
+// - cxxrtl: dut_cxxrtl.cpp, using the Yosys CXXRTL model (default)
+// - verilator: dut_verilator.cpp, using a Verilator model
+//
+// Wave times are in ns.
+
+#include <string>
+#include <cstdint>
+#include <vector>
+
+// The ports the testbench drives
+struct dut_inputs {
+	bool     clk;
+	bool     swclk;
+	bool     clk_dst;
+	bool     rst_n;
+	bool     swdi;
+	uint8_t  instid;
+	uint32_t dst_prdata;
+	bool     dst_pready;
+	bool     dst_pslverr;
+	bool     trace_valid;
+	uint32_t trace_data;
+	bool     trace_trigger;
+	bool     mbox_h2t_ready;
+	uint32_t mbox_t2h_data;
+	bool     mbox_t2h_valid;
+	bool     mbox_rst_n_tgt;
+};
+
+// The ports the testbench observes
+struct dut_outputs {
+	bool     swdo;
+	bool     swdo_en;
+	bool     dst_psel;
+	bool     dst_penable;
+	bool     dst_pwrite;
+	uint32_t dst_paddr;
+	uint32_t dst_pwdata;
+	uint32_t mbox_h2t_data;
+	bool     mbox_h2t_valid;
+	bool     mbox_t2h_ready;
+};
+
+class dut_sim {
+public:
+	dut_sim();
+	~dut_sim();
+	// Apply inputs, settle, and read back outputs
+	void eval(const dut_inputs &in, dut_outputs &out);
+	// Waves are off until a file is opened
+	bool open_waves(const std::string &path);
+	void sample_waves(uint64_t time);
+	// Snapshot of the model's state, for checkpoints. Returns false if the
+	// backend can't do this. A snapshot restores only into a model from the
+	// same build.
+	bool save_state(std::vector<uint8_t> &state);
+	bool restore_state(const std::vector<uint8_t> &state);
+	static const char *backend();
+
+private:
+	dut_sim(const dut_sim&) = delete;
+	dut_sim &operator=(const dut_sim&) = delete;
+
+	struct impl;
+	impl *p;
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+// Behavioural model of a RISC-V Debug Module (debug spec 0.13.2) with an
+// APB Debug Module Interface, plus a flat system memory, for attaching to the
+// DAP testbench's downstream APB port through the APB callbacks.
+//
+// Implemented:
+//
+// - dmcontrol/dmstatus: haltreq, resumereq, ackhavereset, hartsel, dmactive,
+//   with configurable halt and resume latency
+// - Abstract commands: access register (GPRs 0x1000-0x101f, CSRs including
+//   dpc and dcsr), with transfer, postincrement and postexec; abstractauto
+// - Program buffer, executed by a small RV32I interpreter on the selected
+//   hart (loads, stores, ALU ops, LUI, CSR ops, FENCE, EBREAK), with an
+//   implicit EBREAK after the last word. No branches, jumps or AUIPC.
+// - System bus access: 8/16/32-bit, sbreadonaddr, sbreadondata,
+//   sbautoincrement, sbbusy and sbbusyerror
+//
+// Not implemented: authentication, hart arrays, halt groups, quick access,
+// access memory commands, 64-bit harts, triggers. Registers not listed in
+// dmi_read() read as zero.
+//
+// All timing is in downstream bus clock cycles. The model has no clock of its
+// own: each access passes in the current cycle count, and anything which
+// should have finished by then (halt, command, bus access) is brought up to
+// date first.
+
+#include <cstdint>
+#include <vector>
+
+#include "tb.h"
+
+// DMI register addresses (word addresses, so APB address is dm_base + 4 * a)
+static const uint32_t DMI_DATA0        = 0x04;
+static const uint32_t DMI_DMCONTROL    = 0x10;
+static const uint32_t DMI_DMSTATUS     = 0x11;
+static const uint32_t DMI_HARTINFO     = 0x12;
+static const uint32_t DMI_ABSTRACTCS   = 0x16;
+static const uint32_t DMI_COMMAND      = 0x17;
+static const uint32_t DMI_ABSTRACTAUTO = 0x18;
+static const uint32_t DMI_PROGBUF0     = 0x20;
+static const uint32_t DMI_SBCS         = 0x38;
+static const uint32_t DMI_SBADDRESS0   = 0x39;
+static const uint32_t DMI_SBDATA0      = 0x3c;
+static const uint32_t DMI_HALTSUM0     = 0x40;
+
+static const uint32_t DM_DMCONTROL_HALTREQ      = 1u << 31;
+static const uint32_t DM_DMCONTROL_RESUMEREQ    = 1u << 30;
+static const uint32_t DM_DMCONTROL_ACKHAVERESET = 1u << 28;
+static const int      DM_DMCONTROL_HARTSEL_LSB  = 16;
+static const uint32_t DM_DMCONTROL_DMACTIVE     = 1u << 0;
+
+static const uint32_t DM_DMSTATUS_ALLHAVERESET  = 1u << 19;
+static const uint32_t DM_DMSTATUS_ALLRESUMEACK  = 1u << 17;
+static const uint32_t DM_DMSTATUS_ALLRUNNING    = 1u << 11;
+static const uint32_t DM_DMSTATUS_ALLHALTED     = 1u << 9;
+
+static const uint32_t DM_ABSTRACTCS_BUSY        = 1u << 12;
+static const int      DM_ABSTRACTCS_CMDERR_LSB  = 8;
+static const uint32_t DM_ABSTRACTCS_CMDERR      = 7u << 8;
+
+static const uint32_t DM_COMMAND_AARSIZE_32     = 2u << 20;
+static const uint32_t DM_COMMAND_POSTINCREMENT  = 1u << 19;
+static const uint32_t DM_COMMAND_POSTEXEC       = 1u << 18;
+static const uint32_t DM_COMMAND_TRANSFER       = 1u << 17;
+static const uint32_t DM_COMMAND_WRITE          = 1u << 16;
+static const uint32_t DM_REGNO_GPR0             = 0x1000;
+static const uint32_t DM_REGNO_DPC              = 0x7b1;
+
+static const uint32_t DM_SBCS_SBBUSYERROR       = 1u << 22;
+static const uint32_t DM_SBCS_SBBUSY            = 1u << 21;
+static const uint32_t DM_SBCS_SBREADONADDR      = 1u << 20;
+static const int      DM_SBCS_SBACCESS_LSB      = 17;
+static const uint32_t DM_SBCS_SBAUTOINCREMENT   = 1u << 16;
+static const uint32_t DM_SBCS_SBREADONDATA      = 1u << 15;
+static const uint32_t DM_SBCS_SBERROR           = 7u << 12;
+
+class riscv_dm_model {
+public:
+	struct config {
+		uint32_t dm_base;         // APB address of DMI register 0
+		int n_harts;
+		uint32_t mem_base;        // System memory, for SBA and progbuf
+		uint32_t mem_size;
+		int progbuf_size;         // 0 to 16 words
+		int data_count;           // 1 to 12 words
+		int halt_latency;         // Cycles from haltreq to halted
+		int resume_latency;       // Cycles from resumereq to running
+		int abstract_latency;     // Cycles per abstract command, excluding progbuf
+		int progbuf_insn_latency; // Cycles per executed progbuf instruction
+		int sba_latency;          // Cycles per system bus access
+		int apb_delay;            // Wait states on every APB access
+	};
+
+	static config default_config();
+
+	explicit riscv_dm_model(const config &cfg);
+
+	// APB slave for the DM and system memory regions. Anything else is an
+	// error response.
+	apb_read_response apb_read(uint64_t now, uint32_t addr);
+	apb_write_response apb_write(uint64_t now, uint32_t addr, uint32_t data);
+
+	// DMI register access, for the APB slave or for direct use
+	uint32_t dmi_read(uint64_t now, uint32_t dmi_addr);
+	void dmi_write(uint64_t now, uint32_t dmi_addr, uint32_t data);
+
+	// Backdoor access for testcases
+	uint32_t &gpr(int hart, int reg) {return harts[hart].x[reg];}
+	uint32_t &pc(int hart) {return harts[hart].pc;}
+	bool halted(uint64_t now, int hart) {update(now); return harts[hart].halted;}
+	// Mimic target software halting or running on its own
+	void set_halted(uint64_t now, int hart, bool halted);
+	bool mem_read(uint32_t addr, int size, uint32_t &data);
+	bool mem_write(uint32_t addr, int size, uint32_t data);
+
+	// Statistics
+	int abstract_commands;
+	int progbuf_insns;
+	int sba_accesses;
+
+private:
+	struct hart_state {
+		uint32_t x[32];
+		uint32_t pc;     // dpc whilst halted
+		uint32_t dcsr;
+		uint32_t dscratch[2];
+		bool halted;
+		bool havereset;
+		bool resumeack;
+		bool haltreq;
+		uint64_t halt_at;
+		bool resume_pending;
+		uint64_t resume_at;
+	};
+
+	config cfg;
+	std::vector<hart_state> harts;
+	std::vector<uint8_t> mem;
+
+	// DM state
+	bool dmactive;
+	uint32_t hartsel;
+	uint32_t data[12];
+	uint32_t progbuf[16];
+	uint32_t command;
+	uint32_t abstractauto;
+	uint32_t cmderr;
+	uint64_t abstract_busy_until;
+
+	uint32_t sbcs;
+	uint32_t sbaddress;
+	uint32_t sbdata;
+	uint64_t sb_busy_until;
+
+	void reset_dm();
+	void update(uint64_t now);
+	bool hart_exists() const {return hartsel < (uint32_t)cfg.n_harts;}
+	bool abstract_busy(uint64_t now) const {return now < abstract_busy_until;}
+	bool sb_busy(uint64_t now) const {return now < sb_busy_until;}
+
+	void execute_command(uint64_t now);
+	// Returns false on an exception. Fills in the number of instructions.
+	bool execute_progbuf(hart_state &h, int &n_insns);
+	bool csr_access(hart_state &h, uint32_t csr, uint32_t &rdata, bool write, uint32_t wdata);
+
+	void sb_read(uint64_t now);
+	void sb_write(uint64_t now);
+	void sb_increment();
+};
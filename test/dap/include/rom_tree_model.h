@@ -0,0 +1,53 @@
+#pragma once
+
+// Model of a CoreSight ROM table hierarchy on the DAP testbench's downstream
+// APB port, for the ROM table discovery tests. Attach it through the APB
+// read callback.
+//
+// The RTL table (opendap_rom_table, at ROM_TREE_RTL_BASE in the DAP
+// testbench) has three entries: a nested ROM table at ROM_TREE_BASE, a
+// component at ROM_TREE_COMP_BASE, and a not-present entry pointing at
+// ROM_TREE_ABSENT_BASE. Below ROM_TREE_BASE, the model is a tree of ROM
+// tables with a given depth and fanout, with ordinary components at the
+// leaves. Reads anywhere else get an error.
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "tb.h"
+#include "coresight_discovery.h"
+
+static const uint32_t ROM_TREE_RTL_BASE    = 0xe00ff000u;
+static const uint32_t ROM_TREE_BASE        = 0xe0100000u;
+static const uint32_t ROM_TREE_COMP_BASE   = 0xe0001000u;
+static const uint32_t ROM_TREE_ABSENT_BASE = 0xe0002000u;
+
+class rom_tree_model {
+public:
+	// Replaces the modelled tree. depth 0 is a single leaf component.
+	void build(int depth, int fanout);
+
+	apb_read_response read(uint32_t addr) const;
+
+	// Number of components in the modelled tree, not counting the RTL table
+	// or the extra component
+	int tree_size() const {return count(ROM_TREE_BASE);}
+
+	// Assert that a topology discovered from the RTL table matches the model
+	void check_topology(const cs_topology &topo) const;
+
+private:
+	struct node {
+		bool table;
+		uint32_t part;
+		std::vector<uint32_t> children;
+	};
+
+	uint32_t build_node(int depth, int fanout);
+	int count(uint32_t base) const;
+
+	std::map<uint32_t, node> nodes;
+	uint32_t next_slot;
+	int depth;
+};
@@ -2,12 +2,13 @@
 
 #include <string>
 #include <cstdint>
-#include <fstream>
-#include <backends/cxxrtl/cxxrtl.h>
-#include <backends/cxxrtl/cxxrtl_vcd.h>
 
+#include "dut_sim.h"
+#include "stim_log.h"
 #include "swd_util.h"
 
+class swd_monitor;
+
 struct apb_read_response {
 	uint32_t rdata;
 	int delay_cycles;
@@ -23,27 +24,128 @@ typedef apb_read_response (*apb_read_callback)(uint32_t addr);
 
 typedef apb_write_response (*apb_write_callback)(uint32_t addr, uint32_t data);
 
+struct trace_sample {
+	bool valid;
+	uint32_t data;
+	bool trigger;
+};
+
+// Downstream APB port as the testbench sees it after the latest step
+struct apb_request {
+	bool psel;
+	bool penable;
+	bool pwrite;
+	uint32_t paddr;
+	uint32_t pwdata;
+};
+
+// Called once per trace clock cycle, with the number of cycles since reset.
+typedef trace_sample (*trace_callback)(uint64_t cycle);
+
+// Target side of the mailbox AP, called once per target clock cycle:
+//
+// - h2t: called whilst a host->target word is available. Return true to
+//   consume it (it is then removed on the next clock edge).
+// - t2h: called whilst the target has no word on offer. Return true, and set
+//   data, to offer a word to the host. The word stays on offer until the
+//   FIFO accepts it, and the callback is not called again until then.
+typedef bool (*mailbox_h2t_callback)(uint64_t cycle, uint32_t data);
+typedef bool (*mailbox_t2h_callback)(uint64_t cycle, uint32_t &data);
+
+// clk_dst runs the downstream APB bus: the Mem-AP and register window AP
+// downstream ports, the ROM table, and the APB callbacks. It also runs the
+// trace AP's capture side and the mailbox AP's target side, and their
+// callbacks. By default it is tied to SWCLK. Otherwise it runs at ratio_num /
+// ratio_den times the SWCLK frequency, assuming SWCLK is toggled once per
+// step(), and APB callback delays and trace/mailbox callback cycle counts are
+// in clk_dst cycles rather than SWCLK cycles.
+struct dst_clock_config {
+	int ratio_num;     // 1 to 8
+	int ratio_den;     // 1 to 8
+	int phase_deg;     // Delay of the first rising edge, in 1/360 clk_dst periods
+	int jitter_pct;    // Peak random change to each half period, 0 to 50 percent
+	uint32_t seed;
+};
+
+// Called at the end of every tb::step(), e.g. by the agent scheduler in
+// tb_coro.h. Must not step the testbench itself.
+typedef void (*tb_step_hook)(void *ctx);
+
 class tb {
 public:
+	// An empty vcdfile disables waves. Set TB_RECORD in the environment to
+	// record the stimulus for replay, see stim_log.h.
 	tb(std::string vcdfile);
 	void set_apb_read_callback(apb_read_callback cb);
 	void set_apb_write_callback(apb_write_callback cb);
+	void set_trace_callback(trace_callback cb);
+	void set_mailbox_callbacks(mailbox_h2t_callback h2t, mailbox_t2h_callback t2h);
+	// Hold the mailbox AP's target-side reset, rst_n_tgt, on its own. It is
+	// applied on the next step().
+	void set_mailbox_target_reset(bool asserted);
+	// For testcases which model the APB target themselves, e.g. as an agent
+	// (tb_coro.h), with no APB callbacks set. The response is sampled on the
+	// following clk_dst rising edges, until changed.
+	apb_request get_apb_request();
+	void set_apb_response(bool pready, uint32_t prdata, bool pslverr);
+	// Passive protocol monitor, fed on every SWCLK rising edge. Null to remove.
+	void set_swd_monitor(swd_monitor *mon);
 
 	void set_swclk(bool swclk);
 	void set_swdi(bool swdi);
 	bool get_swdo();
 	void set_instid(uint8_t instid);
+	// Returns false if clk_dst can't be separated from the bus clock in this
+	// build (SYSCLK_RATIO), in which case it stays tied.
+	bool set_dst_clock(const dst_clock_config &cfg);
+	void set_dst_clock_tied();
 	void step();
+	void set_step_hook(tb_step_hook hook, void *ctx);
+	// Simulator this testbench was built with
+	const char *backend() {return dut_sim::backend();}
+	// SWCLK periods since reset
+	uint64_t swclk_cycles() {return step_count / 2;}
+	// Bus clock cycles since reset (SWCLK, or the system clock)
+	uint64_t bus_cycles() {return bus_cycle;}
+	// clk_dst periods since reset (the system clock in SYSCLK builds)
+	uint64_t dst_cycles() {return dst_cycle;}
+	// Synchroniser depth of the clk_dst bridges in this build
+	int n_sync_stages();
+	// Mem-AP TAR auto-increment range in this build, in address bits
+	int tar_increment_bits();
 private:
-	int vcd_sample;
+	void apb_posedge(bool apb_start, uint32_t paddr, bool pwrite, uint32_t pwdata);
+	void trace_posedge();
+	void mailbox_posedge(bool mbox_t2h_fire);
+	bool dst_edge();
+	void eval();
+	void sample_waves(uint64_t time);
+
+	swd_monitor *swd_mon;
+	bool swd_mon_swclk_prev;
+
+	bool dst_tied;
+	dst_clock_config dst_cfg;
+	uint64_t dst_next_edge;
+	uint32_t dst_rand;
+	uint64_t dst_cycle;
+
 	bool swclk_prev;
 	apb_read_callback read_callback;
 	apb_read_response last_read_response;
 	apb_write_callback write_callback;
 	apb_write_response last_write_response;
-	std::ofstream waves_fd;
-	cxxrtl::vcd_writer vcd;
-	cxxrtl::module *dut;
+	trace_callback trace_cb;
+	mailbox_h2t_callback mbox_h2t_cb;
+	mailbox_t2h_callback mbox_t2h_cb;
+	uint64_t bus_cycle;
+	uint64_t step_count;
+	dut_sim sim;
+	dut_inputs in;
+	dut_outputs out;
+	stim_recorder rec;
+	tb_step_hook step_hook;
+	void *step_hook_ctx;
 };
 
 #define tb_assert(cond, ...) if (!(cond)) {printf(__VA_ARGS__); exit(-1);}
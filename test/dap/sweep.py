@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+
+# Sweep DAP RTL parameters and measure SWD protocol efficiency. Builds the DAP
+# testbench with CXXRTL for every point of a parameter grid, each in its own
+# copy of the tree so builds can run side by side, then runs the fixed
+# workloads in testcase/bench_sweep_workload.cpp on each build, and tabulates
+# bytes per SWCLK cycle and WAIT rate (WAITs per SWD packet) for each
+# workload, clk_dst setting and APB wait state count.
+#
+# Builds and runs go in parallel, one per job. The CXXRTL compile dominates,
+# so expect a minute or so per point on a typical machine.
+#
+# Usage (after sourcing ../../sourceme):
+#
+#   ./sweep.py                                     # default grid, write sweep_results.tsv
+#   ./sweep.py --grid TAR_INCREMENT_BITS=10,12,16  # replace or add a grid axis
+#   ./sweep.py -k sync3                            # only points whose name contains sync3
+#   ./sweep.py --sim verilator                     # same builds with Verilator
+#
+# N_SYNC_STAGES and TAR_INCREMENT_BITS are the testbench's own Makefile
+# variables; any other grid axis is passed to dap_integration through
+# RTL_PARAMS, so new parameters (e.g. buffer depths) can be swept once they
+# are plumbed up to dap_integration.v. Results are tab-separated, one row per
+# (point, workload, clock, wait states), with the git revision on every row
+# like example/synth/bench.py.
+
+import argparse
+import collections
+import concurrent.futures
+import itertools
+import os
+import shutil
+import subprocess
+import sys
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(os.path.abspath(__file__)), "../.."))
+
+# ----------------------------------------------------------------------------
+# Configurations
+
+GRID = collections.OrderedDict([
+	# 0 is only safe with clk_dst tied to SWCLK, so its points skip the
+	# independent clock workloads.
+	("N_SYNC_STAGES",      [0, 2, 3]),
+	("TAR_INCREMENT_BITS", [10, 12]),
+])
+
+# Testbench Makefile variables; anything else goes in RTL_PARAMS
+MAKE_VARS = ["N_SYNC_STAGES", "TAR_INCREMENT_BITS"]
+
+SHORT_NAMES = {
+	"N_SYNC_STAGES":      "sync",
+	"TAR_INCREMENT_BITS": "tarinc",
+}
+
+WORKLOAD = "bench_sweep_workload"
+
+def point_name(params):
+	return "_".join(f"{SHORT_NAMES.get(k, k.lower())}{v}" for k, v in params.items())
+
+def grid_points(grid):
+	keys = list(grid.keys())
+	for values in itertools.product(*(grid[k] for k in keys)):
+		params = collections.OrderedDict(zip(keys, values))
+		yield {"name": point_name(params), "params": params}
+
+# ----------------------------------------------------------------------------
+# Flow
+
+def run(cmd, cwd, log):
+	with open(os.path.join(cwd, log), "w") as f:
+		subprocess.run(cmd, cwd=cwd, stdout=f, stderr=subprocess.STDOUT, check=True)
+
+# Source only: skip build products, including other sweeps' build directories.
+COPY_IGNORE = shutil.ignore_patterns("build", "obj_dir", "*.o", "dut.cpp", "*.log", "*.vcd", "*.fst",
+	"replay", "sweep_build*", "bench_build*")
+
+def make_tree(workdir):
+	# The testbench Makefiles find the RTL and common code by relative path,
+	# so copy hdl/ and test/ side by side.
+	for d in ["hdl", "test"]:
+		dst = os.path.join(workdir, d)
+		if os.path.exists(dst):
+			shutil.rmtree(dst)
+		shutil.copytree(os.path.join(ROOT, d), dst, ignore=COPY_IGNORE, symlinks=True)
+
+def sweep_one(point, builddir, sim):
+	workdir = os.path.abspath(os.path.join(builddir, point["name"]))
+	os.makedirs(workdir, exist_ok=True)
+	make_tree(workdir)
+	testdir = os.path.join(workdir, "test", "dap", "testcase")
+
+	make_args = [f"SIM={sim}"]
+	rtl_params = []
+	for k, v in point["params"].items():
+		if k in MAKE_VARS:
+			make_args.append(f"{k}={v}")
+		else:
+			rtl_params.append(f"{k}={v}")
+	if rtl_params:
+		make_args.append("RTL_PARAMS=" + " ".join(rtl_params))
+	run(["make", f"build/{WORKLOAD}"] + make_args, testdir, "build.log")
+	run([f"./build/{WORKLOAD}"], testdir, "run.log")
+
+	rows = []
+	with open(os.path.join(testdir, "run.log")) as f:
+		for line in f:
+			fields = line.rstrip("\n").split("\t")
+			if fields[0] != "sweep":
+				continue
+			workload, clock, ws, nbytes, cycles, waits, packets = fields[1:]
+			rows.append({
+				"workload": workload, "clock": clock, "wait_states": int(ws), "bytes": int(nbytes),
+				"cycles": int(cycles), "waits": int(waits), "packets": int(packets),
+			})
+	if not rows:
+		raise RuntimeError(f"no results in {os.path.join(testdir, 'run.log')}")
+	return rows
+
+def git_rev():
+	try:
+		return subprocess.run(["git", "describe", "--always", "--dirty"], cwd=ROOT, check=True,
+			stdout=subprocess.PIPE, universal_newlines=True).stdout.strip()
+	except (OSError, subprocess.CalledProcessError):
+		return "unknown"
+
+COLUMNS = ["rev", "point", "params", "workload", "clock", "wait_states", "bytes", "cycles", "waits",
+	"packets", "bytes_per_cycle", "wait_rate"]
+
+def bytes_per_cycle(r):
+	return r["bytes"] / r["cycles"] if r["cycles"] else 0.0
+
+def wait_rate(r):
+	return r["waits"] / r["packets"] if r["packets"] else 0.0
+
+def parse_grid_arg(s):
+	name, _, values = s.partition("=")
+	if not name or not values:
+		raise argparse.ArgumentTypeError(f"expected NAME=v1,v2,...: {s}")
+	return name, [int(v, 0) for v in values.split(",")]
+
+def main():
+	parser = argparse.ArgumentParser(description="DAP parameter sweep of SWD protocol efficiency")
+	parser.add_argument("--grid", type=parse_grid_arg, action="append", default=[],
+		help="NAME=v1,v2,...: sweep this dap_integration parameter over these values")
+	parser.add_argument("-k", "--filter", default="", help="only run points whose name contains this")
+	parser.add_argument("-o", "--out", default="sweep_results.tsv", help="results file")
+	parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="parallel jobs")
+	parser.add_argument("--builddir", default="sweep_build")
+	parser.add_argument("--sim", default="cxxrtl", choices=["cxxrtl", "verilator"])
+	args = parser.parse_args()
+
+	grid = collections.OrderedDict(GRID)
+	for name, values in args.grid:
+		grid[name] = values
+	points = [p for p in grid_points(grid) if args.filter in p["name"]]
+	rev = git_rev()
+	results = {}
+	with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+		futures = {pool.submit(sweep_one, p, args.builddir, args.sim): p for p in points}
+		for fut in concurrent.futures.as_completed(futures):
+			p = futures[fut]
+			try:
+				results[p["name"]] = fut.result()
+				print(f"Done: {p['name']}")
+			except (subprocess.CalledProcessError, RuntimeError) as e:
+				print(f"FAILED: {p['name']} (see {os.path.join(args.builddir, p['name'])}): {e}", file=sys.stderr)
+
+	with open(args.out, "w") as f:
+		f.write("\t".join(COLUMNS) + "\n")
+		for p in points:
+			params = ",".join(f"{k}={v}" for k, v in p["params"].items())
+			for r in results.get(p["name"], []):
+				f.write("\t".join(str(x) for x in [
+					rev, p["name"], params, r["workload"], r["clock"], r["wait_states"], r["bytes"],
+					r["cycles"], r["waits"], r["packets"], f"{bytes_per_cycle(r):.4f}", f"{wait_rate(r):.4f}"
+				]) + "\n")
+
+	# One table per workload: a row per point, a column per (clock, wait
+	# states), each "bytes/cycle wait rate"
+	name_w = max([len(p["name"]) for p in points] + [5]) + 2
+	col_w = max(16, name_w)
+	print()
+	for workload in sorted({r["workload"] for rows in results.values() for r in rows}):
+		cols = []
+		for rows in results.values():
+			for r in rows:
+				c = (r["clock"], r["wait_states"])
+				if r["workload"] == workload and c not in cols:
+					cols.append(c)
+		print(workload + " (bytes/SWCLK, WAITs/packet)")
+		print(f"{'point':<{name_w}}" + "".join(f"{f'{c} {ws}ws':>{col_w}}" for c, ws in cols))
+		best = {}
+		for p in points:
+			line = f"{p['name']:<{name_w}}"
+			by_col = {(r["clock"], r["wait_states"]): r for r in results.get(p["name"], []) if r["workload"] == workload}
+			for c in cols:
+				r = by_col.get(c)
+				if r:
+					line += f"{bytes_per_cycle(r):>{col_w - 6}.3f} {wait_rate(r):>5.2f}"
+					if c not in best or bytes_per_cycle(r) > bytes_per_cycle(best[c][1]):
+						best[c] = (p["name"], r)
+				else:
+					line += f"{'-':>{col_w}}"
+			print(line)
+		print(f"{'best':<{name_w}}" + "".join(f"{best[c][0] if c in best else '-':>{col_w}}" for c in cols))
+		print()
+
+	return 0 if len(results) == len(points) else 1
+
+if __name__ == "__main__":
+	sys.exit(main())
@@ -0,0 +1,204 @@
+#include "apb_trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool apb_trace_write(const std::string &path, const std::vector<apb_trace_beat> &beats) {
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f)
+		return false;
+	apb_trace_header hdr;
+	memcpy(hdr.magic, APB_TRACE_MAGIC, sizeof(hdr.magic));
+	hdr.beat_size = sizeof(apb_trace_beat);
+	hdr.reserved = 0;
+	hdr.n_beats = beats.size();
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+		fwrite(beats.data(), sizeof(apb_trace_beat), beats.size(), f) == beats.size();
+	return fclose(f) == 0 && ok;
+}
+
+apb_trace_responder::apb_trace_responder() {
+	hdr = NULL;
+	beats = NULL;
+	map_size = 0;
+	n = 0;
+	mode = APB_TRACE_EXACT;
+	loop = false;
+	seed = 1;
+	rewind();
+}
+
+apb_trace_responder::~apb_trace_responder() {
+	close();
+}
+
+bool apb_trace_responder::open(const std::string &path, apb_trace_mode mode_, bool loop_, uint32_t seed_) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	void *p = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(apb_trace_header))
+		p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+		return false;
+	hdr = (const apb_trace_header *)p;
+	map_size = st.st_size;
+	if (memcmp(hdr->magic, APB_TRACE_MAGIC, sizeof(hdr->magic)) || hdr->beat_size != sizeof(apb_trace_beat) ||
+			hdr->n_beats > (map_size - sizeof(apb_trace_header)) / sizeof(apb_trace_beat)) {
+		close();
+		return false;
+	}
+	beats = (const apb_trace_beat *)(hdr + 1);
+	n = hdr->n_beats;
+	mode = mode_;
+	loop = loop_;
+	seed = seed_;
+
+	// Exact replay walks the trace once, front to back. Statistical replay
+	// only needs it here, to build the distributions and memory image.
+	if (mode == APB_TRACE_EXACT) {
+		madvise(p, map_size, MADV_SEQUENTIAL);
+	} else {
+		for (uint64_t i = 0; i < n; ++i) {
+			const apb_trace_beat &b = beats[i];
+			latency_dist &d = b.flags & APB_TRACE_WRITE ? write_dist : read_dist;
+			if (d.cumulative.size() <= b.wait_states)
+				d.cumulative.resize(b.wait_states + 1, 0);
+			++d.cumulative[b.wait_states];
+			if (b.flags & APB_TRACE_SLVERR)
+				++d.errors;
+			else
+				mem[b.addr] = b.data;
+		}
+		for (latency_dist *d : {&read_dist, &write_dist}) {
+			for (size_t i = 1; i < d->cumulative.size(); ++i)
+				d->cumulative[i] += d->cumulative[i - 1];
+		}
+	}
+	rewind();
+	return true;
+}
+
+void apb_trace_responder::close() {
+	if (hdr)
+		munmap((void *)hdr, map_size);
+	hdr = NULL;
+	beats = NULL;
+	map_size = 0;
+	n = 0;
+	read_dist = latency_dist();
+	write_dist = latency_dist();
+	mem.clear();
+}
+
+void apb_trace_responder::rewind() {
+	pos = 0;
+	rand_state = seed;
+	transfers = 0;
+	wait_states = 0;
+	errors = 0;
+	mismatches = 0;
+	first_mismatch = 0;
+}
+
+uint32_t apb_trace_responder::rand_next() {
+	rand_state = rand_state * 6364136223846793005ull + 1442695040888963407ull;
+	return rand_state >> 32;
+}
+
+const apb_trace_beat *apb_trace_responder::next_beat(bool write, uint32_t addr) {
+	if (pos >= n) {
+		if (!loop || n == 0)
+			return NULL;
+		pos = 0;
+	}
+	const apb_trace_beat *b = &beats[pos++];
+	if (b->addr != addr || !(b->flags & APB_TRACE_WRITE) != !write) {
+		if (mismatches == 0)
+			first_mismatch = transfers;
+		++mismatches;
+	}
+	return b;
+}
+
+int apb_trace_responder::draw(const latency_dist &d, bool &err) {
+	uint64_t total = d.total();
+	if (total == 0) {
+		err = false;
+		return 0;
+	}
+	uint64_t r = (((uint64_t)rand_next() << 32) | rand_next()) % total;
+	err = (((uint64_t)rand_next() << 32) | rand_next()) % total < d.errors;
+	return std::upper_bound(d.cumulative.begin(), d.cumulative.end(), r) - d.cumulative.begin();
+}
+
+apb_read_response apb_trace_responder::apb_read(uint32_t addr) {
+	apb_read_response resp = {.rdata = 0, .delay_cycles = 0, .err = true};
+	if (mode == APB_TRACE_EXACT) {
+		const apb_trace_beat *b = next_beat(false, addr);
+		if (b) {
+			resp.rdata = b->data;
+			resp.delay_cycles = b->wait_states;
+			resp.err = b->flags & APB_TRACE_SLVERR;
+		}
+	} else {
+		resp.delay_cycles = draw(read_dist, resp.err);
+		if (!resp.err) {
+			auto it = mem.find(addr);
+			resp.rdata = it == mem.end() ? 0 : it->second;
+		}
+	}
+	++transfers;
+	wait_states += resp.delay_cycles;
+	errors += resp.err;
+	return resp;
+}
+
+apb_write_response apb_trace_responder::apb_write(uint32_t addr, uint32_t data) {
+	apb_write_response resp = {.delay_cycles = 0, .err = true};
+	if (mode == APB_TRACE_EXACT) {
+		const apb_trace_beat *b = next_beat(true, addr);
+		if (b) {
+			resp.delay_cycles = b->wait_states;
+			resp.err = b->flags & APB_TRACE_SLVERR;
+		}
+	} else {
+		resp.delay_cycles = draw(write_dist, resp.err);
+		if (!resp.err)
+			mem[addr] = data;
+	}
+	++transfers;
+	wait_states += resp.delay_cycles;
+	errors += resp.err;
+	return resp;
+}
+
+double apb_trace_responder::capture_mean_read_wait() const {
+	uint64_t sum = 0, count = 0;
+	for (uint64_t i = 0; i < n; ++i) {
+		if (!(beats[i].flags & APB_TRACE_WRITE)) {
+			sum += beats[i].wait_states;
+			++count;
+		}
+	}
+	return count ? (double)sum / count : 0.0;
+}
+
+double apb_trace_responder::capture_mean_write_wait() const {
+	uint64_t sum = 0, count = 0;
+	for (uint64_t i = 0; i < n; ++i) {
+		if (beats[i].flags & APB_TRACE_WRITE) {
+			sum += beats[i].wait_states;
+			++count;
+		}
+	}
+	return count ? (double)sum / count : 0.0;
+}
@@ -1,3 +1,9 @@
 file dap_integration.v
 list $HDL/opendap_sw_dp.f
+list $HDL/opendap_sw_dp_sysclk.f
 list $HDL/opendap_mem_ap_apb.f
+list $HDL/opendap_ap_mux.f
+list $HDL/opendap_trace_ap.f
+list $HDL/opendap_mailbox_ap.f
+list $HDL/opendap_reg_window_ap.f
+list $HDL/opendap_rom_table.f
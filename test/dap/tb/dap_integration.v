@@ -1,4 +1,21 @@
-// Integrate SW-DP and APB3 Mem-AP for testing. Actual testbench logic is all C++.
+// Integrate SW-DP and APs for testing. Actual testbench logic is all C++.
+//
+// - APSEL 0: APB3 Mem-AP
+// - APSEL 1: trace capture AP
+// - APSEL 2: mailbox AP
+// - APSEL 3: register window AP, sharing the Mem-AP's downstream APB port
+//
+// A ROM table at ROM_BASE answers on the downstream bus in place of the
+// testbench, and the Mem-AP's BASE points at it. Its entries point back into
+// testbench-modelled space, where testcases can model further components and
+// nested tables.
+//
+// SYSCLK=0: DP and AP are clocked by SWCLK (clk is unused). The downstream
+//           bus, trace capture and mailbox target side run on clk_dst,
+//           which the testbench drives either in step with SWCLK or as an
+//           independent clock.
+// SYSCLK=1: DP oversamples SWCLK, and everything runs on clk (clk_dst is
+//           unused).
 
 module dap_integration #(
 	parameter        DPIDR              = 32'hdeadbeef,
@@ -6,17 +23,30 @@ module dap_integration #(
 
 	parameter [10:0] IDR_DESIGNER       = 11'h7ff,
 	parameter [3:0]  IDR_REVISION       = 4'h0,
-	parameter [31:0] BASE               = 32'h0000_0000,
-	parameter        TAR_INCREMENT_BITS = 12
+	parameter [31:0] ROM_BASE           = 32'he00f_f000,
+	parameter [31:0] BASE               = ROM_BASE | 32'h3,
+	parameter        TAR_INCREMENT_BITS = 12,
+	parameter        DST_TIMEOUT_CYCLES = 256,
+	// Synchroniser depth for all APs' crossings to clk_dst. Forced to 0 with
+	// SYSCLK, where there is no clock crossing.
+	parameter        N_SYNC_STAGES      = 2,
+	parameter        SYSCLK             = 0,
+	parameter        PERF_COUNTERS      = 1,
+	parameter        MEM_ENGINE         = 1,
+	parameter        TAR_STRIDE         = 1,
+	parameter        TAR_2D             = 1,
+	parameter        ATOMIC_ALIASES     = 1
 
 ) (
 
+	input  wire        clk,
 	input  wire        swclk,
+	input  wire        clk_dst,
 	input  wire        rst_n,
 
 	input  wire        swdi,
-	output reg         swdo,
-	output reg         swdo_en,
+	output wire        swdo,
+	output wire        swdo_en,
 
 	output wire        cdbgpwrupreq,
 	input  wire        cdbgpwrupack,
@@ -24,7 +54,6 @@ module dap_integration #(
 	input  wire        csyspwrupack,
 
 	input  wire [3:0]  instid,
-	input  wire        eventstat,
 
 	output wire        dst_psel,
 	output wire        dst_penable,
@@ -33,7 +62,21 @@ module dap_integration #(
 	output wire [31:0] dst_pwdata,
 	input  wire [31:0] dst_prdata,
 	input  wire        dst_pready,
-	input  wire        dst_pslverr
+	input  wire        dst_pslverr,
+
+	input  wire        trace_valid,
+	input  wire [31:0] trace_data,
+	input  wire        trace_trigger,
+
+	output wire [31:0] mbox_h2t_data,
+	output wire        mbox_h2t_valid,
+	input  wire        mbox_h2t_ready,
+	input  wire [31:0] mbox_t2h_data,
+	input  wire        mbox_t2h_valid,
+	output wire        mbox_t2h_ready,
+	input  wire        mbox_rst_n_tgt,
+	output wire        mbox_irq_h2t_nonempty,
+	output wire        mbox_irq_t2h_empty
 );
 
 wire cdbgpwrupreq;
@@ -43,6 +86,11 @@ wire csyspwrupack = csyspwrupreq;
 wire cdbgrstreq;
 wire cdbgrstack = cdbgrstreq;
 
+// EVENTSTAT.EA is 0 when an event requires attention: here, when the
+// Mem-AP's poll engine has finished.
+wire        mem_ap_poll_done;
+wire        eventstat = !mem_ap_poll_done;
+
 wire [7:0]  ap_sel;
 wire [5:0]  ap_addr;
 wire [31:0] ap_wdata;
@@ -53,69 +101,373 @@ wire [31:0] ap_rdata;
 wire        ap_rdy;
 wire        ap_err;
 
-opendap_sw_dp #(
-	.DPIDR    (DPIDR),
-	.TARGETID (TARGETID)
-) dp (
-	.swclk        (swclk),
-	.rst_n        (rst_n),
-
-	.swdi         (swdi),
-	.swdo         (swdo),
-	.swdo_en      (swdo_en),
-
-	.cdbgpwrupreq (cdbgpwrupreq),
-	.cdbgpwrupack (cdbgpwrupack),
-	.csyspwrupreq (csyspwrupreq),
-	.csyspwrupack (csyspwrupack),
-	.cdbgrstreq   (cdbgrstreq),
-	.cdbgrstack   (cdbgrstack),
-
-	.instid       (instid),
-	.eventstat    (eventstat),
-
-	.ap_sel       (ap_sel),
-	.ap_addr      (ap_addr),
-	.ap_wdata     (ap_wdata),
-	.ap_wen       (ap_wen),
-	.ap_ren       (ap_ren),
-	.ap_abort     (ap_abort),
-	.ap_rdata     (ap_rdata),
-	.ap_rdy       (ap_rdy),
-	.ap_err       (ap_err)
+wire [5:0]  apn_addr;
+wire [31:0] apn_wdata;
+wire        apn_abort;
+
+wire        ap0_wen;
+wire        ap0_ren;
+wire [31:0] ap0_rdata;
+wire        ap0_rdy;
+wire        ap0_err;
+
+wire        ap1_wen;
+wire        ap1_ren;
+wire [31:0] ap1_rdata;
+wire        ap1_rdy;
+wire        ap1_err;
+
+wire        ap2_wen;
+wire        ap2_ren;
+wire [31:0] ap2_rdata;
+wire        ap2_rdy;
+wire        ap2_err;
+
+wire        ap3_wen;
+wire        ap3_ren;
+wire [31:0] ap3_rdata;
+wire        ap3_rdy;
+wire        ap3_err;
+
+wire        mem_ap_psel;
+wire        mem_ap_penable;
+wire        mem_ap_pwrite;
+wire [31:0] mem_ap_paddr;
+wire [31:0] mem_ap_pwdata;
+wire        mem_ap_pready;
+
+wire        window_ap_psel;
+wire        window_ap_penable;
+wire        window_ap_pwrite;
+wire [31:0] window_ap_paddr;
+wire [31:0] window_ap_pwdata;
+wire        window_ap_pready;
+
+wire        bus_psel;
+wire        bus_penable;
+wire        bus_pwrite;
+wire [31:0] bus_paddr;
+wire [31:0] bus_pwdata;
+wire [31:0] bus_prdata;
+wire        bus_pready;
+wire        bus_pslverr;
+
+// The DP, mux and Mem-AP upstream port are all on bus_clk. In the SYSCLK
+// configuration the Mem-AP's downstream clock is the same clock, so its
+// bridge synchronisers are removed too.
+wire bus_clk = SYSCLK ? clk : swclk;
+wire dst_clk = SYSCLK ? clk : clk_dst;
+
+generate
+if (SYSCLK) begin: dp_sysclk
+
+	opendap_sw_dp_sysclk #(
+		.DPIDR         (DPIDR),
+		.TARGETID      (TARGETID),
+		.PERF_COUNTERS (PERF_COUNTERS)
+	) dp (
+		.clk          (clk),
+		.swclk        (swclk),
+		.rst_n        (rst_n),
+
+		.swdi         (swdi),
+		.swdo         (swdo),
+		.swdo_en      (swdo_en),
+
+		.cdbgpwrupreq (cdbgpwrupreq),
+		.cdbgpwrupack (cdbgpwrupack),
+		.csyspwrupreq (csyspwrupreq),
+		.csyspwrupack (csyspwrupack),
+		.cdbgrstreq   (cdbgrstreq),
+		.cdbgrstack   (cdbgrstack),
+
+		.instid       (instid),
+		.eventstat    (eventstat),
+
+		.ap_sel       (ap_sel),
+		.ap_addr      (ap_addr),
+		.ap_wdata     (ap_wdata),
+		.ap_wen       (ap_wen),
+		.ap_ren       (ap_ren),
+		.ap_abort     (ap_abort),
+		.ap_rdata     (ap_rdata),
+		.ap_rdy       (ap_rdy),
+		.ap_err       (ap_err)
+	);
+
+end else begin: dp_swclk
+
+	opendap_sw_dp #(
+		.DPIDR         (DPIDR),
+		.TARGETID      (TARGETID),
+		.PERF_COUNTERS (PERF_COUNTERS)
+	) dp (
+		.swclk        (swclk),
+		.rst_n        (rst_n),
+
+		.swdi         (swdi),
+		.swdo         (swdo),
+		.swdo_en      (swdo_en),
+
+		.cdbgpwrupreq (cdbgpwrupreq),
+		.cdbgpwrupack (cdbgpwrupack),
+		.csyspwrupreq (csyspwrupreq),
+		.csyspwrupack (csyspwrupack),
+		.cdbgrstreq   (cdbgrstreq),
+		.cdbgrstack   (cdbgrstack),
+
+		.instid       (instid),
+		.eventstat    (eventstat),
+
+		.ap_sel       (ap_sel),
+		.ap_addr      (ap_addr),
+		.ap_wdata     (ap_wdata),
+		.ap_wen       (ap_wen),
+		.ap_ren       (ap_ren),
+		.ap_abort     (ap_abort),
+		.ap_rdata     (ap_rdata),
+		.ap_rdy       (ap_rdy),
+		.ap_err       (ap_err)
+	);
+
+end
+endgenerate
+
+// Other APSELs are RAZ/WI.
+opendap_ap_mux #(
+	.N_APS (4)
+) ap_mux (
+	.swclk       (bus_clk),
+	.rst_n       (rst_n),
+
+	.dpacc_sel   (ap_sel),
+	.dpacc_addr  (ap_addr),
+	.dpacc_wdata (ap_wdata),
+	.dpacc_wen   (ap_wen),
+	.dpacc_ren   (ap_ren),
+	.dpacc_abort (ap_abort),
+	.dpacc_rdata (ap_rdata),
+	.dpacc_rdy   (ap_rdy),
+	.dpacc_err   (ap_err),
+
+	.ap_addr     (apn_addr),
+	.ap_wdata    (apn_wdata),
+	.ap_wen      ({ap3_wen,   ap2_wen,   ap1_wen,   ap0_wen}),
+	.ap_ren      ({ap3_ren,   ap2_ren,   ap1_ren,   ap0_ren}),
+	.ap_abort    (apn_abort),
+	.ap_rdata    ({ap3_rdata, ap2_rdata, ap1_rdata, ap0_rdata}),
+	.ap_rdy      ({ap3_rdy,   ap2_rdy,   ap1_rdy,   ap0_rdy}),
+	.ap_err      ({ap3_err,   ap2_err,   ap1_err,   ap0_err})
 );
 
 opendap_mem_ap_apb #(
 	.IDR_DESIGNER       (IDR_DESIGNER),
 	.IDR_REVISION       (IDR_REVISION),
 	.BASE               (BASE),
-	.TAR_INCREMENT_BITS (TAR_INCREMENT_BITS)
+	.TAR_INCREMENT_BITS (TAR_INCREMENT_BITS),
+	.DST_TIMEOUT_CYCLES (DST_TIMEOUT_CYCLES),
+	.N_SYNC_STAGES      (SYSCLK ? 0 : N_SYNC_STAGES),
+	.PERF_COUNTERS      (PERF_COUNTERS),
+	.MEM_ENGINE         (MEM_ENGINE),
+	.TAR_STRIDE         (TAR_STRIDE),
+	.TAR_2D             (TAR_2D),
+	.ATOMIC_ALIASES     (ATOMIC_ALIASES)
 ) ap (
-	.swclk       (swclk),
+	.swclk       (bus_clk),
 	.rst_n_por   (rst_n),
 
-	// For simplicity, tie the clocks together. This CDC logic has already
-	// been tested with JTAG on a RISC-V FPGA platform.
-	.clk_dst     (swclk),
+	.clk_dst     (dst_clk),
 	.rst_n_dst   (rst_n),
 
-	.dpacc_addr  (ap_addr),
-	.dpacc_wdata (ap_wdata),
-	.dpacc_wen   (ap_wen && ap_sel == 8'h00),
-	.dpacc_ren   (ap_ren && ap_sel == 8'h00),
-	.dpacc_abort (ap_abort),
-	.dpacc_rdata (ap_rdata),
-	.dpacc_rdy   (ap_rdy),
-	.dpacc_err   (ap_err),
+	.dpacc_addr  (apn_addr),
+	.dpacc_wdata (apn_wdata),
+	.dpacc_wen   (ap0_wen),
+	.dpacc_ren   (ap0_ren),
+	.dpacc_abort (apn_abort),
+	.dpacc_rdata (ap0_rdata),
+	.dpacc_rdy   (ap0_rdy),
+	.dpacc_err   (ap0_err),
+
+	.dst_psel    (mem_ap_psel),
+	.dst_penable (mem_ap_penable),
+	.dst_pwrite  (mem_ap_pwrite),
+	.dst_paddr   (mem_ap_paddr),
+	.dst_pwdata  (mem_ap_pwdata),
+	.dst_prdata  (bus_prdata),
+	.dst_pready  (mem_ap_pready),
+	.dst_pslverr (bus_pslverr),
+
+	.eng_poll_done (mem_ap_poll_done)
+);
+
+opendap_reg_window_ap #(
+	.IDR_DESIGNER       (IDR_DESIGNER),
+	.IDR_REVISION       (IDR_REVISION),
+	.DST_TIMEOUT_CYCLES (DST_TIMEOUT_CYCLES),
+	.N_SYNC_STAGES      (SYSCLK ? 0 : N_SYNC_STAGES)
+) window_ap (
+	.swclk       (bus_clk),
+	.rst_n_por   (rst_n),
+
+	.clk_dst     (dst_clk),
+	.rst_n_dst   (rst_n),
+
+	.dpacc_addr  (apn_addr),
+	.dpacc_wdata (apn_wdata),
+	.dpacc_wen   (ap3_wen),
+	.dpacc_ren   (ap3_ren),
+	.dpacc_abort (apn_abort),
+	.dpacc_rdata (ap3_rdata),
+	.dpacc_rdy   (ap3_rdy),
+	.dpacc_err   (ap3_err),
+
+	.dst_psel    (window_ap_psel),
+	.dst_penable (window_ap_penable),
+	.dst_pwrite  (window_ap_pwrite),
+	.dst_paddr   (window_ap_paddr),
+	.dst_pwdata  (window_ap_pwdata),
+	.dst_prdata  (bus_prdata),
+	.dst_pready  (window_ap_pready),
+	.dst_pslverr (bus_pslverr)
+);
+
+// The Mem-AP and register window AP share the downstream bus. Whichever
+// selects it first owns it until its transfer ends (or it drops psel, on a
+// timeout or abort), with the Mem-AP winning a tie. The other AP sees
+// pready low until then, and the bus makes its own setup phase for the
+// transfer once granted, as that AP's penable may already be high.
+reg  bus_locked;
+reg  bus_owner_window;
+reg  bus_access;
+
+wire window_owns_bus = bus_locked ? bus_owner_window : window_ap_psel && !mem_ap_psel;
+
+always @ (posedge dst_clk or negedge rst_n) begin
+	if (!rst_n) begin
+		bus_locked <= 1'b0;
+		bus_owner_window <= 1'b0;
+		bus_access <= 1'b0;
+	end else if (!bus_psel || (bus_access && bus_pready)) begin
+		bus_locked <= 1'b0;
+		bus_access <= 1'b0;
+	end else begin
+		bus_locked <= 1'b1;
+		bus_owner_window <= window_owns_bus;
+		bus_access <= 1'b1;
+	end
+end
+
+assign bus_psel    = window_owns_bus ? window_ap_psel   : mem_ap_psel;
+assign bus_penable = bus_psel && bus_access;
+assign bus_pwrite  = window_owns_bus ? window_ap_pwrite : mem_ap_pwrite;
+assign bus_paddr   = window_owns_bus ? window_ap_paddr  : mem_ap_paddr;
+assign bus_pwdata  = window_owns_bus ? window_ap_pwdata : mem_ap_pwdata;
+
+assign mem_ap_pready    = bus_penable && bus_pready && !window_owns_bus;
+assign window_ap_pready = bus_penable && bus_pready && window_owns_bus;
+
+// The ROM table's 4 kB is decoded out here, and the testbench never sees
+// those transfers. Everything else goes out to the testbench.
+wire        rom_sel = bus_paddr[31:12] == ROM_BASE[31:12];
+wire [31:0] rom_prdata;
+wire        rom_pready;
+wire        rom_pslverr;
+
+// Entry 0: nested table, entry 1: a component, entry 2: a component that
+// is not present in this configuration. All three are modelled in C++.
+opendap_rom_table #(
+	.ROM_BASE     (ROM_BASE),
+	.N_COMPONENTS (3),
+	.COMPONENTS   ({32'he000_2000, 32'he000_1000, 32'he010_0000}),
+	.PRESENT      (3'b011),
+	.SYSMEM       (1),
+	.DESIGNER     (IDR_DESIGNER),
+	.PART_NUMBER  (12'h0da),
+	.REVISION     (IDR_REVISION)
+) rom_table (
+	.clk     (dst_clk),
+	.rst_n   (rst_n),
+
+	.psel    (bus_psel && rom_sel),
+	.penable (bus_penable),
+	.pwrite  (bus_pwrite),
+	.paddr   (bus_paddr[11:0]),
+	.pwdata  (bus_pwdata),
+	.prdata  (rom_prdata),
+	.pready  (rom_pready),
+	.pslverr (rom_pslverr)
+);
+
+assign dst_psel    = bus_psel && !rom_sel;
+assign dst_penable = bus_penable;
+assign dst_pwrite  = bus_pwrite;
+assign dst_paddr   = bus_paddr;
+assign dst_pwdata  = bus_pwdata;
+
+assign bus_prdata  = rom_sel ? rom_prdata  : dst_prdata;
+assign bus_pready  = rom_sel ? rom_pready  : dst_pready;
+assign bus_pslverr = rom_sel ? rom_pslverr : dst_pslverr;
+
+// Small buffer so that wrap/full cases are quick to reach. Trace data is
+// driven by the testbench on dst_clk.
+opendap_trace_ap #(
+	.IDR_DESIGNER  (IDR_DESIGNER),
+	.IDR_REVISION  (IDR_REVISION),
+	.LOG2_DEPTH    (5),
+	.N_SYNC_STAGES (SYSCLK ? 0 : N_SYNC_STAGES)
+) trace_ap (
+	.swclk         (bus_clk),
+	.rst_n_por     (rst_n),
+
+	.clk_trace     (dst_clk),
+	.rst_n_trace   (rst_n),
+
+	.dpacc_addr    (apn_addr),
+	.dpacc_wdata   (apn_wdata),
+	.dpacc_wen     (ap1_wen),
+	.dpacc_ren     (ap1_ren),
+	.dpacc_abort   (apn_abort),
+	.dpacc_rdata   (ap1_rdata),
+	.dpacc_rdy     (ap1_rdy),
+	.dpacc_err     (ap1_err),
+
+	.trace_valid   (trace_valid),
+	.trace_data    (trace_data),
+	.trace_trigger (trace_trigger)
+);
+
+// The target side of the mailbox is modelled by the testbench on dst_clk,
+// and has its own reset as well as the DAP reset.
+opendap_mailbox_ap #(
+	.IDR_DESIGNER   (IDR_DESIGNER),
+	.IDR_REVISION   (IDR_REVISION),
+	.LOG2_H2T_DEPTH (3),
+	.LOG2_T2H_DEPTH (4),
+	.N_SYNC_STAGES  (SYSCLK ? 0 : N_SYNC_STAGES)
+) mailbox_ap (
+	.swclk                (bus_clk),
+	.rst_n_por            (rst_n),
+
+	.clk_tgt              (dst_clk),
+	.rst_n_tgt            (rst_n && mbox_rst_n_tgt),
+
+	.dpacc_addr           (apn_addr),
+	.dpacc_wdata          (apn_wdata),
+	.dpacc_wen            (ap2_wen),
+	.dpacc_ren            (ap2_ren),
+	.dpacc_abort          (apn_abort),
+	.dpacc_rdata          (ap2_rdata),
+	.dpacc_rdy            (ap2_rdy),
+	.dpacc_err            (ap2_err),
 
-	.dst_psel    (dst_psel),
-	.dst_penable (dst_penable),
-	.dst_pwrite  (dst_pwrite),
-	.dst_paddr   (dst_paddr),
-	.dst_pwdata  (dst_pwdata),
-	.dst_prdata  (dst_prdata),
-	.dst_pready  (dst_pready),
-	.dst_pslverr (dst_pslverr)
+	.tgt_h2t_data         (mbox_h2t_data),
+	.tgt_h2t_valid        (mbox_h2t_valid),
+	.tgt_h2t_ready        (mbox_h2t_ready),
+	.tgt_t2h_data         (mbox_t2h_data),
+	.tgt_t2h_valid        (mbox_t2h_valid),
+	.tgt_t2h_ready        (mbox_t2h_ready),
+	.tgt_irq_h2t_nonempty (mbox_irq_h2t_nonempty),
+	.tgt_irq_t2h_empty    (mbox_irq_t2h_empty)
 );
 
 endmodule
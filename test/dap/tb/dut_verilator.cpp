@@ -0,0 +1,99 @@
+#include "dut_sim.h"
+
+#include "Vdap_integration.h"
+#include "verilated.h"
+#include "verilated_vcd_c.h"
+
+struct dut_sim::impl {
+	Vdap_integration *top;
+	VerilatedVcdC *vcd;
+};
+
+dut_sim::dut_sim() : p(new impl) {
+	// Must be set before the model is built, or trace() does nothing
+	Verilated::traceEverOn(true);
+	p->top = new Vdap_integration;
+	p->vcd = nullptr;
+	// Verilator models the asynchronous resets as edge-triggered, so start
+	// with the resets high: the testbench's first eval then makes a falling
+	// edge.
+	p->top->rst_n = 1;
+	p->top->mbox_rst_n_tgt = 1;
+	p->top->eval();
+}
+
+dut_sim::~dut_sim() {
+	p->top->final();
+	if (p->vcd) {
+		p->vcd->close();
+		delete p->vcd;
+	}
+	delete p->top;
+	delete p;
+}
+
+const char *dut_sim::backend() {
+	return "verilator";
+}
+
+void dut_sim::eval(const dut_inputs &in, dut_outputs &out) {
+	Vdap_integration *top = p->top;
+	top->clk = in.clk;
+	top->swclk = in.swclk;
+	top->clk_dst = in.clk_dst;
+	top->rst_n = in.rst_n;
+	top->swdi = in.swdi;
+	top->instid = in.instid;
+	top->dst_prdata = in.dst_prdata;
+	top->dst_pready = in.dst_pready;
+	top->dst_pslverr = in.dst_pslverr;
+	top->trace_valid = in.trace_valid;
+	top->trace_data = in.trace_data;
+	top->trace_trigger = in.trace_trigger;
+	top->mbox_h2t_ready = in.mbox_h2t_ready;
+	top->mbox_t2h_data = in.mbox_t2h_data;
+	top->mbox_t2h_valid = in.mbox_t2h_valid;
+	top->mbox_rst_n_tgt = in.mbox_rst_n_tgt;
+
+	top->eval();
+
+	out.swdo = top->swdo;
+	out.swdo_en = top->swdo_en;
+	out.dst_psel = top->dst_psel;
+	out.dst_penable = top->dst_penable;
+	out.dst_pwrite = top->dst_pwrite;
+	out.dst_paddr = top->dst_paddr;
+	out.dst_pwdata = top->dst_pwdata;
+	out.mbox_h2t_data = top->mbox_h2t_data;
+	out.mbox_h2t_valid = top->mbox_h2t_valid;
+	out.mbox_t2h_ready = top->mbox_t2h_ready;
+}
+
+bool dut_sim::open_waves(const std::string &path) {
+	if (p->vcd)
+		return false;
+	p->vcd = new VerilatedVcdC;
+	p->top->trace(p->vcd, 99);
+	p->vcd->open(path.c_str());
+	return p->vcd->isOpen();
+}
+
+void dut_sim::sample_waves(uint64_t time) {
+	if (!p->vcd)
+		return;
+	p->vcd->dump(time);
+	p->vcd->flush();
+}
+
+// Verilator can only save a model built with --savable, to a file, which
+// costs speed in every run, so there are no checkpoints: logs replay from
+// the start.
+bool dut_sim::save_state(std::vector<uint8_t> &state) {
+	(void)state;
+	return false;
+}
+
+bool dut_sim::restore_state(const std::vector<uint8_t> &state) {
+	(void)state;
+	return false;
+}
@@ -0,0 +1,573 @@
+#include "riscv_dm_model.h"
+
+// 128 DMI registers
+static const uint32_t DM_APB_SIZE = 0x200;
+
+static const uint32_t CMDERR_BUSY         = 1;
+static const uint32_t CMDERR_NOTSUP       = 2;
+static const uint32_t CMDERR_EXCEPTION    = 3;
+static const uint32_t CMDERR_HALTRESUME   = 4;
+
+static const uint32_t SBERROR_BADADDR     = 2;
+static const uint32_t SBERROR_ALIGNMENT   = 3;
+static const uint32_t SBERROR_SIZE        = 4;
+
+// sbcs fields which are plain read/write storage
+static const uint32_t SBCS_RW_MASK =
+	DM_SBCS_SBREADONADDR |
+	(7u << DM_SBCS_SBACCESS_LSB) |
+	DM_SBCS_SBAUTOINCREMENT |
+	DM_SBCS_SBREADONDATA;
+static const uint32_t SBCS_SBBUSYERROR = DM_SBCS_SBBUSYERROR;
+static const int      SBCS_SBERROR_LSB = 12;
+
+static const uint32_t CSR_MISA     = 0x301;
+static const uint32_t CSR_DCSR     = 0x7b0;
+static const uint32_t CSR_DPC      = 0x7b1;
+static const uint32_t CSR_DSCRATCH0 = 0x7b2;
+static const uint32_t CSR_DSCRATCH1 = 0x7b3;
+static const uint32_t CSR_MHARTID  = 0xf14;
+
+static const uint32_t DCSR_CAUSE_HALTREQ = 3u << 6;
+
+riscv_dm_model::config riscv_dm_model::default_config() {
+	config cfg;
+	cfg.dm_base = 0x00000000u;
+	cfg.n_harts = 2;
+	cfg.mem_base = 0x20000000u;
+	cfg.mem_size = 64 * 1024;
+	cfg.progbuf_size = 2;
+	cfg.data_count = 2;
+	cfg.halt_latency = 20;
+	cfg.resume_latency = 5;
+	cfg.abstract_latency = 4;
+	cfg.progbuf_insn_latency = 1;
+	cfg.sba_latency = 2;
+	cfg.apb_delay = 0;
+	return cfg;
+}
+
+riscv_dm_model::riscv_dm_model(const config &cfg_) : cfg(cfg_) {
+	harts.resize(cfg.n_harts);
+	for (int i = 0; i < cfg.n_harts; ++i) {
+		hart_state &h = harts[i];
+		for (int j = 0; j < 32; ++j)
+			h.x[j] = 0;
+		h.pc = cfg.mem_base;
+		h.dcsr = (4u << 28) | 3u; // xdebugver = 4, prv = M
+		h.dscratch[0] = 0;
+		h.dscratch[1] = 0;
+		h.halted = false;
+		h.havereset = true;
+		h.resumeack = false;
+		h.haltreq = false;
+		h.halt_at = 0;
+		h.resume_pending = false;
+		h.resume_at = 0;
+	}
+	mem.resize(cfg.mem_size, 0);
+	abstract_commands = 0;
+	progbuf_insns = 0;
+	sba_accesses = 0;
+	reset_dm();
+}
+
+void riscv_dm_model::reset_dm() {
+	dmactive = false;
+	hartsel = 0;
+	for (int i = 0; i < 12; ++i)
+		data[i] = 0;
+	for (int i = 0; i < 16; ++i)
+		progbuf[i] = 0;
+	command = 0;
+	abstractauto = 0;
+	cmderr = 0;
+	abstract_busy_until = 0;
+	sbcs = 2u << 17; // sbaccess = 32-bit
+	sbaddress = 0;
+	sbdata = 0;
+	sb_busy_until = 0;
+	for (hart_state &h : harts) {
+		h.haltreq = false;
+		h.resume_pending = false;
+	}
+}
+
+void riscv_dm_model::update(uint64_t now) {
+	for (hart_state &h : harts) {
+		if (h.haltreq && !h.halted && now >= h.halt_at) {
+			h.halted = true;
+			h.dcsr = (h.dcsr & ~(7u << 6)) | DCSR_CAUSE_HALTREQ;
+		}
+		if (h.resume_pending && now >= h.resume_at) {
+			h.resume_pending = false;
+			h.halted = false;
+			h.resumeack = true;
+		}
+	}
+}
+
+void riscv_dm_model::set_halted(uint64_t now, int hart, bool halted) {
+	update(now);
+	harts[hart].halted = halted;
+	harts[hart].resume_pending = false;
+}
+
+// ----------------------------------------------------------------------------
+// Bus interfaces
+
+apb_read_response riscv_dm_model::apb_read(uint64_t now, uint32_t addr) {
+	apb_read_response resp = {0, cfg.apb_delay, false};
+	if (addr - cfg.dm_base < DM_APB_SIZE)
+		resp.rdata = dmi_read(now, (addr - cfg.dm_base) >> 2);
+	else
+		resp.err = !mem_read(addr, 4, resp.rdata);
+	return resp;
+}
+
+apb_write_response riscv_dm_model::apb_write(uint64_t now, uint32_t addr, uint32_t data) {
+	apb_write_response resp = {cfg.apb_delay, false};
+	if (addr - cfg.dm_base < DM_APB_SIZE)
+		dmi_write(now, (addr - cfg.dm_base) >> 2, data);
+	else
+		resp.err = !mem_write(addr, 4, data);
+	return resp;
+}
+
+bool riscv_dm_model::mem_read(uint32_t addr, int size, uint32_t &data) {
+	uint32_t offs = addr - cfg.mem_base;
+	if (offs >= cfg.mem_size || cfg.mem_size - offs < (uint32_t)size || addr % size)
+		return false;
+	data = 0;
+	for (int i = 0; i < size; ++i)
+		data |= (uint32_t)mem[offs + i] << (8 * i);
+	return true;
+}
+
+bool riscv_dm_model::mem_write(uint32_t addr, int size, uint32_t data) {
+	uint32_t offs = addr - cfg.mem_base;
+	if (offs >= cfg.mem_size || cfg.mem_size - offs < (uint32_t)size || addr % size)
+		return false;
+	for (int i = 0; i < size; ++i)
+		mem[offs + i] = data >> (8 * i);
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// DMI registers
+
+uint32_t riscv_dm_model::dmi_read(uint64_t now, uint32_t dmi_addr) {
+	update(now);
+	if (!dmactive && dmi_addr != DMI_DMCONTROL)
+		return 0;
+
+	if (dmi_addr >= DMI_DATA0 && dmi_addr < DMI_DATA0 + (uint32_t)cfg.data_count) {
+		int i = dmi_addr - DMI_DATA0;
+		if (abstract_busy(now)) {
+			if (!cmderr)
+				cmderr = CMDERR_BUSY;
+			return data[i];
+		}
+		uint32_t rdata = data[i];
+		if ((abstractauto >> i) & 1u && !cmderr)
+			execute_command(now);
+		return rdata;
+	}
+	if (dmi_addr >= DMI_PROGBUF0 && dmi_addr < DMI_PROGBUF0 + (uint32_t)cfg.progbuf_size) {
+		int i = dmi_addr - DMI_PROGBUF0;
+		if (abstract_busy(now)) {
+			if (!cmderr)
+				cmderr = CMDERR_BUSY;
+			return progbuf[i];
+		}
+		uint32_t rdata = progbuf[i];
+		if ((abstractauto >> (16 + i)) & 1u && !cmderr)
+			execute_command(now);
+		return rdata;
+	}
+
+	switch (dmi_addr) {
+	case DMI_DMCONTROL:
+		return (hartsel & 0x3ffu) << 16 | (uint32_t)dmactive;
+	case DMI_DMSTATUS: {
+		uint32_t status =
+			(1u << 22) | // impebreak
+			(1u << 7)  | // authenticated
+			2u;          // version = 0.13
+		if (!hart_exists()) {
+			status |= (1u << 15) | (1u << 14);
+		} else {
+			const hart_state &h = harts[hartsel];
+			if (h.havereset)
+				status |= (1u << 19) | (1u << 18);
+			if (h.resumeack)
+				status |= (1u << 17) | (1u << 16);
+			if (h.halted)
+				status |= (1u << 9) | (1u << 8);
+			else
+				status |= (1u << 11) | (1u << 10);
+		}
+		return status;
+	}
+	case DMI_HARTINFO:
+		return 2u << 20; // nscratch = 2
+	case DMI_ABSTRACTCS:
+		return (uint32_t)cfg.progbuf_size << 24 |
+			(uint32_t)abstract_busy(now) << 12 |
+			cmderr << 8 |
+			(uint32_t)cfg.data_count;
+	case DMI_COMMAND:
+		return 0;
+	case DMI_ABSTRACTAUTO:
+		return abstractauto;
+	case DMI_SBCS:
+		return (1u << 29) |                        // sbversion = 1
+			sbcs |
+			(uint32_t)sb_busy(now) << 21 |
+			(32u << 5) |                           // sbasize = 32
+			0x7u;                                  // 8/16/32-bit access
+	case DMI_SBADDRESS0:
+		return sbaddress;
+	case DMI_SBDATA0: {
+		if (sb_busy(now)) {
+			sbcs |= SBCS_SBBUSYERROR;
+			return sbdata;
+		}
+		uint32_t rdata = sbdata;
+		if ((sbcs & (1u << 15)) && !(sbcs & (SBCS_SBBUSYERROR | 7u << SBCS_SBERROR_LSB)))
+			sb_read(now);
+		return rdata;
+	}
+	case DMI_HALTSUM0: {
+		uint32_t sum = 0;
+		for (int i = 0; i < cfg.n_harts && i < 32; ++i)
+			sum |= (uint32_t)harts[i].halted << i;
+		return sum;
+	}
+	default:
+		return 0;
+	}
+}
+
+void riscv_dm_model::dmi_write(uint64_t now, uint32_t dmi_addr, uint32_t wdata) {
+	update(now);
+	if (dmi_addr == DMI_DMCONTROL) {
+		if (!(wdata & 1u)) {
+			reset_dm();
+			return;
+		}
+		dmactive = true;
+		hartsel = (wdata >> 16) & 0x3ffu;
+		if (!hart_exists())
+			return;
+		hart_state &h = harts[hartsel];
+		if (wdata & (1u << 28))
+			h.havereset = false;
+		if (wdata & (1u << 31)) {
+			if (!h.haltreq && !h.halted) {
+				h.haltreq = true;
+				h.halt_at = now + cfg.halt_latency;
+			}
+		} else {
+			h.haltreq = false;
+			if (wdata & (1u << 30)) {
+				h.resumeack = false;
+				if (h.halted) {
+					h.resume_pending = true;
+					h.resume_at = now + cfg.resume_latency;
+				} else {
+					h.resumeack = true;
+				}
+			}
+		}
+		return;
+	}
+	if (!dmactive)
+		return;
+
+	if (dmi_addr >= DMI_DATA0 && dmi_addr < DMI_DATA0 + (uint32_t)cfg.data_count) {
+		int i = dmi_addr - DMI_DATA0;
+		if (abstract_busy(now)) {
+			if (!cmderr)
+				cmderr = CMDERR_BUSY;
+			return;
+		}
+		data[i] = wdata;
+		if ((abstractauto >> i) & 1u && !cmderr)
+			execute_command(now);
+		return;
+	}
+	if (dmi_addr >= DMI_PROGBUF0 && dmi_addr < DMI_PROGBUF0 + (uint32_t)cfg.progbuf_size) {
+		int i = dmi_addr - DMI_PROGBUF0;
+		if (abstract_busy(now)) {
+			if (!cmderr)
+				cmderr = CMDERR_BUSY;
+			return;
+		}
+		progbuf[i] = wdata;
+		if ((abstractauto >> (16 + i)) & 1u && !cmderr)
+			execute_command(now);
+		return;
+	}
+
+	switch (dmi_addr) {
+	case DMI_ABSTRACTCS:
+		cmderr &= ~((wdata >> 8) & 7u);
+		break;
+	case DMI_COMMAND:
+		if (abstract_busy(now)) {
+			if (!cmderr)
+				cmderr = CMDERR_BUSY;
+		} else if (!cmderr) {
+			command = wdata;
+			execute_command(now);
+		}
+		break;
+	case DMI_ABSTRACTAUTO:
+		if (abstract_busy(now)) {
+			if (!cmderr)
+				cmderr = CMDERR_BUSY;
+		} else {
+			uint32_t mask = ((1u << cfg.data_count) - 1u) |
+				(((1u << cfg.progbuf_size) - 1u) << 16);
+			abstractauto = wdata & mask;
+		}
+		break;
+	case DMI_SBCS:
+		sbcs = (sbcs & ~SBCS_RW_MASK) | (wdata & SBCS_RW_MASK);
+		sbcs &= ~(wdata & (SBCS_SBBUSYERROR | 7u << SBCS_SBERROR_LSB));
+		break;
+	case DMI_SBADDRESS0:
+		if (sb_busy(now)) {
+			sbcs |= SBCS_SBBUSYERROR;
+		} else if (!(sbcs & (SBCS_SBBUSYERROR | 7u << SBCS_SBERROR_LSB))) {
+			sbaddress = wdata;
+			if (sbcs & (1u << 20))
+				sb_read(now);
+		}
+		break;
+	case DMI_SBDATA0:
+		if (sb_busy(now)) {
+			sbcs |= SBCS_SBBUSYERROR;
+		} else if (!(sbcs & (SBCS_SBBUSYERROR | 7u << SBCS_SBERROR_LSB))) {
+			sbdata = wdata;
+			sb_write(now);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Abstract commands
+
+bool riscv_dm_model::csr_access(hart_state &h, uint32_t csr, uint32_t &rdata, bool write, uint32_t wdata) {
+	switch (csr) {
+	case CSR_DCSR:
+		rdata = h.dcsr;
+		// Only ebreakm, step and prv are writable.
+		if (write)
+			h.dcsr = (h.dcsr & ~0x8007u) | (wdata & 0x8007u);
+		return true;
+	case CSR_DPC:
+		rdata = h.pc;
+		if (write)
+			h.pc = wdata & ~1u;
+		return true;
+	case CSR_DSCRATCH0:
+	case CSR_DSCRATCH1:
+		rdata = h.dscratch[csr - CSR_DSCRATCH0];
+		if (write)
+			h.dscratch[csr - CSR_DSCRATCH0] = wdata;
+		return true;
+	case CSR_MISA:
+		rdata = (1u << 30) | (1u << 8); // RV32I
+		return true;
+	case CSR_MHARTID:
+		rdata = &h - &harts[0];
+		return true;
+	default:
+		return false;
+	}
+}
+
+void riscv_dm_model::execute_command(uint64_t now) {
+	++abstract_commands;
+	uint64_t cycles = cfg.abstract_latency;
+
+	uint32_t cmdtype = command >> 24;
+	uint32_t aarsize = (command >> 20) & 7u;
+	bool postincrement = command & (1u << 19);
+	bool postexec = command & (1u << 18);
+	bool transfer = command & (1u << 17);
+	bool write = command & (1u << 16);
+	uint32_t regno = command & 0xffffu;
+
+	if (cmdtype != 0 || (transfer && aarsize != 2)) {
+		cmderr = CMDERR_NOTSUP;
+	} else if (!hart_exists() || !harts[hartsel].halted) {
+		cmderr = CMDERR_HALTRESUME;
+	} else {
+		hart_state &h = harts[hartsel];
+		if (transfer) {
+			uint32_t rdata = 0;
+			if (regno >= 0x1000 && regno < 0x1020) {
+				rdata = h.x[regno - 0x1000];
+				if (write && regno != 0x1000)
+					h.x[regno - 0x1000] = data[0];
+			} else if (regno >= 0x1000 || !csr_access(h, regno, rdata, write, data[0])) {
+				cmderr = CMDERR_EXCEPTION;
+			}
+			if (!write && !cmderr)
+				data[0] = rdata;
+		}
+		if (!cmderr && postexec) {
+			int n_insns = 0;
+			if (!execute_progbuf(h, n_insns))
+				cmderr = CMDERR_EXCEPTION;
+			progbuf_insns += n_insns;
+			cycles += (uint64_t)n_insns * cfg.progbuf_insn_latency;
+		}
+		if (!cmderr && postincrement)
+			command = (command & ~0xffffu) | ((regno + 1) & 0xffffu);
+	}
+	abstract_busy_until = now + cycles;
+}
+
+// Minimal RV32I interpreter. The progbuf has no address of its own, so
+// branches, jumps and AUIPC are not supported.
+bool riscv_dm_model::execute_progbuf(hart_state &h, int &n_insns) {
+	uint32_t *x = h.x;
+	for (int i = 0; i < cfg.progbuf_size; ++i) {
+		uint32_t insn = progbuf[i];
+		++n_insns;
+		uint32_t opc = insn & 0x7fu;
+		uint32_t rd = (insn >> 7) & 0x1fu;
+		uint32_t funct3 = (insn >> 12) & 0x7u;
+		uint32_t rs1 = (insn >> 15) & 0x1fu;
+		uint32_t rs2 = (insn >> 20) & 0x1fu;
+		uint32_t funct7 = insn >> 25;
+		uint32_t imm_i = (uint32_t)((int32_t)insn >> 20);
+		uint32_t imm_s = (uint32_t)((int32_t)(insn & 0xfe000000u) >> 20) | rd;
+		uint32_t result = 0;
+		bool wen = true;
+
+		switch (opc) {
+		case 0x37: // LUI
+			result = insn & 0xfffff000u;
+			break;
+		case 0x13: { // OP-IMM
+			uint32_t shamt = imm_i & 0x1fu;
+			switch (funct3) {
+			case 0: result = x[rs1] + imm_i; break;
+			case 1: result = x[rs1] << shamt; break;
+			case 2: result = (int32_t)x[rs1] < (int32_t)imm_i; break;
+			case 3: result = x[rs1] < imm_i; break;
+			case 4: result = x[rs1] ^ imm_i; break;
+			case 5: result = funct7 & 0x20u ? (uint32_t)((int32_t)x[rs1] >> shamt) : x[rs1] >> shamt; break;
+			case 6: result = x[rs1] | imm_i; break;
+			default: result = x[rs1] & imm_i; break;
+			}
+			break;
+		}
+		case 0x33: { // OP
+			uint32_t shamt = x[rs2] & 0x1fu;
+			switch (funct3) {
+			case 0: result = funct7 & 0x20u ? x[rs1] - x[rs2] : x[rs1] + x[rs2]; break;
+			case 1: result = x[rs1] << shamt; break;
+			case 2: result = (int32_t)x[rs1] < (int32_t)x[rs2]; break;
+			case 3: result = x[rs1] < x[rs2]; break;
+			case 4: result = x[rs1] ^ x[rs2]; break;
+			case 5: result = funct7 & 0x20u ? (uint32_t)((int32_t)x[rs1] >> shamt) : x[rs1] >> shamt; break;
+			case 6: result = x[rs1] | x[rs2]; break;
+			default: result = x[rs1] & x[rs2]; break;
+			}
+			break;
+		}
+		case 0x03: { // LOAD
+			int size = 1 << (funct3 & 3u);
+			if ((funct3 & 3u) == 3u || funct3 > 5 || !mem_read(x[rs1] + imm_i, size, result))
+				return false;
+			if (funct3 == 0)
+				result = (uint32_t)(int32_t)(int8_t)result;
+			else if (funct3 == 1)
+				result = (uint32_t)(int32_t)(int16_t)result;
+			break;
+		}
+		case 0x23: // STORE
+			if (funct3 > 2 || !mem_write(x[rs1] + imm_s, 1 << funct3, x[rs2]))
+				return false;
+			wen = false;
+			break;
+		case 0x0f: // MISC-MEM: FENCE, FENCE.I
+			wen = false;
+			break;
+		case 0x73: { // SYSTEM
+			if (insn == 0x00100073u) // EBREAK
+				return true;
+			if ((funct3 & 3u) == 0)
+				return false;
+			uint32_t src = funct3 & 4u ? rs1 : x[rs1];
+			uint32_t csr = insn >> 20;
+			uint32_t old;
+			if (!csr_access(h, csr, old, false, 0))
+				return false;
+			uint32_t wdata = (funct3 & 3u) == 1 ? src : (funct3 & 3u) == 2 ? old | src : old & ~src;
+			bool csr_wen = (funct3 & 3u) == 1 || rs1 != 0;
+			if (csr_wen)
+				(void)csr_access(h, csr, old, true, wdata);
+			result = old;
+			break;
+		}
+		default:
+			return false;
+		}
+		if (wen && rd != 0)
+			x[rd] = result;
+	}
+	// Implicit EBREAK
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// System bus access
+
+void riscv_dm_model::sb_increment() {
+	if (sbcs & (1u << 16))
+		sbaddress += 1u << ((sbcs >> 17) & 7u);
+}
+
+void riscv_dm_model::sb_read(uint64_t now) {
+	uint32_t sbaccess = (sbcs >> 17) & 7u;
+	uint32_t err = 0;
+	if (sbaccess > 2)
+		err = SBERROR_SIZE;
+	else if (sbaddress & ((1u << sbaccess) - 1u))
+		err = SBERROR_ALIGNMENT;
+	else if (!mem_read(sbaddress, 1 << sbaccess, sbdata))
+		err = SBERROR_BADADDR;
+	++sba_accesses;
+	sb_busy_until = now + cfg.sba_latency;
+	if (err)
+		sbcs |= err << SBCS_SBERROR_LSB;
+	else
+		sb_increment();
+}
+
+void riscv_dm_model::sb_write(uint64_t now) {
+	uint32_t sbaccess = (sbcs >> 17) & 7u;
+	uint32_t err = 0;
+	if (sbaccess > 2)
+		err = SBERROR_SIZE;
+	else if (sbaddress & ((1u << sbaccess) - 1u))
+		err = SBERROR_ALIGNMENT;
+	else if (!mem_write(sbaddress, 1 << sbaccess, sbdata))
+		err = SBERROR_BADADDR;
+	++sba_accesses;
+	sb_busy_until = now + cfg.sba_latency;
+	if (err)
+		sbcs |= err << SBCS_SBERROR_LSB;
+	else
+		sb_increment();
+}
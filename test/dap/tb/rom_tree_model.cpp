@@ -0,0 +1,96 @@
+#include "rom_tree_model.h"
+
+static const uint32_t tb_designer = 0x7ffu;
+static const uint32_t rtl_rom_part = 0x0dau;
+static const uint32_t table_part = 0x4a1u;
+static const uint32_t leaf_part = 0x9c0u;
+
+void rom_tree_model::build(int depth, int fanout) {
+	nodes.clear();
+	next_slot = ROM_TREE_BASE;
+	this->depth = depth;
+	build_node(depth, fanout);
+	nodes[ROM_TREE_COMP_BASE] = {false, leaf_part, {}};
+}
+
+uint32_t rom_tree_model::build_node(int depth, int fanout) {
+	uint32_t base = next_slot;
+	next_slot += 0x1000;
+	nodes[base] = {depth > 0, depth > 0 ? table_part : leaf_part, {}};
+	if (depth > 0) {
+		for (int i = 0; i < fanout; ++i) {
+			uint32_t child = build_node(depth - 1, fanout);
+			nodes[base].children.push_back(child);
+		}
+	}
+	return base;
+}
+
+int rom_tree_model::count(uint32_t base) const {
+	int n = 1;
+	for (uint32_t child : nodes.at(base).children)
+		n += count(child);
+	return n;
+}
+
+// CIDR/PIDR at the top of each 4 kB component, for the tb's designer code
+static uint32_t id_reg(bool table, uint32_t part, uint32_t offset) {
+	switch (offset) {
+	case 0xfd0: return tb_designer >> 7;
+	case 0xfe0: return part & 0xffu;
+	case 0xfe4: return (tb_designer & 0xfu) << 4 | part >> 8;
+	case 0xfe8: return 0x08u | (tb_designer >> 4 & 0x7u);
+	case 0xff0: return 0x0du;
+	case 0xff4: return table ? 0x10u : 0x90u;
+	case 0xff8: return 0x05u;
+	case 0xffc: return 0xb1u;
+	default:    return 0;
+	}
+}
+
+apb_read_response rom_tree_model::read(uint32_t addr) const {
+	auto it = nodes.find(addr & 0xfffff000u);
+	if (it == nodes.end())
+		return {.rdata = 0, .delay_cycles = 0, .err = true};
+	const node &n = it->second;
+	uint32_t offset = addr & 0xfffu;
+	uint32_t rdata = id_reg(n.table, n.part, offset);
+	if (n.table && offset / 4 < n.children.size())
+		rdata = (n.children[offset / 4] - it->first) | 0x3u;
+	return {.rdata = rdata, .delay_cycles = 0, .err = false};
+}
+
+void rom_tree_model::check_topology(const cs_topology &topo) const {
+	tb_assert(topo.dpidr == DPIDR_EXPECTED && topo.targetid == TARGETID_EXPECTED,
+		"Bad key: DPIDR %08x TARGETID %08x\n", topo.dpidr, topo.targetid);
+	// RTL table, the modelled tree and the extra component
+	int expected = 1 + tree_size() + 1;
+	tb_assert((int)topo.components.size() == expected,
+		"Expected %d components, found %d\n", expected, (int)topo.components.size());
+
+	const cs_component &root = topo.components[0];
+	tb_assert(root.base == ROM_TREE_RTL_BASE && root.is_rom_table(), "Bad root at %08x\n", root.base);
+	tb_assert(root.designer() == tb_designer && root.part_number() == rtl_rom_part,
+		"Bad root ID: designer %03x part %03x\n", root.designer(), root.part_number());
+
+	int max_depth = 0;
+	bool found_comp = false;
+	for (const cs_component &c : topo.components) {
+		tb_assert(!c.error, "Error reading component at %08x\n", c.base);
+		tb_assert(c.base != ROM_TREE_ABSENT_BASE, "Not-present entry was followed\n");
+		if (c.base == ROM_TREE_COMP_BASE) {
+			found_comp = true;
+			continue;
+		}
+		if (c.base == ROM_TREE_RTL_BASE)
+			continue;
+		auto it = nodes.find(c.base);
+		tb_assert(it != nodes.end(), "Found a component at unmodelled address %08x\n", c.base);
+		tb_assert(it->second.table == c.is_rom_table() && it->second.part == c.part_number(),
+			"Wrong ID at %08x\n", c.base);
+		tb_assert(c.parent >= 0 && c.parent < (int)topo.components.size(), "Bad parent index\n");
+		max_depth = c.depth > max_depth ? c.depth : max_depth;
+	}
+	tb_assert(found_comp, "Missed component at %08x\n", ROM_TREE_COMP_BASE);
+	tb_assert(max_depth == depth + 1, "Expected depth %d, saw %d\n", depth + 1, max_depth);
+}
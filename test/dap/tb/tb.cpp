@@ -1,37 +1,76 @@
 #include "tb.h"
+#include "swd_monitor.h"
 
-#include <fstream>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 
-#include "dut.cpp"
-#include <backends/cxxrtl/cxxrtl_vcd.h>
+// Timebase for waves and for an independent clk_dst: ticks per step(), i.e.
+// per half SWCLK period. Divisible by every clk_dst ratio numerator.
+static const uint64_t ticks_per_step = 840;
+
+// Passed in by the Makefile, to match the RTL parameters
+#ifndef N_SYNC_STAGES
+#define N_SYNC_STAGES 2
+#endif
+#ifndef TAR_INCREMENT_BITS
+#define TAR_INCREMENT_BITS 12
+#endif
 
 tb::tb(std::string vcdfile) {
-	cxxrtl_design::p_dap__integration *dap = new cxxrtl_design::p_dap__integration;
-	dut = dap;
- 
-	waves_fd.open(vcdfile);
-	cxxrtl::debug_items all_debug_items;
-	dap->debug_info(all_debug_items);
-	vcd.timescale(1, "us");
-	vcd.add(all_debug_items);
-	vcd_sample = 0;
-
-	dap->p_rst__n.set<bool>(false);
-	dap->step();
-	dap->p_rst__n.set<bool>(true);
-	dap->p_dst__pready.set<bool>(true);
-	dap->step();
+	in = dut_inputs();
+	out = dut_outputs();
+	step_hook = NULL;
+	step_hook_ctx = NULL;
+	// Recording starts before reset, so a replay can start from a new model
+	const char *record_path = getenv("TB_RECORD");
+	if (record_path) {
+		const char *interval = getenv("TB_RECORD_CHECKPOINT");
+		uint64_t steps = interval ? 2 * strtoull(interval, NULL, 0) : STIM_DEFAULT_CHECKPOINT_STEPS;
+		tb_assert(rec.open(record_path, steps), "Can't record to %s\n", record_path);
+	}
+	if (!vcdfile.empty())
+		sim.open_waves(vcdfile);
+
+	in.rst_n = false;
+	in.mbox_rst_n_tgt = true;
+	in.clk_dst = false;
+	eval();
+	in.rst_n = true;
+	in.dst_pready = true;
+	eval();
 
 	swclk_prev = false;
 	read_callback = NULL;
 	write_callback = NULL;
+	trace_cb = NULL;
+	mbox_h2t_cb = NULL;
+	mbox_t2h_cb = NULL;
+	swd_mon = NULL;
+	swd_mon_swclk_prev = false;
+	bus_cycle = 0;
+	step_count = 0;
+	dst_tied = true;
+	dst_cfg = {1, 1, 0, 0, 0};
+	dst_next_edge = 0;
+	dst_rand = 0;
+	dst_cycle = 0;
 	last_read_response.delay_cycles = 0;
 	last_write_response.delay_cycles = 0;
 
-	vcd.sample(vcd_sample++);
-	waves_fd << vcd.buffer;
-	vcd.buffer.clear();
+	sample_waves(0);
+}
+
+void tb::eval() {
+	if (rec.is_open())
+		rec.eval(in);
+	sim.eval(in, out);
+}
+
+void tb::sample_waves(uint64_t time) {
+	if (rec.is_open())
+		rec.sample(time);
+	sim.sample_waves(time);
 }
 
 void tb::set_apb_read_callback(apb_read_callback cb) {
@@ -42,78 +81,290 @@ void tb::set_apb_write_callback(apb_write_callback cb) {
 	write_callback = cb;
 }
 
+void tb::set_trace_callback(trace_callback cb) {
+	trace_cb = cb;
+}
+
+void tb::set_mailbox_callbacks(mailbox_h2t_callback h2t, mailbox_t2h_callback t2h) {
+	mbox_h2t_cb = h2t;
+	mbox_t2h_cb = t2h;
+}
+
+void tb::set_mailbox_target_reset(bool asserted) {
+	in.mbox_rst_n_tgt = !asserted;
+}
+
+apb_request tb::get_apb_request() {
+	return {
+		.psel = out.dst_psel,
+		.penable = out.dst_penable,
+		.pwrite = out.dst_pwrite,
+		.paddr = out.dst_paddr,
+		.pwdata = out.dst_pwdata
+	};
+}
+
+void tb::set_apb_response(bool pready, uint32_t prdata, bool pslverr) {
+	in.dst_pready = pready;
+	in.dst_prdata = prdata;
+	in.dst_pslverr = pslverr;
+}
+
+void tb::set_swd_monitor(swd_monitor *mon) {
+	swd_mon = mon;
+}
+
 void tb::set_swclk(bool swclk) {
-	static_cast<cxxrtl_design::p_dap__integration*>(dut)->p_swclk.set<bool>(swclk);
+	in.swclk = swclk;
 }
 
 void tb::set_swdi(bool swdi) {
-	static_cast<cxxrtl_design::p_dap__integration*>(dut)->p_swdi.set<bool>(swdi);
+	in.swdi = swdi;
 }
 
 bool tb::get_swdo() {
 	// Pullup on bus, so return 1 if pin tristated.
-	return static_cast<cxxrtl_design::p_dap__integration*>(dut)->p_swdo__en.get<bool>() ?
-		static_cast<cxxrtl_design::p_dap__integration*>(dut)->p_swdo.get<bool>() : true;
+	return out.swdo_en ? out.swdo : true;
 }
 
 void tb::set_instid(uint8_t instid) {
-	static_cast<cxxrtl_design::p_dap__integration*>(dut)->p_instid.set<uint8_t>(instid);
+	in.instid = instid;
 }
 
-void tb::step() {
-	cxxrtl_design::p_dap__integration *dp = static_cast<cxxrtl_design::p_dap__integration*>(dut);
+bool tb::set_dst_clock(const dst_clock_config &cfg) {
+#ifdef SYSCLK_RATIO
+	(void)cfg;
+	return false;
+#else
+	tb_assert(cfg.ratio_num >= 1 && cfg.ratio_num <= 8 && cfg.ratio_den >= 1 && cfg.ratio_den <= 8,
+		"Bad clk_dst ratio %d:%d\n", cfg.ratio_num, cfg.ratio_den);
+	tb_assert(cfg.jitter_pct >= 0 && cfg.jitter_pct <= 50, "Bad clk_dst jitter %d%%\n", cfg.jitter_pct);
+	dst_cfg = cfg;
+	dst_tied = false;
+	dst_rand = cfg.seed;
+	// Start low, so that the first scheduled edge is a rising edge, phase
+	// degrees after the start of the next step.
+	in.clk_dst = false;
+	uint64_t period = 2 * ticks_per_step * cfg.ratio_den / cfg.ratio_num;
+	int phase = (cfg.phase_deg % 360 + 360) % 360;
+	dst_next_edge = step_count * ticks_per_step + period * phase / 360;
+	return true;
+#endif
+}
 
-	// Respond only to setup phase, then assume that access phase happens.
-	// Less state to track.
-	bool apb_start = dp->p_dst__psel.get<bool>() && !dp->p_dst__penable.get<bool>();
-	uint32_t paddr = dp->p_dst__paddr.get<uint32_t>();
-	bool pwrite = dp->p_dst__pwrite.get<bool>();
-	uint32_t pwdata = dp->p_dst__pwdata.get<uint32_t>();
-
-	dp->step();
-	dp->step();
-	vcd.sample(vcd_sample++);
-	waves_fd << vcd.buffer;
-	waves_fd.flush();
-	vcd.buffer.clear();
+void tb::set_dst_clock_tied() {
+	dst_tied = true;
+}
+
+int tb::n_sync_stages() {
+#ifdef SYSCLK_RATIO
+	return 0;
+#else
+	return N_SYNC_STAGES;
+#endif
+}
+
+int tb::tar_increment_bits() {
+	return TAR_INCREMENT_BITS;
+}
+
+// Toggle an independent clk_dst, and schedule its next edge. Returns true
+// for a rising edge.
+bool tb::dst_edge() {
+	bool clk = !in.clk_dst;
+	in.clk_dst = clk;
+
+	int64_t half = ticks_per_step * dst_cfg.ratio_den / dst_cfg.ratio_num;
+	int64_t jitter = 0;
+	if (dst_cfg.jitter_pct > 0) {
+		int64_t max = half * dst_cfg.jitter_pct / 100;
+		dst_rand = dst_rand * 1664525u + 1013904223u;
+		jitter = (int64_t)((dst_rand >> 8) % (uint32_t)(2 * max + 1)) - max;
+	}
+	dst_next_edge += half + jitter;
+	return clk;
+}
+
+// APB delays are counted in SWCLK periods in both configurations, so that
+// testcases see the same downstream timing relative to the SWD bus. With an
+// independent clk_dst they are counted in clk_dst periods instead.
+#ifdef SYSCLK_RATIO
+static const int apb_delay_scale = SYSCLK_RATIO;
+#else
+static const int apb_delay_scale = 1;
+#endif
+
+// Called on each rising edge of the clock which the Mem-AP's downstream port
+// runs on, with the APB request signals sampled just before that edge.
+void tb::apb_posedge(bool apb_start, uint32_t paddr, bool pwrite, uint32_t pwdata) {
+	++dst_cycle;
 
 	// Field APB accesses using testcase callbacks if available, and provide
 	// bus responses with correct timing based on callback results.
-	if (!swclk_prev && dp->p_swclk.get<bool>()) {
-		if (last_read_response.delay_cycles > 0) {
-			--last_read_response.delay_cycles;
-			if (last_read_response.delay_cycles == 0) {
-				dp->p_dst__prdata.set<uint32_t>(last_read_response.rdata);
-				dp->p_dst__pslverr.set<bool>(last_read_response.err);
-				dp->p_dst__pready.set<bool>(1);
-			}
+	if (last_read_response.delay_cycles > 0) {
+		--last_read_response.delay_cycles;
+		if (last_read_response.delay_cycles == 0) {
+			in.dst_prdata = last_read_response.rdata;
+			in.dst_pslverr = last_read_response.err;
+			in.dst_pready = 1;
 		}
-		if (last_write_response.delay_cycles > 0) {
-			--last_write_response.delay_cycles;
-			if (last_write_response.delay_cycles == 0) {
-				dp->p_dst__pslverr.set<bool>(last_write_response.err);
-				dp->p_dst__pready.set<bool>(1);
-			}
+	}
+	if (last_write_response.delay_cycles > 0) {
+		--last_write_response.delay_cycles;
+		if (last_write_response.delay_cycles == 0) {
+			in.dst_pslverr = last_write_response.err;
+			in.dst_pready = 1;
 		}
-		if (apb_start && !pwrite && read_callback) {
-			last_read_response = read_callback(paddr);
-			if (last_read_response.delay_cycles == 0) {
-				dp->p_dst__prdata.set<uint32_t>(last_read_response.rdata);
-				dp->p_dst__pslverr.set<bool>(last_read_response.err);
-			}
-			else {
-				dp->p_dst__pready.set<bool>(0);
-			}
+	}
+	if (apb_start && !pwrite && read_callback) {
+		last_read_response = read_callback(paddr);
+		last_read_response.delay_cycles *= apb_delay_scale;
+		if (last_read_response.delay_cycles == 0) {
+			in.dst_prdata = last_read_response.rdata;
+			in.dst_pslverr = last_read_response.err;
+			// Previous transfer may have been terminated by the bridge
+			// watchdog or an abort whilst we were still counting down.
+			in.dst_pready = 1;
 		}
-		else if (apb_start && pwrite && write_callback) {
-			last_write_response = write_callback(paddr, pwdata);
-			if (last_write_response.delay_cycles == 0) {
-				dp->p_dst__pslverr.set<bool>(last_write_response.err);
-			}
-			else {
-				dp->p_dst__pready.set<bool>(0);
-			}
+		else {
+			in.dst_pready = 0;
+		}
+	}
+	else if (apb_start && pwrite && write_callback) {
+		last_write_response = write_callback(paddr, pwdata);
+		last_write_response.delay_cycles *= apb_delay_scale;
+		if (last_write_response.delay_cycles == 0) {
+			in.dst_pslverr = last_write_response.err;
+			in.dst_pready = 1;
 		}
+		else {
+			in.dst_pready = 0;
+		}
+	}
+}
+
+// Models for the trace AP source and the mailbox AP target side, which run
+// on clk_dst like the downstream bus. Inputs are driven just after each
+// clk_dst rising edge, so they are sampled on the following edge. Called
+// before apb_posedge() for the same edge, so dst_cycle counts the edges
+// before it.
+void tb::trace_posedge() {
+	trace_sample s = {false, 0, false};
+	if (trace_cb)
+		s = trace_cb(dst_cycle);
+	in.trace_valid = s.valid;
+	in.trace_data = s.data;
+	in.trace_trigger = s.trigger;
+}
+
+// The t2h handshake is sampled just before the edge.
+void tb::mailbox_posedge(bool mbox_t2h_fire) {
+	bool h2t_ready = false;
+	if (mbox_h2t_cb && out.mbox_h2t_valid)
+		h2t_ready = mbox_h2t_cb(dst_cycle, out.mbox_h2t_data);
+	in.mbox_h2t_ready = h2t_ready;
+
+	if (mbox_t2h_fire || !in.mbox_t2h_valid) {
+		uint32_t data = 0;
+		bool valid = mbox_t2h_cb && mbox_t2h_cb(dst_cycle, data);
+		in.mbox_t2h_valid = valid;
+		in.mbox_t2h_data = data;
+	}
+}
+
+void tb::step() {
+	++step_count;
+
+	// The monitor sees SWDIO as the DP samples it: the host's value set up
+	// before the edge, or the target's output if it is driving.
+	bool swclk_mon = in.swclk;
+	if (swd_mon && swclk_mon && !swd_mon_swclk_prev) {
+		swd_mon->clock(out.swdo_en ? out.swdo : in.swdi);
 	}
-	swclk_prev = dp->p_swclk.get<bool>();
+	swd_mon_swclk_prev = swclk_mon;
+
+#ifdef SYSCLK_RATIO
+	// Each step is half a SWCLK period, so run half a SWCLK period's worth of
+	// system clock cycles.
+	for (int i = 0; i < SYSCLK_RATIO / 2; ++i) {
+		in.clk = false;
+		eval();
+
+		// Respond only to setup phase, then assume that access phase happens.
+		// Less state to track.
+		bool apb_start = out.dst_psel && !out.dst_penable;
+		uint32_t paddr = out.dst_paddr;
+		bool pwrite = out.dst_pwrite;
+		uint32_t pwdata = out.dst_pwdata;
+		bool mbox_t2h_fire = in.mbox_t2h_valid && out.mbox_t2h_ready;
+
+		in.clk = true;
+		eval();
+		trace_posedge();
+		mailbox_posedge(mbox_t2h_fire);
+		apb_posedge(apb_start, paddr, pwrite, pwdata);
+		++bus_cycle;
+	}
+	sample_waves((step_count - 1) * ticks_per_step);
+#else
+	// Respond only to setup phase, then assume that access phase happens.
+	// Less state to track.
+	bool apb_start = out.dst_psel && !out.dst_penable;
+	uint32_t paddr = out.dst_paddr;
+	bool pwrite = out.dst_pwrite;
+	uint32_t pwdata = out.dst_pwdata;
+	bool mbox_t2h_fire = in.mbox_t2h_valid && out.mbox_t2h_ready;
+
+	// The SWCLK edge (if any) is at the start of the step, and a clk_dst edge
+	// scheduled for the same time happens in the same evaluation.
+	const uint64_t t_start = (step_count - 1) * ticks_per_step;
+	bool swclk = in.swclk;
+	bool dst_rose;
+	if (dst_tied) {
+		in.clk_dst = swclk;
+		dst_rose = !swclk_prev && swclk;
+	} else {
+		dst_rose = dst_next_edge <= t_start && dst_edge();
+	}
+
+	eval();
+	eval();
+	sample_waves(t_start);
+
+	if (dst_rose) {
+		trace_posedge();
+		mailbox_posedge(mbox_t2h_fire);
+		apb_posedge(apb_start, paddr, pwrite, pwdata);
+	}
+	if (!swclk_prev && swclk)
+		++bus_cycle;
+	swclk_prev = swclk;
+
+	// Independent clk_dst edges before the next step
+	while (!dst_tied && dst_next_edge < t_start + ticks_per_step) {
+		const uint64_t t_edge = dst_next_edge;
+		apb_start = out.dst_psel && !out.dst_penable;
+		paddr = out.dst_paddr;
+		pwrite = out.dst_pwrite;
+		pwdata = out.dst_pwdata;
+		mbox_t2h_fire = in.mbox_t2h_valid && out.mbox_t2h_ready;
+		dst_rose = dst_edge();
+		eval();
+		sample_waves(t_edge);
+		if (dst_rose) {
+			trace_posedge();
+			mailbox_posedge(mbox_t2h_fire);
+			apb_posedge(apb_start, paddr, pwrite, pwdata);
+		}
+	}
+#endif
+	if (rec.is_open())
+		rec.end_step(sim);
+	if (step_hook)
+		step_hook(step_hook_ctx);
+}
+
+void tb::set_step_hook(tb_step_hook hook, void *ctx) {
+	step_hook = hook;
+	step_hook_ctx = ctx;
 }
@@ -0,0 +1,78 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check DAPABORT releases the DP from a downstream transfer that
+// is stuck, and that the bridge then terminates the transfer itself. clk_dst
+// runs at 1/8 of SWCLK, so the abort takes a few dozen SWCLK cycles to drain
+// through the bridge: a new access in that time fails cleanly and doesn't
+// increment TAR. Afterwards CSW.TrInProg is clear and the Mem-AP works
+// normally, well before the bridge watchdog (256 cycles in dap_integration)
+// could have ended the transfer.
+
+const uint32_t rdata_magic = 0x1234;
+const uint32_t start_addr =  0x5a000000;
+const uint32_t CSW_TR_IN_PROG = 0x80u;
+
+apb_read_response read_callback(uint32_t addr) {
+	static int count = 0;
+	return {
+		.rdata = rdata_magic + addr,
+		.delay_cycles = count++ == 0 ? 100000 : 0,
+		.err = false
+	};
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+
+	if (t.n_sync_stages() == 0 || !t.set_dst_clock({.ratio_num = 1, .ratio_den = 8, .phase_deg = 0,
+		.jitter_pct = 0, .seed = 0})) {
+		printf("clk_dst can't run independently in this build, nothing to test\n");
+		return 0;
+	}
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	// Word accesses with address auto-increment
+	(void)swd_write(t, AP, AP_REG_CSW, 0x12u);
+	(void)swd_write(t, AP, AP_REG_TAR, start_addr);
+
+	uint32_t data;
+	uint64_t stuck_since = t.dst_cycles();
+	status = swd_read(t, AP, AP_REG_DRW, data);
+	tb_assert(status == OK, "Should get OK on priming read\n");
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == WAIT, "Should get WAIT on stuck transfer\n");
+
+	status = swd_write(t, DP, DP_REG_ABORT, DP_ABORT_DAPABORT);
+	tb_assert(status == OK, "ABORT write should always be OK\n");
+
+	// Stuck transfer is still draining, so this can't be launched, and
+	// fails immediately.
+	status = swd_read(t, AP, AP_REG_DRW, data);
+	tb_assert(status == OK, "Access after abort should be accepted\n");
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == FAULT, "Access during drain should fail\n");
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK && (data & DP_CTRL_STAT_STICKYERR), "STICKYERR should be set\n");
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_STKERRCLR);
+
+	// Only the priming read incremented TAR.
+	(void)swd_read(t, AP, AP_REG_TAR, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == start_addr + 4, "Rejected access moved TAR to %08x\n", data);
+
+	(void)swd_read(t, AP, AP_REG_CSW, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && !(data & CSW_TR_IN_PROG), "TrInProg should clear after drain\n");
+	tb_assert(t.dst_cycles() - stuck_since < 256, "Watchdog could have ended the transfer\n");
+
+	(void)swd_write(t, AP, AP_REG_TAR, start_addr);
+	(void)swd_read(t, AP, AP_REG_DRW, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == rdata_magic + start_addr, "Bad readback after abort: %08x\n", data);
+
+	return 0;
+}
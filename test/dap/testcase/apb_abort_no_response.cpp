@@ -0,0 +1,52 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check that after DAPABORT of a transfer to a slave which never
+// raises pready, the next access succeeds. The abort has to end the stuck
+// transfer itself: the next access goes out well within the bridge watchdog
+// period (256 cycles in dap_integration), so the watchdog can't have helped.
+
+const uint32_t rdata_magic = 0x1234;
+const uint32_t start_addr =  0x5a000000;
+const uint32_t hang_addr =   0x5a0000f0;
+
+apb_read_response read_callback(uint32_t addr) {
+	return {
+		.rdata = rdata_magic + addr,
+		.delay_cycles = addr == hang_addr ? 100000 : 0,
+		.err = false
+	};
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	(void)swd_write(t, AP, AP_REG_CSW, 0x12u);
+	(void)swd_write(t, AP, AP_REG_TAR, hang_addr);
+
+	uint32_t data;
+	status = swd_read(t, AP, AP_REG_DRW, data);
+	tb_assert(status == OK, "Should get OK on priming read\n");
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == WAIT, "Should get WAIT on stuck transfer\n");
+
+	status = swd_write(t, DP, DP_REG_ABORT, DP_ABORT_DAPABORT);
+	tb_assert(status == OK, "ABORT write should always be OK\n");
+	// A few cycles for the abort to cross to clk_dst and back
+	idle_clocks(t, 16);
+
+	(void)swd_write(t, AP, AP_REG_TAR, start_addr);
+	status = swd_read(t, AP, AP_REG_DRW, data);
+	tb_assert(status == OK, "Access after abort should be accepted\n");
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == rdata_magic + start_addr, "Bad readback after abort: %d %08x\n",
+		(int)status, data);
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK && !(data & DP_CTRL_STAT_STICKYERR), "STICKYERR should be clear\n");
+
+	return 0;
+}
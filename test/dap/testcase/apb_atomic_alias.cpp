@@ -0,0 +1,117 @@
+#include "tb.h"
+
+// Test intent: check the Mem-AP's atomic set/clear/toggle aliases. Each
+// alias write should become one downstream read followed by one write to the
+// same address, with the modified value, and cost a single SWD write. Bits
+// changed by the target between host accesses must be preserved. Also check
+// that a read error skips the write, and that TAR does not increment.
+
+static const uint32_t gpio_out = 0x40014000u;
+static const uint32_t bad_addr = 0x40018000u;
+
+static uint32_t gpio_reg;
+static int reads;
+static int writes;
+static uint32_t last_addr;
+static bool last_was_write;
+static bool order_ok;
+
+apb_read_response read_callback(uint32_t addr) {
+	++reads;
+	// A read must not follow a read: each RMW is read then write.
+	if (reads != writes + 1)
+		order_ok = false;
+	last_addr = addr;
+	last_was_write = false;
+	return {
+		.rdata = addr == gpio_out ? gpio_reg : 0,
+		.delay_cycles = 1,
+		.err = addr != gpio_out
+	};
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	++writes;
+	if (last_was_write || addr != last_addr)
+		order_ok = false;
+	last_was_write = true;
+	if (addr == gpio_out)
+		gpio_reg = data;
+	return {
+		.delay_cycles = 1,
+		.err = addr != gpio_out
+	};
+}
+
+static void alias_write(tb &t, int reg, uint32_t data) {
+	reads = writes = 0;
+	order_ok = true;
+	last_was_write = true;
+	swd_status_t status = swd_write(t, AP, reg, data);
+	tb_assert(status == OK, "Alias write failed\n");
+	// Room for both halves of the read-modify-write to cross the bridge.
+	idle_clocks(t, 32);
+	uint32_t ctrl_stat;
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, ctrl_stat);
+	tb_assert(status == OK && !(ctrl_stat & DP_CTRL_STAT_STICKYERR), "Unexpected STICKYERR\n");
+	tb_assert(reads == 1 && writes == 1 && order_ok,
+		"Expected one read then one write, saw %d reads, %d writes\n", reads, writes);
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	// Auto-increment on, to check the aliases don't use it.
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_CSW);
+	(void)swd_write(t, AP, AP_REG_CSW, 0x10u);
+	(void)swd_write(t, AP, AP_REG_TAR, gpio_out);
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_ATOMIC);
+
+	gpio_reg = 0x0000f000u;
+	alias_write(t, AP_REG_DSET, 0x00000005u);
+	tb_assert(gpio_reg == 0x0000f005u, "Bad DSET result: %08x\n", gpio_reg);
+
+	// Target software sets a bit of its own in the meantime. A host-side
+	// read-modify-write started before this would have cleared it again.
+	gpio_reg |= 0x80000000u;
+	alias_write(t, AP_REG_DCLR, 0x00001001u);
+	tb_assert(gpio_reg == 0x8000e004u, "Bad DCLR result: %08x\n", gpio_reg);
+
+	alias_write(t, AP_REG_DXOR, 0x0000ff00u);
+	tb_assert(gpio_reg == 0x80001f04u, "Bad DXOR result: %08x\n", gpio_reg);
+
+	// Toggle a pin: one SWD write per edge.
+	const int n_toggles = 16;
+	for (int i = 0; i < n_toggles; ++i)
+		alias_write(t, AP_REG_DXOR, 0x1u);
+	tb_assert(gpio_reg == 0x80001f04u, "Even number of toggles should restore value: %08x\n", gpio_reg);
+
+	// Aliases read as zero, with no downstream access, and TAR hasn't moved.
+	uint32_t data;
+	reads = 0;
+	(void)swd_read(t, AP, AP_REG_DSET, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == 0 && reads == 0, "Alias read should be RES0: %08x\n", data);
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_TAR);
+	(void)swd_read(t, AP, AP_REG_TAR, data);
+	(void)swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(data == gpio_out, "TAR should not increment: %08x\n", data);
+
+	// Read error: STICKYERR, and no write.
+	(void)swd_write(t, AP, AP_REG_TAR, bad_addr);
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_ATOMIC);
+	reads = writes = 0;
+	(void)swd_write(t, AP, AP_REG_DSET, 0x1u);
+	idle_clocks(t, 32);
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK && (data & DP_CTRL_STAT_STICKYERR), "Read error should set STICKYERR\n");
+	tb_assert(reads == 1 && writes == 0, "Read error should skip the write: %d reads, %d writes\n", reads, writes);
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_STKERRCLR);
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the Mem-AP memory engine. Run CRC32, fill and compare
+// operations over ranges of a modelled memory, and check results against the
+// model. Then check that memory accesses are rejected and TAR writes ignored
+// whilst the engine is busy, and that DAPABORT stops a long-running
+// operation early.
+
+static const uint32_t mem_base = 0x20000000u;
+static const int mem_words = 256;
+static uint32_t mem[mem_words];
+static int mem_delay = 0;
+
+apb_read_response read_callback(uint32_t addr) {
+	uint32_t idx = (addr - mem_base) / 4;
+	bool err = idx >= (uint32_t)mem_words;
+	return {
+		.rdata = err ? 0 : mem[idx],
+		.delay_cycles = mem_delay,
+		.err = err
+	};
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	uint32_t idx = (addr - mem_base) / 4;
+	bool err = idx >= (uint32_t)mem_words;
+	if (!err)
+		mem[idx] = data;
+	return {
+		.delay_cycles = mem_delay,
+		.err = err
+	};
+}
+
+// Reference CRC32, bitwise, as zlib crc32()
+static uint32_t crc32_ref(const uint32_t *words, int n) {
+	uint32_t crc = 0xffffffffu;
+	for (int i = 0; i < n; ++i) {
+		for (int b = 0; b < 4; ++b) {
+			crc ^= (words[i] >> (8 * b)) & 0xffu;
+			for (int j = 0; j < 8; ++j)
+				crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1u));
+		}
+	}
+	return ~crc;
+}
+
+static uint32_t ap_read(tb &t, int reg) {
+	uint32_t data;
+	(void)swd_read(t, AP, reg, data);
+	swd_status_t status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK, "AP read failed\n");
+	return data;
+}
+
+static void ap_write(tb &t, int reg, uint32_t data) {
+	swd_status_t status = swd_write(t, AP, reg, data);
+	tb_assert(status == OK, "AP write failed\n");
+}
+
+static void eng_start(tb &t, uint32_t op, uint32_t addr, uint32_t len_bytes, uint32_t pattern) {
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_TAR);
+	ap_write(t, AP_REG_TAR, addr);
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_ENG);
+	ap_write(t, AP_REG_ENG_LEN, len_bytes);
+	ap_write(t, AP_REG_ENG_PATTERN, pattern);
+	ap_write(t, AP_REG_ENG_CTRL, op | AP_ENG_CTRL_START);
+}
+
+static uint32_t eng_wait(tb &t) {
+	for (int i = 0; i < 1000; ++i) {
+		uint32_t ctrl = ap_read(t, AP_REG_ENG_CTRL);
+		if (!(ctrl & AP_ENG_CTRL_BUSY)) {
+			tb_assert(ctrl & AP_ENG_CTRL_DONE, "DONE should be set when not busy\n");
+			return ctrl;
+		}
+		idle_clocks(t, 16);
+	}
+	tb_assert(false, "Engine timed out\n");
+	return 0;
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+	for (int i = 0; i < mem_words; ++i)
+		mem[i] = 0x9e3779b9u * (i + 1);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	// CRC32
+	const int crc_first = 4, crc_len = 64;
+	eng_start(t, AP_ENG_OP_CRC32, mem_base + 4 * crc_first, 4 * crc_len, 0);
+	uint32_t ctrl = eng_wait(t);
+	tb_assert(!(ctrl & (AP_ENG_CTRL_ERR | AP_ENG_CTRL_MISMATCH)), "Bad CRC status %08x\n", ctrl);
+	uint32_t crc = ap_read(t, AP_REG_ENG_RESULT);
+	uint32_t crc_expect = crc32_ref(&mem[crc_first], crc_len);
+	tb_assert(crc == crc_expect, "Bad CRC: %08x, expected %08x\n", crc, crc_expect);
+
+	// Fill
+	const int fill_first = 64, fill_len = 32;
+	const uint32_t pattern = 0xa5a5a5a5u;
+	const uint32_t fill_addr = mem_base + 4 * fill_first;
+	eng_start(t, AP_ENG_OP_FILL, fill_addr, 4 * fill_len, pattern);
+	ctrl = eng_wait(t);
+	tb_assert(!(ctrl & (AP_ENG_CTRL_ERR | AP_ENG_CTRL_MISMATCH)), "Bad fill status %08x\n", ctrl);
+	tb_assert(ap_read(t, AP_REG_ENG_RESULT) == fill_addr + 4 * fill_len, "Bad fill end address\n");
+	for (int i = 0; i < mem_words; ++i) {
+		bool in_range = i >= fill_first && i < fill_first + fill_len;
+		tb_assert(in_range == (mem[i] == pattern), "Bad fill at word %d\n", i);
+	}
+
+	// Compare, matching then mismatching
+	eng_start(t, AP_ENG_OP_COMPARE, fill_addr, 4 * fill_len, pattern);
+	ctrl = eng_wait(t);
+	tb_assert(!(ctrl & (AP_ENG_CTRL_ERR | AP_ENG_CTRL_MISMATCH)), "Bad compare status %08x\n", ctrl);
+	tb_assert(ap_read(t, AP_REG_ENG_RESULT) == fill_addr + 4 * fill_len, "Bad compare end address\n");
+
+	mem[fill_first + 7] = 0;
+	eng_start(t, AP_ENG_OP_COMPARE, fill_addr, 4 * fill_len, pattern);
+	ctrl = eng_wait(t);
+	tb_assert((ctrl & (AP_ENG_CTRL_ERR | AP_ENG_CTRL_MISMATCH)) == AP_ENG_CTRL_MISMATCH,
+		"Should see mismatch: %08x\n", ctrl);
+	tb_assert(ap_read(t, AP_REG_ENG_RESULT) == fill_addr + 4 * 7, "Bad mismatch address\n");
+
+	// Bus error ends the operation, and reports the faulting address
+	eng_start(t, AP_ENG_OP_CRC32, mem_base + 4 * (mem_words - 2), 16, 0);
+	ctrl = eng_wait(t);
+	tb_assert(ctrl & AP_ENG_CTRL_ERR, "Should see bus error: %08x\n", ctrl);
+	tb_assert(ap_read(t, AP_REG_ENG_RESULT) == mem_base + 4 * mem_words, "Bad error address\n");
+
+	// Memory access whilst busy is rejected, and doesn't move TAR.
+	mem_delay = 8;
+	const uint32_t long_addr = mem_base;
+	const uint32_t long_len = 4 * 200;
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_CSW);
+	ap_write(t, AP_REG_CSW, 0x10u);
+	eng_start(t, AP_ENG_OP_CRC32, long_addr, long_len, 0);
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_DRW);
+	uint32_t data;
+	(void)swd_read(t, AP, AP_REG_DRW, data);
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK && (data & DP_CTRL_STAT_STICKYERR), "Access whilst busy should set STICKYERR\n");
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_STKERRCLR);
+	tb_assert(ap_read(t, AP_REG_TAR) == long_addr, "TAR should not increment on rejected access\n");
+	// The engine is still reading TAR, so writes to it are ignored.
+	ap_write(t, AP_REG_TAR, mem_base + 0x80u);
+	tb_assert(ap_read(t, AP_REG_TAR) == long_addr, "TAR write whilst busy should be ignored\n");
+
+	// DAPABORT stops the engine early.
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_DAPABORT);
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_ENG);
+	ctrl = eng_wait(t);
+	tb_assert(ctrl & AP_ENG_CTRL_ERR, "Stopped operation should report ERR: %08x\n", ctrl);
+	uint32_t stop_addr = ap_read(t, AP_REG_ENG_RESULT);
+	tb_assert(stop_addr > long_addr && stop_addr < long_addr + long_len,
+		"Should stop part way through: %08x\n", stop_addr);
+	printf("Stopped at %08x\n", stop_addr);
+
+	// Back to normal memory accesses.
+	mem_delay = 0;
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_DRW);
+	ap_write(t, AP_REG_TAR, mem_base + 4 * crc_first);
+	(void)swd_read(t, AP, AP_REG_DRW, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == mem[crc_first], "Bad readback after engine: %08x\n", data);
+
+	return 0;
+}
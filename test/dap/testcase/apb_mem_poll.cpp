@@ -0,0 +1,110 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the Mem-AP memory engine's poll operation. Wait for a
+// modelled busy flag to clear, watching the DP's EVENTSTAT rather than
+// polling the Mem-AP, then check the timeout and DAPABORT paths.
+
+static const uint32_t status_addr = 0x40000000u;
+static const uint32_t never_addr = 0x40000004u;
+static const uint32_t status_busy = 0x1u;
+static const uint32_t status_ready = 0x80u;
+static const int busy_reads = 50;
+
+static int status_reads;
+
+apb_read_response read_callback(uint32_t addr) {
+	uint32_t rdata = 0;
+	if (addr == status_addr)
+		rdata = ++status_reads > busy_reads ? status_ready : status_busy;
+	return {
+		.rdata = rdata,
+		.delay_cycles = 1,
+		.err = addr != status_addr && addr != never_addr
+	};
+}
+
+static uint32_t ap_read(tb &t, int reg) {
+	uint32_t data;
+	(void)swd_read(t, AP, reg, data);
+	swd_status_t status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK, "AP read failed\n");
+	return data;
+}
+
+static void ap_write(tb &t, int reg, uint32_t data) {
+	swd_status_t status = swd_write(t, AP, reg, data);
+	tb_assert(status == OK, "AP write failed\n");
+}
+
+static void poll_start(tb &t, uint32_t addr, uint32_t mask, uint32_t expect, uint32_t timeout) {
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_TAR);
+	ap_write(t, AP_REG_TAR, addr);
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_ENG_MASK);
+	ap_write(t, AP_REG_ENG_MASK, mask);
+	// Stay in DP bank 4 from here, so EVENTSTAT can be read directly.
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_ENG | DP_BANK_EVENTSTAT);
+	ap_write(t, AP_REG_ENG_LEN, timeout);
+	ap_write(t, AP_REG_ENG_PATTERN, expect);
+	ap_write(t, AP_REG_ENG_CTRL, AP_ENG_OP_POLL | AP_ENG_CTRL_START);
+}
+
+// Returns number of EVENTSTAT reads before the event was seen.
+static int wait_event(tb &t) {
+	for (int i = 0; i < 1000; ++i) {
+		uint32_t data;
+		swd_status_t status = swd_read(t, DP, DP_REG_EVENTSTAT, data);
+		tb_assert(status == OK, "EVENTSTAT read failed\n");
+		if (!(data & DP_EVENTSTAT_EA))
+			return i + 1;
+		idle_clocks(t, 8);
+	}
+	tb_assert(false, "No event\n");
+	return 0;
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	uint32_t data;
+	(void)swd_write(t, DP, DP_REG_SELECT, DP_BANK_EVENTSTAT);
+	status = swd_read(t, DP, DP_REG_EVENTSTAT, data);
+	tb_assert(status == OK && (data & DP_EVENTSTAT_EA), "No event expected out of reset\n");
+
+	// Wait for busy flag to clear, no timeout.
+	status_reads = 0;
+	poll_start(t, status_addr, status_busy, 0, 0);
+	int eventstat_reads = wait_event(t);
+	uint32_t ctrl = ap_read(t, AP_REG_ENG_CTRL);
+	tb_assert((ctrl & (AP_ENG_CTRL_BUSY | AP_ENG_CTRL_DONE | AP_ENG_CTRL_ERR | AP_ENG_CTRL_TIMEOUT))
+		== AP_ENG_CTRL_DONE, "Bad status after match: %08x\n", ctrl);
+	uint32_t result = ap_read(t, AP_REG_ENG_RESULT);
+	tb_assert(result == status_ready, "RESULT should be the matching value: %08x\n", result);
+	tb_assert(status_reads == busy_reads + 1, "Should stop polling on match: %d reads\n", status_reads);
+	printf("Matched after %d bus reads, %d EVENTSTAT reads\n", status_reads, eventstat_reads);
+
+	// Condition never true: times out, which is also an event.
+	poll_start(t, never_addr, 0x1u, 0x1u, 500);
+	(void)wait_event(t);
+	ctrl = ap_read(t, AP_REG_ENG_CTRL);
+	tb_assert((ctrl & (AP_ENG_CTRL_BUSY | AP_ENG_CTRL_ERR | AP_ENG_CTRL_TIMEOUT)) == AP_ENG_CTRL_TIMEOUT,
+		"Bad status after timeout: %08x\n", ctrl);
+
+	// Poll forever, check the event is cleared, then stop with DAPABORT.
+	poll_start(t, never_addr, 0x1u, 0x1u, 0);
+	idle_clocks(t, 100);
+	status = swd_read(t, DP, DP_REG_EVENTSTAT, data);
+	tb_assert(status == OK && (data & DP_EVENTSTAT_EA), "Event should clear on new start\n");
+	tb_assert(ap_read(t, AP_REG_ENG_CTRL) & AP_ENG_CTRL_BUSY, "Should still be polling\n");
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_DAPABORT);
+	(void)wait_event(t);
+	ctrl = ap_read(t, AP_REG_ENG_CTRL);
+	tb_assert((ctrl & (AP_ENG_CTRL_BUSY | AP_ENG_CTRL_ERR | AP_ENG_CTRL_TIMEOUT)) == AP_ENG_CTRL_ERR,
+		"Bad status after abort: %08x\n", ctrl);
+
+	return 0;
+}
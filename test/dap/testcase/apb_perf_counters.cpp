@@ -0,0 +1,66 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the Mem-AP's downstream transfer counters: number of
+// transfers, total bus cycles, and the longest transfer, and that a write to
+// any of them clears all three.
+
+const uint32_t start_addr = 0x5a000000;
+const int n_reads = 3;
+const int delays[n_reads] = {0, 7, 3};
+
+apb_read_response read_callback(uint32_t addr) {
+	static int count = 0;
+	return {
+		.rdata = addr,
+		.delay_cycles = delays[count++ % n_reads],
+		.err = false
+	};
+}
+
+static uint32_t read_perf(tb &t, int reg) {
+	uint32_t data;
+	(void)swd_read(t, AP, reg, data);
+	swd_status_t status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK, "Perf counter read failed\n");
+	return data;
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	(void)swd_write(t, AP, AP_REG_CSW, 0);
+	(void)swd_write(t, AP, AP_REG_TAR, start_addr);
+	for (int i = 0; i < n_reads; ++i) {
+		uint32_t data;
+		(void)swd_read(t, AP, AP_REG_DRW, data);
+		idle_clocks(t, 20);
+		status = swd_read(t, DP, DP_REG_RDBUF, data);
+		tb_assert(status == OK && data == start_addr, "Bad read %d\n", i);
+	}
+
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_PERF);
+	uint32_t count = read_perf(t, AP_REG_PERF_XFER_COUNT);
+	uint32_t cycles = read_perf(t, AP_REG_PERF_XFER_CYCLES);
+	uint32_t max = read_perf(t, AP_REG_PERF_XFER_MAX);
+	printf("Transfers: %u, total cycles: %u, max cycles: %u\n", count, cycles, max);
+
+	// Every APB transfer takes at least a setup and an access cycle, plus the
+	// delay we added (which is scaled up if the downstream clock is faster).
+	tb_assert(count == n_reads, "Expected %d transfers\n", n_reads);
+	tb_assert(max >= 2 + 7, "Max latency too small\n");
+	tb_assert(cycles >= 3 * 2 + 0 + 7 + 3, "Total cycles too small\n");
+	tb_assert(cycles >= max + 2 * 2, "Total should include max plus two more transfers\n");
+
+	status = swd_write(t, AP, AP_REG_PERF_XFER_MAX, 0);
+	tb_assert(status == OK, "Clear write failed\n");
+	tb_assert(read_perf(t, AP_REG_PERF_XFER_COUNT) == 0, "Count not cleared\n");
+	tb_assert(read_perf(t, AP_REG_PERF_XFER_CYCLES) == 0, "Cycles not cleared\n");
+	tb_assert(read_perf(t, AP_REG_PERF_XFER_MAX) == 0, "Max not cleared\n");
+
+	return 0;
+}
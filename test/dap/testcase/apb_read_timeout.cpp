@@ -0,0 +1,48 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the bridge watchdog (256 cycles in dap_integration)
+// terminates a downstream read that never completes, reporting an error
+// instead of WAITing forever, and that we can recover afterward.
+
+const uint32_t rdata_magic = 0x1234;
+const uint32_t start_addr =  0x5a000000;
+
+apb_read_response read_callback(uint32_t addr) {
+	static int count = 0;
+	return {
+		.rdata = rdata_magic + addr,
+		.delay_cycles = count++ == 0 ? 100000 : 0,
+		.err = false
+	};
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	(void)swd_write(t, AP, AP_REG_CSW, 0);
+	(void)swd_write(t, AP, AP_REG_TAR, start_addr);
+
+	uint32_t data;
+	status = swd_read(t, AP, AP_REG_DRW, data);
+	tb_assert(status == OK, "Should get OK on priming read\n");
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == WAIT, "Should get WAIT on stuck transfer\n");
+
+	idle_clocks(t, 300);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == FAULT, "Timed-out transfer should give FAULT\n");
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK && (data & DP_CTRL_STAT_STICKYERR), "STICKYERR should be set\n");
+
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_STKERRCLR);
+	(void)swd_read(t, AP, AP_REG_DRW, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == rdata_magic + start_addr, "Bad readback after timeout: %08x\n", data);
+
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the Mem-AP's TAR stride and 2-D auto-increment. Read a
+// column of a modelled framebuffer with a single TAR write, walk downwards
+// with a negative stride, then write a rectangular block using row length
+// and row stride, checking every downstream address. Finally check that the
+// default stride of 4 gives normal auto-increment.
+
+static const uint32_t fb_base = 0x20000000u;
+static const uint32_t fb_pitch = 1024u;
+static const uint32_t fb_size = 64 * 1024u;
+static uint32_t fb[fb_size / 4];
+static int reads;
+static int writes;
+
+apb_read_response read_callback(uint32_t addr) {
+	uint32_t idx = (addr - fb_base) / 4;
+	bool err = idx >= fb_size / 4;
+	++reads;
+	return {
+		.rdata = err ? 0 : fb[idx],
+		.delay_cycles = 0,
+		.err = err
+	};
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	uint32_t idx = (addr - fb_base) / 4;
+	bool err = idx >= fb_size / 4;
+	if (!err)
+		fb[idx] = data;
+	++writes;
+	return {
+		.delay_cycles = 0,
+		.err = err
+	};
+}
+
+static void ap_write(tb &t, int reg, uint32_t data) {
+	swd_status_t status = swd_write(t, AP, reg, data);
+	tb_assert(status == OK, "AP write failed\n");
+}
+
+static void set_stride(tb &t, uint32_t stride, uint32_t row_len, uint32_t row_stride) {
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_TAR_STRIDE);
+	ap_write(t, AP_REG_TAR_STRIDE, stride);
+	ap_write(t, AP_REG_TAR_ROW_LEN, row_len);
+	ap_write(t, AP_REG_TAR_ROW_STRIDE, row_stride);
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_DRW);
+}
+
+// Pipelined DRW reads, checked against fb[] at the expected addresses.
+static void check_reads(tb &t, uint32_t start, const uint32_t *expect_addr, int n) {
+	uint32_t data;
+	reads = 0;
+	ap_write(t, AP_REG_TAR, start);
+	(void)swd_read(t, AP, AP_REG_DRW, data);
+	for (int i = 1; i <= n; ++i) {
+		swd_status_t status = i < n ? swd_read(t, AP, AP_REG_DRW, data) : swd_read(t, DP, DP_REG_RDBUF, data);
+		tb_assert(status == OK, "Read %d failed\n", i - 1);
+		uint32_t expect = fb[(expect_addr[i - 1] - fb_base) / 4];
+		tb_assert(data == expect, "Read %d: got %08x, expected %08x (addr %08x)\n",
+			i - 1, data, expect, expect_addr[i - 1]);
+	}
+	tb_assert(reads == n, "Expected %d bus reads, saw %d\n", n, reads);
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+	for (uint32_t i = 0; i < fb_size / 4; ++i)
+		fb[i] = fb_base + 4 * i;
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	uint32_t data;
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_TAR_STRIDE);
+	(void)swd_read(t, AP, AP_REG_TAR_STRIDE, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == 4, "STRIDE should reset to 4: %08x\n", data);
+
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_CSW);
+	ap_write(t, AP_REG_CSW, 0x10u);
+
+	// Column: crosses several 4 kB pages with one TAR write.
+	const int col_n = 16;
+	const uint32_t col_start = fb_base + 0x40;
+	uint32_t addrs[64];
+	for (int i = 0; i < col_n; ++i)
+		addrs[i] = col_start + i * fb_pitch;
+	set_stride(t, fb_pitch, 0, 0);
+	check_reads(t, col_start, addrs, col_n);
+
+	// Negative stride walks downwards.
+	const int down_n = 8;
+	const uint32_t down_start = fb_base + 0x100;
+	for (int i = 0; i < down_n; ++i)
+		addrs[i] = down_start - 8 * i;
+	set_stride(t, (uint32_t)-8, 0, 0);
+	check_reads(t, down_start, addrs, down_n);
+
+	// 2-D: 4 rows of 3 words, one word apart, rows one pitch apart. Written
+	// back-to-back, then read back in 2-D order.
+	const int rows = 4, row_len = 3;
+	const uint32_t blk_start = fb_base + 2 * fb_pitch + 0x20;
+	set_stride(t, 4, row_len, fb_pitch);
+	writes = 0;
+	ap_write(t, AP_REG_TAR, blk_start);
+	for (int i = 0; i < rows * row_len; ++i)
+		ap_write(t, AP_REG_DRW, 0xb10c0000u + i);
+	idle_clocks(t, 8);
+	tb_assert(writes == rows * row_len, "Expected %d bus writes, saw %d\n", rows * row_len, writes);
+	for (int r = 0; r < rows; ++r) {
+		for (int c = 0; c < row_len; ++c) {
+			uint32_t addr = blk_start + r * fb_pitch + 4 * c;
+			uint32_t got = fb[(addr - fb_base) / 4];
+			tb_assert(got == 0xb10c0000u + r * row_len + c, "Bad block word %d,%d: %08x\n", r, c, got);
+			addrs[r * row_len + c] = addr;
+		}
+		// Word just past the end of each row is untouched.
+		uint32_t past = blk_start + r * fb_pitch + 4 * row_len;
+		tb_assert(fb[(past - fb_base) / 4] == past, "Row %d overran\n", r);
+	}
+	check_reads(t, blk_start, addrs, rows * row_len);
+
+	// TAR readback follows the 2-D walk: next is row 1, word 1.
+	ap_write(t, AP_REG_TAR, blk_start);
+	for (int i = 0; i < row_len + 1; ++i)
+		(void)swd_read(t, AP, AP_REG_DRW, data);
+	(void)swd_read(t, AP, AP_REG_TAR, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == blk_start + fb_pitch + 4, "Bad TAR after row end: %08x\n", data);
+
+	// Back to a plain increment.
+	for (int i = 0; i < 8; ++i)
+		addrs[i] = fb_base + 4 * i;
+	set_stride(t, 4, 0, 0);
+	check_reads(t, fb_base, addrs, 8);
+
+	printf("%d-word column, %dx%d block, one TAR write each\n", col_n, rows, row_len);
+	return 0;
+}
@@ -0,0 +1,137 @@
+#include "tb.h"
+#include "apb_trace.h"
+#include <cstdio>
+
+// Test intent: drive the downstream APB port from a captured bus trace.
+// Synthesise a capture with a bursty latency pattern (mostly zero or one wait
+// state, with a long stall every 16th transfer, like a memory with refresh),
+// then:
+//
+// - Replay it exactly, repeating the captured access sequence, and check
+//   that every transfer matches its beat, read data is the captured data,
+//   and that a second replay takes exactly as many SWCLK cycles and WAITs
+// - Replay it statistically, on a longer workload, and check that data
+//   written reads back, and the wait states drawn have roughly the capture's
+//   mean
+//
+// Reports throughput in data bits per SWCLK cycle for each.
+
+static const uint32_t mem_base = 0x20000000u;
+static const int block_words = 64;
+static const char *trace_path = "build/apb_trace_replay.bin";
+
+static apb_trace_responder apb;
+
+apb_read_response read_callback(uint32_t addr) {
+	return apb.apb_read(addr);
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	return apb.apb_write(addr, data);
+}
+
+static uint32_t block_data(uint32_t base, int i) {
+	return base ^ (uint32_t)i * 0x9e3779b9u;
+}
+
+static swd_retry_stats swd_stats;
+
+// Write a block, then read it back with pipelined DRW reads: block_words APB
+// writes followed by block_words APB reads. Returns SWCLK cycles taken.
+static uint64_t write_read_block(tb &t, uint32_t base) {
+	uint64_t start = t.swclk_cycles();
+	swd_status_t status = swd_write_retry(t, AP, AP_REG_TAR, base, &swd_stats);
+	tb_assert(status == OK, "TAR write failed\n");
+	for (int i = 0; i < block_words; ++i) {
+		status = swd_write_retry(t, AP, AP_REG_DRW, block_data(base, i), &swd_stats);
+		tb_assert(status == OK, "DRW write %d failed\n", i);
+	}
+	status = swd_write_retry(t, AP, AP_REG_TAR, base, &swd_stats);
+	tb_assert(status == OK, "TAR write failed\n");
+	uint32_t data;
+	(void)swd_read_retry(t, AP, AP_REG_DRW, data, &swd_stats);
+	for (int i = 0; i < block_words; ++i) {
+		status = i < block_words - 1 ? swd_read_retry(t, AP, AP_REG_DRW, data, &swd_stats) :
+			swd_read_retry(t, DP, DP_REG_RDBUF, data, &swd_stats);
+		tb_assert(status == OK, "Read %d failed\n", i);
+		tb_assert(data == block_data(base, i), "Word %d at %08x: got %08x, expected %08x\n",
+			i, base, data, block_data(base, i));
+	}
+	return t.swclk_cycles() - start;
+}
+
+static std::vector<apb_trace_beat> make_capture() {
+	std::vector<apb_trace_beat> beats;
+	uint32_t r = 0x1234567u;
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < block_words; ++i) {
+			r = r * 1664525u + 1013904223u;
+			apb_trace_beat b;
+			b.addr = mem_base + 4 * i;
+			b.data = block_data(mem_base, i);
+			b.wait_states = beats.size() % 16 == 15 ? 12 : (r >> 16) % 2;
+			b.flags = pass == 0 ? APB_TRACE_WRITE : 0;
+			b.reserved = 0;
+			beats.push_back(b);
+		}
+	}
+	return beats;
+}
+
+int main() {
+	tb t("");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	std::vector<apb_trace_beat> capture = make_capture();
+	tb_assert(apb_trace_write(trace_path, capture), "Can't write %s\n", trace_path);
+	uint64_t capture_waits = 0;
+	for (const apb_trace_beat &b : capture)
+		capture_waits += b.wait_states;
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	(void)swd_write_retry(t, DP, DP_REG_SELECT, AP_BANK_CSW, &swd_stats);
+	// Word accesses with address auto-increment
+	(void)swd_write_retry(t, AP, AP_REG_CSW, 0x12u, &swd_stats);
+
+	// Exact replay, twice
+	tb_assert(apb.open(trace_path, APB_TRACE_EXACT), "Can't open %s\n", trace_path);
+	uint64_t cycles[2];
+	int waits[2];
+	for (int pass = 0; pass < 2; ++pass) {
+		apb.rewind();
+		swd_stats.waits = 0;
+		cycles[pass] = write_read_block(t, mem_base);
+		waits[pass] = swd_stats.waits;
+		tb_assert(apb.mismatches == 0, "Access sequence differs from capture at transfer %llu\n",
+			(unsigned long long)apb.first_mismatch);
+		tb_assert(apb.transfers == capture.size(), "%llu transfers, capture has %zu\n",
+			(unsigned long long)apb.transfers, capture.size());
+		tb_assert(apb.wait_states == capture_waits, "%llu wait states, capture has %llu\n",
+			(unsigned long long)apb.wait_states, (unsigned long long)capture_waits);
+	}
+	tb_assert(cycles[0] == cycles[1] && waits[0] == waits[1],
+		"Exact replay not repeatable: %llu cycles %d WAITs, then %llu cycles %d WAITs\n",
+		(unsigned long long)cycles[0], waits[0], (unsigned long long)cycles[1], waits[1]);
+	printf("Exact:       %llu SWCLK cycles, %d WAITs, %.3f bits/cycle\n", (unsigned long long)cycles[0],
+		waits[0], 2.0 * 32 * block_words / cycles[0]);
+
+	// Statistical replay
+	tb_assert(apb.open(trace_path, APB_TRACE_STATISTICAL, false, 42), "Can't open %s\n", trace_path);
+	const int n_blocks = 16;
+	uint64_t stat_cycles = 0;
+	swd_stats.waits = 0;
+	for (int i = 0; i < n_blocks; ++i)
+		stat_cycles += write_read_block(t, mem_base + 0x1000 * i);
+	double mean = (double)apb.wait_states / apb.transfers;
+	double capture_mean = (apb.capture_mean_read_wait() + apb.capture_mean_write_wait()) / 2;
+	tb_assert(apb.errors == 0, "Capture has no errors, but %llu were drawn\n", (unsigned long long)apb.errors);
+	tb_assert(mean > 0.5 * capture_mean && mean < 1.5 * capture_mean,
+		"Mean wait states %.2f, capture %.2f\n", mean, capture_mean);
+	printf("Statistical: %llu SWCLK cycles, %d WAITs, %.3f bits/cycle, %.2f mean wait states (capture %.2f)\n",
+		(unsigned long long)stat_cycles, swd_stats.waits, 2.0 * 32 * block_words * n_blocks / stat_cycles,
+		mean, capture_mean);
+
+	return 0;
+}
@@ -1,5 +1,6 @@
 #include "tb.h"
 #include <cstdio>
+#include <vector>
 
 // Test intent: Check an APB read error correctly sets STICKYERR, and we can
 // then recover from the error and issue more transfers.
@@ -0,0 +1,60 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: measure how much of the SWD turnaround between a DRW read and
+// the following RDBUFF read is left over for the downstream bus, after the
+// DP, AP and bridge have taken their share. Run with and without
+// SYSCLK_RATIO to compare the SWCLK-clocked and oversampled DPs.
+//
+// We sweep the APB read delay upward until the RDBUFF read gets a WAIT. The
+// largest delay which does not WAIT is printed; a larger number means lower
+// fixed AP latency.
+
+const uint32_t rdata_magic = 0x1234;
+const uint32_t start_addr =  0x5a000000;
+const int max_delay = 64;
+
+static int apb_delay;
+
+apb_read_response read_callback(uint32_t addr) {
+	return {
+		.rdata = rdata_magic + addr,
+		.delay_cycles = apb_delay,
+		.err = false
+	};
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	(void)swd_write(t, AP, AP_REG_CSW, 0);
+	(void)swd_write(t, AP, AP_REG_TAR, start_addr);
+
+	int max_delay_no_wait = -1;
+	uint32_t data;
+	for (apb_delay = 0; apb_delay <= max_delay; ++apb_delay) {
+		status = swd_read(t, AP, AP_REG_DRW, data);
+		tb_assert(status == OK, "Should get OK on priming read\n");
+		status = swd_read(t, DP, DP_REG_RDBUF, data);
+		if (status == WAIT) {
+			// Let the transfer finish, then make sure it completed correctly.
+			idle_clocks(t, max_delay + 16);
+			status = swd_read(t, DP, DP_REG_RDBUF, data);
+			tb_assert(status == OK && data == rdata_magic + start_addr,
+				"Bad readback after WAIT: %08x\n", data);
+			break;
+		}
+		tb_assert(status == OK && data == rdata_magic + start_addr,
+			"Bad readback at delay %d: %08x\n", apb_delay, data);
+		max_delay_no_wait = apb_delay;
+	}
+	tb_assert(max_delay_no_wait >= 0, "Should not WAIT with a zero-wait-state slave\n");
+	tb_assert(max_delay_no_wait < max_delay, "Should WAIT eventually\n");
+
+	printf("Max APB read delay with no WAIT: %d SWCLK cycles\n", max_delay_no_wait);
+	return 0;
+}
@@ -0,0 +1,171 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: stream data in both directions through the mailbox AP at
+// APSEL 2, with the target side modelled by the testbench. Check that data
+// arrives intact and in order, and report the sustained throughput of
+// back-to-back DATA accesses. Then check that a slow target throttles the
+// host with WAIT responses without losing data, and that DAPABORT cancels a
+// held write without pushing it.
+//
+// Run once with the target clock tied to SWCLK, then again with it running
+// independently (and faster, with jitter) through the AP's synchronisers, if
+// this build has them.
+
+static const int n_words = 128;
+static const uint32_t h2t_base = 0x10000000u;
+static const uint32_t t2h_base = 0x20000000u;
+
+// Host->target sink. Consumes one word every sink_period cycles, or never if
+// sink_period is zero.
+static uint64_t sink_period = 1;
+static uint64_t sink_last_cycle;
+static uint32_t h2t_received[n_words];
+static int h2t_count;
+
+bool h2t_callback(uint64_t cycle, uint32_t data) {
+	if (sink_period == 0 || cycle - sink_last_cycle < sink_period || h2t_count >= n_words)
+		return false;
+	sink_last_cycle = cycle;
+	h2t_received[h2t_count++] = data;
+	return true;
+}
+
+// Target->host source. Offers t2h_limit words, as fast as the FIFO takes them.
+static int t2h_count;
+static int t2h_limit;
+
+bool t2h_callback(uint64_t cycle, uint32_t &data) {
+	if (t2h_count >= t2h_limit)
+		return false;
+	data = t2h_base + t2h_count++;
+	return true;
+}
+
+static int wait_count;
+
+static void mbox_write_data(tb &t, uint32_t data) {
+	swd_status_t status;
+	while ((status = swd_write(t, AP, MBOX_AP_REG_DATA, data)) == WAIT)
+		++wait_count;
+	tb_assert(status == OK, "DATA write failed: %d\n", (int)status);
+}
+
+static uint32_t mbox_read(tb &t, ap_dp_t ap_dp, int reg) {
+	uint32_t data;
+	swd_status_t status;
+	while ((status = swd_read(t, ap_dp, reg, data)) == WAIT)
+		++wait_count;
+	tb_assert(status == OK, "Read failed: %d\n", (int)status);
+	return data;
+}
+
+static void reset_sink(uint64_t period) {
+	sink_period = period;
+	sink_last_cycle = 0;
+	h2t_count = 0;
+}
+
+static void check_h2t(int n) {
+	tb_assert(h2t_count == n, "Target received %d words, expected %d\n", h2t_count, n);
+	for (int i = 0; i < n; ++i)
+		tb_assert(h2t_received[i] == h2t_base + i, "Bad h2t word %d: %08x\n", i, h2t_received[i]);
+}
+
+static void run_streams(tb &t, uint32_t h2t_depth) {
+	swd_status_t status;
+
+	// Host->target, target always ready
+	reset_sink(1);
+	wait_count = 0;
+	uint64_t start = t.swclk_cycles();
+	for (int i = 0; i < n_words; ++i)
+		mbox_write_data(t, h2t_base + i);
+	uint64_t h2t_cycles = t.swclk_cycles() - start;
+	// Last word crosses the synchronisers to the target
+	idle_clocks(t, 16);
+	check_h2t(n_words);
+	printf("h2t: %d words in %llu SWCLK cycles, %.3f bytes/SWCLK, %d WAITs\n",
+		n_words, (unsigned long long)h2t_cycles, 4.0 * n_words / h2t_cycles, wait_count);
+	tb_assert(wait_count == 0, "Should not WAIT with a fast target\n");
+
+	// Target->host, target always has data. Reads are pipelined, so the
+	// first DATA read returns nothing useful and RDBUF returns the last word.
+	t2h_count = 0;
+	t2h_limit = n_words;
+	wait_count = 0;
+	start = t.swclk_cycles();
+	(void)mbox_read(t, AP, MBOX_AP_REG_DATA);
+	for (int i = 0; i < n_words; ++i) {
+		uint32_t data = mbox_read(t, i == n_words - 1 ? DP : AP,
+			i == n_words - 1 ? DP_REG_RDBUF : MBOX_AP_REG_DATA);
+		tb_assert(data == t2h_base + i, "Bad t2h word %d: %08x\n", i, data);
+	}
+	uint64_t t2h_cycles = t.swclk_cycles() - start;
+	printf("t2h: %d words in %llu SWCLK cycles, %.3f bytes/SWCLK, %d WAITs\n",
+		n_words, (unsigned long long)t2h_cycles, 4.0 * n_words / t2h_cycles, wait_count);
+	tb_assert(wait_count == 0, "Should not WAIT with a fast target\n");
+
+	// Every access is a 46-cycle SWD packet with no idle cycles. Reads need
+	// one extra packet to drain the pipeline.
+	tb_assert(h2t_cycles <= 46 * n_words, "h2t throughput too low\n");
+	tb_assert(t2h_cycles <= 46 * (n_words + 1), "t2h throughput too low\n");
+
+	// Slow target: host is throttled with WAIT, and no data is lost.
+	const int n_slow = 20;
+	reset_sink(1000);
+	wait_count = 0;
+	for (int i = 0; i < n_slow; ++i)
+		mbox_write_data(t, h2t_base + i);
+	idle_clocks(t, 1000 * (h2t_depth + 2));
+	check_h2t(n_slow);
+	printf("h2t with slow target: %d WAITs for %d words\n", wait_count, n_slow);
+	tb_assert(wait_count > 0, "Slow target should cause WAITs\n");
+
+	// Fill the FIFO with the target stalled, hold one more write, and abort it.
+	reset_sink(0);
+	for (uint32_t i = 0; i < h2t_depth + 1; ++i) {
+		status = swd_write(t, AP, MBOX_AP_REG_DATA, h2t_base + i);
+		tb_assert(status == OK, "Write %u should be accepted\n", i);
+	}
+	status = swd_write(t, AP, MBOX_AP_REG_DATA, 0xdeadbeefu);
+	tb_assert(status == WAIT, "Write to full FIFO should WAIT\n");
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_DAPABORT);
+	(void)mbox_read(t, AP, MBOX_AP_REG_LEVEL);
+	uint32_t level = mbox_read(t, DP, DP_REG_RDBUF);
+	tb_assert((level & 0xffffu) == h2t_depth, "Aborted write was pushed: level %08x\n", level);
+	reset_sink(1);
+	idle_clocks(t, 2 * h2t_depth + 16);
+	check_h2t(h2t_depth);
+}
+
+int main() {
+	tb t("waves.vcd");
+	reset_sink(0);
+	t2h_limit = 0;
+	t.set_mailbox_callbacks(h2t_callback, t2h_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	(void)swd_write(t, DP, DP_REG_SELECT, (MBOX_AP_APSEL << 24) | AP_BANK_IDR);
+	(void)mbox_read(t, AP, AP_REG_IDR);
+	uint32_t idr = mbox_read(t, DP, DP_REG_RDBUF);
+	tb_assert(idr == MBOX_APIDR_EXPECTED, "Bad mailbox AP IDR: %08x\n", idr);
+	(void)swd_write(t, DP, DP_REG_SELECT, MBOX_AP_APSEL << 24);
+	(void)mbox_read(t, AP, MBOX_AP_REG_DEPTH);
+	uint32_t depth = mbox_read(t, DP, DP_REG_RDBUF);
+	const uint32_t h2t_depth = depth & 0xffffu;
+	tb_assert(h2t_depth == 8 && depth >> 16 == 16, "Bad DEPTH: %08x\n", depth);
+
+	run_streams(t, h2t_depth);
+
+	if (t.n_sync_stages() == 0 || !t.set_dst_clock({.ratio_num = 3, .ratio_den = 2, .phase_deg = 45,
+		.jitter_pct = 20, .seed = 4321})) {
+		printf("Target clock can't run independently in this build, skipping second pass\n");
+		return 0;
+	}
+	printf("Independent target clock, %d sync stages\n", t.n_sync_stages());
+	run_streams(t, h2t_depth);
+	return 0;
+}
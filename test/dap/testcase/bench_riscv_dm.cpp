@@ -0,0 +1,288 @@
+#include "tb.h"
+#include "riscv_dm_model.h"
+#include <cstdio>
+
+// Test intent: drive a behavioural RISC-V Debug Module, attached to the
+// Mem-AP's downstream APB port, the way a debugger would, and check the
+// results against the model's backdoor. Report end-to-end costs through the
+// real DP and Mem-AP: halt latency, a full GPR dump with and without
+// abstractauto, memory reads through SBA with sbautoincrement, memory reads
+// through the program buffer, and resume.
+//
+// DMI registers are reached through the Mem-AP's banked data registers,
+// caching TAR and SELECT, so consecutive DMI registers in one 16-byte block
+// cost one SWD access each. Repeated accesses to one DMI register go through
+// DRW with pipelined reads.
+
+static riscv_dm_model dm(riscv_dm_model::default_config());
+static const uint32_t dm_base = riscv_dm_model::default_config().dm_base;
+static const uint32_t mem_base = riscv_dm_model::default_config().mem_base;
+static tb *tbp;
+
+apb_read_response read_callback(uint32_t addr) {
+	return dm.apb_read(tbp->bus_cycles(), addr);
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	return dm.apb_write(tbp->bus_cycles(), addr, data);
+}
+
+// ----------------------------------------------------------------------------
+// Host side
+
+static swd_retry_stats swd_stats;
+static uint32_t cur_select = ~0u;
+static uint32_t cur_tar = ~0u;
+
+static void set_select(tb &t, uint32_t select) {
+	if (select != cur_select) {
+		swd_status_t status = swd_write_retry(t, DP, DP_REG_SELECT, select, &swd_stats);
+		tb_assert(status == OK, "SELECT write failed\n");
+		cur_select = select;
+	}
+}
+
+static void set_tar(tb &t, uint32_t addr) {
+	if (addr != cur_tar) {
+		set_select(t, AP_BANK_TAR);
+		swd_status_t status = swd_write_retry(t, AP, AP_REG_TAR, addr, &swd_stats);
+		tb_assert(status == OK, "TAR write failed\n");
+		cur_tar = addr;
+	}
+}
+
+static void dmi_write(tb &t, uint32_t dmi_addr, uint32_t data) {
+	uint32_t addr = dm_base + 4 * dmi_addr;
+	set_tar(t, addr & ~0xfu);
+	set_select(t, AP_BANK_BDx);
+	swd_status_t status = swd_write_retry(t, AP, (addr >> 2) & 0x3u, data, &swd_stats);
+	tb_assert(status == OK, "DMI write %02x failed\n", dmi_addr);
+}
+
+static uint32_t dmi_read(tb &t, uint32_t dmi_addr) {
+	uint32_t addr = dm_base + 4 * dmi_addr;
+	set_tar(t, addr & ~0xfu);
+	set_select(t, AP_BANK_BDx);
+	uint32_t data;
+	(void)swd_read_retry(t, AP, (addr >> 2) & 0x3u, data, &swd_stats);
+	swd_status_t status = swd_read_retry(t, DP, DP_REG_RDBUF, data, &swd_stats);
+	tb_assert(status == OK, "DMI read %02x failed\n", dmi_addr);
+	return data;
+}
+
+// n pipelined reads of one DMI register, through DRW (no auto-increment).
+static void dmi_read_repeat(tb &t, uint32_t dmi_addr, uint32_t *data, int n) {
+	set_tar(t, dm_base + 4 * dmi_addr);
+	set_select(t, AP_BANK_DRW);
+	uint32_t discard;
+	(void)swd_read_retry(t, AP, AP_REG_DRW, discard, &swd_stats);
+	for (int i = 0; i < n; ++i) {
+		swd_status_t status = i < n - 1 ?
+			swd_read_retry(t, AP, AP_REG_DRW, data[i], &swd_stats) :
+			swd_read_retry(t, DP, DP_REG_RDBUF, data[i], &swd_stats);
+		tb_assert(status == OK, "Repeated DMI read %d failed\n", i);
+	}
+}
+
+static void wait_abstract(tb &t) {
+	for (int i = 0; i < 100; ++i) {
+		uint32_t abstractcs = dmi_read(t, DMI_ABSTRACTCS);
+		if (!(abstractcs & DM_ABSTRACTCS_BUSY)) {
+			tb_assert(!(abstractcs & DM_ABSTRACTCS_CMDERR), "cmderr = %u\n",
+				(abstractcs & DM_ABSTRACTCS_CMDERR) >> DM_ABSTRACTCS_CMDERR_LSB);
+			return;
+		}
+	}
+	tb_assert(false, "Abstract command stuck busy\n");
+}
+
+static const uint32_t dmactive = DM_DMCONTROL_DMACTIVE;
+
+// Start of a measured section
+static uint64_t mark_swclk;
+static int mark_packets;
+static int mark_waits;
+
+static void mark() {
+	mark_swclk = tbp->swclk_cycles();
+	mark_packets = swd_stats.packets;
+	mark_waits = swd_stats.waits;
+}
+
+static uint64_t report(const char *what, int n_bytes) {
+	uint64_t cycles = tbp->swclk_cycles() - mark_swclk;
+	printf("%-28s %6llu SWCLK, %4d SWD packets, %3d WAITs", what,
+		(unsigned long long)cycles, swd_stats.packets - mark_packets, swd_stats.waits - mark_waits);
+	if (n_bytes)
+		printf(", %.3f bytes/SWCLK", (double)n_bytes / cycles);
+	printf("\n");
+	return cycles;
+}
+
+int main() {
+	tb t("waves.vcd");
+	tbp = &t;
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	for (int i = 1; i < 32; ++i)
+		dm.gpr(0, i) = 0x1000u * i + 0xabu;
+	dm.pc(0) = mem_base + 0x124;
+	const int mem_words = 64;
+	for (int i = 0; i < mem_words; ++i)
+		(void)dm.mem_write(mem_base + 4 * i, 4, 0x9e3779b9u * (i + 1));
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	// Activate, check hart 0 is there and running, clear havereset.
+	dmi_write(t, DMI_DMCONTROL, dmactive);
+	tb_assert(dmi_read(t, DMI_DMCONTROL) & dmactive, "dmactive didn't stick\n");
+	uint32_t dmstatus = dmi_read(t, DMI_DMSTATUS);
+	tb_assert((dmstatus & 0xfu) == 2, "Bad DM version: %08x\n", dmstatus);
+	tb_assert(dmstatus & DM_DMSTATUS_ALLRUNNING, "Hart should be running: %08x\n", dmstatus);
+	tb_assert(dmstatus & DM_DMSTATUS_ALLHAVERESET, "Hart should report havereset: %08x\n", dmstatus);
+	dmi_write(t, DMI_DMCONTROL, dmactive | DM_DMCONTROL_ACKHAVERESET);
+	tb_assert(!(dmi_read(t, DMI_DMSTATUS) & DM_DMSTATUS_ALLHAVERESET), "havereset should clear\n");
+
+	// Halt
+	mark();
+	dmi_write(t, DMI_DMCONTROL, dmactive | DM_DMCONTROL_HALTREQ);
+	int polls = 0;
+	do {
+		dmstatus = dmi_read(t, DMI_DMSTATUS);
+		tb_assert(++polls < 100, "Hart didn't halt\n");
+	} while (!(dmstatus & DM_DMSTATUS_ALLHALTED));
+	dmi_write(t, DMI_DMCONTROL, dmactive);
+	report("Halt", 0);
+	tb_assert(dm.halted(t.bus_cycles(), 0), "Model disagrees on halt\n");
+
+	// GPR dump, one command per register.
+	uint32_t regs[32];
+	mark();
+	for (int i = 0; i < 32; ++i) {
+		dmi_write(t, DMI_COMMAND, DM_COMMAND_AARSIZE_32 | DM_COMMAND_TRANSFER | (DM_REGNO_GPR0 + i));
+		wait_abstract(t);
+		regs[i] = dmi_read(t, DMI_DATA0);
+	}
+	report("GPR dump, command per reg", 32 * 4);
+	for (int i = 0; i < 32; ++i)
+		tb_assert(regs[i] == dm.gpr(0, i), "Bad x%d: %08x, expected %08x\n", i, regs[i], dm.gpr(0, i));
+
+	// GPR dump with postincrement and autoexecdata: back-to-back data0 reads.
+	mark();
+	dmi_write(t, DMI_COMMAND, DM_COMMAND_AARSIZE_32 | DM_COMMAND_TRANSFER |
+		DM_COMMAND_POSTINCREMENT | DM_REGNO_GPR0);
+	dmi_write(t, DMI_ABSTRACTAUTO, 0x1u);
+	dmi_read_repeat(t, DMI_DATA0, regs, 31);
+	// Stop before the last read, which would otherwise run off the end of
+	// the GPRs.
+	dmi_write(t, DMI_ABSTRACTAUTO, 0);
+	regs[31] = dmi_read(t, DMI_DATA0);
+	report("GPR dump, abstractauto", 32 * 4);
+	tb_assert(!(dmi_read(t, DMI_ABSTRACTCS) & DM_ABSTRACTCS_CMDERR), "cmderr set after autoexec dump\n");
+	for (int i = 0; i < 32; ++i)
+		tb_assert(regs[i] == dm.gpr(0, i), "Bad autoexec x%d: %08x, expected %08x\n", i, regs[i], dm.gpr(0, i));
+
+	// dpc
+	dmi_write(t, DMI_COMMAND, DM_COMMAND_AARSIZE_32 | DM_COMMAND_TRANSFER | DM_REGNO_DPC);
+	wait_abstract(t);
+	uint32_t dpc = dmi_read(t, DMI_DATA0);
+	tb_assert(dpc == mem_base + 0x124, "Bad dpc: %08x\n", dpc);
+
+	// Memory through SBA: sbreadonaddr starts the first read, sbreadondata
+	// each subsequent one, and sbautoincrement moves the address.
+	uint32_t words[mem_words];
+	mark();
+	dmi_write(t, DMI_SBCS, DM_SBCS_SBREADONADDR | (2u << DM_SBCS_SBACCESS_LSB) |
+		DM_SBCS_SBAUTOINCREMENT | DM_SBCS_SBREADONDATA);
+	dmi_write(t, DMI_SBADDRESS0, mem_base);
+	dmi_read_repeat(t, DMI_SBDATA0, words, mem_words);
+	report("Memory via SBA", mem_words * 4);
+	uint32_t sbcs = dmi_read(t, DMI_SBCS);
+	tb_assert(!(sbcs & (DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR)), "SBA error: %08x\n", sbcs);
+	for (int i = 0; i < mem_words; ++i) {
+		uint32_t expect;
+		(void)dm.mem_read(mem_base + 4 * i, 4, expect);
+		tb_assert(words[i] == expect, "Bad SBA word %d: %08x, expected %08x\n", i, words[i], expect);
+	}
+
+	// SBA write, then check through the backdoor.
+	dmi_write(t, DMI_SBCS, (2u << DM_SBCS_SBACCESS_LSB) | DM_SBCS_SBAUTOINCREMENT);
+	dmi_write(t, DMI_SBADDRESS0, mem_base + 0x100);
+	for (int i = 0; i < 4; ++i)
+		dmi_write(t, DMI_SBDATA0, 0x5ba00000u + i);
+	for (int i = 0; i < 4; ++i) {
+		uint32_t got;
+		(void)dm.mem_read(mem_base + 0x100 + 4 * i, 4, got);
+		tb_assert(got == 0x5ba00000u + i, "Bad SBA write %d: %08x\n", i, got);
+	}
+
+	// Memory through the program buffer: lw s1, 0(s0); addi s0, s0, 4.
+	// Write s0 and run the progbuf, then read s1 with postexec, with data0
+	// autoexec so that each data0 read returns one word and fetches the next.
+	dmi_write(t, DMI_PROGBUF0 + 0, 0x00042483u);
+	dmi_write(t, DMI_PROGBUF0 + 1, 0x00440413u);
+	mark();
+	dmi_write(t, DMI_DATA0, mem_base);
+	dmi_write(t, DMI_COMMAND, DM_COMMAND_AARSIZE_32 | DM_COMMAND_TRANSFER | DM_COMMAND_WRITE |
+		DM_COMMAND_POSTEXEC | (DM_REGNO_GPR0 + 8));
+	wait_abstract(t);
+	dmi_write(t, DMI_COMMAND, DM_COMMAND_AARSIZE_32 | DM_COMMAND_TRANSFER | DM_COMMAND_POSTEXEC |
+		(DM_REGNO_GPR0 + 9));
+	dmi_write(t, DMI_ABSTRACTAUTO, 0x1u);
+	const int pb_words = 16;
+	dmi_read_repeat(t, DMI_DATA0, words, pb_words);
+	dmi_write(t, DMI_ABSTRACTAUTO, 0);
+	report("Memory via progbuf", pb_words * 4);
+	tb_assert(!(dmi_read(t, DMI_ABSTRACTCS) & DM_ABSTRACTCS_CMDERR), "cmderr set after progbuf reads\n");
+	for (int i = 0; i < pb_words; ++i) {
+		uint32_t expect;
+		(void)dm.mem_read(mem_base + 4 * i, 4, expect);
+		tb_assert(words[i] == expect, "Bad progbuf word %d: %08x, expected %08x\n", i, words[i], expect);
+	}
+
+	// Same memory straight through the Mem-AP, for comparison.
+	mark();
+	set_select(t, AP_BANK_CSW);
+	(void)swd_write_retry(t, AP, AP_REG_CSW, 0x12u, &swd_stats);
+	set_tar(t, mem_base);
+	set_select(t, AP_BANK_DRW);
+	(void)swd_read_retry(t, AP, AP_REG_DRW, words[0], &swd_stats);
+	for (int i = 0; i < mem_words; ++i)
+		(void)swd_read_retry(t, i < mem_words - 1 ? AP : DP, i < mem_words - 1 ? AP_REG_DRW : DP_REG_RDBUF, words[i],
+			&swd_stats);
+	report("Memory via Mem-AP DRW", mem_words * 4);
+	(void)swd_write_retry(t, AP, AP_REG_CSW, 0x02u, &swd_stats);
+	cur_tar = ~0u;
+	for (int i = 0; i < mem_words; ++i) {
+		uint32_t expect;
+		(void)dm.mem_read(mem_base + 4 * i, 4, expect);
+		tb_assert(words[i] == expect, "Bad DRW word %d: %08x, expected %08x\n", i, words[i], expect);
+	}
+
+	// Abstract command on a running hart (hart 1) fails with cmderr = 4.
+	dmi_write(t, DMI_DMCONTROL, dmactive | (1u << DM_DMCONTROL_HARTSEL_LSB));
+	dmi_write(t, DMI_COMMAND, DM_COMMAND_AARSIZE_32 | DM_COMMAND_TRANSFER | DM_REGNO_GPR0);
+	uint32_t abstractcs = dmi_read(t, DMI_ABSTRACTCS);
+	tb_assert((abstractcs & DM_ABSTRACTCS_CMDERR) >> DM_ABSTRACTCS_CMDERR_LSB == 4,
+		"Expected cmderr = 4 on running hart: %08x\n", abstractcs);
+	dmi_write(t, DMI_ABSTRACTCS, DM_ABSTRACTCS_CMDERR);
+	dmi_write(t, DMI_DMCONTROL, dmactive);
+
+	// Resume
+	mark();
+	dmi_write(t, DMI_DMCONTROL, dmactive | DM_DMCONTROL_RESUMEREQ);
+	polls = 0;
+	do {
+		dmstatus = dmi_read(t, DMI_DMSTATUS);
+		tb_assert(++polls < 100, "Hart didn't resume\n");
+	} while (!(dmstatus & DM_DMSTATUS_ALLRESUMEACK));
+	dmi_write(t, DMI_DMCONTROL, dmactive);
+	report("Resume", 0);
+	tb_assert(dmstatus & DM_DMSTATUS_ALLRUNNING, "Hart should be running: %08x\n", dmstatus);
+
+	printf("%d abstract commands, %d progbuf instructions, %d SBA accesses\n",
+		dm.abstract_commands, dm.progbuf_insns, dm.sba_accesses);
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "tb.h"
+#include "coresight_discovery.h"
+#include "rom_tree_model.h"
+#include <cstdio>
+
+// Test intent: benchmark CoreSight topology discovery time against the depth
+// of the ROM table hierarchy, using the modelled tree in rom_tree_model.h.
+// For each depth, compare:
+//
+// - Cold discovery, writing TAR before every word
+// - Cold discovery with block reads
+// - Reconnect with a warm cache, which only reads the top-level table
+//
+// rom_discovery checks the discovered topology and the cache.
+
+static rom_tree_model model;
+
+apb_read_response read_callback(uint32_t addr) {
+	return model.read(addr);
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	return {.delay_cycles = 0, .err = true};
+}
+
+static uint64_t discover(tb &t, bool block_reads, cs_topology_cache *cache,
+		cs_topology &topo, cs_walk_stats &stats) {
+	cs_walk_options opt = CS_WALK_DEFAULT_OPTIONS;
+	opt.block_reads = block_reads;
+	uint64_t start = t.swclk_cycles();
+	swd_status_t status = cs_discover(t, opt, cache, topo, stats);
+	tb_assert(status == OK, "Discovery failed: %d\n", (int)status);
+	return t.swclk_cycles() - start;
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	const int fanout = 4;
+	const int max_tree_depth = 3;
+	printf("fanout %d\n", fanout);
+	printf("depth comps | per-word: SWCLK  pkts | block: SWCLK  pkts | cached: SWCLK  pkts | speedup\n");
+
+	for (int depth = 0; depth <= max_tree_depth; ++depth) {
+		model.build(depth, fanout);
+		cs_topology topo;
+		cs_walk_stats word_stats, block_stats, cached_stats;
+
+		uint64_t word_cycles = discover(t, false, nullptr, topo, word_stats);
+		// The RTL top-level table is the same for every model, so start
+		// from an empty cache each time.
+		cs_topology_cache cache;
+		uint64_t block_cycles = discover(t, true, &cache, topo, block_stats);
+		status = swd_prepare_dp_for_ap_access(t);
+		tb_assert(status == OK, "Failed to reconnect\n");
+		uint64_t cached_cycles = discover(t, true, &cache, topo, cached_stats);
+
+		printf("%5d %5d | %15llu %5d | %12llu %5d | %13llu %5d | %.1fx\n",
+			depth + 1, (int)topo.components.size(),
+			(unsigned long long)word_cycles, word_stats.swd_reads + word_stats.swd_writes,
+			(unsigned long long)block_cycles, block_stats.swd_reads + block_stats.swd_writes,
+			(unsigned long long)cached_cycles, cached_stats.swd_reads + cached_stats.swd_writes,
+			(double)word_cycles / cached_cycles);
+	}
+
+	return 0;
+}
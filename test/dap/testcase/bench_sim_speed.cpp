@@ -0,0 +1,101 @@
+#include "tb.h"
+#include <chrono>
+#include <cstdio>
+
+// Test intent: measure simulator throughput, so the CXXRTL and Verilator
+// backends can be compared on the same workload. Build and run this once per
+// backend:
+//
+//   make SIM=cxxrtl run.bench_sim_speed
+//   make clean; make SIM=verilator run.bench_sim_speed
+//
+// The workload is a seeded random mix of Mem-AP block writes and pipelined
+// block reads of random lengths and addresses, through a zero-wait-state
+// memory, with waves off. The data read back is checked, so a broken backend
+// can't look fast. Reports simulated SWCLK cycles per second of host time.
+
+static const uint32_t mem_base = 0x20000000u;
+static const int mem_words = 1024;
+static uint32_t mem[mem_words];
+
+apb_read_response read_callback(uint32_t addr) {
+	uint32_t idx = (addr - mem_base) / 4;
+	bool err = idx >= mem_words;
+	return {
+		.rdata = err ? 0 : mem[idx],
+		.delay_cycles = 0,
+		.err = err
+	};
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	uint32_t idx = (addr - mem_base) / 4;
+	bool err = idx >= mem_words;
+	if (!err)
+		mem[idx] = data;
+	return {
+		.delay_cycles = 0,
+		.err = err
+	};
+}
+
+static uint32_t rand_state = 0x5eed1234u;
+
+static uint32_t rand_next() {
+	rand_state = rand_state * 1664525u + 1013904223u;
+	return rand_state;
+}
+
+int main() {
+	tb t("");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	status = swd_write_retry(t, DP, DP_REG_SELECT, AP_BANK_CSW);
+	tb_assert(status == OK, "SELECT write failed\n");
+	// Word accesses with address auto-increment
+	status = swd_write_retry(t, AP, AP_REG_CSW, 0x12u);
+	tb_assert(status == OK, "CSW write failed\n");
+
+	const int n_blocks = 200;
+	const int max_block_words = 32;
+	uint64_t words = 0;
+	uint64_t start_cycles = t.swclk_cycles();
+	auto start_time = std::chrono::steady_clock::now();
+
+	for (int b = 0; b < n_blocks; ++b) {
+		int n = 1 + rand_next() % max_block_words;
+		// Stay inside one 1 kB auto-increment range
+		uint32_t idx = rand_next() % (mem_words / 256) * 256 + rand_next() % (257 - n);
+		uint32_t addr = mem_base + 4 * idx;
+		status = swd_write_retry(t, AP, AP_REG_TAR, addr);
+		tb_assert(status == OK, "TAR write failed\n");
+		uint32_t seed = rand_next();
+		for (int i = 0; i < n; ++i) {
+			status = swd_write_retry(t, AP, AP_REG_DRW, seed ^ (uint32_t)i * 0x9e3779b9u);
+			tb_assert(status == OK, "DRW write failed\n");
+		}
+
+		status = swd_write_retry(t, AP, AP_REG_TAR, addr);
+		tb_assert(status == OK, "TAR write failed\n");
+		uint32_t data;
+		(void)swd_read_retry(t, AP, AP_REG_DRW, data);
+		for (int i = 0; i < n; ++i) {
+			status = i < n - 1 ? swd_read_retry(t, AP, AP_REG_DRW, data) : swd_read_retry(t, DP, DP_REG_RDBUF, data);
+			tb_assert(status == OK, "Read failed\n");
+			uint32_t expect = seed ^ (uint32_t)i * 0x9e3779b9u;
+			tb_assert(data == expect, "Block %d word %d: got %08x, expected %08x\n", b, i, data, expect);
+		}
+		words += 2 * n;
+	}
+
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	uint64_t cycles = t.swclk_cycles() - start_cycles;
+	printf("backend %s: %llu SWCLK cycles, %llu words in %.3f s\n", t.backend(),
+		(unsigned long long)cycles, (unsigned long long)words, secs);
+	printf("%.1f kcycles/s, %.1f kwords/s\n", cycles / secs / 1e3, words / secs / 1e3);
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: a fixed set of throughput workloads for comparing builds of
+// the DAP with different RTL parameters (see ../sweep.py). For each clk_dst
+// setting and APB wait state count:
+//
+// - Block write: 8 KiB of DRW writes, rewriting TAR at each boundary of the
+//   Mem-AP's auto-increment range
+// - Block read: the same 8 KiB with pipelined DRW reads, checked against
+//   what was written
+// - Single read: TAR write, DRW read and RDBUF read per word
+//
+// Each prints one tab-separated line starting "sweep", with the bytes moved,
+// SWCLK cycles, WAITs and SWD packets (including WAITs), for sweep.py to
+// collect. Independent clk_dst settings are skipped in builds with no bridge
+// synchronisers, where they aren't safe, and in SYSCLK builds.
+
+static const uint32_t mem_base = 0x20000000u;
+static const int mem_words = 2048;
+static const int single_words = 64;
+static uint32_t mem[mem_words];
+static int wait_states;
+
+apb_read_response read_callback(uint32_t addr) {
+	uint32_t idx = (addr - mem_base) / 4;
+	bool err = idx >= mem_words;
+	return {
+		.rdata = err ? 0 : mem[idx],
+		.delay_cycles = wait_states,
+		.err = err
+	};
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	uint32_t idx = (addr - mem_base) / 4;
+	bool err = idx >= mem_words;
+	if (!err)
+		mem[idx] = data;
+	return {
+		.delay_cycles = wait_states,
+		.err = err
+	};
+}
+
+static swd_retry_stats stats;
+
+static uint32_t block_data(uint32_t seed, int i) {
+	return seed ^ (uint32_t)i * 0x9e3779b9u;
+}
+
+static void block_write(tb &t, uint32_t seed) {
+	const uint32_t incr_mask = (1u << t.tar_increment_bits()) - 1;
+	swd_status_t status;
+	for (int i = 0; i < mem_words; ++i) {
+		uint32_t addr = mem_base + 4 * i;
+		if (i == 0 || (addr & incr_mask) == 0) {
+			status = swd_write_retry(t, AP, AP_REG_TAR, addr, &stats);
+			tb_assert(status == OK, "TAR write failed\n");
+		}
+		status = swd_write_retry(t, AP, AP_REG_DRW, block_data(seed, i), &stats);
+		tb_assert(status == OK, "DRW write %d failed\n", i);
+	}
+	// Writes are posted; a DP read flushes the last one before we time it.
+	uint32_t data;
+	status = swd_read_retry(t, DP, DP_REG_RDBUF, data, &stats);
+	tb_assert(status == OK, "RDBUF read failed\n");
+}
+
+static void block_read(tb &t, uint32_t seed) {
+	const uint32_t incr_mask = (1u << t.tar_increment_bits()) - 1;
+	swd_status_t status;
+	uint32_t data;
+	// Each DRW read returns the previous one's data, so finish each
+	// auto-increment segment with an RDBUF read before moving TAR.
+	for (int i = 0; i < mem_words; ++i) {
+		uint32_t addr = mem_base + 4 * i;
+		if (i == 0 || (addr & incr_mask) == 0) {
+			status = swd_write_retry(t, AP, AP_REG_TAR, addr, &stats);
+			tb_assert(status == OK, "TAR write failed\n");
+			(void)swd_read_retry(t, AP, AP_REG_DRW, data, &stats);
+		}
+		bool last_in_segment = i == mem_words - 1 || ((addr + 4) & incr_mask) == 0;
+		status = last_in_segment ? swd_read_retry(t, DP, DP_REG_RDBUF, data, &stats) :
+			swd_read_retry(t, AP, AP_REG_DRW, data, &stats);
+		tb_assert(status == OK, "Read %d failed\n", i);
+		tb_assert(data == block_data(seed, i), "Word %d: got %08x, expected %08x\n", i, data, block_data(seed, i));
+	}
+}
+
+static void single_read(tb &t, uint32_t seed) {
+	swd_status_t status;
+	uint32_t data;
+	for (int i = 0; i < single_words; ++i) {
+		// Scattered through the block
+		int idx = (i * 37) % mem_words;
+		status = swd_write_retry(t, AP, AP_REG_TAR, mem_base + 4 * idx, &stats);
+		tb_assert(status == OK, "TAR write failed\n");
+		(void)swd_read_retry(t, AP, AP_REG_DRW, data, &stats);
+		status = swd_read_retry(t, DP, DP_REG_RDBUF, data, &stats);
+		tb_assert(status == OK, "Read %d failed\n", i);
+		tb_assert(data == block_data(seed, idx), "Word %d: got %08x, expected %08x\n", idx, data,
+			block_data(seed, idx));
+	}
+}
+
+struct clock_point {
+	const char *name;
+	bool tied;
+	dst_clock_config clk;
+};
+
+static void report(tb &t, const char *workload, const char *clock, int bytes, uint64_t start) {
+	printf("sweep\t%s\t%s\t%d\t%d\t%llu\t%d\t%d\n", workload, clock, wait_states, bytes,
+		(unsigned long long)(t.swclk_cycles() - start), stats.waits, stats.packets);
+}
+
+int main() {
+	tb t("");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	const clock_point clocks[] = {
+		{"tied", true,  {1, 1, 0, 0, 0}},
+		{"1:2",  false, {1, 2, 0, 0, 0}},
+		{"4:1",  false, {4, 1, 0, 0, 0}},
+	};
+	const int wait_state_counts[] = {0, 2};
+
+	bool independent = t.set_dst_clock(clocks[0].clk) && t.n_sync_stages() > 0;
+	t.set_dst_clock_tied();
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	(void)swd_write_retry(t, DP, DP_REG_SELECT, AP_BANK_CSW, &stats);
+	// Word accesses with address auto-increment
+	(void)swd_write_retry(t, AP, AP_REG_CSW, 0x12u, &stats);
+
+	printf("%d sync stages, %d TAR increment bits\n", t.n_sync_stages(), t.tar_increment_bits());
+	uint32_t seed = 0x5eed0000u;
+	for (const clock_point &c : clocks) {
+		if (!c.tied && !independent)
+			continue;
+		if (c.tied)
+			t.set_dst_clock_tied();
+		else
+			tb_assert(t.set_dst_clock(c.clk), "Failed to set clk_dst\n");
+		for (int ws : wait_state_counts) {
+			wait_states = ws;
+			++seed;
+			// Let the bridge settle after changing clocks or wait states
+			idle_clocks(t, 64);
+
+			stats = {0, 0};
+			uint64_t start = t.swclk_cycles();
+			block_write(t, seed);
+			report(t, "block_write", c.name, 4 * mem_words, start);
+
+			stats = {0, 0};
+			start = t.swclk_cycles();
+			block_read(t, seed);
+			report(t, "block_read", c.name, 4 * mem_words, start);
+
+			stats = {0, 0};
+			start = t.swclk_cycles();
+			single_read(t, seed);
+			report(t, "single_read", c.name, 4 * single_words, start);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+#include "tb.h"
+#include "dap_model.h"
+#include <cstdio>
+#include <cstdlib>
+
+// Test intent: validate the analytical throughput model in test/dap_model
+// against the RTL. For a set of clk_dst ratios, phases and APB wait states,
+// run each of the model's workloads (single, block and ORUNDETECT streaming,
+// reads and writes) on the DAP, packet for packet as the model sees them, and
+// compare the SWCLK cycles, WAITs and overrun it predicts with those
+// measured. With clk_dst tied to SWCLK the model should be cycle exact; with
+// an independent clk_dst, cycles must be within max_error.
+//
+// Needs the SWCLK-clocked build: with SYSCLK_RATIO, clk_dst is the system
+// clock, and this test does nothing.
+
+static const uint32_t mem_base = 0x20000000u;
+static const int mem_words = 64;
+static uint32_t mem[mem_words];
+static int wait_states;
+
+static const double max_error = 0.02;
+
+apb_read_response read_callback(uint32_t addr) {
+	uint32_t idx = (addr - mem_base) / 4;
+	bool err = idx >= mem_words;
+	return {
+		.rdata = err ? 0 : mem[idx],
+		.delay_cycles = wait_states,
+		.err = err
+	};
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	uint32_t idx = (addr - mem_base) / 4;
+	bool err = idx >= mem_words;
+	if (!err)
+		mem[idx] = data;
+	return {
+		.delay_cycles = wait_states,
+		.err = err
+	};
+}
+
+struct model_point {
+	const char *name;
+	bool tied;
+	dst_clock_config clk;
+	int wait_states;
+};
+
+static const struct {
+	dap_pattern pattern;
+	bool write;
+	int n_words;
+	const char *name;
+} workloads[] = {
+	{DAP_PATTERN_SINGLE, false, 8,  "single read"},
+	{DAP_PATTERN_SINGLE, true,  8,  "single write"},
+	{DAP_PATTERN_BLOCK,  false, 32, "block read"},
+	{DAP_PATTERN_BLOCK,  true,  32, "block write"},
+	{DAP_PATTERN_ORUN,   false, 32, "orun read"},
+	{DAP_PATTERN_ORUN,   true,  32, "orun write"},
+};
+
+struct measured {
+	uint64_t cycles;
+	int waits;
+	bool overrun;
+};
+
+static void write_ctrl_stat(tb &t, uint32_t extra) {
+	swd_status_t status;
+	do {
+		status = swd_write(t, DP, DP_REG_CTRL_STAT, DP_CTRL_STAT_CSYSPWRUPREQ | DP_CTRL_STAT_CDBGPWRUPREQ | extra);
+	} while (status == WAIT);
+	tb_assert(status == OK, "CTRL/STAT write failed\n");
+}
+
+// Send the workload's packets as the model sends them: retry on WAIT, except
+// for ORUNDETECT packets, which go out once whatever the ACK.
+static measured run_workload(tb &t, const dap_workload &w, uint32_t pattern) {
+	measured m = {0, 0, false};
+	bool orun = false;
+	for (const dap_packet &p : w.packets)
+		orun = orun || p.orun;
+	if (orun)
+		write_ctrl_stat(t, DP_CTRL_STAT_ORUNDETECT);
+
+	uint64_t start = t.swclk_cycles();
+	int word = 0;
+	for (const dap_packet &p : w.packets) {
+		ap_dp_t ap_ndp = p.ap ? AP : DP;
+		uint32_t data = 0;
+		if (p.ap && p.addr == AP_REG_TAR)
+			data = mem_base + 4 * word;
+		else if (p.bus)
+			data = pattern ^ (uint32_t)word++;
+		swd_status_t status;
+		do {
+			if (p.read)
+				status = p.orun ? swd_read_orun(t, ap_ndp, p.addr, data) : swd_read(t, ap_ndp, p.addr, data);
+			else
+				status = p.orun ? swd_write_orun(t, ap_ndp, p.addr, data) : swd_write(t, ap_ndp, p.addr, data);
+			m.waits += status == WAIT;
+		} while (status == WAIT && !p.orun);
+		tb_assert(status == OK || p.orun, "Packet failed with ACK %d\n", status);
+	}
+	m.cycles = t.swclk_cycles() - start;
+
+	uint32_t ctrl_stat;
+	swd_status_t status = swd_read(t, DP, DP_REG_CTRL_STAT, ctrl_stat);
+	tb_assert(status == OK, "CTRL/STAT read failed\n");
+	tb_assert(!(ctrl_stat & DP_CTRL_STAT_STICKYERR), "Unexpected STICKYERR\n");
+	m.overrun = ctrl_stat & DP_CTRL_STAT_STICKYORUN;
+	if (m.overrun) {
+		status = swd_write(t, DP, DP_REG_ABORT, DP_ABORT_ORUNERRCLR);
+		tb_assert(status == OK, "ABORT write failed\n");
+	}
+	if (orun) {
+		// Not retried with ORUNDETECT set, so wait out the last write first
+		idle_clocks(t, 128);
+		write_ctrl_stat(t, 0);
+	}
+	return m;
+}
+
+int main() {
+	tb t("");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	const model_point points[] = {
+		{"tied",      true,  {1, 1, 0,  0, 0}, 0},
+		{"tied 1ws",  true,  {1, 1, 0,  0, 0}, 1},
+		{"tied 4ws",  true,  {1, 1, 0,  0, 0}, 4},
+		{"1:4",       false, {1, 4, 0,  0, 0}, 0},
+		{"1:2",       false, {1, 2, 0,  0, 0}, 0},
+		{"1:1 90deg", false, {1, 1, 90, 0, 0}, 0},
+		{"3:2 1ws",   false, {3, 2, 0,  0, 0}, 1},
+		{"4:1 2ws",   false, {4, 1, 0,  0, 0}, 2},
+	};
+	const int n_points = sizeof(points) / sizeof(points[0]);
+
+	if (!t.set_dst_clock(points[0].clk)) {
+		printf("clk_dst is tied to the system clock in this build, nothing to model\n");
+		return 0;
+	}
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	status = swd_write(t, DP, DP_REG_SELECT, AP_BANK_CSW);
+	tb_assert(status == OK, "SELECT write failed\n");
+	// Word accesses with address auto-increment
+	status = swd_write(t, AP, AP_REG_CSW, 0x12u);
+	tb_assert(status == OK, "CSW write failed\n");
+
+	dap_model_config cfg = dap_model_default_config();
+	cfg.n_sync_stages = t.n_sync_stages();
+	printf("%d sync stages\n", cfg.n_sync_stages);
+	printf("%-10s %-13s | %8s %8s | %6s %6s | %s\n", "clk_dst", "workload", "cycles", "model",
+		"WAITs", "model", "overrun");
+	double worst_error = 0;
+	for (int i = 0; i < n_points; ++i) {
+		const model_point &pt = points[i];
+		uint64_t clk_set_cycle = 0;
+		if (pt.tied) {
+			t.set_dst_clock_tied();
+		} else {
+			tb_assert(t.set_dst_clock(pt.clk), "Failed to set clk_dst\n");
+			clk_set_cycle = t.swclk_cycles();
+		}
+		wait_states = pt.wait_states;
+		cfg.read_wait_states = pt.wait_states;
+		cfg.write_wait_states = pt.wait_states;
+		cfg.dst_ratio = (double)pt.clk.ratio_num / pt.clk.ratio_den;
+
+		for (const auto &wl : workloads) {
+			// Let any transfer in flight finish, so the model starts from idle
+			idle_clocks(t, 128);
+			// set_dst_clock() puts the first clk_dst rising edge phase_deg
+			// after the start of the next step, which is half a SWCLK period
+			// before a rising edge. The workload starts half a period before
+			// the edge its first bit is sampled on.
+			if (pt.tied) {
+				cfg.dst_phase = 0;
+			} else {
+				double td = 1.0 / cfg.dst_ratio;
+				cfg.dst_phase = (double)clk_set_cycle - (double)t.swclk_cycles() - 0.5 + td * pt.clk.phase_deg / 360;
+			}
+
+			dap_workload w = dap_make_workload(wl.pattern, wl.write, wl.n_words);
+			dap_model_result predicted = dap_model_run(cfg, w);
+			measured m = run_workload(t, w, 0x3e000000u + ((uint32_t)i << 16));
+
+			printf("%-10s %-13s | %8llu %8llu | %6d %6llu | %s%s\n", pt.name, wl.name,
+				(unsigned long long)m.cycles, (unsigned long long)predicted.swclk_cycles, m.waits,
+				(unsigned long long)predicted.waits, m.overrun ? "yes" : "no",
+				m.overrun == predicted.overrun ? "" : " (model disagrees)");
+
+			tb_assert(m.overrun == predicted.overrun, "%s %s: overrun %d, model predicts %d\n",
+				pt.name, wl.name, m.overrun, predicted.overrun);
+			double error = (double)llabs((long long)m.cycles - (long long)predicted.swclk_cycles) / m.cycles;
+			if (error > worst_error)
+				worst_error = error;
+			if (pt.tied) {
+				tb_assert(error == 0 && (uint64_t)m.waits == predicted.waits,
+					"%s %s: %llu cycles %d WAITs, model predicts %llu cycles %llu WAITs\n", pt.name, wl.name,
+					(unsigned long long)m.cycles, m.waits, (unsigned long long)predicted.swclk_cycles,
+					(unsigned long long)predicted.waits);
+			} else {
+				tb_assert(error <= max_error, "%s %s: %llu cycles, model predicts %llu\n", pt.name, wl.name,
+					(unsigned long long)m.cycles, (unsigned long long)predicted.swclk_cycles);
+			}
+		}
+	}
+	printf("Worst cycle count error %.2f%%\n", 100 * worst_error);
+
+	return 0;
+}
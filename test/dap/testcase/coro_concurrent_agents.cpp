@@ -0,0 +1,192 @@
+#include "tb.h"
+#include "tb_coro.h"
+#include <cstdio>
+
+// Test intent: run the host, the APB target and a bus monitor as concurrent
+// agents on the coroutine scheduler, with target firmware updating memory
+// whilst the host accesses it:
+//
+// - Responder: APB memory with random 0 to 3 wait states per transfer,
+//   driving the downstream port directly rather than through callbacks
+// - Monitor: checks that each setup phase is followed by an access phase with
+//   the same address and control, held stable through wait states
+// - Firmware: bumps a heartbeat word in memory every so many clk_dst cycles
+// - Host: writes and reads back a block with WAIT retries, then polls the
+//   heartbeat until it has seen it advance
+//
+// clk_dst runs at half the SWCLK frequency, so that agents, which run once
+// per step, see every clk_dst edge. Needs the SWCLK-clocked build: with
+// SYSCLK_RATIO, clk_dst is the system clock, and this test does nothing.
+
+static const uint32_t mem_base = 0x20000000u;
+static const int mem_words = 64;
+static const int heartbeat_idx = mem_words - 1;
+static const int heartbeat_period = 500;
+static uint32_t mem[mem_words];
+
+static uint32_t rand_state = 0xc0ffee11u;
+
+static uint32_t rand_next() {
+	rand_state = rand_state * 1664525u + 1013904223u;
+	return rand_state >> 8;
+}
+
+// co_await this for the next clk_dst rising edge. A plain awaiter rather
+// than a task, as the agents wait on it every cycle.
+static auto dst_posedge(tb_sched &s) {
+	tb *t = &s.target();
+	uint64_t c = t->dst_cycles();
+	return s.until([t, c] {return t->dst_cycles() != c;});
+}
+
+static int apb_transfers;
+static int apb_wait_states;
+
+static tb_task<> apb_responder(tb_sched &s) {
+	tb &t = s.target();
+	int wait_left = 0;
+	bool responded = true;
+	uint32_t rdata = 0;
+	bool err = false;
+	t.set_apb_response(false, 0, false);
+	for (;;) {
+		co_await dst_posedge(s);
+		apb_request r = t.get_apb_request();
+		if (r.psel && !r.penable) {
+			// Setup phase: do the access now, respond in the access phase
+			++apb_transfers;
+			uint32_t idx = (r.paddr - mem_base) / 4;
+			err = idx >= mem_words;
+			rdata = 0;
+			if (!err && r.pwrite)
+				mem[idx] = r.pwdata;
+			else if (!err)
+				rdata = mem[idx];
+			wait_left = rand_next() % 4;
+			apb_wait_states += wait_left;
+			responded = false;
+			t.set_apb_response(false, 0, false);
+		} else if (r.psel && r.penable && !responded) {
+			if (wait_left-- == 0) {
+				t.set_apb_response(true, rdata, err);
+				responded = true;
+			}
+		}
+	}
+}
+
+static tb_task<> apb_monitor(tb_sched &s) {
+	tb &t = s.target();
+	apb_request prev = {};
+	for (;;) {
+		co_await dst_posedge(s);
+		apb_request r = t.get_apb_request();
+		bool prev_setup = prev.psel && !prev.penable;
+		bool prev_access = prev.psel && prev.penable;
+		bool access = r.psel && r.penable;
+		tb_assert(!prev_setup || access, "APB setup phase not followed by access phase\n");
+		if ((prev_setup || prev_access) && access) {
+			tb_assert(r.paddr == prev.paddr && r.pwrite == prev.pwrite && (!r.pwrite || r.pwdata == prev.pwdata),
+				"APB signals changed during transfer: %08x -> %08x\n", prev.paddr, r.paddr);
+		}
+		prev = r;
+	}
+}
+
+static tb_task<> firmware(tb_sched &s) {
+	for (;;) {
+		for (int i = 0; i < heartbeat_period; ++i)
+			co_await dst_posedge(s);
+		++mem[heartbeat_idx];
+	}
+}
+
+static int host_waits;
+
+static tb_task<swd_status_t> retry_write(tb_sched &s, ap_dp_t ap_ndp, uint8_t addr, uint32_t data) {
+	swd_status_t status;
+	while ((status = co_await co_swd_write(s, ap_ndp, addr, data)) == WAIT)
+		++host_waits;
+	co_return status;
+}
+
+static tb_task<swd_status_t> retry_read(tb_sched &s, ap_dp_t ap_ndp, uint8_t addr, uint32_t &data) {
+	swd_status_t status;
+	while ((status = co_await co_swd_read(s, ap_ndp, addr, data)) == WAIT)
+		++host_waits;
+	co_return status;
+}
+
+static tb_task<uint32_t> read_word(tb_sched &s, uint32_t addr) {
+	uint32_t data;
+	swd_status_t status = co_await retry_write(s, AP, AP_REG_TAR, addr);
+	tb_assert(status == OK, "TAR write failed\n");
+	(void)co_await retry_read(s, AP, AP_REG_DRW, data);
+	status = co_await retry_read(s, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK, "Read of %08x failed\n", addr);
+	co_return data;
+}
+
+static tb_task<> host(tb_sched &s) {
+	swd_status_t status = co_await retry_write(s, DP, DP_REG_SELECT, AP_BANK_CSW);
+	tb_assert(status == OK, "SELECT write failed\n");
+	// Word accesses with address auto-increment
+	status = co_await retry_write(s, AP, AP_REG_CSW, 0x12u);
+	tb_assert(status == OK, "CSW write failed\n");
+
+	const int n = 32;
+	status = co_await retry_write(s, AP, AP_REG_TAR, mem_base);
+	tb_assert(status == OK, "TAR write failed\n");
+	for (int i = 0; i < n; ++i) {
+		status = co_await retry_write(s, AP, AP_REG_DRW, 0x5a000000u + i * 0x01010101u);
+		tb_assert(status == OK, "DRW write %d failed\n", i);
+	}
+	status = co_await retry_write(s, AP, AP_REG_TAR, mem_base);
+	tb_assert(status == OK, "TAR write failed\n");
+	uint32_t data;
+	(void)co_await retry_read(s, AP, AP_REG_DRW, data);
+	for (int i = 0; i < n; ++i) {
+		status = co_await (i < n - 1 ? retry_read(s, AP, AP_REG_DRW, data) : retry_read(s, DP, DP_REG_RDBUF, data));
+		tb_assert(status == OK, "Read %d failed\n", i);
+		uint32_t expect = 0x5a000000u + i * 0x01010101u;
+		tb_assert(data == expect, "Word %d: got %08x, expected %08x\n", i, data, expect);
+	}
+
+	// The firmware agent keeps running whilst we poll
+	uint32_t first = co_await read_word(s, mem_base + 4 * heartbeat_idx);
+	uint32_t beat = first;
+	int polls = 0;
+	while (beat - first < 3) {
+		++polls;
+		tb_assert(polls < 1000, "Heartbeat stuck at %u\n", beat);
+		uint32_t next = co_await read_word(s, mem_base + 4 * heartbeat_idx);
+		tb_assert(next - beat <= 1, "Heartbeat skipped from %u to %u\n", beat, next);
+		beat = next;
+	}
+	printf("Heartbeat %u -> %u in %d polls\n", first, beat, polls);
+}
+
+int main() {
+	tb t("waves.vcd");
+	if (!t.set_dst_clock({.ratio_num = 1, .ratio_den = 2, .phase_deg = 0, .jitter_pct = 0, .seed = 0})) {
+		printf("clk_dst is tied to the system clock in this build, nothing to test\n");
+		return 0;
+	}
+
+	tb_sched s(t);
+	s.spawn(apb_monitor(s), true);
+	s.spawn(apb_responder(s), true);
+	s.spawn(firmware(s), true);
+
+	// Agents run as soon as anything steps the testbench, including the
+	// blocking helpers
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	s.spawn(host(s));
+	tb_assert(s.run(1000000), "Host agent did not finish\n");
+
+	printf("%d APB transfers, %d wait states, %d host WAITs, %llu SWCLK cycles\n",
+		apb_transfers, apb_wait_states, host_waits, (unsigned long long)t.swclk_cycles());
+	return 0;
+}
@@ -0,0 +1,232 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the mailbox AP at APSEL 2 register by register, with the
+// target side modelled by the testbench:
+//
+// - STATUS, LEVEL and DEPTH after reset, with a full h2t FIFO, and with data
+//   in the t2h FIFO
+// - a DATA write to a full h2t FIFO is held with WAIT until the target drains
+//   it, and nothing is lost or reordered
+// - a DATA read from an empty t2h FIFO is held with WAIT until the target
+//   offers a word
+// - DAPABORT cancels a held write without pushing, and a held read without
+//   popping
+// - a target-side reset on its own empties both FIFOs, on both sides
+
+static const uint32_t h2t_base = 0x10000000u;
+static const uint32_t t2h_base = 0x20000000u;
+static const int max_words = 64;
+
+// Host->target sink, stalled unless sink_ready
+static bool sink_ready;
+static uint32_t h2t_received[max_words];
+static int h2t_count;
+
+bool h2t_callback(uint64_t cycle, uint32_t data) {
+	if (!sink_ready || h2t_count >= max_words)
+		return false;
+	h2t_received[h2t_count++] = data;
+	return true;
+}
+
+// Target->host source, offers words until t2h_count reaches t2h_limit
+static int t2h_count;
+static int t2h_limit;
+
+bool t2h_callback(uint64_t cycle, uint32_t &data) {
+	if (t2h_count >= t2h_limit)
+		return false;
+	data = t2h_base + t2h_count++;
+	return true;
+}
+
+// Give up on a held access after this many WAITs
+static const int max_waits = 1000;
+
+static swd_status_t mbox_write(tb &t, uint8_t reg, uint32_t data) {
+	swd_status_t status;
+	int waits = 0;
+	while ((status = swd_write(t, AP, reg, data)) == WAIT)
+		tb_assert(++waits < max_waits, "Write to %d still WAIT\n", reg);
+	return status;
+}
+
+static uint32_t mbox_rdbuf(tb &t) {
+	uint32_t data;
+	swd_status_t status;
+	int waits = 0;
+	while ((status = swd_read(t, DP, DP_REG_RDBUF, data)) == WAIT)
+		tb_assert(++waits < max_waits, "RDBUF read still WAIT\n");
+	tb_assert(status == OK, "RDBUF read failed: %d\n", (int)status);
+	return data;
+}
+
+static uint32_t mbox_read(tb &t, uint8_t reg) {
+	uint32_t data;
+	swd_status_t status;
+	int waits = 0;
+	while ((status = swd_read(t, AP, reg, data)) == WAIT)
+		tb_assert(++waits < max_waits, "Read of %d still WAIT\n", reg);
+	tb_assert(status == OK, "Read of %d failed: %d\n", reg, (int)status);
+	return mbox_rdbuf(t);
+}
+
+static void check_levels(tb &t, uint32_t h2t, uint32_t t2h, const char *when) {
+	uint32_t level = mbox_read(t, MBOX_AP_REG_LEVEL);
+	tb_assert(level == (t2h << 16 | h2t), "Bad LEVEL %s: %08x\n", when, level);
+	uint32_t status = mbox_read(t, MBOX_AP_REG_STATUS);
+	uint32_t expect = (h2t == 0 ? MBOX_AP_STATUS_H2T_EMPTY : 0) | (t2h == 0 ? MBOX_AP_STATUS_T2H_EMPTY : 0);
+	tb_assert((status & (MBOX_AP_STATUS_H2T_EMPTY | MBOX_AP_STATUS_T2H_EMPTY)) == expect,
+		"Bad STATUS %s: %08x\n", when, status);
+}
+
+static void check_h2t(int n, const char *when) {
+	tb_assert(h2t_count == n, "Target received %d words %s, expected %d\n", h2t_count, when, n);
+	for (int i = 0; i < n; ++i)
+		tb_assert(h2t_received[i] == h2t_base + i, "Bad h2t word %d %s: %08x\n", i, when, h2t_received[i]);
+}
+
+int main() {
+	tb t("waves.vcd");
+	sink_ready = false;
+	t2h_limit = 0;
+	t.set_mailbox_callbacks(h2t_callback, t2h_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	(void)swd_write(t, DP, DP_REG_SELECT, (MBOX_AP_APSEL << 24) | AP_BANK_IDR);
+	uint32_t idr = mbox_read(t, AP_REG_IDR);
+	tb_assert(idr == MBOX_APIDR_EXPECTED, "Bad mailbox AP IDR: %08x\n", idr);
+	(void)swd_write(t, DP, DP_REG_SELECT, MBOX_AP_APSEL << 24);
+
+	uint32_t depth = mbox_read(t, MBOX_AP_REG_DEPTH);
+	tb_assert(depth == (16u << 16 | 8u), "Bad DEPTH: %08x\n", depth);
+	const int h2t_depth = depth & 0xffffu;
+	const int t2h_depth = depth >> 16;
+	uint32_t stat = mbox_read(t, MBOX_AP_REG_STATUS);
+	tb_assert(stat == (MBOX_AP_STATUS_H2T_EMPTY | MBOX_AP_STATUS_T2H_EMPTY),
+		"Bad STATUS after reset: %08x\n", stat);
+	check_levels(t, 0, 0, "after reset");
+
+	// Fill the h2t FIFO with the target stalled
+	int n_h2t = 0;
+	for (int i = 0; i < h2t_depth; ++i) {
+		status = swd_write(t, AP, MBOX_AP_REG_DATA, h2t_base + n_h2t++);
+		tb_assert(status == OK, "Write %d to non-full FIFO should not WAIT\n", i);
+	}
+	stat = mbox_read(t, MBOX_AP_REG_STATUS);
+	tb_assert(stat == (MBOX_AP_STATUS_H2T_FULL | MBOX_AP_STATUS_T2H_EMPTY),
+		"Bad STATUS with h2t full: %08x\n", stat);
+	check_levels(t, h2t_depth, 0, "with h2t full");
+
+	// One more write is accepted, but held, so the next access WAITs for as
+	// long as the target is stalled.
+	status = swd_write(t, AP, MBOX_AP_REG_DATA, h2t_base + n_h2t++);
+	tb_assert(status == OK, "Write to full FIFO should be accepted and held\n");
+	for (int i = 0; i < 20; ++i) {
+		status = swd_write(t, AP, MBOX_AP_REG_DATA, h2t_base + n_h2t);
+		tb_assert(status == WAIT, "Access behind held write should WAIT\n");
+	}
+	tb_assert(h2t_count == 0, "Target should have received nothing yet\n");
+	sink_ready = true;
+	status = mbox_write(t, MBOX_AP_REG_DATA, h2t_base + n_h2t++);
+	tb_assert(status == OK, "Write should complete once the target drains the FIFO\n");
+	idle_clocks(t, 2 * h2t_depth + 16);
+	check_h2t(n_h2t, "after drain");
+	check_levels(t, 0, 0, "after h2t drain");
+
+	// Read from the empty t2h FIFO: the read is held until the target offers
+	// a word. The pipelined read returns OK, and RDBUF WAITs behind it.
+	uint32_t data;
+	status = swd_read(t, AP, MBOX_AP_REG_DATA, data);
+	tb_assert(status == OK, "Read from empty FIFO should be accepted and held\n");
+	for (int i = 0; i < 20; ++i) {
+		status = swd_read(t, DP, DP_REG_RDBUF, data);
+		tb_assert(status == WAIT, "RDBUF behind held read should WAIT\n");
+	}
+	t2h_limit = 1;
+	data = mbox_rdbuf(t);
+	tb_assert(data == t2h_base, "Held read returned %08x\n", data);
+	check_levels(t, 0, 0, "after held read");
+
+	// Fill the t2h FIFO from the target, and check the levels
+	t2h_count = 0;
+	t2h_limit = t2h_depth;
+	idle_clocks(t, 2 * t2h_depth + 16);
+	stat = mbox_read(t, MBOX_AP_REG_STATUS);
+	tb_assert(stat == (MBOX_AP_STATUS_T2H_FULL | MBOX_AP_STATUS_H2T_EMPTY),
+		"Bad STATUS with t2h full: %08x\n", stat);
+	check_levels(t, 0, t2h_depth, "with t2h full");
+	status = swd_read(t, AP, MBOX_AP_REG_DATA, data);
+	tb_assert(status == OK, "Read from non-empty FIFO should not WAIT\n");
+	for (int i = 0; i < t2h_depth - 1; ++i) {
+		status = swd_read(t, AP, MBOX_AP_REG_DATA, data);
+		tb_assert(status == OK && data == t2h_base + i, "Bad t2h word %d: %08x\n", i, data);
+	}
+	data = mbox_rdbuf(t);
+	tb_assert(data == t2h_base + t2h_depth - 1, "Bad last t2h word: %08x\n", data);
+	check_levels(t, 0, 0, "after t2h drain");
+
+	// DAPABORT of a held write: the FIFO is full, and the write is not pushed
+	sink_ready = false;
+	h2t_count = 0;
+	n_h2t = 0;
+	for (int i = 0; i < h2t_depth; ++i)
+		(void)mbox_write(t, MBOX_AP_REG_DATA, h2t_base + n_h2t++);
+	status = swd_write(t, AP, MBOX_AP_REG_DATA, 0xdeadbeefu);
+	tb_assert(status == OK, "Write to full FIFO should be accepted and held\n");
+	status = swd_write(t, DP, DP_REG_ABORT, DP_ABORT_DAPABORT);
+	tb_assert(status == OK, "ABORT should always give OK\n");
+	check_levels(t, h2t_depth, 0, "after aborted write");
+	sink_ready = true;
+	idle_clocks(t, 2 * h2t_depth + 16);
+	check_h2t(n_h2t, "after aborted write");
+
+	// DAPABORT of a held read: the FIFO is empty, and a word which arrives
+	// afterwards is not popped
+	t2h_count = 0;
+	t2h_limit = 0;
+	status = swd_read(t, AP, MBOX_AP_REG_DATA, data);
+	tb_assert(status == OK, "Read from empty FIFO should be accepted and held\n");
+	status = swd_write(t, DP, DP_REG_ABORT, DP_ABORT_DAPABORT);
+	tb_assert(status == OK, "ABORT should always give OK\n");
+	t2h_limit = 1;
+	idle_clocks(t, 16);
+	check_levels(t, 0, 1, "after aborted read");
+	data = mbox_read(t, MBOX_AP_REG_DATA);
+	tb_assert(data == t2h_base, "Word after aborted read: %08x\n", data);
+
+	// Target-side reset on its own, with data in both FIFOs. Both FIFOs empty,
+	// and the target sees none of the old h2t data.
+	sink_ready = false;
+	h2t_count = 0;
+	for (int i = 0; i < 3; ++i)
+		(void)mbox_write(t, MBOX_AP_REG_DATA, h2t_base + i);
+	t2h_count = 0;
+	t2h_limit = 5;
+	idle_clocks(t, 16);
+	check_levels(t, 3, 5, "before target reset");
+	t2h_limit = 0;
+	t.set_mailbox_target_reset(true);
+	idle_clocks(t, 8);
+	t.set_mailbox_target_reset(false);
+	idle_clocks(t, 16);
+	check_levels(t, 0, 0, "after target reset");
+	sink_ready = true;
+	idle_clocks(t, 16);
+	tb_assert(h2t_count == 0, "Target received %d words from before its reset\n", h2t_count);
+
+	// And the mailbox still works afterwards
+	for (int i = 0; i < 3; ++i)
+		(void)mbox_write(t, MBOX_AP_REG_DATA, h2t_base + i);
+	t2h_count = 0;
+	t2h_limit = 1;
+	data = mbox_read(t, MBOX_AP_REG_DATA);
+	tb_assert(data == t2h_base, "Bad t2h word after target reset: %08x\n", data);
+	idle_clocks(t, 16);
+	check_h2t(3, "after target reset");
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include "tb.h"
+#include "coresight_discovery.h"
+#include "rom_tree_model.h"
+#include <cstdio>
+
+// Test intent: discover the CoreSight topology behind the Mem-AP, starting
+// from the RTL ROM table its BASE points at, with a modelled tree of nested
+// ROM tables below it (see rom_tree_model.h). Check that:
+//
+// - per-word and block-read discovery both find every component, with the
+//   right IDs and depth, and skip the not-present entry
+// - both read the same words
+// - a cold discovery misses the topology cache, and a reconnect hits it and
+//   reads less, with the same result
+// - the cache survives a save and load
+//
+// bench_rom_discovery measures how long all of this takes.
+
+static rom_tree_model model;
+
+apb_read_response read_callback(uint32_t addr) {
+	return model.read(addr);
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	return {.delay_cycles = 0, .err = true};
+}
+
+static void discover(tb &t, bool block_reads, cs_topology_cache *cache,
+		cs_topology &topo, cs_walk_stats &stats) {
+	cs_walk_options opt = CS_WALK_DEFAULT_OPTIONS;
+	opt.block_reads = block_reads;
+	swd_status_t status = cs_discover(t, opt, cache, topo, stats);
+	tb_assert(status == OK, "Discovery failed: %d\n", (int)status);
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	model.build(2, 3);
+	cs_topology topo;
+	cs_walk_stats word_stats, block_stats, cached_stats;
+
+	discover(t, false, nullptr, topo, word_stats);
+	model.check_topology(topo);
+
+	cs_topology_cache cache;
+	discover(t, true, &cache, topo, block_stats);
+	model.check_topology(topo);
+	tb_assert(!block_stats.cache_hit && cache.size() == 1, "Cold discovery should miss\n");
+	tb_assert(block_stats.mem_words == word_stats.mem_words, "Block and per-word reads differ\n");
+
+	status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to reconnect\n");
+	discover(t, true, &cache, topo, cached_stats);
+	model.check_topology(topo);
+	tb_assert(cached_stats.cache_hit, "Reconnect should hit the cache\n");
+	tb_assert(cached_stats.mem_words < block_stats.mem_words, "Cache hit should read less\n");
+
+	// Cache persists across host sessions
+	const char *cache_file = "rom_topology.cache";
+	tb_assert(cache.save(cache_file), "Failed to save cache\n");
+	cs_topology_cache loaded;
+	tb_assert(loaded.load(cache_file) && loaded.size() == 1, "Failed to load cache\n");
+	cs_walk_stats loaded_stats;
+	discover(t, true, &loaded, topo, loaded_stats);
+	tb_assert(loaded_stats.cache_hit, "Loaded cache should hit\n");
+	model.check_topology(topo);
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+#include "tb.h"
+#include "swd_monitor.h"
+#include <cstdio>
+
+// Test intent: check that the passive SWD monitor decodes everything the
+// host sends and the DP returns, by comparing its counts against the host's
+// own, then print its latency histograms. Covers Dormant-to-SWD, line
+// resets, packets with OK and WAIT, TARGETSEL with a good and bad ID (no
+// ACK), a malformed header, and SWD-to-Dormant. Check the JSON-lines log
+// has one line per event, and that the binary log round-trips.
+//
+// Runs without waves, which the monitor log is meant to replace.
+
+static const uint32_t mem_base = 0x20000000u;
+static int apb_delay;
+
+apb_read_response read_callback(uint32_t addr) {
+	return {
+		.rdata = ~addr,
+		.delay_cycles = apb_delay,
+		.err = false
+	};
+}
+
+static swd_retry_stats host_stats;
+
+static swd_status_t counted_write(tb &t, ap_dp_t ap_ndp, uint8_t addr, uint32_t data) {
+	++host_stats.packets;
+	return swd_write(t, ap_ndp, addr, data);
+}
+
+static int count_lines(const char *path) {
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return -1;
+	int lines = 0;
+	for (int c = fgetc(f); c != EOF; c = fgetc(f))
+		lines += c == '\n';
+	fclose(f);
+	return lines;
+}
+
+int main() {
+	tb t("");
+	t.set_apb_read_callback(read_callback);
+
+	const char *json_path = "swd_monitor.jsonl";
+	swd_monitor *mon = new swd_monitor(json_path, SWD_LOG_JSONL);
+	t.set_swd_monitor(mon);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	tb_assert(mon->dormant_exits == 1 && mon->line_resets == 1, "Missed Dormant-to-SWD or line reset\n");
+	tb_assert(mon->packets == 5 && mon->acks_ok == 5, "Expected 5 OK packets on connect, saw %llu (%llu OK)\n",
+		(unsigned long long)mon->packets, (unsigned long long)mon->acks_ok);
+	host_stats.packets = 5;
+
+	uint32_t data;
+	status = swd_read_retry(t, DP, DP_REG_DPIDR, data, &host_stats);
+	tb_assert(status == OK && data == DPIDR_EXPECTED, "Bad DPIDR\n");
+	tb_assert(mon->last.event == SWD_EVENT_PACKET && mon->last.data == DPIDR_EXPECTED
+		&& mon->last.ack == OK && mon->last.flags == SWD_RECORD_DATA_PHASE, "Monitor misread DPIDR\n");
+
+	// Reads of increasing latency, so that RDBUFF starts getting WAITs
+	(void)counted_write(t, DP, DP_REG_SELECT, AP_BANK_CSW);
+	(void)counted_write(t, AP, AP_REG_CSW, 0x12u);
+	(void)counted_write(t, AP, AP_REG_TAR, mem_base);
+	for (int i = 0; i < 16; ++i) {
+		apb_delay = 8 * i;
+		(void)swd_read_retry(t, AP, AP_REG_DRW, data, &host_stats);
+		status = swd_read_retry(t, DP, DP_REG_RDBUF, data, &host_stats);
+		tb_assert(status == OK && data == ~(mem_base + 4 * i), "Bad read %d: %08x\n", i, data);
+		tb_assert(mon->last.data == data, "Monitor disagrees on read %d: %08x\n", i, mon->last.data);
+	}
+	apb_delay = 0;
+	tb_assert(host_stats.waits > 0, "Expected some WAITs\n");
+	tb_assert((int)mon->packets == host_stats.packets && (int)mon->acks_wait == host_stats.waits,
+		"Monitor saw %llu packets, %llu WAITs; host sent %d, got %d WAITs\n",
+		(unsigned long long)mon->packets, (unsigned long long)mon->acks_wait, host_stats.packets, host_stats.waits);
+	tb_assert(mon->ap_latency.count() > 0 && mon->wait_retries.max() > 0, "Empty histograms\n");
+
+	// TARGETSEL with the wrong ID deselects: the next packet gets no ACK.
+	swd_line_reset(t);
+	swd_targetsel(t, (TARGETID_EXPECTED & 0x0fffffffu) | 0x80000000u);
+	status = swd_read(t, DP, DP_REG_DPIDR, data);
+	tb_assert(status == DISCONNECTED, "Should be deselected\n");
+	tb_assert(mon->targetsels == 1 && mon->acks_none == 1, "Missed TARGETSEL or missing ACK\n");
+	swd_line_reset(t);
+	swd_targetsel(t, TARGETID_EXPECTED & 0x0fffffffu);
+	status = swd_read(t, DP, DP_REG_DPIDR, data);
+	tb_assert(status == OK, "Failed to reselect\n");
+	tb_assert(mon->targetsels == 2 && mon->line_resets == 3, "Missed TARGETSEL or line reset\n");
+
+	// Malformed header: park bit clear. Then recover.
+	uint8_t bad_header = swd_header(DP, 1, 0) & 0x7fu;
+	put_bits(t, &bad_header, 8);
+	idle_clocks(t, 8);
+	swd_line_reset(t);
+	status = swd_read(t, DP, DP_REG_DPIDR, data);
+	tb_assert(status == OK, "Failed to recover from protocol error\n");
+	tb_assert(mon->protocol_errors == 1, "Expected one protocol error, saw %llu\n",
+		(unsigned long long)mon->protocol_errors);
+
+	// SWD-to-Dormant directly after a line reset's ones, then come back
+	const uint8_t seq_to_dormant[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xbc, 0xe3};
+	put_bits(t, seq_to_dormant, 72);
+	tb_assert(mon->dormant_entries == 1 && mon->protocol_errors == 1,
+		"Missed SWD-to-Dormant, or mistook it for a protocol error\n");
+	status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to reconnect from Dormant\n");
+	tb_assert(mon->dormant_exits == 2, "Missed second Dormant-to-SWD\n");
+	tb_assert(mon->parity_errors == 0, "Unexpected parity errors\n");
+
+	mon->print_summary(stdout);
+	uint64_t events = mon->packets + mon->targetsels + mon->line_resets + mon->dormant_exits
+		+ mon->dormant_entries + mon->protocol_errors;
+	t.set_swd_monitor(NULL);
+	delete mon;
+	int lines = count_lines(json_path);
+	tb_assert(lines == (int)events, "Expected %d log lines, found %d\n", (int)events, lines);
+
+	// Binary log: a short session, read back
+	const char *bin_path = "swd_monitor.bin";
+	mon = new swd_monitor(bin_path, SWD_LOG_BINARY);
+	t.set_swd_monitor(mon);
+	status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	uint64_t bin_events = mon->packets + mon->line_resets + mon->dormant_exits;
+	t.set_swd_monitor(NULL);
+	delete mon;
+
+	FILE *f = fopen(bin_path, "rb");
+	tb_assert(f, "No binary log\n");
+	swd_monitor_record r;
+	uint64_t n_records = 0;
+	bool saw_dpidr = false;
+	while (fread(&r, sizeof(r), 1, f) == 1) {
+		++n_records;
+		saw_dpidr = saw_dpidr || (r.event == SWD_EVENT_PACKET && r.header == swd_header(DP, 1, 0)
+			&& r.data == DPIDR_EXPECTED);
+	}
+	fclose(f);
+	tb_assert(n_records == bin_events && saw_dpidr, "Bad binary log: %llu records\n", (unsigned long long)n_records);
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the trace capture AP at APSEL 1. Capture a stream of
+// incrementing words in stop-when-full mode and read the whole buffer back
+// with pipelined RDATA reads, then capture in wrap mode with a trigger and
+// check that capture stops TRIGCNT words after the trigger.
+//
+// Run once with the trace clock tied to SWCLK, then again with it running
+// independently (and faster, with jitter) through the AP's synchronisers, if
+// this build has them.
+
+static const int trigger_period = 256;
+static const uint32_t trigcnt = 5;
+
+trace_sample trace_source(uint64_t cycle) {
+	return {
+		.valid = true,
+		.data = (uint32_t)cycle,
+		.trigger = cycle % trigger_period == 0
+	};
+}
+
+static void trace_select(tb &t, int bank) {
+	swd_status_t status = swd_write(t, DP, DP_REG_SELECT, (TRACE_AP_APSEL << 24) | bank);
+	tb_assert(status == OK, "SELECT write failed\n");
+}
+
+static uint32_t trace_read(tb &t, int bank, int reg) {
+	uint32_t data;
+	trace_select(t, bank);
+	(void)swd_read(t, AP, reg, data);
+	swd_status_t status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK, "Trace AP read failed\n");
+	return data;
+}
+
+static void trace_write(tb &t, int bank, int reg, uint32_t data) {
+	trace_select(t, bank);
+	swd_status_t status = swd_write(t, AP, reg, data);
+	tb_assert(status == OK, "Trace AP write failed\n");
+}
+
+// Read n words starting at index start, using one pipelined block of reads.
+static void trace_readout(tb &t, uint32_t start, int n, uint32_t *buf) {
+	trace_write(t, TRACE_AP_BANK_RDPTR, TRACE_AP_REG_RDPTR, start);
+	trace_select(t, TRACE_AP_BANK_CTRL);
+	uint32_t data;
+	(void)swd_read(t, AP, TRACE_AP_REG_RDATA, data);
+	for (int i = 0; i < n - 1; ++i) {
+		swd_status_t status = swd_read(t, AP, TRACE_AP_REG_RDATA, buf[i]);
+		tb_assert(status == OK, "RDATA read %d failed\n", i);
+	}
+	swd_status_t status = swd_read(t, DP, DP_REG_RDBUF, buf[n - 1]);
+	tb_assert(status == OK, "RDBUF read failed\n");
+}
+
+static void run_capture(tb &t, uint32_t depth) {
+	uint32_t buf[32];
+
+	// Stop-when-full: buffer holds the first DEPTH words after arming.
+	trace_write(t, TRACE_AP_BANK_CTRL, TRACE_AP_REG_CTRL,
+		TRACE_AP_CTRL_ENABLE | TRACE_AP_CTRL_MODE_STOP);
+	idle_clocks(t, 2 * depth);
+	uint32_t stat = trace_read(t, TRACE_AP_BANK_CTRL, TRACE_AP_REG_STATUS);
+	tb_assert(stat == TRACE_AP_STATUS_WRAPPED, "Bad STATUS after fill: %x\n", stat);
+	uint32_t wrptr = trace_read(t, TRACE_AP_BANK_CTRL, TRACE_AP_REG_WRPTR);
+	tb_assert(wrptr == 0, "Bad WRPTR after fill: %u\n", wrptr);
+
+	trace_readout(t, 0, depth, buf);
+	for (uint32_t i = 1; i < depth; ++i)
+		tb_assert(buf[i] == buf[i - 1] + 1, "Non-consecutive data at %u: %08x %08x\n", i, buf[i - 1], buf[i]);
+	uint32_t rdptr = trace_read(t, TRACE_AP_BANK_RDPTR, TRACE_AP_REG_RDPTR);
+	tb_assert(rdptr == 0, "RDPTR should have wrapped back to 0, got %u\n", rdptr);
+
+	// Wrap mode with trigger. Configuration may only change whilst disabled.
+	trace_write(t, TRACE_AP_BANK_CTRL, TRACE_AP_REG_CTRL, 0);
+	trace_write(t, TRACE_AP_BANK_RDPTR, TRACE_AP_REG_TRIGCNT, trigcnt);
+	trace_write(t, TRACE_AP_BANK_CTRL, TRACE_AP_REG_CTRL,
+		TRACE_AP_CTRL_ENABLE | TRACE_AP_CTRL_TRIGEN);
+	idle_clocks(t, 3 * trigger_period);
+	stat = trace_read(t, TRACE_AP_BANK_CTRL, TRACE_AP_REG_STATUS);
+	tb_assert(!(stat & TRACE_AP_STATUS_RUNNING), "Still running after trigger\n");
+	tb_assert(stat & TRACE_AP_STATUS_TRIGGERED, "Trigger not seen: %x\n", stat);
+	wrptr = trace_read(t, TRACE_AP_BANK_CTRL, TRACE_AP_REG_WRPTR);
+
+	// Oldest word is at WRPTR if the buffer wrapped, else at 0.
+	bool wrapped = stat & TRACE_AP_STATUS_WRAPPED;
+	uint32_t n = wrapped ? depth : wrptr;
+	tb_assert(n >= trigcnt, "Too few words captured: %u\n", n);
+	trace_readout(t, wrapped ? wrptr : 0, n, buf);
+	for (uint32_t i = 1; i < n; ++i)
+		tb_assert(buf[i] == buf[i - 1] + 1, "Non-consecutive data at %u\n", i);
+	uint32_t trigger_word = buf[n - trigcnt];
+	tb_assert(trigger_word % trigger_period == 0, "Trigger word %08x not at trigger\n", trigger_word);
+	printf("Captured %u words, trigger at %08x, last %08x\n", n, trigger_word, buf[n - 1]);
+
+	trace_write(t, TRACE_AP_BANK_CTRL, TRACE_AP_REG_CTRL, 0);
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_trace_callback(trace_source);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	uint32_t idr = trace_read(t, AP_BANK_IDR, AP_REG_IDR);
+	tb_assert(idr == TRACE_APIDR_EXPECTED, "Bad trace AP IDR: %08x\n", idr);
+	const uint32_t depth = trace_read(t, TRACE_AP_BANK_RDPTR, TRACE_AP_REG_DEPTH);
+	tb_assert(depth == 32, "Bad DEPTH: %u\n", depth);
+
+	run_capture(t, depth);
+
+	if (t.n_sync_stages() == 0 || !t.set_dst_clock({.ratio_num = 5, .ratio_den = 3, .phase_deg = 77,
+		.jitter_pct = 20, .seed = 1234})) {
+		printf("Trace clock can't run independently in this build, skipping second pass\n");
+		return 0;
+	}
+	printf("Independent trace clock, %d sync stages\n", t.n_sync_stages());
+	run_capture(t, depth);
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the register window AP at APSEL 3. Program the window
+// base, then read and write registers scattered across the window, checking
+// the downstream addresses, and check that bus errors are reported. Then
+// issue a window read while a slow Mem-AP write is still on the shared
+// downstream bus, and check that neither transfer corrupts the other.
+
+static const uint32_t window_base = 0x40001200u;
+static const uint32_t rdata_xor = 0x5a5a0000u;
+static const uint32_t err_offset = 0x80u;
+
+static const uint32_t mem_addr = 0x20000040u;
+static const int mem_write_delay = 100;
+
+static uint32_t last_write_addr;
+static uint32_t last_write_data;
+static uint32_t mem_write_data;
+static int mem_writes;
+
+apb_read_response read_callback(uint32_t addr) {
+	return {
+		.rdata = addr ^ rdata_xor,
+		.delay_cycles = 0,
+		.err = addr == window_base + err_offset
+	};
+}
+
+apb_write_response write_callback(uint32_t addr, uint32_t data) {
+	if (addr == mem_addr) {
+		mem_write_data = data;
+		++mem_writes;
+		return {
+			.delay_cycles = mem_write_delay,
+			.err = false
+		};
+	}
+	last_write_addr = addr;
+	last_write_data = data;
+	return {
+		.delay_cycles = 0,
+		.err = false
+	};
+}
+
+static int swd_packets;
+
+static void window_select(tb &t, uint32_t offset) {
+	swd_status_t status = swd_write(t, DP, DP_REG_SELECT, (WINDOW_AP_APSEL << 24) | (offset & 0xf0u));
+	tb_assert(status == OK, "SELECT write failed\n");
+	++swd_packets;
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_apb_read_callback(read_callback);
+	t.set_apb_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	uint32_t data;
+	window_select(t, AP_BANK_IDR);
+	(void)swd_read(t, AP, AP_REG_IDR, data);
+	(void)swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(data == WINDOW_APIDR_EXPECTED, "Bad window AP IDR: %08x\n", data);
+
+	// Window is 256-byte aligned.
+	(void)swd_write(t, AP, WINDOW_AP_REG_WINDOW, window_base | 0x34u);
+	(void)swd_read(t, AP, WINDOW_AP_REG_WINDOW, data);
+	(void)swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(data == window_base, "Bad WINDOW readback: %08x\n", data);
+
+	// Scattered reads, sorted by bank so consecutive reads in a bank can be
+	// pipelined. Each is one SWD packet, plus one SELECT per bank.
+	const uint32_t offsets[] = {0x00, 0x04, 0x10, 0x38, 0x3c, 0x40, 0x44, 0x48, 0xa0, 0xec};
+	const int n = sizeof(offsets) / sizeof(offsets[0]);
+	swd_packets = 0;
+	int bank = -1;
+	bool pending = false;
+	uint32_t pending_offset = 0;
+	for (int i = 0; i < n; ++i) {
+		if ((int)(offsets[i] >> 4) != bank) {
+			bank = offsets[i] >> 4;
+			window_select(t, offsets[i]);
+		}
+		status = swd_read(t, AP, (offsets[i] >> 2) & 0x3, data);
+		++swd_packets;
+		tb_assert(status == OK, "Read of %02x failed\n", offsets[i]);
+		if (pending)
+			tb_assert(data == ((window_base + pending_offset) ^ rdata_xor), "Bad read at %02x: %08x\n", pending_offset, data);
+		pending = true;
+		pending_offset = offsets[i];
+	}
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	++swd_packets;
+	tb_assert(status == OK && data == ((window_base + pending_offset) ^ rdata_xor), "Bad final read: %08x\n", data);
+	// Through a Mem-AP this would also need a TAR write per 16-byte block.
+	printf("%d registers read in %d SWD packets\n", n, swd_packets);
+
+	// Write, which goes straight to the window offset.
+	window_select(t, 0xe0);
+	status = swd_write(t, AP, 3, 0xcafef00du);
+	tb_assert(status == OK, "Window write failed\n");
+	idle_clocks(t, 8);
+	tb_assert(last_write_addr == window_base + 0xec && last_write_data == 0xcafef00du,
+		"Bad write: %08x -> %08x\n", last_write_data, last_write_addr);
+
+	// Bus error
+	window_select(t, err_offset);
+	(void)swd_read(t, AP, (err_offset >> 2) & 0x3, data);
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK && (data & DP_CTRL_STAT_STICKYERR), "Bus error should set STICKYERR\n");
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_STKERRCLR);
+
+	// Bank 0xf is registers, not window: the write must not go downstream.
+	last_write_addr = 0;
+	window_select(t, WINDOW_AP_BANK_CTRL);
+	(void)swd_read(t, AP, WINDOW_AP_REG_STATUS, data);
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == OK && data == 0, "TRINPROG should be clear: %08x\n", data);
+	(void)swd_write(t, AP, 2, 0x12345678u);
+	idle_clocks(t, 8);
+	tb_assert(last_write_addr == 0, "Bank 0xf write went downstream\n");
+
+	// Window read while a Mem-AP write holds the downstream bus. The write
+	// is posted, so the window read is issued well before it completes.
+	(void)swd_write(t, DP, DP_REG_SELECT, AP_BANK_CSW);
+	(void)swd_write(t, AP, AP_REG_CSW, 0x02u);
+	(void)swd_write(t, AP, AP_REG_TAR, mem_addr);
+	status = swd_write(t, AP, AP_REG_DRW, 0x600df00du);
+	tb_assert(status == OK, "Mem-AP write failed\n");
+	while ((status = swd_write(t, DP, DP_REG_SELECT, WINDOW_AP_APSEL << 24)) == WAIT)
+		;
+	tb_assert(status == OK, "SELECT write failed\n");
+	while ((status = swd_read(t, AP, 1, data)) == WAIT)
+		;
+	tb_assert(status == OK, "Window read failed\n");
+	while ((status = swd_read(t, DP, DP_REG_RDBUF, data)) == WAIT)
+		;
+	tb_assert(status == OK && data == ((window_base + 0x04) ^ rdata_xor), "Bad window read under contention: %08x\n",
+		data);
+	idle_clocks(t, 8);
+	tb_assert(mem_writes == 1 && mem_write_data == 0x600df00du, "Bad Mem-AP write under contention: %d, %08x\n",
+		mem_writes, mem_write_data);
+	tb_assert(last_write_addr == 0, "Mem-AP write went to the window: %08x\n", last_write_addr);
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(!(data & DP_CTRL_STAT_STICKYERR), "Contention set STICKYERR\n");
+
+	return 0;
+}
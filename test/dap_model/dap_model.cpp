@@ -0,0 +1,153 @@
+#include "dap_model.h"
+
+#include <cmath>
+
+// Packet lengths, and the edges the DP acts on, relative to the first edge
+static const int packet_ok_cycles = 46;
+static const int packet_wait_cycles = 13;
+static const int ack_edge = 8;
+static const int write_issue_edge = 46;
+
+// Slack for clk_dst edges which land on a SWCLK edge after rounding
+static const double edge_eps = 1e-9;
+
+dap_model_config dap_model_default_config() {
+	dap_model_config cfg;
+	cfg.swclk_hz = 10e6;
+	cfg.dst_ratio = 1.0;
+	cfg.dst_phase = 0.0;
+	cfg.n_sync_stages = 2;
+	cfg.read_wait_states = 0;
+	cfg.write_wait_states = 0;
+	cfg.idle_cycles = 0;
+	return cfg;
+}
+
+// Register addresses, A[3:2]
+static const uint8_t reg_ctrl_stat = 1;
+static const uint8_t reg_rdbuf = 3;
+static const uint8_t reg_tar = 1;
+static const uint8_t reg_drw = 3;
+
+static dap_packet packet(bool ap, bool read, uint8_t addr, bool orun) {
+	dap_packet p;
+	p.ap = ap;
+	p.read = read;
+	p.addr = addr;
+	p.bus = ap && addr == reg_drw;
+	p.always_ok = !ap && read && addr == reg_ctrl_stat;
+	p.orun = orun;
+	return p;
+}
+
+dap_workload dap_make_workload(dap_pattern pattern, bool write, int n_words) {
+	dap_workload w;
+	w.data_words = n_words;
+	bool orun = pattern == DAP_PATTERN_ORUN;
+	const dap_packet tar = packet(true, false, reg_tar, orun);
+	const dap_packet drw = packet(true, !write, reg_drw, orun);
+	const dap_packet rdbuf = packet(false, true, reg_rdbuf, orun);
+	if (pattern == DAP_PATTERN_SINGLE) {
+		for (int i = 0; i < n_words; ++i) {
+			w.packets.push_back(tar);
+			w.packets.push_back(drw);
+			if (!write)
+				w.packets.push_back(rdbuf);
+		}
+		if (write)
+			w.packets.push_back(rdbuf);
+	} else {
+		w.packets.push_back(tar);
+		for (int i = 0; i < n_words; ++i)
+			w.packets.push_back(drw);
+		if (orun && write)
+			w.packets.push_back(packet(false, true, reg_ctrl_stat, true));
+		else
+			w.packets.push_back(rdbuf);
+	}
+	return w;
+}
+
+// First SWCLK edge strictly after x
+static int64_t next_src(double x) {
+	return (int64_t)std::floor(x + edge_eps) + 1;
+}
+
+// First clk_dst rising edge strictly after x
+static double next_dst(const dap_model_config &cfg, double x) {
+	double period = 1.0 / cfg.dst_ratio;
+	double k = std::floor((x - cfg.dst_phase) / period + edge_eps) + 1;
+	return cfg.dst_phase + k * period;
+}
+
+int64_t dap_model_ap_busy_until(const dap_model_config &cfg, int64_t issue, bool write) {
+	const double td = 1.0 / cfg.dst_ratio;
+	const int s = cfg.n_sync_stages;
+	const int ws = write ? cfg.write_wait_states : cfg.read_wait_states;
+	// src_req rises on the issue edge. After s clk_dst edges dst_req is
+	// visible, and the next edge raises dst_ack and PSEL; then one edge of
+	// setup phase, and the access phase with its wait states.
+	double t_ack = next_dst(cfg, issue) + s * td;
+	double t_finish = t_ack + (2 + ws) * td;
+	// src_ack seen, src_req falls
+	int64_t t_req_low = next_src(t_ack) + s;
+	// dst_ack falls once dst_req has fallen and the transfer has finished
+	double t_ack_low = std::fmax(next_dst(cfg, t_req_low) + s * td, t_finish + td);
+	// src_ack seen low, PREADY back high
+	return next_src(t_ack_low) + s;
+}
+
+dap_model_result dap_model_run(const dap_model_config &cfg, const dap_workload &w) {
+	dap_model_result r = {};
+	r.data_words = w.data_words;
+	int64_t t = 0;
+	int64_t busy_until = INT64_MIN;
+	bool sticky = false;
+	uint64_t ok_packets = 0;
+	for (const dap_packet &p : w.packets) {
+		for (;;) {
+			++r.packets;
+			int64_t ack = t + ack_edge;
+			bool fault = sticky && !p.always_ok;
+			bool wait = !fault && !p.always_ok && ack <= busy_until;
+			if (wait) {
+				++r.waits;
+				if (p.orun) {
+					r.overrun = true;
+					sticky = true;
+				}
+			}
+			bool ok = !fault && !wait;
+			if (ok && p.bus)
+				busy_until = dap_model_ap_busy_until(cfg, p.read ? ack : t + write_issue_edge, !p.read);
+			t += (ok || p.orun ? packet_ok_cycles : packet_wait_cycles) + cfg.idle_cycles;
+			ok_packets += ok;
+			// Retry on WAIT; a FAULT ends the workload's progress, but the
+			// host still sends the rest of it.
+			if (!wait || p.orun)
+				break;
+		}
+	}
+	r.swclk_cycles = t;
+	r.seconds = t / cfg.swclk_hz;
+	if (t > 0) {
+		r.transfers_per_s = ok_packets / r.seconds;
+		r.bytes_per_s = r.overrun ? 0.0 : 4.0 * w.data_words / r.seconds;
+		r.bits_per_cycle = r.overrun ? 0.0 : 32.0 * w.data_words / t;
+	}
+	return r;
+}
+
+double dap_model_required_swclk(const dap_model_config &cfg, const dap_workload &w, double dst_hz,
+		double bytes_per_s, double min_swclk_hz, double max_swclk_hz) {
+	dap_model_config c = cfg;
+	for (double f = min_swclk_hz; f <= max_swclk_hz; f *= 1.01) {
+		c.swclk_hz = f;
+		c.dst_ratio = dst_hz / f;
+		c.dst_phase = cfg.dst_phase / c.dst_ratio;
+		dap_model_result r = dap_model_run(c, w);
+		if (!r.overrun && r.bytes_per_s >= bytes_per_s)
+			return f;
+	}
+	return 0.0;
+}
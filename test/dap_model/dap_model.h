@@ -0,0 +1,92 @@
+#pragma once
+
+// Analytical SWD throughput model for the DAP: predicts SWCLK cycles, WAITs
+// and data rates for a sequence of SWD packets, without simulating the RTL.
+//
+// Packet costs are those of opendap_sw_dp_serial_comms.v, as driven by the
+// host in swd_util.cpp. A packet whose first bit is sampled on SWCLK edge t:
+//
+// - Decides its ACK on edge t + 8, from the AP's busy state before that edge
+// - Issues an AP read on edge t + 8, and an AP write on edge t + 46
+// - Takes 46 cycles if OK, else 13 (46 with ORUNDETECT, which clocks the data
+//   phase regardless)
+//
+// Downstream transfers go through opendap_apb_async_bridge.v. The model walks
+// its four-phase req/ack handshake edge by edge, on an ideal clk_dst of any
+// ratio and phase, so the AP's busy time is exact for a given alignment. The
+// SW-DP is the MINDP configuration of the DAP testbench: no pushed operations
+// or TRNCNT, and no register slices in the AP mux.
+//
+// Times are in SWCLK periods, with SWCLK rising edges on the integers.
+
+#include <cstdint>
+#include <vector>
+
+struct dap_model_config {
+	double swclk_hz;
+	// clk_dst frequency over SWCLK frequency, e.g. 1 when clk_dst is SWCLK
+	double dst_ratio;
+	// Time of some clk_dst rising edge, relative to the first edge of the
+	// first packet. 0 with the ratio 1 is clk_dst tied to SWCLK.
+	double dst_phase;
+	int n_sync_stages;
+	// APB wait states, in clk_dst cycles
+	int read_wait_states;
+	int write_wait_states;
+	// Host idle cycles after each packet
+	int idle_cycles;
+};
+
+dap_model_config dap_model_default_config();
+
+struct dap_packet {
+	bool ap;
+	bool read;
+	uint8_t addr;   // A[3:2]
+	bool bus;       // AP access with a downstream transfer (DRW, BDx)
+	bool always_ok; // DPIDR or CTRL/STAT read, ABORT write: never WAITs
+	bool orun;      // Sent with ORUNDETECT: ACK not checked, never retried
+};
+
+enum dap_pattern {
+	DAP_PATTERN_SINGLE, // Per word: TAR write, DRW access (and RDBUF read)
+	DAP_PATTERN_BLOCK,  // TAR write, then a DRW access per word (auto-increment)
+	DAP_PATTERN_ORUN    // Block, streamed with ORUNDETECT
+};
+
+struct dap_workload {
+	std::vector<dap_packet> packets;
+	int data_words;
+};
+
+// Mem-AP word transfers at consecutive addresses. Ends with an RDBUF read,
+// which returns the last read data, or waits for the last write to finish.
+// An ORUNDETECT write stream instead ends by reading CTRL/STAT for
+// STICKYORUN, which doesn't wait.
+dap_workload dap_make_workload(dap_pattern pattern, bool write, int n_words);
+
+struct dap_model_result {
+	uint64_t swclk_cycles;
+	uint64_t packets;       // Including WAIT and FAULT responses
+	uint64_t waits;
+	bool overrun;           // An ORUNDETECT packet got WAIT; data from then on is lost
+	int data_words;
+	double seconds;
+	double transfers_per_s; // OK packets
+	double bytes_per_s;
+	double bits_per_cycle;  // Data bits per SWCLK cycle
+};
+
+dap_model_result dap_model_run(const dap_model_config &cfg, const dap_workload &w);
+
+// For a downstream transfer issued on SWCLK edge issue: the last SWCLK edge
+// at which the AP is still busy. A packet starting on edge t gets WAIT if
+// t + 8 is not after this.
+int64_t dap_model_ap_busy_until(const dap_model_config &cfg, int64_t issue, bool write);
+
+// Lowest SWCLK frequency, on a 1% grid from min_swclk_hz to max_swclk_hz,
+// at which w reaches bytes_per_s with clk_dst fixed at dst_hz. Returns 0 if
+// there is none, counting overrun as failure. Here cfg.dst_phase is a
+// fraction of a clk_dst period, as the period in SWCLK cycles varies.
+double dap_model_required_swclk(const dap_model_config &cfg, const dap_workload &w, double dst_hz,
+	double bytes_per_s, double min_swclk_hz, double max_swclk_hz);
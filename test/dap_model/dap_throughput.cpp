@@ -0,0 +1,139 @@
+// Command line front end for the DAP throughput model: what does a given
+// SWCLK and clk_dst get us, and what SWCLK do we need for a target rate.
+
+#include "dap_model.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static void usage(const char *argv0) {
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --swclk HZ         SWCLK frequency (default 10e6)\n"
+		"  --dst HZ           clk_dst frequency (default: SWCLK)\n"
+		"  --phase F          clk_dst phase, fraction of a clk_dst period (default 0)\n"
+		"  --sync N           bridge synchroniser stages (default 2)\n"
+		"  --rwait N          APB read wait states (default 0)\n"
+		"  --wwait N          APB write wait states (default 0)\n"
+		"  --idle N           host idle cycles between packets (default 0)\n"
+		"  --words N          words per workload (default 256)\n"
+		"  --target MBPS      also find the lowest SWCLK reaching MBPS megabytes/s,\n"
+		"                     with clk_dst fixed at --dst, or at each of a range of\n"
+		"                     clock ratios if --dst is not given\n",
+		argv0);
+}
+
+static const struct {
+	dap_pattern pattern;
+	bool write;
+	const char *name;
+} workloads[] = {
+	{DAP_PATTERN_SINGLE, false, "single read"},
+	{DAP_PATTERN_SINGLE, true,  "single write"},
+	{DAP_PATTERN_BLOCK,  false, "block read"},
+	{DAP_PATTERN_BLOCK,  true,  "block write"},
+	{DAP_PATTERN_ORUN,   false, "orun read"},
+	{DAP_PATTERN_ORUN,   true,  "orun write"},
+};
+
+int main(int argc, char **argv) {
+	dap_model_config cfg = dap_model_default_config();
+	double dst_hz = 0.0;
+	double phase = 0.0;
+	double target_mbps = 0.0;
+	int words = 256;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			usage(argv[0]);
+			return 1;
+		}
+		const char *val = argv[++i];
+		if (arg == "--swclk")
+			cfg.swclk_hz = atof(val);
+		else if (arg == "--dst")
+			dst_hz = atof(val);
+		else if (arg == "--phase")
+			phase = atof(val);
+		else if (arg == "--sync")
+			cfg.n_sync_stages = atoi(val);
+		else if (arg == "--rwait")
+			cfg.read_wait_states = atoi(val);
+		else if (arg == "--wwait")
+			cfg.write_wait_states = atoi(val);
+		else if (arg == "--idle")
+			cfg.idle_cycles = atoi(val);
+		else if (arg == "--words")
+			words = atoi(val);
+		else if (arg == "--target")
+			target_mbps = atof(val);
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (cfg.swclk_hz <= 0 || dst_hz < 0 || cfg.n_sync_stages < 0 || words < 1) {
+		usage(argv[0]);
+		return 1;
+	}
+	cfg.dst_ratio = dst_hz > 0 ? dst_hz / cfg.swclk_hz : 1.0;
+	cfg.dst_phase = phase / cfg.dst_ratio;
+
+	printf("SWCLK %.3f MHz, clk_dst %.3f MHz, %d sync stages, %d/%d read/write wait states\n\n",
+		cfg.swclk_hz * 1e-6, cfg.swclk_hz * cfg.dst_ratio * 1e-6, cfg.n_sync_stages,
+		cfg.read_wait_states, cfg.write_wait_states);
+	printf("%-13s %10s %10s %10s %12s %10s\n", "Pattern", "cyc/word", "WAIT/word", "bits/cyc",
+		"xfers/s", "MB/s");
+	for (const auto &wl : workloads) {
+		dap_workload w = dap_make_workload(wl.pattern, wl.write, words);
+		dap_model_result r = dap_model_run(cfg, w);
+		printf("%-13s %10.2f %10.3f %10.3f %12.0f %10.3f%s\n", wl.name, (double)r.swclk_cycles / words,
+			(double)r.waits / words, r.bits_per_cycle, r.transfers_per_s, r.bytes_per_s * 1e-6,
+			r.overrun ? "  overrun" : "");
+	}
+
+	if (target_mbps <= 0)
+		return 0;
+
+	// Without a fixed clk_dst, report for each ratio the testbench can run
+	static const double ratios[] = {0.25, 0.5, 1.0, 2.0, 4.0, 8.0};
+	int n_ratios = dst_hz > 0 ? 1 : sizeof(ratios) / sizeof(ratios[0]);
+	printf("\nLowest SWCLK (MHz) for %.3f MB/s:\n", target_mbps);
+	printf("%-13s", "Pattern");
+	for (int i = 0; i < n_ratios; ++i) {
+		char col[32];
+		if (dst_hz > 0)
+			snprintf(col, sizeof(col), "dst %.1fM", dst_hz * 1e-6);
+		else
+			snprintf(col, sizeof(col), "dst %gx", ratios[i]);
+		printf(" %10s", col);
+	}
+	printf("\n");
+	cfg.dst_phase = phase;
+	for (const auto &wl : workloads) {
+		dap_workload w = dap_make_workload(wl.pattern, wl.write, words);
+		printf("%-13s", wl.name);
+		for (int i = 0; i < n_ratios; ++i) {
+			double f;
+			if (dst_hz > 0) {
+				f = dap_model_required_swclk(cfg, w, dst_hz, target_mbps * 1e6, 1e3, 200e6);
+			} else {
+				// Fixed ratio: cycles per word don't depend on frequency
+				dap_model_config c = cfg;
+				c.swclk_hz = 1.0;
+				c.dst_ratio = ratios[i];
+				c.dst_phase = phase / ratios[i];
+				dap_model_result r = dap_model_run(c, w);
+				f = r.overrun ? 0.0 : target_mbps * 1e6 / r.bytes_per_s;
+			}
+			if (f > 0)
+				printf(" %10.3f", f * 1e-6);
+			else
+				printf(" %10s", "-");
+		}
+		printf("\n");
+	}
+	return 0;
+}
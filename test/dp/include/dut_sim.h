@@ -0,0 +1,67 @@
+#pragma once
+
+// Simulator backend for the DP testbench. tb.cpp drives the DUT only through
+// these pin-level structs, so the same testbench and testcases run on any
+// simulator. Exactly one backend is linked, chosen by SIM in the Makefiles:
+//
+// - cxxrtl: dut_cxxrtl.cpp, using the Yosys CXXRTL model (default)
+// - verilator: dut_verilator.cpp, using a Verilator model
+//
+// Wave times are in us, one per step.
+
+#include <string>
+#include <cstdint>
+#include <vector>
+
+// The ports the testbench drives
+struct dut_inputs {
+	bool     swclk;
+	bool     rst_n;
+	bool     swdi;
+	uint8_t  instid;
+	bool     eventstat;
+	bool     cdbgpwrupack;
+	bool     csyspwrupack;
+	bool     cdbgrstack;
+	uint32_t ap_rdata;
+	bool     ap_rdy;
+	bool     ap_err;
+};
+
+// The ports the testbench observes
+struct dut_outputs {
+	bool     swdo;
+	bool     swdo_en;
+	bool     cdbgpwrupreq;
+	bool     csyspwrupreq;
+	bool     cdbgrstreq;
+	uint8_t  ap_sel;
+	uint8_t  ap_addr;
+	uint32_t ap_wdata;
+	bool     ap_wen;
+	bool     ap_ren;
+};
+
+class dut_sim {
+public:
+	dut_sim();
+	~dut_sim();
+	// Apply inputs, settle, and read back outputs
+	void eval(const dut_inputs &in, dut_outputs &out);
+	// Waves are off until a file is opened
+	bool open_waves(const std::string &path);
+	void sample_waves(uint64_t time);
+	// Snapshot of the model's state, for checkpoints. Returns false if the
+	// backend can't do this. A snapshot restores only into a model from the
+	// same build.
+	bool save_state(std::vector<uint8_t> &state);
+	bool restore_state(const std::vector<uint8_t> &state);
+	static const char *backend();
+
+private:
+	dut_sim(const dut_sim&) = delete;
+	dut_sim &operator=(const dut_sim&) = delete;
+
+	struct impl;
+	impl *p;
+};
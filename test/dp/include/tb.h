@@ -2,10 +2,9 @@
 
 #include <string>
 #include <cstdint>
-#include <fstream>
-#include <backends/cxxrtl/cxxrtl.h>
-#include <backends/cxxrtl/cxxrtl_vcd.h>
 
+#include "dut_sim.h"
+#include "stim_log.h"
 #include "swd_util.h"
 
 struct ap_read_response {
@@ -23,8 +22,14 @@ typedef ap_read_response (*ap_read_callback)(uint16_t addr);
 
 typedef ap_write_response (*ap_write_callback)(uint16_t addr, uint32_t data);
 
+// Called at the end of every tb::step(), e.g. by the agent scheduler in
+// tb_coro.h. Must not step the testbench itself.
+typedef void (*tb_step_hook)(void *ctx);
+
 class tb {
 public:
+	// Set TB_RECORD in the environment to record the stimulus for replay,
+	// see stim_log.h.
 	tb(std::string vcdfile);
 	void set_ap_read_callback(ap_read_callback cb);
 	void set_ap_write_callback(ap_write_callback cb);
@@ -34,16 +39,25 @@ public:
 	bool get_swdo();
 	void set_instid(uint8_t instid);
 	void step();
+	void set_step_hook(tb_step_hook hook, void *ctx);
+	// Simulator this testbench was built with
+	const char *backend() {return dut_sim::backend();}
 private:
+	void eval();
+	void sample_waves(uint64_t time);
+
 	int vcd_sample;
 	bool swclk_prev;
 	ap_read_callback read_callback;
 	ap_read_response last_read_response;
 	ap_write_callback write_callback;
 	ap_write_response last_write_response;
-	std::ofstream waves_fd;
-	cxxrtl::vcd_writer vcd;
-	cxxrtl::module *dut;
+	dut_sim sim;
+	dut_inputs in;
+	dut_outputs out;
+	stim_recorder rec;
+	tb_step_hook step_hook;
+	void *step_hook_ctx;
 };
 
 #define tb_assert(cond, ...) if (!(cond)) {printf(__VA_ARGS__); exit(-1);}
@@ -0,0 +1,113 @@
+#include "dut_sim.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "dut.cpp"
+#include <backends/cxxrtl/cxxrtl_vcd.h>
+
+struct dut_sim::impl {
+	cxxrtl_design::p_opendap__sw__dp top;
+	cxxrtl::debug_items all_debug_items;
+	cxxrtl::vcd_writer vcd;
+	std::ofstream waves_fd;
+};
+
+dut_sim::dut_sim() : p(new impl) {
+	p->top.debug_info(p->all_debug_items);
+	p->vcd.timescale(1, "us");
+	p->vcd.add(p->all_debug_items);
+}
+
+dut_sim::~dut_sim() {
+	delete p;
+}
+
+const char *dut_sim::backend() {
+	return "cxxrtl";
+}
+
+void dut_sim::eval(const dut_inputs &in, dut_outputs &out) {
+	cxxrtl_design::p_opendap__sw__dp &top = p->top;
+	top.p_swclk.set<bool>(in.swclk);
+	top.p_rst__n.set<bool>(in.rst_n);
+	top.p_swdi.set<bool>(in.swdi);
+	top.p_instid.set<uint8_t>(in.instid);
+	top.p_eventstat.set<bool>(in.eventstat);
+	top.p_cdbgpwrupack.set<bool>(in.cdbgpwrupack);
+	top.p_csyspwrupack.set<bool>(in.csyspwrupack);
+	top.p_cdbgrstack.set<bool>(in.cdbgrstack);
+	top.p_ap__rdata.set<uint32_t>(in.ap_rdata);
+	top.p_ap__rdy.set<bool>(in.ap_rdy);
+	top.p_ap__err.set<bool>(in.ap_err);
+
+	top.step();
+
+	out.swdo = top.p_swdo.get<bool>();
+	out.swdo_en = top.p_swdo__en.get<bool>();
+	out.cdbgpwrupreq = top.p_cdbgpwrupreq.get<bool>();
+	out.csyspwrupreq = top.p_csyspwrupreq.get<bool>();
+	out.cdbgrstreq = top.p_cdbgrstreq.get<bool>();
+	out.ap_sel = top.p_ap__sel.get<uint8_t>();
+	out.ap_addr = top.p_ap__addr.get<uint8_t>();
+	out.ap_wdata = top.p_ap__wdata.get<uint32_t>();
+	out.ap_wen = top.p_ap__wen.get<bool>();
+	out.ap_ren = top.p_ap__ren.get<bool>();
+}
+
+bool dut_sim::open_waves(const std::string &path) {
+	p->waves_fd.open(path);
+	return p->waves_fd.is_open();
+}
+
+void dut_sim::sample_waves(uint64_t time) {
+	if (!p->waves_fd.is_open())
+		return;
+	p->vcd.sample(time);
+	p->waves_fd << p->vcd.buffer;
+	p->waves_fd.flush();
+	p->vcd.buffer.clear();
+}
+
+// The state is every value, wire (both phases) and memory in the debug info,
+// which is what CXXRTL's own replay snapshots contain. Needs the default
+// debug level (write_cxxrtl -g2) or above, so that no state is hidden.
+template<class F>
+static size_t for_each_state(cxxrtl::debug_items &items, F f) {
+	size_t bytes = 0;
+	for (auto &it : items.table) {
+		for (auto &part : it.second) {
+			if (part.type != cxxrtl::debug_item::VALUE && part.type != cxxrtl::debug_item::WIRE &&
+					part.type != cxxrtl::debug_item::MEMORY)
+				continue;
+			size_t n = (part.width + 31) / 32 * part.depth * sizeof(uint32_t);
+			f(part.curr, n);
+			bytes += n;
+			if (part.type == cxxrtl::debug_item::WIRE) {
+				f(part.next, n);
+				bytes += n;
+			}
+		}
+	}
+	return bytes;
+}
+
+bool dut_sim::save_state(std::vector<uint8_t> &state) {
+	state.clear();
+	for_each_state(p->all_debug_items, [&](const uint32_t *chunks, size_t n) {
+		const uint8_t *b = (const uint8_t*)chunks;
+		state.insert(state.end(), b, b + n);
+	});
+	return true;
+}
+
+bool dut_sim::restore_state(const std::vector<uint8_t> &state) {
+	if (for_each_state(p->all_debug_items, [](const uint32_t *, size_t) {}) != state.size())
+		return false;
+	const uint8_t *b = state.data();
+	for_each_state(p->all_debug_items, [&](uint32_t *chunks, size_t n) {
+		memcpy(chunks, b, n);
+		b += n;
+	});
+	return true;
+}
@@ -0,0 +1,92 @@
+#include "dut_sim.h"
+
+#include "Vopendap_sw_dp.h"
+#include "verilated.h"
+#include "verilated_vcd_c.h"
+
+struct dut_sim::impl {
+	Vopendap_sw_dp *top;
+	VerilatedVcdC *vcd;
+};
+
+dut_sim::dut_sim() : p(new impl) {
+	// Must be set before the model is built, or trace() does nothing
+	Verilated::traceEverOn(true);
+	p->top = new Vopendap_sw_dp;
+	p->vcd = nullptr;
+	// Verilator models the asynchronous resets as edge-triggered, so start
+	// with rst_n high: the testbench's first eval then makes a falling edge.
+	p->top->rst_n = 1;
+	p->top->eval();
+}
+
+dut_sim::~dut_sim() {
+	p->top->final();
+	if (p->vcd) {
+		p->vcd->close();
+		delete p->vcd;
+	}
+	delete p->top;
+	delete p;
+}
+
+const char *dut_sim::backend() {
+	return "verilator";
+}
+
+void dut_sim::eval(const dut_inputs &in, dut_outputs &out) {
+	Vopendap_sw_dp *top = p->top;
+	top->swclk = in.swclk;
+	top->rst_n = in.rst_n;
+	top->swdi = in.swdi;
+	top->instid = in.instid;
+	top->eventstat = in.eventstat;
+	top->cdbgpwrupack = in.cdbgpwrupack;
+	top->csyspwrupack = in.csyspwrupack;
+	top->cdbgrstack = in.cdbgrstack;
+	top->ap_rdata = in.ap_rdata;
+	top->ap_rdy = in.ap_rdy;
+	top->ap_err = in.ap_err;
+
+	top->eval();
+
+	out.swdo = top->swdo;
+	out.swdo_en = top->swdo_en;
+	out.cdbgpwrupreq = top->cdbgpwrupreq;
+	out.csyspwrupreq = top->csyspwrupreq;
+	out.cdbgrstreq = top->cdbgrstreq;
+	out.ap_sel = top->ap_sel;
+	out.ap_addr = top->ap_addr;
+	out.ap_wdata = top->ap_wdata;
+	out.ap_wen = top->ap_wen;
+	out.ap_ren = top->ap_ren;
+}
+
+bool dut_sim::open_waves(const std::string &path) {
+	if (p->vcd)
+		return false;
+	p->vcd = new VerilatedVcdC;
+	p->top->trace(p->vcd, 99);
+	p->vcd->open(path.c_str());
+	return p->vcd->isOpen();
+}
+
+void dut_sim::sample_waves(uint64_t time) {
+	if (!p->vcd)
+		return;
+	p->vcd->dump(time);
+	p->vcd->flush();
+}
+
+// Verilator can only save a model built with --savable, to a file, which
+// costs speed in every run, so there are no checkpoints: logs replay from
+// the start.
+bool dut_sim::save_state(std::vector<uint8_t> &state) {
+	(void)state;
+	return false;
+}
+
+bool dut_sim::restore_state(const std::vector<uint8_t> &state) {
+	(void)state;
+	return false;
+}
@@ -1,30 +1,29 @@
 #include "tb.h"
 
-#include <fstream>
 #include <cstdint>
-
-#include "dut.cpp"
-#include <backends/cxxrtl/cxxrtl_vcd.h>
+#include <cstdio>
+#include <cstdlib>
 
 tb::tb(std::string vcdfile) {
-	// Raw pointer... CXXRTL doesn't give us the type declaration without also
-	// giving us non-inlined implementation, and I'm not very good at C++, so
-	// we do this shit
-	cxxrtl_design::p_opendap__sw__dp *dp = new cxxrtl_design::p_opendap__sw__dp;
-	dut = dp;
- 
-	waves_fd.open(vcdfile);
-	cxxrtl::debug_items all_debug_items;
-	dp->debug_info(all_debug_items);
-	vcd.timescale(1, "us");
-	vcd.add(all_debug_items);
+	in = dut_inputs();
+	out = dut_outputs();
+	step_hook = NULL;
+	step_hook_ctx = NULL;
+	// Recording starts before reset, so a replay can start from a new model
+	const char *record_path = getenv("TB_RECORD");
+	if (record_path) {
+		const char *interval = getenv("TB_RECORD_CHECKPOINT");
+		uint64_t steps = interval ? 2 * strtoull(interval, NULL, 0) : STIM_DEFAULT_CHECKPOINT_STEPS;
+		tb_assert(rec.open(record_path, steps), "Can't record to %s\n", record_path);
+	}
+	sim.open_waves(vcdfile);
 	vcd_sample = 0;
 
-	dp->p_rst__n.set<bool>(false);
-	dp->step();
-	dp->p_rst__n.set<bool>(true);
-	dp->p_ap__rdy.set<bool>(true);
-	dp->step();
+	in.rst_n = false;
+	eval();
+	in.rst_n = true;
+	in.ap_rdy = true;
+	eval();
 
 	swclk_prev = false;
 	read_callback = NULL;
@@ -32,9 +31,19 @@ tb::tb(std::string vcdfile) {
 	last_read_response.delay_cycles = 0;
 	last_write_response.delay_cycles = 0;
 
-	vcd.sample(vcd_sample++);
-	waves_fd << vcd.buffer;
-	vcd.buffer.clear();
+	sample_waves(vcd_sample++);
+}
+
+void tb::eval() {
+	if (rec.is_open())
+		rec.eval(in);
+	sim.eval(in, out);
+}
+
+void tb::sample_waves(uint64_t time) {
+	if (rec.is_open())
+		rec.sample(time);
+	sim.sample_waves(time);
 }
 
 void tb::set_ap_read_callback(ap_read_callback cb) {
@@ -46,81 +55,85 @@ void tb::set_ap_write_callback(ap_write_callback cb) {
 }
 
 void tb::set_swclk(bool swclk) {
-	static_cast<cxxrtl_design::p_opendap__sw__dp*>(dut)->p_swclk.set<bool>(swclk);
+	in.swclk = swclk;
 }
 
 void tb::set_swdi(bool swdi) {
-	static_cast<cxxrtl_design::p_opendap__sw__dp*>(dut)->p_swdi.set<bool>(swdi);
+	in.swdi = swdi;
 }
 
 bool tb::get_swdo() {
 	// Pullup on bus, so return 1 if pin tristated.
-	return static_cast<cxxrtl_design::p_opendap__sw__dp*>(dut)->p_swdo__en.get<bool>() ?
-		static_cast<cxxrtl_design::p_opendap__sw__dp*>(dut)->p_swdo.get<bool>() : true;
+	return out.swdo_en ? out.swdo : true;
 }
 
 void tb::set_instid(uint8_t instid) {
-	static_cast<cxxrtl_design::p_opendap__sw__dp*>(dut)->p_instid.set<uint8_t>(instid);
+	in.instid = instid;
 }
 
 void tb::step() {
-	cxxrtl_design::p_opendap__sw__dp *dp = static_cast<cxxrtl_design::p_opendap__sw__dp*>(dut);
-
-	uint16_t ap_addr = dp->p_ap__addr.get<uint16_t>() | dp->p_ap__sel.get<uint16_t>() << 6;
-	bool ap_wen = dp->p_ap__wen.get<bool>();
-	bool ap_ren = dp->p_ap__ren.get<bool>();
-	uint32_t ap_wdata = dp->p_ap__wdata.get<uint32_t>();
+	uint16_t ap_addr = out.ap_addr | out.ap_sel << 6;
+	bool ap_wen = out.ap_wen;
+	bool ap_ren = out.ap_ren;
+	uint32_t ap_wdata = out.ap_wdata;
 
-	dp->step();
-	dp->step();
-	vcd.sample(vcd_sample++);
-	waves_fd << vcd.buffer;
-	waves_fd.flush();
-	vcd.buffer.clear();
+	eval();
+	eval();
+	sample_waves(vcd_sample++);
 
 	// Field AP accesses using testcase callbacks if available, and provide AP
 	// bus responses with correct timing based on callback results.
-	if (!swclk_prev && dp->p_swclk.get<bool>()) {
-		dp->p_ap__err.set<bool>(0);
+	if (!swclk_prev && in.swclk) {
+		in.ap_err = 0;
 		if (last_read_response.delay_cycles > 0) {
 			--last_read_response.delay_cycles;
 			if (last_read_response.delay_cycles == 0) {
-				dp->p_ap__rdata.set<uint32_t>(last_read_response.rdata);
-				dp->p_ap__err.set<bool>(last_read_response.err);
-				dp->p_ap__rdy.set<bool>(1);
+				in.ap_rdata = last_read_response.rdata;
+				in.ap_err = last_read_response.err;
+				in.ap_rdy = 1;
 			}
 		}
 		if (last_write_response.delay_cycles > 0) {
 			--last_write_response.delay_cycles;
 			if (last_write_response.delay_cycles == 0) {
-				dp->p_ap__err.set<bool>(last_write_response.err);
-				dp->p_ap__rdy.set<bool>(1);
+				in.ap_err = last_write_response.err;
+				in.ap_rdy = 1;
 			}
 		}
 		if (ap_ren && read_callback) {
 			last_read_response = read_callback(ap_addr);
 			if (last_read_response.delay_cycles == 0) {
-				dp->p_ap__rdata.set<uint32_t>(last_read_response.rdata);
-				dp->p_ap__err.set<bool>(last_read_response.err);
+				in.ap_rdata = last_read_response.rdata;
+				in.ap_err = last_read_response.err;
 			}
 			else {
-				dp->p_ap__rdy.set<bool>(0);
+				in.ap_rdy = 0;
 			}
 		}
 		else if (ap_wen && write_callback) {
 			last_write_response = write_callback(ap_addr, ap_wdata);
 			if (last_write_response.delay_cycles == 0) {
-				dp->p_ap__err.set<bool>(last_write_response.err);
+				in.ap_err = last_write_response.err;
 			}
 			else {
-				dp->p_ap__rdy.set<bool>(0);
+				in.ap_rdy = 0;
 			}
 		}
 	}
-	swclk_prev = dp->p_swclk.get<bool>();
+	swclk_prev = in.swclk;
 
 	// Tie back REQs to ACKs so they can be toggled
-	dp->p_csyspwrupack.set<bool>(dp->p_csyspwrupreq.get<bool>());
-	dp->p_cdbgpwrupack.set<bool>(dp->p_cdbgpwrupreq.get<bool>());
-	dp->p_cdbgrstack.set<bool>(dp->p_cdbgrstreq.get<bool>());
+	in.csyspwrupack = out.csyspwrupreq;
+	in.cdbgpwrupack = out.cdbgpwrupreq;
+	in.cdbgrstack = out.cdbgrstreq;
+
+	if (rec.is_open())
+		rec.end_step(sim);
+	if (step_hook)
+		step_hook(step_hook_ctx);
+}
+
+void tb::set_step_hook(tb_step_hook hook, void *ctx) {
+	step_hook = hook;
+	step_hook_ctx = ctx;
 }
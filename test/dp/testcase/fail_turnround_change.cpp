@@ -31,7 +31,7 @@ int main() {
 	// Line reset should bring it back.
 	swd_line_reset(t);
 	status = swd_read(t, DP, DP_REG_DPIDR, dpidr);
-	tb_assert(status == OK && dpidr == DPIDR_EXPECTED, "Should get good DPIDR readback after reset\n");
+	tb_assert(status == OK && swd_dpidr_ok(dpidr), "Should get good DPIDR readback after reset\n");
 
 	return 0;
 }
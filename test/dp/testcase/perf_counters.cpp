@@ -0,0 +1,91 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check the implementation-defined performance counters in DP
+// banks 0x8 to 0xd count OK and WAIT responses and AP reads/writes, and are
+// cleared by a write. Skip if the DP was built without them.
+
+static int read_delay = 0;
+
+ap_read_response read_callback(uint16_t addr) {
+	return {
+		.rdata = 0x1234u + addr,
+		.delay_cycles = read_delay,
+		.err = false
+	};
+}
+
+ap_write_response write_callback(uint16_t addr, uint32_t data) {
+	return {
+		.delay_cycles = 0,
+		.err = false
+	};
+}
+
+static uint32_t read_counter(tb &t, int bank) {
+	swd_status_t status = swd_write(t, DP, DP_REG_SELECT, bank);
+	tb_assert(status == OK, "SELECT write failed\n");
+	uint32_t data;
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK, "Counter read failed\n");
+	return data;
+}
+
+int main() {
+	tb t("waves.vcd");
+	t.set_ap_read_callback(read_callback);
+	t.set_ap_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+
+	// Clear all counters. The OK for this write comes before the clear.
+	(void)swd_write(t, DP, DP_REG_SELECT, DP_BANK_PERF_ACK_OK);
+	status = swd_write(t, DP, DP_REG_CTRL_STAT, 0);
+	tb_assert(status == OK, "Counter clear write failed\n");
+
+	uint32_t data;
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(data == 0, "OK counter should read 0 after clear, got %u\n", data);
+	// That read counted one OK, as will the next access
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	if (status == OK && data == 0) {
+		printf("No performance counters, skipping\n");
+		return 0;
+	}
+	tb_assert(data == 1, "Expected 1 OK, got %u\n", data);
+
+	// SELECT (OK) + 3 AP reads + 2 AP writes, all OK
+	(void)swd_write(t, DP, DP_REG_SELECT, DP_BANK_PERF_ACK_OK);
+	for (int i = 0; i < 3; ++i)
+		(void)swd_read(t, AP, 0, data);
+	for (int i = 0; i < 2; ++i)
+		(void)swd_write(t, AP, 0, i);
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(data == 8, "Expected 8 OKs, got %u\n", data);
+	tb_assert(read_counter(t, DP_BANK_PERF_AP_READS) == 3, "Expected 3 AP reads\n");
+	tb_assert(read_counter(t, DP_BANK_PERF_AP_WRITES) == 2, "Expected 2 AP writes\n");
+	tb_assert(read_counter(t, DP_BANK_PERF_ACK_WAIT) == 0, "Expected no WAITs yet\n");
+
+	// Stall an AP read, and collect two WAITs on it
+	read_delay = 100;
+	(void)swd_read(t, AP, 0, data);
+	read_delay = 0;
+	for (int i = 0; i < 2; ++i) {
+		status = swd_read(t, DP, DP_REG_RDBUF, data);
+		tb_assert(status == WAIT, "Should WAIT on stalled AP read\n");
+	}
+	idle_clocks(t, 100);
+	tb_assert(read_counter(t, DP_BANK_PERF_ACK_WAIT) == 2, "Expected 2 WAITs\n");
+	tb_assert(read_counter(t, DP_BANK_PERF_ACK_FAULT) == 0, "Expected no FAULTs\n");
+	tb_assert(read_counter(t, DP_BANK_PERF_PROTOCOL_ERR) == 0, "Expected no protocol errors\n");
+
+	// Clear through a different counter bank, and check everything cleared
+	status = swd_write(t, DP, DP_REG_CTRL_STAT, 0);
+	tb_assert(status == OK, "Counter clear write failed\n");
+	tb_assert(read_counter(t, DP_BANK_PERF_ACK_WAIT) == 0, "WAIT count not cleared\n");
+	tb_assert(read_counter(t, DP_BANK_PERF_AP_READS) == 0, "AP read count not cleared\n");
+	tb_assert(read_counter(t, DP_BANK_PERF_AP_WRITES) == 0, "AP write count not cleared\n");
+
+	return 0;
+}
@@ -0,0 +1,61 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: use pushed-compare with a large TRNCNT to poll an AP register
+// until it holds an expected value. Check the DP WAITs during the sequence,
+// stops polling on the first match, and leaves the remaining count in TRNCNT.
+
+static int n_reads = 0;
+
+ap_read_response read_callback(uint16_t addr) {
+	++n_reads;
+	return {
+		// Expected value in the low byte after 5 misses, junk above.
+		.rdata = n_reads > 5 ? 0xcafe00a5u : 0xcafe0000u + n_reads,
+		.delay_cycles = 10,
+		.err = false
+	};
+}
+
+const uint32_t MASK_PWRUPREQ = DP_CTRL_STAT_CSYSPWRUPREQ | DP_CTRL_STAT_CDBGPWRUPREQ;
+
+int main() {
+	tb t("waves.vcd");
+	t.set_ap_read_callback(read_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	if (!swd_dp_has_pushed_ops(t)) {
+		printf("DP is MINDP, skipping\n");
+		return 0;
+	}
+
+	const uint32_t trncnt = 100;
+	status = swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ |
+		trncnt << DP_CTRL_STAT_TRNCNT_LSB |
+		0x1u << DP_CTRL_STAT_MASKLANE_LSB |
+		DP_CTRL_STAT_TRNMODE_PUSHED_COMPARE);
+	tb_assert(status == OK, "Failed to write CTRL/STAT\n");
+
+	status = swd_write(t, AP, 3, 0x000000a5u);
+	tb_assert(status == OK, "Pushed compare should give OK\n");
+
+	uint32_t data;
+	status = swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(status == WAIT, "Should WAIT while TRNCNT sequence is running\n");
+
+	idle_clocks(t, 100);
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK, "Should never get FAULT on CTRL/STAT read\n");
+	tb_assert(data & DP_CTRL_STAT_STICKYCMP, "STICKYCMP should be set on match\n");
+	tb_assert(n_reads == 6, "Expected polling to stop after 6 reads, got %d\n", n_reads);
+	tb_assert((data & DP_CTRL_STAT_TRNCNT) >> DP_CTRL_STAT_TRNCNT_LSB == trncnt - 5,
+		"Bad TRNCNT remaining: %u\n", (data & DP_CTRL_STAT_TRNCNT) >> DP_CTRL_STAT_TRNCNT_LSB);
+
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_STKCMPCLR);
+	(void)swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ);
+	(void)swd_read(t, DP, DP_REG_RDBUF, data);
+	tb_assert(data == 0xcafe00a5u, "RDBUFF should hold the matching read data, got %08x\n", data);
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include "tb.h"
+#include <cstdio>
+
+// Test intent: check that pushed-verify turns AP writes into AP reads, sets
+// STICKYCMP only on a mismatch under MASKLANE, and that STICKYCMP causes AP
+// accesses to FAULT until it is cleared via ABORT.
+
+static uint32_t read_value;
+static int n_reads = 0;
+static int n_writes = 0;
+
+ap_read_response read_callback(uint16_t addr) {
+	++n_reads;
+	return {
+		.rdata = read_value,
+		.delay_cycles = 0,
+		.err = false
+	};
+}
+
+ap_write_response write_callback(uint16_t addr, uint32_t data) {
+	++n_writes;
+	return {
+		.delay_cycles = 0,
+		.err = false
+	};
+}
+
+const uint32_t MASK_PWRUPREQ = DP_CTRL_STAT_CSYSPWRUPREQ | DP_CTRL_STAT_CDBGPWRUPREQ;
+
+int main() {
+	tb t("waves.vcd");
+	t.set_ap_read_callback(read_callback);
+	t.set_ap_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	if (!swd_dp_has_pushed_ops(t)) {
+		printf("DP is MINDP, skipping\n");
+		return 0;
+	}
+
+	status = swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ |
+		0xfu << DP_CTRL_STAT_MASKLANE_LSB | DP_CTRL_STAT_TRNMODE_PUSHED_VERIFY);
+	tb_assert(status == OK, "Failed to write CTRL/STAT\n");
+
+	read_value = 0x12345678u;
+	status = swd_write(t, AP, 0, 0x12345678u);
+	tb_assert(status == OK, "Pushed verify should give OK\n");
+	idle_clocks(t, 5);
+	uint32_t data;
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(!(data & DP_CTRL_STAT_STICKYCMP), "STICKYCMP set on matching verify\n");
+	tb_assert(n_reads == 1 && n_writes == 0, "Pushed write should become one AP read (%d, %d)\n",
+		n_reads, n_writes);
+
+	status = swd_write(t, AP, 0, 0x12345679u);
+	tb_assert(status == OK, "Pushed verify should give OK\n");
+	idle_clocks(t, 5);
+	status = swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(status == OK, "Should never get FAULT on CTRL/STAT read\n");
+	tb_assert(data & DP_CTRL_STAT_STICKYCMP, "STICKYCMP not set on mismatching verify\n");
+	tb_assert(!(data & (DP_CTRL_STAT_STICKYERR | DP_CTRL_STAT_WDATAERR | DP_CTRL_STAT_STICKYORUN)),
+		"No other sticky flags should be set.\n");
+
+	status = swd_write(t, AP, 0, 0x12345678u);
+	tb_assert(status == FAULT, "AP access with STICKYCMP set should FAULT\n");
+	tb_assert(n_reads == 2, "FAULTed access should not reach the AP\n");
+
+	(void)swd_write(t, DP, DP_REG_ABORT, DP_ABORT_STKCMPCLR);
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(!(data & DP_CTRL_STAT_STICKYCMP), "STICKYCMP should be cleared by ABORT\n");
+
+	// Ignore byte lane 0, and the same mismatch now passes.
+	status = swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ |
+		0xeu << DP_CTRL_STAT_MASKLANE_LSB | DP_CTRL_STAT_TRNMODE_PUSHED_VERIFY);
+	status = swd_write(t, AP, 0, 0x123456ffu);
+	tb_assert(status == OK, "Pushed verify should give OK\n");
+	idle_clocks(t, 5);
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(!(data & DP_CTRL_STAT_STICKYCMP), "STICKYCMP set on mismatch in masked lane\n");
+
+	// Back to normal mode, writes are writes again.
+	(void)swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ);
+	status = swd_write(t, AP, 0, 0x0u);
+	idle_clocks(t, 5);
+	tb_assert(status == OK && n_writes == 1 && n_reads == 3, "Bad access counts after pushed mode\n");
+
+	return 0;
+}
@@ -1,7 +1,10 @@
 #include "tb.h"
 #include <cstdio>
 
-// Test intent: hello world
+// Test intent: hello world. Also check DPIDR.MIN matches the DP
+// configuration: TRNMODE is writable only in a full (non-MINDP) DP.
+
+const uint32_t MASK_PWRUPREQ = DP_CTRL_STAT_CSYSPWRUPREQ | DP_CTRL_STAT_CDBGPWRUPREQ;
 
 int main() {
 	tb t("waves.vcd");
@@ -11,6 +14,16 @@ int main() {
 	uint32_t id;
 	swd_status_t status = swd_read(t, DP, DP_REG_DPIDR, id);
 	tb_assert(status == OK, "Bad status: %d\n", (int)status);
-	tb_assert(id == DPIDR_EXPECTED, "Bad DPIDR: %08x\n", id);
+	tb_assert(swd_dpidr_ok(id), "Bad DPIDR: %08x\n", id);
+
+	status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	uint32_t data;
+	(void)swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ | DP_CTRL_STAT_TRNMODE_PUSHED_VERIFY);
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	(void)swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ);
+	bool full_dp = (data & DP_CTRL_STAT_TRNMODE) == DP_CTRL_STAT_TRNMODE_PUSHED_VERIFY;
+	tb_assert(full_dp == !(id & DPIDR_MIN), "DPIDR.MIN is %d, but TRNMODE is%s writable\n",
+		!!(id & DPIDR_MIN), full_dp ? "" : " not");
 	return 0;
 }
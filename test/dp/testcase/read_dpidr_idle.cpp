@@ -13,6 +13,6 @@ int main() {
 	uint32_t id;
 	swd_status_t status = swd_read(t, DP, DP_REG_DPIDR, id);
 	tb_assert(status == OK, "Bad status: %d\n", (int)status);
-	tb_assert(id == DPIDR_EXPECTED, "Bad DPIDR: %08x\n", id);
+	tb_assert(swd_dpidr_ok(id), "Bad DPIDR: %08x\n", id);
 	return 0;
 }
@@ -51,7 +51,7 @@ int main() {
 		"Repeated RESEND of same data should succeed\n");
 
 	status = swd_read(t, DP, DP_REG_DPIDR, data);
-	tb_assert(status == OK && data == DPIDR_EXPECTED, "Bad DPIDR read after RESEND\n");
+	tb_assert(status == OK && swd_dpidr_ok(data), "Bad DPIDR read after RESEND\n");
 	status = swd_read(t, DP, DP_REG_RESEND, data);
 	tb_assert(status == DISCONNECTED, "RESEND after DPIDR should cause a protocol error\n");
 
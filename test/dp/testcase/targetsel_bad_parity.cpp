@@ -37,7 +37,7 @@ int main() {
 	swd_line_reset(t);
 	swd_targetsel(t, TARGETID_EXPECTED & 0x0fffffffu);
 	status = swd_read(t, DP, 0, id);
-	tb_assert(status == OK && id == DPIDR_EXPECTED, "Couldn't reconnect after bad TARGETSEL\n");
+	tb_assert(status == OK && swd_dpidr_ok(id), "Couldn't reconnect after bad TARGETSEL\n");
 
 	uint32_t stat;
 	status = swd_read(t, DP, 1, stat);
@@ -14,7 +14,7 @@ int main() {
 		swd_targetsel(t, (TARGETID_EXPECTED & 0x0fffffffu) | (uint32_t)i << 28);
 		uint32_t id;
 		swd_status_t status = swd_read(t, DP, 0, id);
-		tb_assert(status == OK && id == DPIDR_EXPECTED, "Failed to select with instid %d\n", i);
+		tb_assert(status == OK && swd_dpidr_ok(id), "Failed to select with instid %d\n", i);
 	}
 
 	swd_line_reset(t);
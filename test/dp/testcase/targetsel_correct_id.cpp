@@ -11,6 +11,6 @@ int main() {
 	swd_targetsel(t, TARGETID_EXPECTED & 0x0fffffffu);
 	uint32_t id;
 	swd_status_t status = swd_read(t, DP, 0, id);
-	tb_assert(status == OK && id == DPIDR_EXPECTED, "Bad DPIDR read after TARGETSEL\n");
+	tb_assert(status == OK && swd_dpidr_ok(id), "Bad DPIDR read after TARGETSEL\n");
 	return 0;
 }
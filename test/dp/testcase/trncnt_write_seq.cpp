@@ -0,0 +1,67 @@
+#include "tb.h"
+#include <cstdio>
+#include <vector>
+
+// Test intent: check that an AP write with nonzero TRNCNT is repeated TRNCNT
+// more times with the same address and data, that TRNCNT counts down to
+// zero, and that an AP error stops the sequence early.
+
+std::vector<uint64_t> write_history;
+static int fail_after = -1;
+
+ap_write_response write_callback(uint16_t addr, uint32_t data) {
+	write_history.push_back((uint64_t)addr << 32 | data);
+	return {
+		.delay_cycles = 2,
+		.err = (int)write_history.size() == fail_after
+	};
+}
+
+const uint32_t MASK_PWRUPREQ = DP_CTRL_STAT_CSYSPWRUPREQ | DP_CTRL_STAT_CDBGPWRUPREQ;
+
+int main() {
+	tb t("waves.vcd");
+	t.set_ap_write_callback(write_callback);
+
+	swd_status_t status = swd_prepare_dp_for_ap_access(t);
+	tb_assert(status == OK, "Failed to connect to DP\n");
+	if (!swd_dp_has_pushed_ops(t)) {
+		printf("DP is MINDP, skipping\n");
+		return 0;
+	}
+
+	const uint32_t trncnt = 7;
+	const uint32_t magic = 0x600dcafeu;
+	(void)swd_write(t, DP, DP_REG_SELECT, 0x5u << 24 | 0x3u << 4);
+	(void)swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ | trncnt << DP_CTRL_STAT_TRNCNT_LSB);
+	status = swd_write(t, AP, 1, magic);
+	tb_assert(status == OK, "Write should give OK\n");
+	idle_clocks(t, 50);
+
+	tb_assert(write_history.size() == trncnt + 1, "Expected %u writes, got %lu\n",
+		trncnt + 1, write_history.size());
+	for (size_t i = 0; i < write_history.size(); ++i) {
+		tb_assert(write_history[i] == ((uint64_t)(0x5u << 6 | 0x3u << 2 | 1u) << 32 | magic),
+			"Bad repeated write %lu: %012lx\n", i, write_history[i]);
+	}
+
+	uint32_t data;
+	(void)swd_write(t, DP, DP_REG_SELECT, DP_BANK_CTRL_STAT);
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(!(data & DP_CTRL_STAT_TRNCNT), "TRNCNT should have reached 0\n");
+
+	// Error on the third write: sequence stops and the count is left behind.
+	write_history.clear();
+	fail_after = 3;
+	(void)swd_write(t, DP, DP_REG_CTRL_STAT, MASK_PWRUPREQ | trncnt << DP_CTRL_STAT_TRNCNT_LSB);
+	(void)swd_write(t, AP, 1, magic);
+	idle_clocks(t, 50);
+	tb_assert(write_history.size() == 3, "Expected sequence to stop after 3 writes, got %lu\n",
+		write_history.size());
+	(void)swd_read(t, DP, DP_REG_CTRL_STAT, data);
+	tb_assert(data & DP_CTRL_STAT_STICKYERR, "STICKYERR should be set\n");
+	tb_assert((data & DP_CTRL_STAT_TRNCNT) >> DP_CTRL_STAT_TRNCNT_LSB == trncnt - 2,
+		"Bad TRNCNT remaining\n");
+
+	return 0;
+}
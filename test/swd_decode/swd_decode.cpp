@@ -0,0 +1,570 @@
+// Offline SWD decoder for large captures: VCD files (e.g. from the CXXRTL
+// testbenches, or exported from a logic analyser) and raw logic analyser
+// sample dumps.
+//
+// The input is memory-mapped and read once, front to back. Pages behind the
+// read pointer are dropped as it goes, so resident memory stays small however
+// large the capture is. SWDIO is sampled at every SWCLK rising edge, using
+// its value from just before the edge, and the bit stream is decoded by
+// swd_monitor, the same decoder the testbenches use. Output is the monitor's
+// JSON lines (with a "time" field, in VCD timescale units or raw sample
+// indices) or binary records, followed by a summary on stderr.
+//
+// VCD: SWCLK and SWDIO are found by name. SWDIO can be a single signal, or
+// the testbench's swdi/swdo/swdo_en, in which case the line is swdo when
+// swdo_en is high, else swdi. A name without dots matches a signal of that
+// name in the shallowest scope it appears in; a dotted name must match the
+// full hierarchical path. z reads as 1 (SWDIO has a pull-up); x leaves the
+// previous value in place.
+//
+// Raw: packed samples of 1, 2 or 4 bytes (little-endian), as written by
+// sigrok's "binary" output format, with SWCLK and SWDIO on given bit
+// positions. Single-byte samples are scanned 64 at a time with SSE2 (or
+// AVX2), so runs of samples without a SWCLK rising edge cost a few
+// instructions per 64 samples.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "swd_monitor.h"
+
+// ----------------------------------------------------------------------------
+// Input file
+
+// Pages behind the read pointer are released in steps of this size
+static const size_t release_step = 64u << 20;
+
+class mapped_file {
+public:
+	mapped_file() : base(nullptr), size(0), released(0) {}
+	~mapped_file() {
+		if (base)
+			munmap((void*)base, size);
+	}
+
+	bool open(const char *path) {
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
+			return false;
+		}
+		size = st.st_size;
+		void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (p == MAP_FAILED)
+			return false;
+		base = (const uint8_t*)p;
+		madvise(p, size, MADV_SEQUENTIAL);
+		return true;
+	}
+
+	// Called as parsing progresses, with the offset that has been consumed
+	void release_before(size_t offset) {
+		if (offset < released + release_step)
+			return;
+		size_t page = sysconf(_SC_PAGESIZE);
+		size_t end = offset & ~(page - 1);
+		madvise((void*)(base + released), end - released, MADV_DONTNEED);
+		released = end;
+	}
+
+	const uint8_t *base;
+	size_t size;
+
+private:
+	size_t released;
+};
+
+// ----------------------------------------------------------------------------
+// Edge sink: SWCLK edge timestamps, and the monitor
+
+// Must cover the longest span between the first bit of a record and the
+// edge on which it is emitted. A packet is under 50 cycles; a malformed
+// header can be held back for 16 more.
+static const uint64_t time_ring_size = 1u << 16;
+
+class edge_sink {
+public:
+	edge_sink(swd_monitor &m) : mon(m), times(time_ring_size), edges(0), first_time(0), last_time(0) {
+		mon.set_time_source(time_of_cycle, this);
+	}
+
+	void edge(bool swdio, uint64_t time) {
+		if (edges++ == 0)
+			first_time = time;
+		last_time = time;
+		times[mon.cycles & (time_ring_size - 1)] = time;
+		mon.clock(swdio);
+	}
+
+	swd_monitor &mon;
+	std::vector<uint64_t> times;
+	uint64_t edges;
+	uint64_t first_time;
+	uint64_t last_time;
+
+private:
+	static uint64_t time_of_cycle(void *ctx, uint64_t cycle) {
+		return static_cast<edge_sink*>(ctx)->times[cycle & (time_ring_size - 1)];
+	}
+};
+
+// ----------------------------------------------------------------------------
+// VCD
+
+enum {
+	SIG_CLK,
+	SIG_DIO,
+	SIG_DI,
+	SIG_DO,
+	SIG_OE,
+	N_SIGS
+};
+
+struct vcd_signal {
+	std::string spec;   // Name to look for, empty if unused
+	std::string id;     // Identifier code, once found
+	int depth;          // Scope depth of the match, -1 if not found
+	bool value;
+};
+
+static bool is_space(uint8_t c) {
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+class vcd_parser {
+public:
+	vcd_parser(mapped_file &f) : file(f), p(f.base), end(f.base + f.size) {}
+
+	bool token(const uint8_t *&start, size_t &len) {
+		while (p < end && is_space(*p))
+			++p;
+		if (p >= end)
+			return false;
+		start = p;
+		while (p < end && !is_space(*p))
+			++p;
+		len = p - start;
+		return true;
+	}
+
+	bool token(std::string &s) {
+		const uint8_t *start;
+		size_t len;
+		if (!token(start, len))
+			return false;
+		s.assign((const char*)start, len);
+		return true;
+	}
+
+	void skip_to_end_keyword() {
+		std::string s;
+		while (token(s) && s != "$end")
+			;
+	}
+
+	// Declarations, up to $enddefinitions. Returns false if the file ends first.
+	bool parse_header(vcd_signal *sigs, std::string &timescale) {
+		std::vector<std::string> scope;
+		std::string s;
+		while (token(s)) {
+			if (s == "$enddefinitions") {
+				skip_to_end_keyword();
+				return true;
+			} else if (s == "$scope") {
+				std::string kind, name;
+				token(kind);
+				token(name);
+				scope.push_back(name);
+				skip_to_end_keyword();
+			} else if (s == "$upscope") {
+				if (!scope.empty())
+					scope.pop_back();
+				skip_to_end_keyword();
+			} else if (s == "$timescale") {
+				timescale.clear();
+				while (token(s) && s != "$end")
+					timescale += s;
+			} else if (s == "$var") {
+				std::string type, width, id, ref;
+				token(type);
+				token(width);
+				token(id);
+				token(ref);
+				skip_to_end_keyword();
+				std::string path;
+				for (const std::string &sc : scope)
+					path += sc + ".";
+				path += ref;
+				for (int i = 0; i < N_SIGS; ++i) {
+					vcd_signal &sig = sigs[i];
+					if (sig.spec.empty() || width != "1")
+						continue;
+					bool dotted = sig.spec.find('.') != std::string::npos;
+					bool match = dotted ? path == sig.spec : ref == sig.spec;
+					int depth = (int)scope.size();
+					if (match && (sig.depth < 0 || depth < sig.depth)) {
+						sig.id = id;
+						sig.depth = depth;
+					}
+				}
+			} else if (s[0] == '$') {
+				skip_to_end_keyword();
+			}
+		}
+		return false;
+	}
+
+	// Value changes, calling out on every SWCLK rising edge
+	void parse_body(vcd_signal *sigs, edge_sink &sink) {
+		const bool split = sigs[SIG_DIO].depth < 0;
+		// -1: unknown, so the first value seen is not an edge
+		int clk = -1;
+		bool line_before = true;
+		uint64_t time = 0;
+		const uint8_t *start;
+		size_t len;
+		while (token(start, len)) {
+			file.release_before(start - file.base);
+			uint8_t c = start[0];
+			int value;
+			const uint8_t *id;
+			size_t id_len;
+			if (c == '#') {
+				// Value of SWDIO going into this timestep, for any edge in it
+				line_before = split ?
+					(sigs[SIG_OE].value ? sigs[SIG_DO].value : sigs[SIG_DI].value) : sigs[SIG_DIO].value;
+				time = 0;
+				for (size_t i = 1; i < len && start[i] >= '0' && start[i] <= '9'; ++i)
+					time = time * 10 + (start[i] - '0');
+				continue;
+			} else if (c == '0' || c == '1') {
+				value = c - '0';
+				id = start + 1;
+				id_len = len - 1;
+			} else if (c == 'z' || c == 'Z') {
+				value = 1;
+				id = start + 1;
+				id_len = len - 1;
+			} else if (c == 'x' || c == 'X') {
+				continue;
+			} else if (c == 'b' || c == 'B') {
+				uint8_t last = start[len - 1];
+				if (!token(id, id_len))
+					break;
+				if (last == 'x' || last == 'X')
+					continue;
+				value = last != '0';
+			} else if (c == 'r' || c == 'R') {
+				if (!token(id, id_len))
+					break;
+				continue;
+			} else if (len == 8 && !memcmp(start, "$comment", 8)) {
+				skip_to_end_keyword();
+				continue;
+			} else {
+				// $dumpvars, $end and friends
+				continue;
+			}
+
+			for (int i = 0; i < N_SIGS; ++i) {
+				vcd_signal &sig = sigs[i];
+				if (sig.depth < 0 || sig.id.size() != id_len || memcmp(sig.id.data(), id, id_len))
+					continue;
+				if (i == SIG_CLK) {
+					if (clk == 0 && value)
+						sink.edge(line_before, time);
+					clk = value;
+				}
+				sig.value = value;
+			}
+		}
+	}
+
+private:
+	mapped_file &file;
+	const uint8_t *p;
+	const uint8_t *end;
+};
+
+// ----------------------------------------------------------------------------
+// Raw sample dumps
+
+class raw_scanner {
+public:
+	raw_scanner(mapped_file &f, int unit, int clk_bit, int dio_bit) :
+		file(f), unit(unit), clk_bit(clk_bit), dio_bit(dio_bit) {}
+
+	void scan(edge_sink &sink) {
+		const uint8_t *p = file.base;
+		uint64_t n_samples = file.size / unit;
+		if (n_samples == 0)
+			return;
+		// Sample 0 has nothing before it to make an edge
+		uint64_t prev_clk = bit(p, 0, clk_bit);
+		uint64_t prev_dio = bit(p, 0, dio_bit);
+		for (uint64_t s = 0; s < n_samples; s += 64) {
+			int n = n_samples - s < 64 ? (int)(n_samples - s) : 64;
+			const uint8_t *block = p + s * unit;
+			uint64_t clk, dio;
+			if (unit == 1 && n == 64) {
+				clk = level_mask_64(block, clk_bit);
+				dio = level_mask_64(block, dio_bit);
+			} else {
+				clk = dio = 0;
+				for (int i = 0; i < n; ++i) {
+					clk |= bit(block, i, clk_bit) << i;
+					dio |= bit(block, i, dio_bit) << i;
+				}
+			}
+			// Rising edges, and SWDIO on the sample before each one
+			uint64_t rise = clk & ~(clk << 1 | prev_clk);
+			uint64_t dio_before = dio << 1 | prev_dio;
+			while (rise) {
+				int i = __builtin_ctzll(rise);
+				sink.edge((dio_before >> i) & 1u, s + i);
+				rise &= rise - 1;
+			}
+			prev_clk = (clk >> (n - 1)) & 1u;
+			prev_dio = (dio >> (n - 1)) & 1u;
+			file.release_before((s + n) * unit);
+		}
+	}
+
+private:
+	uint64_t bit(const uint8_t *block, int sample, int b) const {
+		return (block[sample * unit + b / 8] >> (b % 8)) & 1u;
+	}
+
+	// Bit i of the result is bit b of byte i
+	static uint64_t level_mask_64(const uint8_t *block, int b) {
+#if defined(__AVX2__)
+		const __m256i m = _mm256_set1_epi8((char)(1u << b));
+		uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+			_mm256_and_si256(_mm256_loadu_si256((const __m256i*)block), m), m));
+		uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+			_mm256_and_si256(_mm256_loadu_si256((const __m256i*)(block + 32)), m), m));
+		return lo | hi << 32;
+#elif defined(__SSE2__)
+		const __m128i m = _mm_set1_epi8((char)(1u << b));
+		uint64_t mask = 0;
+		for (int i = 0; i < 4; ++i) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+			mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, m), m)) << (16 * i);
+		}
+		return mask;
+#else
+		// Shift the wanted bit of each byte to its MSB, then gather the MSBs
+		// of eight bytes at a time with a multiply.
+		uint64_t mask = 0;
+		for (int i = 0; i < 8; ++i) {
+			uint64_t w;
+			memcpy(&w, block + 8 * i, 8);
+			w = (w >> b) & 0x0101010101010101ull;
+			mask |= ((w * 0x0102040810204080ull) >> 56) << (8 * i);
+		}
+		return mask;
+#endif
+	}
+
+	mapped_file &file;
+	int unit;
+	int clk_bit;
+	int dio_bit;
+};
+
+// ----------------------------------------------------------------------------
+// Main
+
+static void usage(const char *argv0) {
+	fprintf(stderr,
+		"Usage: %s [options] capture\n"
+		"\n"
+		"Decode SWD traffic from a VCD file or a raw logic analyser dump.\n"
+		"\n"
+		"  -o path          Write decoded records here (default: stdout, \"-\")\n"
+		"  -f jsonl|binary|none\n"
+		"                   Record format (default: jsonl)\n"
+		"  -e               Only log FAULTs, missing ACKs, parity and protocol errors\n"
+		"  -q               No summary\n"
+		"  --active         The capture starts with the link already in SWD mode, so\n"
+		"                   decode from the first line reset (default: start in\n"
+		"                   Dormant, and wait for the Dormant-to-SWD sequence)\n"
+		"\n"
+		"VCD input (default):\n"
+		"  --swclk name     SWCLK signal (default: swclk)\n"
+		"  --swdio name     SWDIO signal (default: swdio, or else swdi/swdo/swdo_en)\n"
+		"  --swdi name, --swdo name, --swdo-en name\n"
+		"                   Split SWDIO, as in the testbenches\n"
+		"\n"
+		"Raw input:\n"
+		"  --raw            Input is packed samples, not VCD\n"
+		"  --unit n         Bytes per sample: 1, 2 or 4 (default: 1)\n"
+		"  --clk-bit n      Bit position of SWCLK in each sample (default: 0)\n"
+		"  --dio-bit n      Bit position of SWDIO in each sample (default: 1)\n"
+		"  --rate hz        Sample rate, for the summary only\n",
+		argv0);
+}
+
+int main(int argc, char **argv) {
+	const char *in_path = nullptr;
+	const char *out_path = "-";
+	swd_log_format fmt = SWD_LOG_JSONL;
+	bool errors_only = false;
+	bool quiet = false;
+	bool active = false;
+	bool raw = false;
+	int unit = 1;
+	int clk_bit = 0;
+	int dio_bit = 1;
+	double rate = 0;
+	vcd_signal sigs[N_SIGS];
+	const char *default_names[N_SIGS] = {"swclk", "swdio", "swdi", "swdo", "swdo_en"};
+	for (int i = 0; i < N_SIGS; ++i) {
+		sigs[i].spec = default_names[i];
+		sigs[i].depth = -1;
+		sigs[i].value = true;
+	}
+
+	for (int i = 1; i < argc; ++i) {
+		std::string a = argv[i];
+		bool has_arg = i + 1 < argc;
+		if (a == "-o" && has_arg) {
+			out_path = argv[++i];
+		} else if (a == "-f" && has_arg) {
+			std::string f = argv[++i];
+			if (f == "jsonl")
+				fmt = SWD_LOG_JSONL;
+			else if (f == "binary")
+				fmt = SWD_LOG_BINARY;
+			else if (f == "none")
+				fmt = SWD_LOG_NONE;
+			else {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (a == "-e") {
+			errors_only = true;
+		} else if (a == "-q") {
+			quiet = true;
+		} else if (a == "--active") {
+			active = true;
+		} else if (a == "--swclk" && has_arg) {
+			sigs[SIG_CLK].spec = argv[++i];
+		} else if (a == "--swdio" && has_arg) {
+			sigs[SIG_DIO].spec = argv[++i];
+		} else if (a == "--swdi" && has_arg) {
+			sigs[SIG_DI].spec = argv[++i];
+			sigs[SIG_DIO].spec.clear();
+		} else if (a == "--swdo" && has_arg) {
+			sigs[SIG_DO].spec = argv[++i];
+			sigs[SIG_DIO].spec.clear();
+		} else if (a == "--swdo-en" && has_arg) {
+			sigs[SIG_OE].spec = argv[++i];
+			sigs[SIG_DIO].spec.clear();
+		} else if (a == "--raw") {
+			raw = true;
+		} else if (a == "--unit" && has_arg) {
+			unit = atoi(argv[++i]);
+		} else if (a == "--clk-bit" && has_arg) {
+			clk_bit = atoi(argv[++i]);
+		} else if (a == "--dio-bit" && has_arg) {
+			dio_bit = atoi(argv[++i]);
+		} else if (a == "--rate" && has_arg) {
+			rate = atof(argv[++i]);
+		} else if (a[0] != '-' && !in_path) {
+			in_path = argv[i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!in_path || (unit != 1 && unit != 2 && unit != 4) ||
+			clk_bit < 0 || clk_bit >= 8 * unit || dio_bit < 0 || dio_bit >= 8 * unit) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	mapped_file file;
+	if (!file.open(in_path)) {
+		fprintf(stderr, "Can't map %s\n", in_path);
+		return 1;
+	}
+
+	if (fmt != SWD_LOG_NONE && strcmp(out_path, "-")) {
+		FILE *f = fopen(out_path, "w");
+		if (!f) {
+			fprintf(stderr, "Can't open %s\n", out_path);
+			return 1;
+		}
+		fclose(f);
+	}
+	swd_monitor mon(out_path, fmt);
+	mon.log_errors_only = errors_only;
+	if (active)
+		mon.start_active();
+	edge_sink sink(mon);
+	std::string timescale = "samples";
+	auto t0 = std::chrono::steady_clock::now();
+
+	if (raw) {
+		raw_scanner scanner(file, unit, clk_bit, dio_bit);
+		scanner.scan(sink);
+	} else {
+		vcd_parser parser(file);
+		if (!parser.parse_header(sigs, timescale)) {
+			fprintf(stderr, "%s: no $enddefinitions\n", in_path);
+			return 1;
+		}
+		if (sigs[SIG_CLK].depth < 0) {
+			fprintf(stderr, "%s: no 1-bit signal called %s\n", in_path, sigs[SIG_CLK].spec.c_str());
+			return 1;
+		}
+		bool split = sigs[SIG_DIO].depth < 0;
+		if (split && (sigs[SIG_DI].depth < 0 || sigs[SIG_DO].depth < 0 || sigs[SIG_OE].depth < 0)) {
+			fprintf(stderr, "%s: no 1-bit SWDIO signal, and no %s/%s/%s\n", in_path,
+				sigs[SIG_DI].spec.c_str(), sigs[SIG_DO].spec.c_str(), sigs[SIG_OE].spec.c_str());
+			return 1;
+		}
+		// Only the signals in use take part in matching value changes
+		if (!split) {
+			for (int i = SIG_DI; i <= SIG_OE; ++i)
+				sigs[i].depth = -1;
+		}
+		parser.parse_body(sigs, sink);
+	}
+
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	if (!quiet) {
+		fprintf(stderr, "%s: %.1f MB in %.2f s (%.0f MB/s)\n", in_path,
+			file.size / 1e6, secs, secs > 0 ? file.size / 1e6 / secs : 0.0);
+		fprintf(stderr, "SWCLK rising edges: %llu, from %llu to %llu (%s)\n",
+			(unsigned long long)sink.edges, (unsigned long long)sink.first_time,
+			(unsigned long long)sink.last_time, timescale.c_str());
+		if (raw && rate > 0 && sink.edges > 1) {
+			double span = (sink.last_time - sink.first_time) / rate;
+			fprintf(stderr, "Mean SWCLK frequency: %.3f MHz\n", (sink.edges - 1) / span / 1e6);
+		}
+		mon.print_summary(stderr);
+		if (!active && mon.dormant_exits == 0)
+			fprintf(stderr, "No Dormant-to-SWD sequence seen: use --active if the capture starts in SWD mode\n");
+	}
+	return 0;
+}